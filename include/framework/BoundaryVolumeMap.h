@@ -0,0 +1,15 @@
+#pragma once
+
+#include "pch.h"
+
+// Part of the cubic spline kernel (support radius 1) that lies behind a flat wall at distance
+// q from the kernel center, for q in [0, 1]. A wall filled with fluid at rest density adds
+// rho0 times this volume to the density of a particle, so walls need no boundary particles.
+// Negative distances follow from the symmetry of the kernel, V(-q) = 1 - V(q).
+struct BoundaryVolumeMap
+{
+    std::vector<Vector2> samples; // at q = k / intervals: x volume V(q), y derivative dV/dq
+
+    // integrates the kernel over the half space numerically, steps sub-steps per interval
+    static BoundaryVolumeMap CubicHalfSpace(uint32_t intervals, uint32_t steps = 64);
+};
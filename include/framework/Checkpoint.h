@@ -0,0 +1,71 @@
+#pragma once
+
+#include "pch.h"
+#include "MappedFile.h"
+
+#include <string_view>
+
+// Restart file: a header, a table of tagged chunks, then the chunk data at 64-byte aligned
+// offsets. Readers skip chunks they do not know and reject files of a newer version.
+class Checkpoint
+{
+public:
+    static constexpr uint32_t k_version = 1;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t chunkCount;
+        uint64_t fileBytes;
+    };
+
+    struct Chunk
+    {
+        char tag[8];            // zero padded
+        uint64_t offset;        // from the start of the file
+        uint64_t bytes;
+        uint32_t elementStride; // 1 for unstructured data
+        uint32_t pad;
+    };
+
+    // a chunk to write, data has to stay valid until Write returns
+    struct Source
+    {
+        std::string_view tag; // at most 8 characters
+        const void *data;
+        uint64_t bytes;
+        uint32_t elementStride = 1;
+    };
+
+    // Writes <path>.tmp through a mapping, flushes it and renames it over path, so a crash
+    // leaves the previous checkpoint intact. Returns the file size; throws std::runtime_error.
+    static uint64_t Write(const std::filesystem::path &path, const std::vector<Source> &sources);
+
+    // maps the file read-only, chunk data is read in place; throws std::runtime_error
+    static std::unique_ptr<Checkpoint> Open(const std::filesystem::path &path);
+
+    // nullptr when the file has no such chunk
+    const Chunk *Find(std::string_view tag) const;
+    const uint8_t *GetData(const Chunk &chunk) const { return file.GetData() + chunk.offset; }
+    // copies a chunk of exactly sizeof(T), false when it is missing or has another size
+    template <typename T>
+    bool Read(std::string_view tag, T &out) const
+    {
+        const Chunk *chunk = Find(tag);
+        if (!chunk || chunk->bytes != sizeof(T))
+        {
+            return false;
+        }
+        memcpy(&out, GetData(*chunk), sizeof(T));
+        return true;
+    }
+
+    uint32_t GetVersion() const { return header.version; }
+    uint64_t GetFileBytes() const { return file.bytes; }
+
+private:
+    MappedFile file;
+    Header header = {};
+    std::vector<Chunk> chunks;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "pch.h"
+
+#include <iomanip>
+
+// Density residual of the PBF solver against accumulated GPU solver time,
+// averaged per iteration over all probed steps.
+class ConvergenceLog
+{
+public:
+    void AddSample(size_t iteration, double elapsedMs, float meanResidual, float maxResidual)
+    {
+        if (iteration >= rows.size())
+            rows.resize(iteration + 1);
+
+        Row &row = rows[iteration];
+        row.elapsedMs += elapsedMs;
+        row.meanResidual += meanResidual;
+        row.maxResidual += maxResidual;
+        row.samples++;
+    }
+
+    bool empty() const
+    {
+        return rows.empty();
+    }
+
+    void Print(std::ostream &os, const char *solverName) const
+    {
+        os << "\n=== Solver Convergence (" << solverName << ") ===\n";
+        os << std::setw(6) << "iter"
+           << std::setw(14) << "solver ms"
+           << std::setw(14) << "mean |C|"
+           << std::setw(14) << "max |C|" << "\n";
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            const Row &row = rows[i];
+            if (row.samples == 0)
+                continue;
+            double n = double(row.samples);
+            os << std::setw(6) << i + 1
+               << std::setw(14) << row.elapsedMs / n
+               << std::setw(14) << row.meanResidual / n
+               << std::setw(14) << row.maxResidual / n << "\n";
+        }
+        os << "====================================\n";
+    }
+
+private:
+    struct Row
+    {
+        double elapsedMs = 0.0;
+        double meanResidual = 0.0;
+        double maxResidual = 0.0;
+        size_t samples = 0;
+    };
+
+    std::vector<Row> rows;
+};
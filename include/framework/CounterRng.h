@@ -0,0 +1,35 @@
+#pragma once
+
+#include "pch.h"
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"): four random
+// words from a 128-bit counter under a 64-bit key. There is no state to advance, so every
+// thread draws the numbers of any item directly and results do not depend on scheduling.
+class CounterRng
+{
+public:
+    explicit CounterRng(uint64_t seed) : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+
+    std::array<uint32_t, 4> Generate(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3) const
+    {
+        std::array<uint32_t, 4> counter = {c0, c1, c2, c3};
+        uint32_t k0 = key[0];
+        uint32_t k1 = key[1];
+        for (int round = 0; round < 10; ++round)
+        {
+            const uint64_t product0 = uint64_t(0xD2511F53u) * counter[0];
+            const uint64_t product1 = uint64_t(0xCD9E8D57u) * counter[2];
+            counter = {static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ k0, static_cast<uint32_t>(product1),
+                       static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ k1, static_cast<uint32_t>(product0)};
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        return counter;
+    }
+
+    // [0, 1) from the top 24 bits
+    static float ToUnit(uint32_t bits) { return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f); }
+
+private:
+    uint32_t key[2];
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "pch.h"
+#include "Time.h"
+
+// Timestamp-query profiler for the simulation queue.
+// Marks and scopes are recorded per frame, resolved on the last command list
+// and read back once the frame fence has been reached.
+class GpuProfiler
+{
+public:
+    void Init(ID3D12Device *device, ID3D12CommandQueue *queue, UINT maxTimestamps = 1024);
+
+    // discards the marks of the previous frame
+    void BeginFrame();
+
+    // returned by Mark once the query heap of the frame is full
+    static constexpr UINT k_noMark = UINT_MAX;
+
+    // writes a timestamp, returns its index inside the current frame or k_noMark
+    UINT Mark(ID3D12GraphicsCommandList *cmdList);
+
+    void BeginScope(ID3D12GraphicsCommandList *cmdList, const char *name);
+    void EndScope(ID3D12GraphicsCommandList *cmdList);
+
+    // copies the frame timestamps into the readback buffer; record on the last command list of the frame
+    void Resolve(ID3D12GraphicsCommandList *cmdList);
+
+    // reads the resolved timestamps back and accumulates scope times; GPU must have finished the frame
+    void EndFrame();
+
+    // valid after EndFrame, 0 if one of the marks was dropped
+    double GetElapsedMs(UINT fromMark, UINT toMark) const;
+
+    void PrintReport(std::ostream &os) const;
+
+private:
+    struct OpenScope
+    {
+        const char *name;
+        UINT begin;
+    };
+
+    struct ClosedScope
+    {
+        const char *name;
+        UINT begin;
+        UINT end;
+    };
+
+    struct ScopeStats
+    {
+        std::string name;
+        TimeAccumulator executed; // ms per frame the scope ran in
+    };
+
+    winrt::com_ptr<ID3D12QueryHeap> m_queryHeap = nullptr;
+    winrt::com_ptr<ID3D12Resource> m_readback = nullptr;
+    UINT m_maxTimestamps = 0;
+    UINT m_used = 0;
+    size_t m_droppedMarks = 0; // marks refused because the heap was full, all frames
+    double m_msPerTick = 0.0;
+
+    std::vector<uint64_t> m_timestamps;
+    std::vector<OpenScope> m_openScopes;
+    std::vector<ClosedScope> m_closedScopes;
+    std::vector<ScopeStats> m_stats; // insertion order
+    size_t m_frames = 0;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "pch.h"
+
+// Terrain elevation raster (DEM). The source is converted once into a cache file of 64 x 64
+// float tiles next to it, which is then memory-mapped: a query only pages in the tiles around
+// it, and rasters larger than memory stay on disk. Rows run north to south, map y is north.
+class Heightfield
+{
+public:
+    // raw rasters carry no header: little-endian float32 rows from north to south
+    struct RawLayout
+    {
+        uint32_t cols = 0;
+        uint32_t rows = 0;
+        double cellSize = 1.0;
+        double minX = 0.0; // map position of the south-west sample
+        double minY = 0.0;
+        float noData = -9999.0f;
+    };
+
+    // .asc is read as an ESRI ASCII grid, anything else as a raw raster; the tile cache is
+    // rebuilt when the source changed. Throws std::runtime_error on unreadable input.
+    static std::unique_ptr<Heightfield> Open(const std::filesystem::path &path, const RawLayout &raw = {});
+
+    uint32_t GetCols() const { return header.cols; }
+    uint32_t GetRows() const { return header.rows; }
+    double GetCellSize() const { return header.cellSize; }
+    double GetMinX() const { return header.minX; }
+    double GetMinY() const { return header.minY; }
+    double GetMaxX() const { return header.minX + (header.cols - 1) * header.cellSize; }
+    double GetMaxY() const { return header.minY + (header.rows - 1) * header.cellSize; }
+    // over the valid samples, no-data samples read as the minimum
+    float GetMinHeight() const { return header.minHeight; }
+    float GetMaxHeight() const { return header.maxHeight; }
+    uint64_t GetCacheBytes() const { return cacheBytes; }
+    bool WasCacheRebuilt() const { return cacheRebuilt; }
+
+    float GetHeight(uint32_t col, uint32_t row) const;
+    // bilinear in map coordinates, clamped to the raster
+    float SampleHeight(double x, double y) const;
+    // nx x ny bilinear samples from (x0, y0) towards +x and +y, rows in parallel
+    std::vector<float> Resample(double x0, double y0, double spacing, uint32_t nx, uint32_t ny) const;
+
+    // must match the start of the cache file
+    struct CacheHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t cols;
+        uint32_t rows;
+        uint32_t tileSize;
+        double minX;
+        double minY;
+        double cellSize;
+        float minHeight;
+        float maxHeight;
+        uint64_t sourceBytes; // the cache is stale when the source size or time differs
+        int64_t sourceTime;
+    };
+
+private:
+    CacheHeader header = {};
+    uint32_t tilesX = 0;
+    uint64_t cacheBytes = 0;
+    bool cacheRebuilt = false;
+    wil::unique_hfile file;
+    wil::unique_handle mapping;
+    wil::unique_mapview_ptr<void> view;
+    const float *tiles = nullptr;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "pch.h"
+
+// A whole file mapped into memory, read-only or created for writing.
+struct MappedFile
+{
+    wil::unique_hfile file;
+    wil::unique_handle mapping;
+    wil::unique_mapview_ptr<void> view;
+    uint64_t bytes = 0;
+
+    // read-only, or created with createBytes for writing; throws std::runtime_error
+    static MappedFile Open(const std::filesystem::path &path, uint64_t createBytes = 0);
+
+    uint8_t *GetData() const { return static_cast<uint8_t *>(view.get()); }
+    // writes the dirty pages and the file buffers to disk
+    void Flush() const;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "pch.h"
+#include "TriangleMesh.h"
+
+// must match MeshBvhNode in CommonKernels.hlsl
+struct MeshBvhNode
+{
+    Vector3 boundsMin;
+    uint32_t leftOrFirst; // children leftOrFirst and leftOrFirst + 1, or the first triangle of a leaf
+    Vector3 boundsMax;
+    uint32_t count; // triangles of a leaf, 0 for inner nodes
+};
+
+// must match MeshTriangle in CommonKernels.hlsl
+struct MeshTriangle
+{
+    Vector3 a;
+    Vector3 b;
+    Vector3 c;
+};
+
+struct MeshHit
+{
+    Vector3 point;
+    float distance;
+    uint32_t triangle; // k_noTriangle when no triangle is within the query distance
+};
+
+// Bounding volume hierarchy over a triangle mesh, built top-down with binned SAH. The
+// subtrees of large nodes are built in parallel. Triangles are stored in leaf order.
+class MeshBvh
+{
+public:
+    static constexpr uint32_t k_noNode = 0xffffffffu; // must match MESH_NO_NODE in CommonKernels.hlsl
+    static constexpr uint32_t k_noTriangle = 0xffffffffu;
+    static constexpr uint32_t k_maxDepth = 30; // the GPU traversal stack holds 32 nodes
+
+    // degenerate triangles are dropped
+    void Build(const TriangleMesh &mesh);
+
+    const std::vector<MeshBvhNode> &GetNodes() const { return nodes; }
+    const std::vector<MeshTriangle> &GetTriangles() const { return triangles; }
+    uint32_t GetDepth() const { return depth; }
+
+    MeshHit ClosestPoint(const Vector3 &p, float maxDistance) const;
+    // Queries are bucketed into cubes of bucketSize. Each bucket traverses the tree once for
+    // the triangles within maxDistance of its cube, sorted by distance to the cube center, and
+    // each query stops once the rest are farther than its best hit. Queries more than 2^20
+    // buckets from the origin traverse the tree on their own.
+    void ClosestPoints(const std::vector<Vector3> &points, float maxDistance, float bucketSize,
+                       std::vector<MeshHit> &out) const;
+    // The same sharing for the neighbor grid: per cell, up to rootsPerCell subtrees (k_noNode
+    // padded) that hold every triangle within radius of the cell. Cells on the border of the
+    // grid reach to infinity outwards, like the clamped cell lookup.
+    std::vector<uint32_t> CollectCellRoots(const Vector3 &origin, float cellSize, const uint32_t resolution[3],
+                                           float radius, uint32_t rootsPerCell) const;
+
+private:
+    std::vector<MeshBvhNode> nodes;
+    std::vector<MeshTriangle> triangles;
+    uint32_t depth = 0;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "pch.h"
+
+#include <execution>
+
+// Calls fn(i) for every i in [begin, end) on the thread pool of the parallel standard
+// algorithms, in chunks of grain indices. Ranges of one chunk run on the calling thread.
+// fn must not write state shared between indices without synchronization.
+template <typename Fn>
+void ParallelFor(uint32_t begin, uint32_t end, Fn &&fn, uint32_t grain = 1024)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+
+    grain = std::max(grain, 1u);
+    const uint32_t chunkCount = (end - begin + grain - 1) / grain;
+    if (chunkCount == 1)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            fn(i);
+        }
+        return;
+    }
+
+    std::vector<uint32_t> chunks(chunkCount);
+    std::iota(chunks.begin(), chunks.end(), 0u);
+    std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](uint32_t chunk)
+                  {
+        const uint32_t chunkBegin = begin + chunk * grain;
+        const uint32_t chunkEnd = std::min(chunkBegin + grain, end);
+        for (uint32_t i = chunkBegin; i < chunkEnd; ++i)
+        {
+            fn(i);
+        } });
+}
@@ -3,6 +3,16 @@
 #include "pch.h"
 #include "StructuredBuffer.h"
 
+constexpr UINT k_maxKillVolumes = 4; // per kind, must match KILL_VOLUME_MAX in CommonData.hlsl
+// adaptive resolution levels, must match ADAPTIVE_LEVEL_* in CommonData.hlsl; the coarsest
+// smoothing length h 2^(6/3) = 4h is the grid cell size
+constexpr int k_adaptiveLevelMin = -6;
+constexpr int k_adaptiveLevelMax = 6;
+constexpr int k_maxTimeLevels = 8; // must match TIME_LEVEL_MAX in CommonData.hlsl
+constexpr UINT k_maxObstacles = 8;  // must match OBSTACLE_MAX in CommonData.hlsl
+constexpr UINT k_meshRootsPerCell = 8; // must match MESH_ROOTS_PER_CELL in CommonKernels.hlsl
+constexpr UINT k_boundaryMapIntervals = 64; // must match BOUNDARY_MAP_INTERVALS in CommonKernels.hlsl
+
 struct SimParams
 {
     float h = 0.1f;       // kernel radius
@@ -35,6 +45,73 @@ struct SimParams
     float muMaxViscosity = 10.0f;       // maximum mu after clamp
     float muNormMaxViscosity = 1.0f;    // value of mu that maps to viscCoeff=1 (for normalization)
 
+    float thermalDt = 0.0f; // time accumulated since the previous heat transfer pass
+    float solverTolerance = 1e-4f; // implicit heat / viscosity solves: stop at |r| <= tol * |r0|
+    float padThermal[2];
+
+    float sleepTemperature = 880.0f; // particles below this temperature and sleepSpeed may fall asleep
+    float wakeTemperature = 900.0f;  // sleepers above this temperature wake up, solidus of GetThermalConductivity
+    float sleepSpeed = 0.01f;
+    float wakeSpeed = 0.05f; // sleepers touched by faster or hotter lava wake up
+
+    uint32_t sleepSteps = 30; // consecutive calm steps before a particle falls asleep
+    uint32_t sleepingEnabled = 0;
+    float padSleep[2];
+
+    float solidifyTemperature = 850.0f; // particles below this temperature join rigid crust clusters
+    float meltTemperature = 900.0f;     // solid particles above this temperature return to the fluid
+    uint32_t rigidEnabled = 0;
+    float padRigid;
+
+    uint32_t killPlaneCount = 0;
+    uint32_t killBoxCount = 0;
+    float padKill[2];
+    Vector4 killPlanes[k_maxKillVolumes]; // xyz normal towards the removed side, w = dot(normal, point on plane)
+    Vector4 killBoxMin[k_maxKillVolumes]; // sinks, xyz used
+    Vector4 killBoxMax[k_maxKillVolumes];
+
+    uint32_t adaptiveEnabled = 0;
+    int32_t minLevel = 0;            // finest level, split particles do not go below
+    int32_t maxLevel = 3;            // coarsest level, its smoothing length fits into one grid cell
+    float maxSmoothingLength = 0.1f; // h 2^(maxLevel/3), h without adaptive resolution
+
+    float mergeSpeed = 0.02f; // interior particles slower and colder than this are merged in pairs
+    float mergeTemperature = 900.0f;
+    float splitSpeed = 0.2f; // surface particles and particles faster than this are split
+    float padAdaptive;
+
+    uint32_t maxTimeLevel = 0; // local time stepping, written per substep by the StepController
+    uint32_t localStep = 0;
+    float timeLevelCfl = 0.4f;
+    float padTimeLevel;
+    float levelDt[k_maxTimeLevels]; // float4[2] in HLSL
+
+    uint32_t heatGridResolution[3]; // grid heat solver: neighbor grid cells subdivided
+    float heatGridSpacing;
+
+    uint32_t surfaceCoolingEnabled = 0; // cooling only over the surface list, not in the heat solvers
+    float surfaceThreshold = 0.3f;      // h |grad color| above which a particle is on the free surface
+    float radiationCoeff = 1.0f;        // radiative loss rate of a fully exposed particle near 1000 K, 1/s
+    float padSurface;
+
+    uint32_t obstacleCount = 0;
+    float obstacleMargin; // particles are kept this far outside the obstacle surfaces
+    float padObstacle[2];
+    Vector4 obstacleOrigin[k_maxObstacles];     // static obstacles: xyz position of sample 0, w sample spacing
+    uint32_t obstacleGrid[k_maxObstacles][4];   // xyz samples per axis, w first sample in the obstacle buffer
+
+    uint32_t terrainDims[2] = {0, 0}; // terrain heightfield: samples along x and z, 0 without terrain
+    float terrainOrigin[2];           // world xz of sample (0, 0)
+    float terrainSpacing;
+    float padTerrain[3];
+
+    uint32_t meshNodeCount = 0; // triangle mesh obstacles: BVH nodes, 0 without meshes
+    float meshQueryRadius;      // particles behind a face up to this depth are pushed back out
+    float padMesh[2];
+
+    uint32_t wallDensityEnabled = 1; // the walls of the domain box add to density through the boundary volume map
+    float padWall[3];
+
     // TODO: init method?
 };
 
@@ -55,7 +132,53 @@ enum class BufferSrvIndex : UINT
     DeltaP = 11,
     ViscosityMu = 12,
     ViscosityCoeff = 13,
-    NumberOfSrvSlots = 14
+    Diagnostics = 14,
+    HeatDiagonal = 15,
+    HeatResidual = 16,
+    HeatPrecond = 17,
+    HeatDirection = 18,
+    HeatProduct = 19,
+    SolverPartials = 20,
+    SolverScalars = 21,
+    ViscosityDiagonal = 22,
+    ViscosityResidual = 23,
+    ViscosityPrecond = 24,
+    ViscosityDirection = 25,
+    ViscosityProduct = 26,
+    DfsphKappa = 27,
+    DfsphKappaV = 28,
+    DfsphStiffness = 29,
+    Phase = 30,
+    ActiveIndices = 31,
+    ActiveArgs = 32,
+    ActiveGroupOffsets = 33,
+    RigidLabel = 34,
+    RigidRestOffset = 35,
+    RigidMembers = 36,
+    RigidClusterOffsets = 37,
+    RigidClusters = 38,
+    RigidRotation = 39,
+    RigidRebuildArgs = 40,
+    RigidArgs = 41,
+    EmitQueue = 42,
+    ParticleId = 43,
+    CompactUint = 44,
+    CompactFloat = 45,
+    ParticleLevel = 46,
+    HeatGridAccum = 47,
+    HeatGridState = 48,
+    HeatGridTemperature = 49,
+    SurfaceIndices = 50,
+    SurfaceArgs = 51,
+    ObstacleSdf = 52,
+    TerrainHeights = 53,
+    MeshNodes = 54,
+    MeshTriangles = 55,
+    MeshCellRoots = 56,
+    BoundaryVolumeMap = 57,
+    RigidGroupOffsets = 58,
+    SolverColor = 59,
+    NumberOfSrvSlots = 60
 };
 
 UINT operator+(UINT offset, BufferSrvIndex index);
@@ -78,12 +201,122 @@ enum class BufferUavIndex : UINT
     DeltaP = 11,
     ViscosityMu = 12,
     ViscosityCoeff = 13,
-    NumberOfUavSlots = 14
+    Diagnostics = 14,
+    HeatDiagonal = 15,
+    HeatResidual = 16,
+    HeatPrecond = 17,
+    HeatDirection = 18,
+    HeatProduct = 19,
+    SolverPartials = 20,
+    SolverScalars = 21,
+    ViscosityDiagonal = 22,
+    ViscosityResidual = 23,
+    ViscosityPrecond = 24,
+    ViscosityDirection = 25,
+    ViscosityProduct = 26,
+    DfsphKappa = 27,
+    DfsphKappaV = 28,
+    DfsphStiffness = 29,
+    Phase = 30,
+    ActiveIndices = 31,
+    ActiveArgs = 32,
+    ActiveGroupOffsets = 33,
+    RigidLabel = 34,
+    RigidRestOffset = 35,
+    RigidMembers = 36,
+    RigidClusterOffsets = 37,
+    RigidClusters = 38,
+    RigidRotation = 39,
+    RigidRebuildArgs = 40,
+    RigidArgs = 41,
+    EmitQueue = 42,
+    ParticleId = 43,
+    CompactUint = 44,
+    CompactFloat = 45,
+    ParticleLevel = 46,
+    HeatGridAccum = 47,
+    HeatGridState = 48,
+    HeatGridTemperature = 49,
+    SurfaceIndices = 50,
+    SurfaceArgs = 51,
+    ObstacleSdf = 52,
+    TerrainHeights = 53,
+    MeshNodes = 54,
+    MeshTriangles = 55,
+    MeshCellRoots = 56,
+    BoundaryVolumeMap = 57,
+    RigidGroupOffsets = 58,
+    SolverColor = 59,
+    NumberOfUavSlots = 60
 };
 
 UINT operator+(UINT offset, BufferUavIndex index);
 UINT operator+(BufferUavIndex index, UINT offset);
 
+// per-dispatch root constants (b1), must match PassConstants in CommonData.hlsl
+struct PassConstants
+{
+    uint32_t passIndex = 0; // iteration / color index of the current dispatch
+    uint32_t passCount = 0;
+    uint32_t passFlags = 0; // PassFlags bits
+    uint32_t passParam = 0; // kernel specific, e.g. diagnostics slot of a solver
+};
+
+enum PassFlags : uint32_t
+{
+    PassFlagNone = 0,
+    PassFlagColorFilter = 1 << 0, // only particles of color passIndex are processed
+    PassFlagWarmStart = 1 << 1,   // DFSPH: stiffness from the previous step instead of the current error
+    PassFlagActiveList = 1 << 2,  // solver scalars: one partial per active thread group instead of passCount
+};
+
+// passIndex of the solver scalars kernel, must match SOLVER_PASS_* in CommonData.hlsl
+enum SolverPass : uint32_t
+{
+    SolverPassInit = 0,  // partials hold r.z, r.r of the initial residual
+    SolverPassAlpha = 1, // partials hold p.Ap
+    SolverPassBeta = 2,  // partials hold r.z, r.r after the update
+};
+
+// layout of the uint diagnostics buffer read back after a step, must match CommonData.hlsl
+enum class DiagnosticsSlot : UINT
+{
+    DensityResidual = 0, // 2 floats per probed solver iteration: mean |C|, max |C|
+    StepLimits = 128,    // 3 floats: max |v|, max mu, max thermal conductivity
+    HeatSolver = 132,      // uint iterations, float |r| / |r0| of the last implicit heat solve
+    ViscositySolver = 134, // uint iterations, float |r| / |r0| of the last implicit viscosity solve
+    ActiveCount = 136,     // uint particles in the active list of the step
+    Rigid = 138,           // uint solid particles, clusters, rebuild mode of the step (RigidRebuild)
+    Killed = 141,          // uint particles inside kill volumes at the end of the step
+    Adaptive = 142,        // uint split, merged pairs, then particles per level from k_adaptiveLevelMin
+    TimeLevels = 157,      // uint active particles per time level
+    SurfaceCount = 165,    // uint particles in the surface list
+    NumberOfDiagnosticsSlots = 256
+};
+
+constexpr UINT k_maxProbedSolverIterations = 64;
+
+// rebuild of the rigid cluster labels, must match RIGID_REBUILD_* in CommonData.hlsl
+enum class RigidRebuild : UINT
+{
+    None = 0,
+    Changed = 1, // particles solidified or melted, clusters with unchanged members keep their rest shape
+    Full = 2,    // particle indices changed, every cluster takes a new rest shape
+};
+
+// layout of the uint solver scalars buffer, must match CommonData.hlsl
+enum class SolverScalar : UINT
+{
+    RZ = 0,         // float r.z of the current iteration
+    Alpha = 1,      // float
+    Beta = 2,       // float
+    RR0 = 3,        // float |r0|^2
+    RR = 4,         // float |r|^2
+    Converged = 5,  // uint, kernels return early once set
+    Iterations = 6, // uint
+    NumberOfSolverScalars = 8
+};
+
 // TODO: to separate header
 struct PingPongBuffer
 {
@@ -122,6 +355,7 @@ struct ParticleScratchBuffers
     std::shared_ptr<StructuredBuffer> constraintC = nullptr; // C_i
     std::shared_ptr<StructuredBuffer> lambda = nullptr;      // λ_i
     std::shared_ptr<StructuredBuffer> deltaP = nullptr;      // Δp_i
+    std::shared_ptr<StructuredBuffer> solverColor = nullptr; // uint, Gauss-Seidel color fixed for the step
 
     std::shared_ptr<StructuredBuffer> viscosityMu = nullptr;    // μ_i
     std::shared_ptr<StructuredBuffer> viscosityCoeff = nullptr; // normalized coeff
@@ -129,8 +363,72 @@ struct ParticleScratchBuffers
     std::shared_ptr<StructuredBuffer> cellStart = nullptr; // per-cell
     std::shared_ptr<StructuredBuffer> cellEnd = nullptr;
 
-    // Optional
-    std::shared_ptr<StructuredBuffer> phase = nullptr; // solid/liquid/etc
+    std::shared_ptr<StructuredBuffer> phase = nullptr; // uint, PHASE_* state and calm step counter
+
+    // active list, only awake particles are predicted, solved and moved
+    std::shared_ptr<StructuredBuffer> activeIndices = nullptr;      // particle indices in grid order
+    std::shared_ptr<StructuredBuffer> activeArgs = nullptr;         // uint[4], dispatch arguments + active count
+    std::shared_ptr<StructuredBuffer> activeGroupOffsets = nullptr; // active count per group, then scanned offsets
+
+    // rigid crust clusters, rebuilt on steps where particles solidified or melted
+    std::shared_ptr<StructuredBuffer> rigidLabel = nullptr;          // uint, root particle of the cluster
+    std::shared_ptr<StructuredBuffer> rigidRestOffset = nullptr;     // float3, rest position relative to the cluster center
+    std::shared_ptr<StructuredBuffer> rigidMembers = nullptr;        // uint, solid particles grouped by cluster, previous labels during a rebuild
+    std::shared_ptr<StructuredBuffer> rigidClusterOffsets = nullptr; // uint per root, member count then first member slot
+    std::shared_ptr<StructuredBuffer> rigidClusters = nullptr;       // uint2 per cluster of two or more, first member slot and count
+    std::shared_ptr<StructuredBuffer> rigidRotation = nullptr;       // float4 quaternion per root, warm start
+    std::shared_ptr<StructuredBuffer> rigidRebuildArgs = nullptr;    // uint[8], rebuild dispatch + mode, change counters
+    std::shared_ptr<StructuredBuffer> rigidArgs = nullptr;           // uint[12], dispatch over clusters, over solids and over singles
+    std::shared_ptr<StructuredBuffer> rigidGroupOffsets = nullptr;   // uint4 per thread group, cluster totals then scanned offsets
+
+    std::shared_ptr<StructuredBuffer> emitQueue = nullptr; // EmittedParticle, written by the emitters on the CPU
+
+    // removal of killed particles, runs only after steps that killed something
+    std::shared_ptr<StructuredBuffer> particleId = nullptr;   // uint, stable across compaction, for output
+    std::shared_ptr<StructuredBuffer> compactUint = nullptr;  // uint4, phase, id, level and density at the compacted index
+    std::shared_ptr<StructuredBuffer> compactFloat = nullptr; // float4, DFSPH stiffness and viscosity at the compacted index
+
+    std::shared_ptr<StructuredBuffer> particleLevel = nullptr; // int, adaptive resolution level, 0 = base mass and h
+
+    std::shared_ptr<StructuredBuffer> diagnostics = nullptr; // uint, read back after the step
+
+    // implicit heat conduction, preconditioned CG
+    std::shared_ptr<StructuredBuffer> heatDiagonal = nullptr;  // Jacobi preconditioner, diag(A)
+    std::shared_ptr<StructuredBuffer> heatResidual = nullptr;  // r
+    std::shared_ptr<StructuredBuffer> heatPrecond = nullptr;   // z = M^-1 r
+    std::shared_ptr<StructuredBuffer> heatDirection = nullptr; // p
+    std::shared_ptr<StructuredBuffer> heatProduct = nullptr;   // A p
+
+    std::shared_ptr<StructuredBuffer> surfaceIndices = nullptr; // uint, free surface particles, unordered
+    std::shared_ptr<StructuredBuffer> surfaceArgs = nullptr;    // uint[8], dispatch over the surface list, count, append counter
+
+    std::shared_ptr<StructuredBuffer> obstacleSdf = nullptr; // float, samples of all obstacle distance grids, written once at Init
+    std::shared_ptr<StructuredBuffer> terrainHeights = nullptr; // float, world terrain height per xz sample, written once at Init
+    std::shared_ptr<StructuredBuffer> meshNodes = nullptr;      // MeshBvhNode, BVH over all mesh obstacles, written once at Init
+    std::shared_ptr<StructuredBuffer> meshTriangles = nullptr;  // MeshTriangle, in BVH leaf order
+    std::shared_ptr<StructuredBuffer> meshCellRoots = nullptr;  // uint[8] per grid cell, BVH subtrees near the cell
+    std::shared_ptr<StructuredBuffer> boundaryVolumeMap = nullptr; // float2, kernel volume behind a wall over distance, written once at Init
+
+    // grid heat solver, per grid node
+    std::shared_ptr<StructuredBuffer> heatGridAccum = nullptr;       // uint4, fixed point weight, w T, w k
+    std::shared_ptr<StructuredBuffer> heatGridState = nullptr;       // float4, T before the solve, k, weight
+    std::shared_ptr<StructuredBuffer> heatGridTemperature = nullptr; // float, two halves for the Jacobi sweeps
+
+    // implicit viscosity, preconditioned CG on float3 velocities
+    std::shared_ptr<StructuredBuffer> viscosityDiagonal = nullptr;  // float, diag(A)
+    std::shared_ptr<StructuredBuffer> viscosityResidual = nullptr;  // r
+    std::shared_ptr<StructuredBuffer> viscosityPrecond = nullptr;   // z = M^-1 r
+    std::shared_ptr<StructuredBuffer> viscosityDirection = nullptr; // p
+    std::shared_ptr<StructuredBuffer> viscosityProduct = nullptr;   // A p
+
+    // DFSPH, alpha factor lives in lambda
+    std::shared_ptr<StructuredBuffer> dfsphKappa = nullptr;     // accumulated density stiffness, kept for warm start
+    std::shared_ptr<StructuredBuffer> dfsphKappaV = nullptr;    // accumulated divergence stiffness, kept for warm start
+    std::shared_ptr<StructuredBuffer> dfsphStiffness = nullptr; // stiffness of the current pass
+
+    // shared by the CG solves
+    std::shared_ptr<StructuredBuffer> solverPartials = nullptr; // float2 per thread group of a dot product
+    std::shared_ptr<StructuredBuffer> solverScalars = nullptr;  // uint, SolverScalar layout
 };
 
 struct SortBuffers
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "pch.h"
+
+// one particle inserted by an emitter, must match EmittedParticle in 42_EmitParticles.hlsl
+struct EmittedParticle
+{
+    Vector3 position;
+    float temperature;
+    Vector3 velocity;
+    uint32_t slot; // particle index the data is written to
+    uint32_t id;   // stable particle id
+    uint32_t pad[3];
+};
+
+// Pool of particle slots. Live particles occupy [0, LiveEnd()) and new ones are appended
+// behind them; removed particles are packed by the GPU compaction, which then resets the
+// live range, so the free slots are always the tail [LiveEnd(), capacity).
+class ParticleSlotPool
+{
+public:
+    void Reset(uint32_t capacityIn, uint32_t liveCount);
+    // keeps the live range
+    void Grow(uint32_t capacityIn);
+
+    // UINT32_MAX when the pool is full
+    uint32_t Acquire();
+    // slots filled on the GPU behind the live range, e.g. by particle splits
+    void Append(uint32_t count) { liveEnd = std::min(liveEnd + count, capacity); }
+
+    uint32_t GetCapacity() const { return capacity; }
+    uint32_t LiveEnd() const { return liveEnd; }
+    uint32_t GetAvailable() const { return capacity - liveEnd; }
+
+private:
+    uint32_t capacity = 0;
+    uint32_t liveEnd = 0;
+};
+
+// Volcanic vent: a disc of the given radius that ejects lava along its direction.
+class ParticleEmitter
+{
+public:
+    struct Settings
+    {
+        Vector3 position = Vector3(2.5f, 0.5f, 2.5f);
+        Vector3 direction = Vector3(0.0f, 1.0f, 0.0f);
+        float radius = 0.2f;
+        float speed = 1.0f;
+        float rate = 2000.0f; // particles per second
+        float temperatureMin = 1200.0f;
+        float temperatureMax = 1400.0f;
+    };
+
+    explicit ParticleEmitter(const Settings &settingsIn, unsigned seed = 1);
+
+    // writes up to maxCount particles for an interval of dt into out and returns their number;
+    // the fractional remainder is carried over, emission stops while the pool is full
+    uint32_t Emit(float dt, ParticleSlotPool &pool, EmittedParticle *out, uint32_t maxCount);
+    // number of particles the next Emit with the same dt wants to insert
+    uint32_t GetPendingCount(float dt) const { return static_cast<uint32_t>(carried + settings.rate * dt); }
+
+    const Settings &GetSettings() const { return settings; }
+    // emission remainder and random engine as text, for checkpoints
+    std::string SaveState() const;
+    void RestoreState(const std::string &state);
+
+private:
+    Settings settings;
+    Vector3 tangent;
+    Vector3 bitangent;
+    float carried = 0.0f;
+    std::mt19937 rng;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "pch.h"
+#include "ParticleEmitter.h"
+#include "SettledBlock.h"
+#include "TriangleMesh.h"
+
+// Scene description file, one item per line, '#' starts a comment. An item is a keyword
+// followed by keys and their values; vectors are three numbers, paths are relative to the
+// scene file:
+//   spacing s | particles n | jitter fraction | seed n | sampler lattice|relaxed
+//   block min x y z max x y z [temperature lo hi]
+//   sphere center x y z radius r [temperature lo hi]
+//   mesh path file.obj [scale s] [offset x y z] [temperature lo hi]
+//   temperature (all | above y | below y | box x0 y0 z0 x1 y1 z1 | sphere x y z r) range lo hi
+//   emitter position x y z [direction x y z] [radius r] [speed s] [rate r] [temperature lo hi]
+//   obstacle-box min x y z max x y z | obstacle-sphere center x y z radius r
+//   obstacle-mesh path file.obj [scale s] [offset x y z]
+//   kill-plane point x y z normal x y z | kill-box min x y z max x y z
+// Fills are sampled on one lattice, so overlapping fills do not double particles; the first
+// fill containing a lattice point sets its temperature range. Temperature items apply in
+// order on top of that, later ones win. The relaxed sampler tiles a SettledBlock instead of
+// the lattice, spacing, particles and jitter do not apply to it.
+class Scene
+{
+public:
+    enum class Sampler
+    {
+        Lattice, // cubic lattice, optionally jittered
+        Relaxed, // tiles of a settled block at rest density
+    };
+
+    enum class Shape
+    {
+        Box,
+        Sphere,
+        Mesh,
+        All,   // temperature regions only
+        Above, // y >= boxMin.y
+        Below, // y < boxMin.y
+    };
+
+    struct Region
+    {
+        Shape shape = Shape::All;
+        Vector3 boxMin;
+        Vector3 boxMax;
+        Vector3 center;
+        float radius = 0.0f;
+        TriangleMesh mesh; // scaled and offset
+        float temperatureMin = 700.0f;
+        float temperatureMax = 900.0f;
+    };
+
+    struct Obstacle
+    {
+        Shape shape = Shape::Box;
+        Vector3 boxMin;
+        Vector3 boxMax;
+        Vector3 center;
+        float radius = 0.0f;
+        std::filesystem::path path;
+        float scale = 1.0f;
+        Vector3 offset;
+    };
+
+    struct KillVolume
+    {
+        bool plane = true;
+        Vector3 a; // plane point or box minimum
+        Vector3 b; // plane normal or box maximum
+    };
+
+    std::vector<Region> fills;
+    std::vector<Region> temperatureFields;
+    std::vector<ParticleEmitter::Settings> emitters;
+    std::vector<Obstacle> obstacles;
+    std::vector<KillVolume> killVolumes;
+    float spacing = 0.0f;       // lattice spacing, 0 for the caller's default
+    uint32_t particleCount = 0; // instead of a spacing: about this many particles
+    float jitter = 0.0f;        // random offset per particle, fraction of the spacing
+    uint64_t seed = 1;
+    Sampler sampler = Sampler::Lattice;
+
+    // throws std::runtime_error naming the line
+    static Scene Load(const std::filesystem::path &path);
+
+    // spacing, particleCount, or else defaultSpacing
+    float ResolveSpacing(float defaultSpacing) const;
+
+    // Lattice points inside the fills and their temperatures, generated row by row in
+    // parallel. Every random number comes from the point's lattice coordinates, so the
+    // result is the same for any thread count.
+    void Generate(float latticeSpacing, std::vector<Vector3> &positions, std::vector<float> &temperatures) const;
+    // the points of the block tiled from the origin that lie inside the fills, tiles in parallel
+    void Generate(const SettledBlock &block, std::vector<Vector3> &positions, std::vector<float> &temperatures) const;
+};
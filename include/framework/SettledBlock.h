@@ -0,0 +1,47 @@
+#pragma once
+
+#include "pch.h"
+
+// SPH density of every point with the cubic spline kernel of 5_ComputeDensity.hlsl (support
+// h, all particles of one mass, no walls), neighbors found on a grid, points in parallel.
+// With periodicSize > 0 the points lie in the cube [0, periodicSize)^3 and wrap around.
+void ComputeSphDensities(const std::vector<Vector3> &points, float h, float mass, std::vector<float> &densities,
+                         float periodicSize = 0.0f);
+
+// Spacing of a cubic lattice whose SPH density is rho0 at h; 0 when a lone particle is
+// already denser than rho0, so no spacing reaches it.
+float GetLatticeRestSpacing(float h, float mass, float rho0);
+
+constexpr uint32_t k_settledBlockPerAxis = 12; // 1728 particles per block
+
+// A periodic cube of particles relaxed until every particle has the SPH density rho0 at h.
+// Stratified random points are first spread evenly by repulsion into an irregular (blue
+// noise) arrangement, then density constraints even out their SPH density. Tiles of it fill
+// any volume at rest density, so a run does not spend its first steps settling the pressure
+// transients of lattices or random points. A block is relaxed once per parameter set and
+// kept in a cache directory.
+struct SettledBlock
+{
+    // must match the cache file
+    struct Key
+    {
+        float h;
+        float mass;
+        float rho0;
+        uint32_t perAxis; // perAxis^3 particles
+        uint32_t seed;
+    };
+
+    Key key = {};
+    float size = 0.0f; // edge length, points in [0, size)^3
+    std::vector<Vector3> points;
+    float densityError = 0.0f; // max |rho / rho0 - 1| over the points, periodic
+    uint32_t iterations = 0;   // relaxation iterations, 0 when loaded
+    bool cached = false;       // read from the cache directory
+
+    // throws std::runtime_error when rho0 cannot be reached at h
+    static SettledBlock Relax(const Key &key);
+    // from the cache directory when it holds the block, else relaxed and stored there; an
+    // empty directory only relaxes. perAxis is raised until the block spans 3 h.
+    static SettledBlock Load(Key key, const std::filesystem::path &cacheDirectory);
+};
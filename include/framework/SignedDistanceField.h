@@ -0,0 +1,30 @@
+#pragma once
+
+#include "pch.h"
+
+#include <functional>
+
+// Signed distance to a static obstacle, sampled on a regular grid: negative inside,
+// samples stored x fastest. The GPU reads it with trilinear distance and gradient lookups.
+struct SignedDistanceField
+{
+    Vector3 origin;      // position of sample (0, 0, 0)
+    float spacing = 0.0f;
+    uint32_t dims[3] = {};
+    std::vector<float> samples;
+
+    size_t GetSampleCount() const { return size_t(dims[0]) * dims[1] * dims[2]; }
+    size_t GetIndex(uint32_t x, uint32_t y, uint32_t z) const { return x + dims[0] * (y + size_t(dims[1]) * z); }
+    Vector3 GetPosition(uint32_t x, uint32_t y, uint32_t z) const
+    {
+        return origin + Vector3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) * spacing;
+    }
+
+    // Samples the inside test on a grid over [boundsMin, boundsMax] widened by padding samples
+    // on every side, then solves |grad d| = 1 outwards and inwards from the surface with fast
+    // sweeping. Samples of one sweep diagonal are independent and updated in parallel.
+    static SignedDistanceField Voxelize(const Vector3 &boundsMin, const Vector3 &boundsMax, float spacing,
+                                        const std::function<bool(const Vector3 &)> &inside, uint32_t padding = 4);
+    static SignedDistanceField Box(const Vector3 &boxMin, const Vector3 &boxMax, float spacing);
+    static SignedDistanceField Sphere(const Vector3 &center, float radius, float spacing);
+};
@@ -2,6 +2,21 @@
 
 #include "pch.h"
 #include "Particle.h"
+#include "GpuProfiler.h"
+#include "ConvergenceLog.h"
+#include "StepController.h"
+#include "ParticleEmitter.h"
+#include "SignedDistanceField.h"
+#include "Heightfield.h"
+#include "TriangleMesh.h"
+#include "MeshBvh.h"
+#include "BoundaryVolumeMap.h"
+#include "Checkpoint.h"
+#include "TrajectoryWriter.h"
+#include "Scene.h"
+
+#include <future>
+#include <optional>
 
 #include "GPUSorting/GPUSorting.h"
 #include "GPUSorting/OneSweep.h"
@@ -13,31 +28,213 @@
 #include "simulation/ComputeLambdaKernel.h"
 #include "simulation/ComputeDeltaPosKernel.h"
 #include "simulation/ApplyDeltaPosKernel.h"
+#include "simulation/SolverColorKernel.h"
 #include "simulation/UpdatePositionVelocityKernel.h"
 #include "simulation/ViscosityKernel.h"
 #include "simulation/ApplyViscosityKernel.h"
 #include "simulation/HeatTransferKernel.h"
 #include "simulation/CollisionProjectionKernel.h"
+#include "simulation/DensityResidualKernel.h"
+#include "simulation/StepLimitsKernel.h"
+#include "simulation/HeatCgSetupKernel.h"
+#include "simulation/HeatCgApplyKernel.h"
+#include "simulation/HeatCgUpdateKernel.h"
+#include "simulation/HeatCgDirectionKernel.h"
+#include "simulation/SolverScalarsKernel.h"
+#include "simulation/ViscosityCgSetupKernel.h"
+#include "simulation/ViscosityCgApplyKernel.h"
+#include "simulation/ViscosityCgUpdateKernel.h"
+#include "simulation/ViscosityCgDirectionKernel.h"
+#include "simulation/DfsphFactorKernel.h"
+#include "simulation/DfsphDensityStiffnessKernel.h"
+#include "simulation/DfsphPressureDeltaKernel.h"
+#include "simulation/DfsphDivergenceStiffnessKernel.h"
+#include "simulation/ApplyDeltaVelocityKernel.h"
+#include "simulation/ClassifyPhaseKernel.h"
+#include "simulation/ActiveListScanKernel.h"
+#include "simulation/ActiveListScatterKernel.h"
+#include "simulation/RigidRebuildArgsKernel.h"
+#include "simulation/RigidLabelInitKernel.h"
+#include "simulation/RigidLabelHookKernel.h"
+#include "simulation/RigidLabelCompressKernel.h"
+#include "simulation/RigidClusterScanKernel.h"
+#include "simulation/RigidMemberScatterKernel.h"
+#include "simulation/RigidRestShapeKernel.h"
+#include "simulation/RigidPredictKernel.h"
+#include "simulation/RigidContactKernel.h"
+#include "simulation/RigidShapeMatchKernel.h"
+#include "simulation/RigidClusterCountKernel.h"
+#include "simulation/RigidClusterOffsetsKernel.h"
+#include "simulation/RigidSingleMoveKernel.h"
+#include "simulation/EmitParticlesKernel.h"
+#include "simulation/KillMarkKernel.h"
+#include "simulation/KillScanKernel.h"
+#include "simulation/CompactScatterKernel.h"
+#include "simulation/CompactFinishKernel.h"
+#include "simulation/AdaptivePairKernel.h"
+#include "simulation/AdaptiveApplyKernel.h"
+#include "simulation/HeatGridSplatKernel.h"
+#include "simulation/HeatGridSetupKernel.h"
+#include "simulation/HeatGridJacobiKernel.h"
+#include "simulation/HeatGridGatherKernel.h"
+#include "simulation/SurfaceClassifyKernel.h"
+#include "simulation/SurfaceArgsKernel.h"
+#include "simulation/SurfaceCoolingKernel.h"
+
+// fixed initial particle layouts, shared by benchmark runs
+enum class InitialScene
+{
+    DenseBottomWithSphere,
+    UniformGrid,
+    DenseRandom,
+};
+
+enum class PressureSolver
+{
+    Pbf,   // position based density constraints
+    Dfsph, // divergence-free SPH: constant density + divergence-free passes, warm started
+};
+
+enum class PbfSolverMode
+{
+    Jacobi,             // all corrections computed, then applied
+    ColoredGaussSeidel, // colors swept in order, corrections applied after each color
+};
+
+enum class HeatSolverMode
+{
+    Explicit,   // forward Euler with clamped contributions
+    ImplicitCG, // backward Euler, Jacobi-preconditioned conjugate gradient
+    Grid,       // backward Euler on a background grid, Jacobi sweeps, particle to grid and back
+};
+
+enum class ViscositySolverMode
+{
+    Xsph,       // explicit XSPH velocity blend, coefficient saturated at 1
+    ImplicitCG, // backward Euler viscous diffusion weighted by mu, Jacobi-preconditioned CG
+};
 
 class SimulationSystem
 {
 public:
     SimulationSystem() = delete;
     static void Init(ID3D12Device *device);
+    // must be called before Init
+    static void SetInitialScene(InitialScene scene) { m_initialScene = scene; };
+    // must be called before Init, 0 fills the whole capacity; the remaining slots are left to the emitters
+    static void SetInitialParticleCount(uint32_t count) { m_initialParticleCount = count; };
+    // capacity at Init; emitters grow it geometrically up to the maximum
+    static void SetParticleCapacity(uint32_t capacity) { m_particleCapacity = std::max(capacity, 256u); };
+    static void SetMaxParticleCapacity(uint32_t capacity) { m_maxParticleCapacity = std::max(capacity, 256u); };
+    static void AddEmitter(const ParticleEmitter::Settings &settings);
+    // particles on the normal side of the plane or inside the box are removed; false when all k_maxKillVolumes are used
+    static bool AddKillPlane(const Vector3 &point, const Vector3 &normal);
+    static bool AddKillBox(const Vector3 &boxMin, const Vector3 &boxMax);
+    // static obstacles, must be called before Init; false when all k_maxObstacles are used
+    static bool AddObstacle(SignedDistanceField sdf);
+    // voxelized with GetObstacleSpacing()
+    static bool AddObstacleBox(const Vector3 &boxMin, const Vector3 &boxMax);
+    static bool AddObstacleSphere(const Vector3 &center, float radius);
+    static float GetObstacleSpacing() { return 0.5f * m_simParams.h; };
+    // must be called before Init; throws std::runtime_error. All meshes share one BVH, closed
+    // meshes with outward facing triangles keep particles outside.
+    static void AddObstacleMesh(const std::filesystem::path &path, float scale = 1.0f, const Vector3 &offset = Vector3::Zero);
+    // times BVH builds and closest point queries over growing parts of the meshes at Init
+    static void SetMeshBenchmark(bool enabled) { m_meshBenchmark = enabled; };
+    // walls of the domain box add to density and the constraint gradients (on by default);
+    // otherwise particles near walls are only clamped
+    static void SetWallDensityEnabled(bool enabled) { m_simParams.wallDensityEnabled = enabled ? 1u : 0u; };
+    // must be called before Init; throws std::runtime_error. Map units times scale give world
+    // units, 0 fits the longer side into the default domain. The south-west corner of the
+    // terrain at its lowest elevation becomes the world origin, and the neighbor grid is
+    // reshaped to cover the terrain footprint.
+    static void LoadTerrain(const std::filesystem::path &path, const Heightfield::RawLayout &raw = {}, float scale = 0.0f);
+    // must be called before Init; throws std::runtime_error. Obstacles, emitters and kill
+    // volumes of the scene are added at once; its fills replace the initial scene and particle
+    // count and are sampled at Init, at the rest density spacing unless the file sets one.
+    static void LoadScene(const std::filesystem::path &path);
+    // must be called before Init; replaces the sampler of the scene file. Without a scene file
+    // the layout of InitialScene::DenseBottomWithSphere is sampled as a scene.
+    static void SetSceneSampler(Scene::Sampler sampler) { m_sceneSampler = sampler; };
+    // settled blocks of the relaxed sampler are cached there, an empty path relaxes them every run
+    static void SetSettledBlockCache(const std::filesystem::path &directory) { m_settledBlockCache = directory; };
+    // fills a test box with every sampler at Init and reports their initial density errors
+    static void SetSamplerBenchmark(bool enabled) { m_samplerBenchmark = enabled; };
+    // must be called before Init; interior particles merge up to maxLevel (mass 2^level, smoothing
+    // length h 2^(level/3)), surface and fast particles split down to minLevel; minLevel <= 0 <= maxLevel
+    static void SetAdaptiveResolution(int minLevel, int maxLevel);
+    // split/merge pass every Nth step
+    static void SetAdaptiveInterval(int steps) { m_adaptiveInterval = std::max(steps, 1); };
+    // Restart: must be called before Init; throws std::runtime_error. Simulation parameters,
+    // particles, emitters and the stepping state come from the checkpoint, settings given
+    // afterwards override them. Static geometry is not stored and has to be given again.
+    static void LoadCheckpoint(const std::filesystem::path &path);
+    // a checkpoint every intervalSteps steps, 0 only at Shutdown
+    static void SetCheckpoint(const std::filesystem::path &path, int intervalSteps);
+    // Copies the particle state off the GPU and writes the file on a background thread, the
+    // step loop only waits for the copy. False when the previous write is still running.
+    static bool SaveCheckpoint(const std::filesystem::path &path);
+    // per-frame particle attributes streamed to a file by background threads; throws
+    // std::runtime_error when the file cannot be created
+    static void SetTrajectory(const TrajectoryWriter::Settings &settings);
+    // writes the final checkpoint and waits for pending checkpoint and trajectory writes; before PrintReport
+    static void Shutdown();
 
     static bool IsRunning() { return isRunning; };
     static void SetSimulationRunning(bool isRunningIn) { isRunning = isRunningIn; };
     static void StartSimulation() { isRunning = true; };
     static void StopSimulation() { isRunning = false; };
 
-    static void Simulate(float dt);
+    // advances the simulation by the requested interval in one or more substeps
+    static void Simulate(float interval);
+
+    static void SetStepControllerSettings(const StepController::Settings &settings) { m_stepController.SetSettings(settings); };
+    static const StepController::Settings &GetStepControllerSettings() { return m_stepController.GetSettings(); };
+    static int GetLastSubstepCount() { return m_stepController.GetLastSubstepCount(); };
+    static double GetSimulatedTime() { return m_stepController.GetSimulatedTime(); };
+
+    static void SetPressureSolver(PressureSolver solver) { m_pressureSolver = solver; };
+    static void SetDfsphIterations(int densityIterations, int divergenceIterations)
+    {
+        m_dfsphDensityIterations = densityIterations;
+        m_dfsphDivergenceIterations = divergenceIterations;
+    };
+    static void SetPbfSolverMode(PbfSolverMode mode) { m_pbfSolverMode = mode; };
+    static PbfSolverMode GetPbfSolverMode() { return m_pbfSolverMode; };
+    static void SetPbfIterations(int iterations) { m_pbfIterations = iterations; };
+    // measures the density residual after every solver iteration (one extra density pass each)
+    static void SetConvergenceProbe(bool enabled) { m_convergenceProbe = enabled; };
+    // heat transfer and viscosity evaluation run every Nth step (1 = every step)
+    static void SetThermalInterval(int steps);
+    static void SetViscosityInterval(int steps) { m_viscosityInterval = std::max(steps, 1); };
+    static void SetHeatSolverMode(HeatSolverMode mode);
+    static void SetHeatSolverIterations(int iterations) { m_heatSolverIterations = std::max(iterations, 1); };
+    static void SetViscositySolverMode(ViscositySolverMode mode);
+    static void SetViscositySolverIterations(int iterations) { m_viscositySolverIterations = std::max(iterations, 1); };
+    static void SetSolverTolerance(float tolerance) { m_simParams.solverTolerance = tolerance; };
+    // cooled, calm particles fall asleep and are skipped by the dynamics passes until woken
+    static void SetSleepingEnabled(bool enabled) { m_simParams.sleepingEnabled = enabled ? 1u : 0u; };
+    static uint32_t GetLastActiveCount() { return m_lastActiveCount; };
+    // solidified crust is grouped into connected clusters and moved as rigid bodies by shape matching
+    static void SetRigidCrustEnabled(bool enabled);
+    // free surface particles are listed every N steps; convection and radiation cool only them
+    static void SetSurfaceCoolingEnabled(bool enabled) { m_simParams.surfaceCoolingEnabled = enabled ? 1u : 0u; };
+    static void SetSurfaceInterval(int steps) { m_surfaceInterval = std::max(steps, 1); };
+    static void PrintReport(std::ostream &os);
 
     static D3D12_GPU_DESCRIPTOR_HANDLE GetPositionBufferSRV();
     static D3D12_GPU_DESCRIPTOR_HANDLE GetTemperatureBufferSRV();
+    // uint per particle, ids survive compaction
+    static D3D12_GPU_DESCRIPTOR_HANDLE GetParticleIdBufferSRV();
+    // uint particle indices of the free surface, GetSurfaceCount() valid entries, with surface cooling
+    static D3D12_GPU_DESCRIPTOR_HANDLE GetSurfaceIndexBufferSRV();
+    static uint32_t GetSurfaceCount() { return m_lastSurfaceCount; }
     static uint32_t GetNumParticles() { return m_simParams.numParticles; }
+    static uint32_t GetParticleCapacity() { return m_slotPool.GetCapacity(); }
     static float GetKernelRadius() { return m_simParams.h; }
 
     // Particle initialization helpers
+    static std::vector<DirectX::SimpleMath::Vector3> GenerateScenePositions(InitialScene scene, UINT numParticles);
     static std::vector<DirectX::SimpleMath::Vector3> GenerateUniformGridPositions(UINT numParticles);
     static std::vector<DirectX::SimpleMath::Vector3> GenerateDenseBottomWithSphere(UINT numParticles);
     static std::vector<DirectX::SimpleMath::Vector3> GenerateDenseRandomPositions(UINT numParticles, unsigned seed = 1337);
@@ -48,6 +245,16 @@ private:
     static void CreateSimulationRootSignature(ID3D12Device *device);
     static void CreateSimulationKernels();
     static void InitSimulationBuffers(ID3D12Device *device, DescriptorAllocator &allocGPU, UINT numParticles, UINT numCells);
+    // grid resolution and terrain constants from the terrain bounds, returns the world heights to upload
+    static std::vector<float> FitWorldToTerrain(int cubicResolution);
+    // BVH over the mesh obstacles and the subtrees per neighbor grid cell; after the grid is final
+    static void BuildMeshObstacles(std::vector<uint32_t> &cellRoots);
+    static void RunMeshBenchmark();
+    // the built-in scene layout as a scene, for the samplers
+    static Scene GetBuiltInScene();
+    // SPH density of the initial particles on the CPU, as the first step computes it
+    static void MeasureInitialDensity(const std::vector<DirectX::SimpleMath::Vector3> &positions, const BoundaryVolumeMap &wallMap);
+    static void RunSamplerBenchmark();
     static void InitTemperatureBuffer(ID3D12Device *device, UINT numParticles);
     static void InitSortIndexBuffers(ID3D12Device *device, DescriptorAllocator &alloc, UINT numParticles);
 
@@ -62,6 +269,49 @@ private:
     static void SetOtherUavsRootSig(ID3D12GraphicsCommandList *cmdList, DescriptorAllocator &allocGPU);
     // cbv
     static void SetSimulationConstantRootSig(ID3D12GraphicsCommandList *cmdList, D3D12_GPU_VIRTUAL_ADDRESS cbAddress);
+    // root constants
+    static void SetPassConstants(ID3D12GraphicsCommandList *cmdList, const PassConstants &constants);
+
+    static void SimulateStep(float dt);
+    // CPU side of the emitters: fills the emit queue upload buffer and grows numParticles
+    static uint32_t QueueEmittedParticles(float dt);
+    static void GrowCapacity(uint32_t newCapacity);
+    static void EmitParticles(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList, uint32_t emittedCount);
+    // removes the particles flagged by the kill mark pass and rebuilds the grid for the new indices
+    static void CompactParticles(uint32_t survivors);
+    // grid over the predicted positions after the particle set changed between steps
+    static void RebuildGrid();
+    // splits and merges after the readback of a step that ran the adaptive passes
+    static void ApplyAdaptiveResolution(uint32_t splitBudget);
+    // phase classification and active list compaction, leaves the dispatch arguments readable
+    static void BuildActiveList(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList, uint32_t numParticles);
+    // union-find labels and rest shapes of the rigid clusters, empty dispatches unless the solid set changed
+    static void RebuildRigidClusters(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList);
+    static void SolveRigidClusters(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList);
+    // to INDIRECT_ARGUMENT | NON_PIXEL_SHADER_RESOURCE
+    static void TransitionDispatchArgs(ID3D12GraphicsCommandList *cmdList, const StructuredBuffer &args,
+                                       D3D12_RESOURCE_STATES before);
+    // passes below run over the active list
+    static void SolveDensityConstraints(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList);
+    static void SolveDensityDfsph(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList);
+    static void SolveDivergenceDfsph(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList);
+    static void ProbeDensityResidual(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+                                     int iteration, UINT iterationBeginMark);
+    static void SolveViscosityImplicit(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList);
+    static void SolveHeatImplicit(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList, uint32_t numParticles);
+    static void SolveHeatGrid(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList, uint32_t numParticles);
+    // partialCount 0: one partial per thread group of the active list
+    static void DispatchSolverScalars(winrt::com_ptr<ID3D12GraphicsCommandList> cmdList, SolverPass pass,
+                                      uint32_t partialCount, DiagnosticsSlot diagnosticsSlot);
+    static void ReadDiagnostics();
+    // per-particle buffers stored in checkpoints: the side the next step starts from (read side,
+    // write side for velocity), and the other side of swap buffers
+    static std::vector<std::pair<StructuredBuffer *, StructuredBuffer *>> GetCheckpointBuffers();
+    // queues GPU copies of the selected attributes for the trajectory writer, does not wait
+    static void CaptureTrajectory();
+    // collects a finished checkpoint write, wait blocks until the running one is done
+    static void FinishCheckpointWrite(bool wait);
+    static float GetDiagnosticFloat(DiagnosticsSlot slot, UINT offset = 0);
 
     inline static SimParams m_simParams = {};
     inline static winrt::com_ptr<ID3D12Resource> m_simParamsUpload = nullptr;
@@ -74,14 +324,68 @@ private:
     inline static std::unique_ptr<SimulationKernels::ComputeLambda> m_computeLambda = nullptr;
     inline static std::unique_ptr<SimulationKernels::ComputeDeltaPos> m_computeDeltaPos = nullptr;
     inline static std::unique_ptr<SimulationKernels::ApplyDeltaPos> m_applyDeltaPos = nullptr;
+    inline static std::unique_ptr<SimulationKernels::SolverColor> m_solverColor = nullptr;
     inline static std::unique_ptr<SimulationKernels::UpdatePositionVelocity> m_updatePosVel = nullptr;
     inline static std::unique_ptr<SimulationKernels::Viscosity> m_viscosity = nullptr;
     inline static std::unique_ptr<SimulationKernels::ApplyViscosity> m_applyViscosity = nullptr;
     inline static std::unique_ptr<SimulationKernels::HeatTransfer> m_heatTransfer = nullptr;
     inline static std::unique_ptr<SimulationKernels::CollisionProjection> m_collisionProjection = nullptr;
+    inline static std::unique_ptr<SimulationKernels::DensityResidual> m_densityResidual = nullptr;
+    inline static std::unique_ptr<SimulationKernels::StepLimits> m_stepLimits = nullptr;
+    inline static std::unique_ptr<SimulationKernels::HeatCgSetup> m_heatCgSetup = nullptr;
+    inline static std::unique_ptr<SimulationKernels::HeatCgApply> m_heatCgApply = nullptr;
+    inline static std::unique_ptr<SimulationKernels::HeatCgUpdate> m_heatCgUpdate = nullptr;
+    inline static std::unique_ptr<SimulationKernels::HeatCgDirection> m_heatCgDirection = nullptr;
+    inline static std::unique_ptr<SimulationKernels::SolverScalars> m_solverScalars = nullptr;
+    inline static std::unique_ptr<SimulationKernels::ViscosityCgSetup> m_viscosityCgSetup = nullptr;
+    inline static std::unique_ptr<SimulationKernels::ViscosityCgApply> m_viscosityCgApply = nullptr;
+    inline static std::unique_ptr<SimulationKernels::ViscosityCgUpdate> m_viscosityCgUpdate = nullptr;
+    inline static std::unique_ptr<SimulationKernels::ViscosityCgDirection> m_viscosityCgDirection = nullptr;
+    inline static std::unique_ptr<SimulationKernels::DfsphFactor> m_dfsphFactor = nullptr;
+    inline static std::unique_ptr<SimulationKernels::DfsphDensityStiffness> m_dfsphDensityStiffness = nullptr;
+    inline static std::unique_ptr<SimulationKernels::DfsphPressureDelta> m_dfsphPressureDelta = nullptr;
+    inline static std::unique_ptr<SimulationKernels::DfsphDivergenceStiffness> m_dfsphDivergenceStiffness = nullptr;
+    inline static std::unique_ptr<SimulationKernels::ApplyDeltaVelocity> m_applyDeltaVelocity = nullptr;
+    inline static std::unique_ptr<SimulationKernels::ClassifyPhase> m_classifyPhase = nullptr;
+    inline static std::unique_ptr<SimulationKernels::ActiveListScan> m_activeListScan = nullptr;
+    inline static std::unique_ptr<SimulationKernels::ActiveListScatter> m_activeListScatter = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidRebuildArgs> m_rigidRebuildArgs = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidLabelInit> m_rigidLabelInit = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidLabelHook> m_rigidLabelHook = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidLabelCompress> m_rigidLabelCompress = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidClusterScan> m_rigidClusterScan = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidMemberScatter> m_rigidMemberScatter = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidRestShape> m_rigidRestShape = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidPredict> m_rigidPredict = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidContact> m_rigidContact = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidShapeMatch> m_rigidShapeMatch = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidClusterCount> m_rigidClusterCount = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidClusterOffsets> m_rigidClusterOffsets = nullptr;
+    inline static std::unique_ptr<SimulationKernels::RigidSingleMove> m_rigidSingleMove = nullptr;
+    inline static std::unique_ptr<SimulationKernels::EmitParticles> m_emitParticles = nullptr;
+    inline static std::unique_ptr<SimulationKernels::KillMark> m_killMark = nullptr;
+    inline static std::unique_ptr<SimulationKernels::KillScan> m_killScan = nullptr;
+    inline static std::unique_ptr<SimulationKernels::CompactScatter> m_compactScatter = nullptr;
+    inline static std::unique_ptr<SimulationKernels::CompactFinish> m_compactFinish = nullptr;
+    inline static std::unique_ptr<SimulationKernels::AdaptivePair> m_adaptivePair = nullptr;
+    inline static std::unique_ptr<SimulationKernels::AdaptiveApply> m_adaptiveApply = nullptr;
+    inline static std::unique_ptr<SimulationKernels::HeatGridSplat> m_heatGridSplat = nullptr;
+    inline static std::unique_ptr<SimulationKernels::HeatGridSetup> m_heatGridSetup = nullptr;
+    inline static std::unique_ptr<SimulationKernels::HeatGridJacobi> m_heatGridJacobi = nullptr;
+    inline static std::unique_ptr<SimulationKernels::HeatGridGather> m_heatGridGather = nullptr;
+    inline static std::unique_ptr<SimulationKernels::SurfaceClassify> m_surfaceClassify = nullptr;
+    inline static std::unique_ptr<SimulationKernels::SurfaceArgs> m_surfaceArgs = nullptr;
+    inline static std::unique_ptr<SimulationKernels::SurfaceCooling> m_surfaceCooling = nullptr;
     inline static std::unique_ptr<OneSweep> m_oneSweep = nullptr;
 
     inline static winrt::com_ptr<ID3D12RootSignature> m_rootSignature = nullptr;
+    inline static winrt::com_ptr<ID3D12CommandSignature> m_dispatchSignature = nullptr;
+    inline static IndirectDispatch m_activeDispatch = {};
+    inline static IndirectDispatch m_rigidRebuildDispatch = {}; // all particles, or nothing
+    inline static IndirectDispatch m_rigidClusterDispatch = {}; // clusters of two or more, groups stride over them
+    inline static IndirectDispatch m_rigidSolidDispatch = {};   // solid particles
+    inline static IndirectDispatch m_rigidSingleDispatch = {};  // single-particle clusters
+    inline static IndirectDispatch m_surfaceDispatch = {};      // surface list
 
     inline static ID3D12DescriptorHeap *m_uavHeap = nullptr;
 
@@ -94,7 +398,13 @@ private:
     inline static UINT m_pingPongUavBase = 0;
 
     const static int m_gridCellsCount = 1 << 12;
-    const static int m_maxParticlesCount = 1 << 15; // TODO: move to params?
+    // heat grid nodes per neighbor grid cell and axis, spacing cellSize / 2 = 2h
+    const static int m_heatGridSubdivision = 2;
+    const static int m_heatGridNodeCount = m_gridCellsCount * m_heatGridSubdivision * m_heatGridSubdivision * m_heatGridSubdivision;
+    inline static uint32_t m_particleCapacity = 1 << 15;
+    inline static uint32_t m_maxParticleCapacity = 1 << 26;
+    const static int m_maxEmittedPerStep = 1 << 12;
+    inline static uint32_t m_initialParticleCount = 0;
     inline static unsigned int m_currentSwapIndex = 0;
 
     inline static ParticleStateSwapBuffers particleSwapBuffers;
@@ -102,4 +412,165 @@ private:
     inline static SortBuffers sortBuffers;
 
     inline static bool isRunning = false;
+    inline static InitialScene m_initialScene = InitialScene::DenseBottomWithSphere;
+
+    inline static PressureSolver m_pressureSolver = PressureSolver::Pbf;
+    inline static int m_dfsphDensityIterations = 4;
+    inline static int m_dfsphDivergenceIterations = 2;
+    inline static PbfSolverMode m_pbfSolverMode = PbfSolverMode::Jacobi;
+    inline static int m_pbfIterations = 10;
+    inline static bool m_convergenceProbe = false;
+
+    inline static int m_thermalInterval = 1;
+    inline static int m_viscosityInterval = 1;
+    inline static uint64_t m_stepIndex = 0;
+    inline static float m_thermalAccumDt = 0.0f;
+
+    inline static HeatSolverMode m_heatSolverMode = HeatSolverMode::Explicit;
+    inline static int m_heatSolverIterations = 50;
+    inline static bool m_heatSolvedThisStep = false;
+    // CG iterations and final relative residual per implicit heat solve
+    inline static TimeAccumulator m_heatSolverIterationStats;
+    inline static TimeAccumulator m_heatSolverResidualStats;
+
+    inline static ViscositySolverMode m_viscositySolverMode = ViscositySolverMode::Xsph;
+    inline static int m_viscositySolverIterations = 30;
+    inline static TimeAccumulator m_viscositySolverIterationStats;
+    inline static TimeAccumulator m_viscositySolverResidualStats;
+
+    inline static uint32_t m_lastActiveCount = 0;
+    inline static uint32_t m_minActiveCount = UINT32_MAX;
+    inline static TimeAccumulator m_activeCountStats; // per step
+    inline static uint64_t m_timeLevelTotals[k_maxTimeLevels] = {}; // active particles per time level, summed over steps
+
+    inline static int m_surfaceInterval = 10;
+    inline static bool m_surfaceListStale = true; // indices moved, reclassify before the next use
+    inline static uint32_t m_lastSurfaceCount = 0;
+    inline static TimeAccumulator m_surfaceCountStats; // per step
+
+    inline static bool m_rigidFullRebuildPending = true;
+    inline static TimeAccumulator m_rigidSolidStats;   // per step
+    inline static TimeAccumulator m_rigidClusterStats; // per step
+    inline static size_t m_rigidRebuilds[3] = {0, 0, 0}; // steps per RigidRebuild mode
+
+    inline static std::vector<ParticleEmitter> m_emitters;
+    inline static ParticleSlotPool m_slotPool;
+    // persistently mapped; the step waits for the GPU, so one queue is never overwritten in flight
+    inline static winrt::com_ptr<ID3D12Resource> m_emitUpload = nullptr;
+    inline static EmittedParticle *m_emitUploadData = nullptr;
+    inline static size_t m_emittedTotal = 0;
+    inline static TimeAccumulator m_emittedStats;  // per step
+    inline static TimeAccumulator m_emitQueueStats; // CPU ms per step
+    inline static uint32_t m_nextParticleId = 0;
+
+    struct CapacityGrowth
+    {
+        uint64_t step;
+        uint32_t oldCapacity;
+        uint32_t newCapacity;
+        UINT64 bytes; // all per-particle buffers after the growth
+        double ms;    // wall, GPU copies included
+    };
+    inline static std::vector<CapacityGrowth> m_capacityGrowths;
+
+    inline static uint32_t m_lastKilledCount = 0;
+    inline static size_t m_killedTotal = 0;
+    inline static TimeAccumulator m_compactionStats; // wall ms per compaction, GPU waits included
+
+    inline static std::vector<SignedDistanceField> m_obstacles; // uploaded at Init
+    inline static TimeAccumulator m_obstacleBuildStats;         // wall ms per voxelized obstacle
+
+    inline static std::unique_ptr<Heightfield> m_terrain = nullptr;
+    inline static float m_terrainScale = 0.0f; // world units per map unit
+    inline static double m_terrainLoadMs = 0.0;
+
+    inline static std::unique_ptr<Scene> m_scene = nullptr; // fills sampled at Init
+    inline static std::filesystem::path m_scenePath;
+    inline static double m_sceneLoadMs = 0.0;     // parsing and mesh files
+    inline static double m_sceneGenerateMs = 0.0; // spacing search and sampling at Init
+    inline static float m_sceneSpacing = 0.0f;
+    inline static std::optional<Scene::Sampler> m_sceneSampler; // replaces the file's
+    inline static std::filesystem::path m_settledBlockCache = "settled_blocks";
+    inline static std::unique_ptr<SettledBlock> m_settledBlock = nullptr; // the relaxed sampler's tile
+    inline static double m_settledBlockMs = 0.0; // cache read or relaxation
+    struct DensityError
+    {
+        size_t particles;
+        double meanError;  // mean |rho / rho0 - 1|
+        double maxError;
+        double compressed; // fraction of particles above rho0 by more than 1 %
+    };
+    inline static DensityError m_initialDensity = {};
+    inline static bool m_samplerBenchmark = false;
+    struct SamplerBenchmarkSample
+    {
+        std::string sampler;
+        double ms;
+        DensityError density; // particles at least h inside the test box
+    };
+    inline static std::vector<SamplerBenchmarkSample> m_samplerBenchmarkSamples;
+
+    inline static TriangleMesh m_obstacleMesh; // all mesh obstacles in world units
+    inline static size_t m_obstacleMeshFiles = 0;
+    inline static MeshBvh m_meshBvh;
+    inline static double m_meshLoadMs = 0.0;
+    inline static double m_meshBuildMs = 0.0;     // BVH and cell roots at Init
+    inline static double m_meshAvgCellRoots = 0.0; // subtrees per non-empty cell list
+    inline static bool m_meshBenchmark = false;
+    struct MeshBenchmarkSample
+    {
+        size_t triangles;
+        uint32_t depth;
+        double buildMs;
+        double batchedQueriesPerSec;
+        double singleQueriesPerSec;
+    };
+    inline static std::vector<MeshBenchmarkSample> m_meshBenchmarkSamples;
+
+    inline static std::filesystem::path m_checkpointPath;
+    inline static int m_checkpointInterval = 0;
+    struct CheckpointWrite
+    {
+        uint64_t bytes;
+        double ms;
+    };
+    inline static std::future<CheckpointWrite> m_checkpointWrite; // background write in flight
+    // reused, a save waits until the previous write is done with it
+    inline static winrt::com_ptr<ID3D12Resource> m_checkpointReadback = nullptr;
+    inline static UINT64 m_checkpointReadbackBytes = 0;
+    inline static uint64_t m_lastCheckpointStep = 0;
+    inline static size_t m_checkpointsWritten = 0;
+    inline static size_t m_checkpointsSkipped = 0; // previous write still running
+    inline static uint64_t m_checkpointBytes = 0;  // last file size
+    inline static TimeAccumulator m_checkpointStallStats; // step loop ms per save: GPU copy and wait
+    inline static TimeAccumulator m_checkpointWriteStats; // background ms per file
+    inline static std::unique_ptr<Checkpoint> m_restart = nullptr; // mapped until Init
+    inline static std::filesystem::path m_restartPath;
+    inline static uint64_t m_restartStep = 0;
+    inline static double m_restartTime = 0.0; // simulated time at the checkpoint
+    inline static double m_restartLoadMs = 0.0; // mapping, checks and restoring, GPU uploads included
+
+    inline static std::unique_ptr<TrajectoryWriter> m_trajectory = nullptr;
+    inline static uint64_t m_frameIndex = 0; // Simulate calls that ran at least one step
+
+    inline static int m_adaptiveInterval = 10;
+    inline static size_t m_splitTotal = 0;
+    inline static size_t m_mergeTotal = 0;
+    inline static std::vector<uint32_t> m_levelCounts; // particles per level after the last adaptive pass
+    struct AdaptiveSample
+    {
+        double time;
+        uint32_t particles;
+        double uniformParticles; // same volume at the finest level everywhere
+    };
+    inline static std::vector<AdaptiveSample> m_adaptiveSamples;
+
+    inline static winrt::com_ptr<ID3D12Resource> m_diagnosticsReadback = nullptr;
+    inline static std::vector<uint32_t> m_diagnostics;
+
+    inline static GpuProfiler m_profiler;
+    inline static StepController m_stepController;
+    inline static ConvergenceLog m_convergenceLog;
+    // (iteration begin, iteration end) profiler marks of the probed solver iterations
+    inline static std::vector<std::pair<UINT, UINT>> m_probeMarks;
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "pch.h"
+#include "Particle.h"
+#include "Time.h"
+
+// per-step maxima read back from the GPU (see StepLimits kernel)
+struct StepLimitValues
+{
+    float maxSpeed = 0.0f;
+    float maxViscosity = 0.0f;
+    float maxConductivity = 0.0f;
+};
+
+// Picks the simulation time step from CFL and diffusion limits and splits
+// a requested interval (usually the frame time) into equal substeps.
+class StepController
+{
+public:
+    struct Settings
+    {
+        float cflNumber = 0.4f;      // dt <= cfl * h / max|v|
+        float forceNumber = 0.25f;   // dt <= c * sqrt(h / |g|)
+        float viscousNumber = 0.125f; // dt <= c * h^2 / nu, nu = mu / rho0
+        float thermalNumber = 0.125f; // dt <= c * h^2 / alpha, alpha = k / rho0
+        float coolingRate = 5.0f;    // heatLossCoeff of 12_HeatTransfer.hlsl, dt <= 1 / rate
+        float minDt = 1e-5f;
+        float maxDt = 1.0f / 60.0f;
+        int maxSubsteps = 16;
+        // intervals shorter than this fraction of the stable dt are carried over to the next call
+        float minStepFraction = 0.5f;
+        // > 0: deterministic fixed stepping, stability limits are ignored
+        float fixedDt = 0.0f;
+        // heat transfer runs every Nth step with N accumulated steps, its limits are divided by N
+        int thermalInterval = 1;
+        // implicit heat conduction is unconditionally stable, thermal and cooling limits are skipped
+        bool implicitThermal = false;
+        // same for the viscous limit with implicit viscosity
+        bool implicitViscosity = false;
+        // local time stepping: particles advance with 2^L substeps, L < timeLevels picked from the
+        // local CFL; the substep dt stays the finest stable dt, 1 = every particle every substep
+        int timeLevels = 1;
+    };
+
+    // stepping state carried across a restart, statistics excluded
+    struct State
+    {
+        float stableDt;
+        float carriedTime;
+        float nonAdvectiveDt;
+        uint32_t substepCounter;
+        std::array<float, 1u << (k_maxTimeLevels - 1)> recentDts;
+    };
+
+    void SetSettings(const Settings &settingsIn);
+    const Settings &GetSettings() const { return settings; }
+
+    // recomputes the stable dt from the latest step maxima
+    void UpdateLimits(const StepLimitValues &limits, const SimParams &params);
+
+    // returns the number of substeps to run for the requested interval and their dt (may be 0)
+    int PlanInterval(float interval, float &substepDt);
+    // time level parameters of the next substep: counter, catch-up dt per level, highest level
+    void BeginSubstep(float dt, SimParams &params);
+
+    float GetStableDt() const { return stableDt; }
+    int GetLastSubstepCount() const { return lastSubsteps; }
+    double GetSimulatedTime() const { return simulatedTime; }
+
+    State GetState() const { return {stableDt, carriedTime, nonAdvectiveDt, substepCounter, recentDts}; }
+    // after SetSettings, which resets the state
+    void SetState(const State &state);
+
+    void PrintReport(std::ostream &os) const;
+
+private:
+    Settings settings;
+    float stableDt = 1.0f / 60.0f;
+    float carriedTime = 0.0f;
+    int lastSubsteps = 0;
+    // stable dt without the advection limit, bounds the coarsest time level
+    float nonAdvectiveDt = 1.0f / 60.0f;
+    uint32_t substepCounter = 0;
+    std::array<float, 1u << (k_maxTimeLevels - 1)> recentDts = {}; // ring of the last substep dts
+
+    TimeAccumulator substepCounts; // per requested interval
+    TimeAccumulator substepDts;    // per substep
+    double droppedTime = 0.0;      // time discarded because maxSubsteps was hit
+    double simulatedTime = 0.0;
+    float peakSpeed = 0.0f;        // largest max |v| seen, blow-ups show up here
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "pch.h"
+#include "TrajectoryFormat.h"
+
+// Quantized trajectory frames. Positions become 16.16 fixed point coordinates: the high half
+// picks a cube of the quantization cell size, the low half the offset in it. Temperatures
+// become 16 bits over the file's range. Particles are sorted by block of
+// k_trajectoryBlockCells^3 cubes, then by cube, then by id. Every block is encoded on its
+// own, so blocks encode in parallel and decode independently.
+//
+// Payload: uint32 block count, a TrajectoryBlockEntry per block, then the blocks. The block
+// table is the frame's spatial index, readers decode only the blocks a query touches. A block is a
+// uint32 cell count and a TrajectoryCellEntry per cell, then the streams, each a uint32 byte
+// count and the data: ids, x, y, z, temperature if selected, velocity if selected. Ids are
+// packed zigzag differences to the previous id. Keyframes store x, y, z and temperature as
+// uint16 arrays. Delta frames pack the zigzag difference to the same particle in the
+// keyframe, or to the cube origin and 0 for particles the keyframe does not have. Packed
+// streams are groups of 128 values, each a width byte and the values at that many bits.
+// Velocities stay float3.
+constexpr uint32_t k_trajectoryBlockCells = 4; // cubes per block and axis
+
+struct TrajectoryBlockEntry
+{
+    uint16_t block[3]; // block coordinates
+    uint16_t pad;
+    uint32_t particleCount;
+    uint32_t cellCount;
+    uint64_t offset; // from the start of the payload
+    uint64_t bytes;
+};
+
+struct TrajectoryCellEntry
+{
+    uint8_t cell[3]; // cube within the block
+    uint8_t pad;
+    uint32_t particleCount;
+};
+
+struct TrajectoryQuantization
+{
+    Vector3 origin;
+    float cellSize;
+    float temperatureMin;
+    float temperatureMax;
+
+    double GetPositionStep() const { return double(cellSize) / 65536.0; }
+    double GetTemperatureStep() const { return double(temperatureMax - temperatureMin) / 65535.0; }
+};
+
+// quantized keyframe values by particle id, what the delta frames after it refer to
+struct TrajectoryKeyframe
+{
+    static constexpr uint32_t k_absent = 0xffffffffu;
+    std::vector<uint32_t> indexOfId; // k_absent for ids the keyframe does not have
+    std::vector<uint32_t> q[3];      // 16.16 coordinates in block order
+    std::vector<uint16_t> temperature;
+};
+
+// one frame in capture order, null for attributes that are not selected
+struct TrajectoryFrameView
+{
+    uint32_t count = 0;
+    const Vector3 *positions = nullptr;
+    const Vector3 *velocities = nullptr;
+    const float *temperatures = nullptr;
+    const uint32_t *ids = nullptr;
+};
+
+// largest absolute errors of a frame
+struct TrajectoryErrors
+{
+    float position = 0.0f; // per axis
+    float temperature = 0.0f;
+};
+
+// decoded particles, arrays of attributes that are not selected stay empty
+struct TrajectoryParticles
+{
+    std::vector<Vector3> positions;
+    std::vector<Vector3> velocities;
+    std::vector<float> temperatures;
+    std::vector<uint32_t> ids;
+
+    void Resize(size_t count, uint32_t attributes);
+    size_t GetCount() const;
+    // drops the particles outside the box, keeping the order; needs positions
+    void KeepInside(const Vector3 &boxMin, const Vector3 &boxMax);
+};
+
+// Encodes a frame with positions and ids into out. Without a reference the frame becomes a
+// keyframe, and its values for later deltas go into keyframeOut if given.
+TrajectoryErrors EncodeTrajectoryFrame(const TrajectoryFrameView &frame, uint32_t attributes,
+                                       const TrajectoryQuantization &quantization, const TrajectoryKeyframe *reference,
+                                       TrajectoryKeyframe *keyframeOut, std::vector<uint8_t> &out);
+
+// the block table of a payload, bounds-checked; throws std::runtime_error on malformed data
+std::vector<TrajectoryBlockEntry> ReadTrajectoryBlockTable(const uint8_t *payload, uint64_t bytes);
+
+// world-space box covered by a block
+void GetTrajectoryBlockBounds(const TrajectoryBlockEntry &block, const TrajectoryQuantization &quantization,
+                              Vector3 &boxMin, Vector3 &boxMax);
+
+// Decodes the given entries of the payload's block table, in that order, with the reference
+// the frame was encoded against. keyframeOut needs every block of a keyframe.
+void DecodeTrajectoryBlocks(const uint8_t *payload, const std::vector<TrajectoryBlockEntry> &blocks, uint32_t attributes,
+                            const TrajectoryQuantization &quantization, const TrajectoryKeyframe *reference,
+                            TrajectoryKeyframe *keyframeOut, TrajectoryParticles &out);
+
+// Decodes a whole payload of EncodeTrajectoryFrame with the same reference; keyframeOut as
+// there. Throws std::runtime_error on malformed data.
+void DecodeTrajectoryFrame(const uint8_t *payload, uint64_t bytes, uint32_t attributes,
+                           const TrajectoryQuantization &quantization, const TrajectoryKeyframe *reference,
+                           TrajectoryKeyframe *keyframeOut, TrajectoryParticles &out);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "pch.h"
+
+// Trajectory file: a file header, then one record per captured frame, a frame header
+// followed by the payload. Several writer threads append records, so frames may be stored
+// out of order; the frame header holds the index. Raw payloads are the selected attribute
+// arrays in bit order, quantized payloads are described in TrajectoryCodec.h. Closing the
+// file appends the frame offset table: a uint64 count, then the record offset of every frame
+// by index, 0 for frames that failed to write.
+constexpr char k_trajectoryMagic[8] = {'L', 'A', 'V', 'A', 'T', 'R', 'A', 'J'};
+constexpr uint32_t k_trajectoryVersion = 3;
+
+enum class TrajectoryEncoding : uint32_t
+{
+    Raw,       // float arrays in capture order
+    Quantized, // 16-bit positions and temperatures in block order, deltas against keyframes
+};
+
+enum TrajectoryAttribute : uint32_t
+{
+    TrajectoryPosition = 1 << 0,    // float3
+    TrajectoryVelocity = 1 << 1,    // float3
+    TrajectoryTemperature = 1 << 2, // float
+    TrajectoryParticleId = 1 << 3,  // uint
+};
+constexpr uint32_t k_trajectoryAttributeCount = 4;
+
+// bytes per particle of one attribute bit
+constexpr uint32_t TrajectoryAttributeStride(uint32_t attribute)
+{
+    return attribute == TrajectoryPosition || attribute == TrajectoryVelocity ? 3 * sizeof(float) : 4;
+}
+
+struct TrajectoryFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t attributes; // TrajectoryAttribute bits
+    uint64_t frameCount; // written when the file is closed, 0 while it is being written
+    TrajectoryEncoding encoding;
+    uint32_t keyframeInterval; // quantized: every Nth frame is a keyframe, the rest are deltas against it
+    float quantizationOrigin[3]; // quantized: world position of coordinate 0
+    float quantizationCellSize;  // quantized: positions are 16-bit offsets in cubes of this size
+    float temperatureMin;        // quantized: temperatures are 16 bits over [min, max]
+    float temperatureMax;
+    uint64_t indexOffset; // frame offset table, 0 until the file is closed
+};
+static_assert(sizeof(TrajectoryFileHeader) == 64);
+
+struct TrajectoryFrameHeader
+{
+    uint64_t frame; // capture index, 0 for the first frame in the file
+    uint64_t step;  // simulation step at the capture
+    double time;    // simulated seconds
+    uint32_t particleCount;
+    uint32_t attributes;
+    uint64_t payloadBytes; // after this header
+    uint64_t keyframe;     // frame the deltas refer to, frame itself for keyframes and raw frames
+    float positionError;   // largest measured error of the quantized frame
+    float temperatureError;
+};
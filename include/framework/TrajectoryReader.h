@@ -0,0 +1,58 @@
+#pragma once
+
+#include "pch.h"
+#include "MappedFile.h"
+#include "TrajectoryFormat.h"
+#include "TrajectoryCodec.h"
+
+// Random access to a trajectory file through a read-only mapping. Frames are found through
+// the offset table, or by walking the records of a file that was not closed. Box queries on
+// quantized frames decode only the blocks that intersect the box. A delta frame needs its
+// keyframe, which is decoded once and kept for the following frames of its group.
+class TrajectoryReader
+{
+public:
+    struct ReadStats
+    {
+        uint32_t blocksDecoded = 0;
+        uint32_t blocksTotal = 0;
+        bool keyframeDecoded = false; // the query had to decode its keyframe first
+    };
+
+    // throws std::runtime_error on files that are not trajectories or are damaged
+    explicit TrajectoryReader(const std::filesystem::path &path);
+
+    const TrajectoryFileHeader &GetHeader() const { return header; }
+    const TrajectoryQuantization &GetQuantization() const { return quantization; }
+    // frames by index, including any that failed to write
+    uint64_t GetFrameCount() const { return frameOffsets.size(); }
+    bool HasFrame(uint64_t frame) const { return frame < frameOffsets.size() && frameOffsets[frame] != 0; }
+    // true when the file was closed and the offset table was used
+    bool IsIndexed() const { return header.indexOffset != 0; }
+
+    // throw std::runtime_error for frames that do not exist
+    TrajectoryFrameHeader GetFrameHeader(uint64_t frame) const;
+    void ReadFrame(uint64_t frame, TrajectoryParticles &out);
+    // only the particles inside [boxMin, boxMax]
+    void ReadFrame(uint64_t frame, const Vector3 &boxMin, const Vector3 &boxMax, TrajectoryParticles &out);
+
+    const ReadStats &GetLastReadStats() const { return lastRead; }
+
+private:
+    void ScanRecords();
+    const uint8_t *GetPayload(uint64_t frame, TrajectoryFrameHeader &frameHeader) const;
+    void ReadRawFrame(const TrajectoryFrameHeader &frameHeader, const uint8_t *payload, TrajectoryParticles &out) const;
+    // the decoded keyframe a quantized frame refers to, null for keyframes
+    const TrajectoryKeyframe *GetReference(const TrajectoryFrameHeader &frameHeader);
+
+    std::filesystem::path path;
+    MappedFile file;
+    TrajectoryFileHeader header = {};
+    TrajectoryQuantization quantization = {};
+    std::vector<uint64_t> frameOffsets;
+
+    uint64_t cachedKeyframe = UINT64_MAX;
+    TrajectoryKeyframe keyframe;
+    TrajectoryParticles keyframeParticles;
+    ReadStats lastRead;
+};
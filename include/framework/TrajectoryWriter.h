@@ -0,0 +1,135 @@
+#pragma once
+
+#include "pch.h"
+#include "StructuredBuffer.h"
+#include "TrajectoryFormat.h"
+#include "TrajectoryCodec.h"
+#include "BoundedQueue.h"
+#include "Time.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// Streams particle attributes to a trajectory file without stalling the step loop. Capture
+// records GPU copies of the selected buffers into a pooled readback slot and queues the
+// slot; writer threads wait for the copy and append the frame at the next free file
+// offset. When every slot is in flight, Capture waits for one to come back (backpressure).
+// Quantized files are encoded on the writer threads; a delta frame waits until the
+// keyframe it refers to is encoded.
+class TrajectoryWriter
+{
+public:
+    struct Settings
+    {
+        std::filesystem::path path;
+        uint32_t attributes = TrajectoryPosition | TrajectoryTemperature;
+        int interval = 1;   // every Nth frame
+        uint32_t slots = 4; // frames in flight
+        uint32_t threads = 2;
+        TrajectoryEncoding encoding = TrajectoryEncoding::Raw;
+        uint32_t keyframeInterval = 32; // quantized: captured frames per keyframe
+        float positionError = 0.0f;     // quantized: largest position error, 0 for the grid cell / 2^17
+        float temperatureMin = 0.0f;    // quantized: range of the 16-bit temperatures, values outside are clamped
+        float temperatureMax = 2000.0f;
+    };
+
+    struct Frame
+    {
+        uint64_t step;
+        double time;
+        uint32_t particleCount;
+    };
+
+    // creates the file and starts the writer threads; throws std::runtime_error
+    explicit TrajectoryWriter(const Settings &settingsIn);
+    ~TrajectoryWriter() { Finish(); }
+
+    // writes the frames in flight and the final file header, no captures afterwards
+    void Finish();
+
+    const Settings &GetSettings() const { return settings; }
+
+    // quantized files: cubes default to gridCellSize, origin is the grid origin; before the first capture
+    void SetQuantizationGrid(const Vector3 &origin, float gridCellSize);
+
+    // sources: one buffer per selected attribute, in bit order; they are kept alive until
+    // their copy has run
+    void Capture(ID3D12Device *device, ID3D12CommandQueue *queue, const Frame &frame,
+                 const std::vector<std::shared_ptr<StructuredBuffer>> &sources);
+
+    void PrintReport(std::ostream &os) const;
+
+private:
+    struct Slot
+    {
+        winrt::com_ptr<ID3D12Resource> readback;
+        UINT64 capacity = 0;
+        winrt::com_ptr<ID3D12CommandAllocator> allocator;
+        winrt::com_ptr<ID3D12GraphicsCommandList> commandList;
+        std::vector<std::shared_ptr<StructuredBuffer>> sources;
+        uint64_t fenceValue = 0;
+        TrajectoryFrameHeader header = {};
+    };
+
+    // pops a slot index, sleeping while the queue is empty; false once stopping with nothing left
+    bool WaitPop(BoundedQueue<uint32_t> &queue, std::atomic<uint32_t> &signal, uint32_t &slotIndex, bool untilStopped);
+    void Push(BoundedQueue<uint32_t> &queue, std::atomic<uint32_t> &signal, uint32_t slotIndex);
+    void WriterLoop();
+    // encodes the mapped readback of a slot into encoded, returns the frame's errors
+    TrajectoryErrors Encode(const Slot &slot, const void *mapped, std::vector<uint8_t> &encoded);
+    TrajectoryFileHeader MakeHeader() const;
+    void WriteAt(uint64_t offset, const void *data, uint64_t bytes);
+
+    Settings settings;
+    wil::unique_hfile file;
+    std::vector<Slot> slots;
+    BoundedQueue<uint32_t> freeSlots;
+    BoundedQueue<uint32_t> filledSlots;
+    // bumped after every push, sleeping poppers wait on them
+    std::atomic<uint32_t> freeSignal = 0;
+    std::atomic<uint32_t> filledSignal = 0;
+    std::atomic<bool> stopping = false;
+    std::vector<std::thread> writers;
+
+    winrt::com_ptr<ID3D12Fence> fence;
+    uint64_t fenceValue = 0;
+    uint64_t nextFrame = 0;
+    std::atomic<uint64_t> fileEnd = sizeof(TrajectoryFileHeader);
+    std::mutex indexMutex;
+    std::vector<uint64_t> frameOffsets; // record offset by frame index, written by Finish
+
+    // Quantized files: the keyframe of every group with frames still to be written, by group
+    // index. A group is erased once all of its keyframeInterval frames are written, so a
+    // delta frame always reads the keyframe its header names, however the writers reorder.
+    struct KeyframeGroup
+    {
+        TrajectoryKeyframe keyframe;
+        bool encoded = false; // the deltas may read keyframe
+        bool failed = false;  // the keyframe was not written, nor can its deltas be
+        uint32_t framesLeft = 0;
+    };
+    // a frame of the group is done with its keyframe; the keyframe itself also publishes it
+    void ReleaseKeyframe(uint64_t group, bool isKeyframe, bool failed);
+
+    TrajectoryQuantization quantization = {};
+    std::mutex keyframeMutex;
+    std::condition_variable keyframeEncoded;
+    std::map<uint64_t, KeyframeGroup> keyframeGroups;
+
+    // statistics, the atomics are updated by the writer threads
+    TimeAccumulator captureStats; // ms on the step loop per capture, waits included
+    size_t stalledCaptures = 0;
+    double stalledMs = 0.0;
+    std::atomic<uint64_t> framesWritten = 0;
+    std::atomic<uint64_t> bytesWritten = 0;
+    std::atomic<uint64_t> writeNanoseconds = 0; // summed over the writer threads
+    std::atomic<uint64_t> rawBytes = 0;          // frame records before encoding
+    std::atomic<uint64_t> encodeNanoseconds = 0;
+    std::atomic<float> maxPositionError = 0.0f;
+    std::atomic<float> maxTemperatureError = 0.0f;
+    mutable std::mutex errorMutex;
+    std::string firstError;
+};
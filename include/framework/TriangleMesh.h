@@ -0,0 +1,18 @@
+#pragma once
+
+#include "pch.h"
+
+// Indexed triangles, e.g. obstacles loaded from Wavefront OBJ files.
+struct TriangleMesh
+{
+    std::vector<Vector3> vertices;
+    std::vector<uint32_t> indices; // three per triangle, counter-clockwise seen from outside
+
+    size_t GetTriangleCount() const { return indices.size() / 3; }
+
+    // v and f records only, polygons are fanned into triangles, negative indices count back
+    // from the last vertex; throws std::runtime_error
+    static TriangleMesh LoadObj(const std::filesystem::path &path);
+    // appends other, scaled by scale and then moved by offset
+    void Append(const TriangleMesh &other, float scale = 1.0f, const Vector3 &offset = Vector3::Zero);
+};
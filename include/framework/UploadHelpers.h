@@ -15,4 +15,18 @@ namespace UploadHelpers
         UINT64 size,
         D3D12_RESOURCE_STATES before,
         D3D12_RESOURCE_STATES after);
+
+    // READBACK heap buffer, stays in COPY_DEST
+    winrt::com_ptr<ID3D12Resource> CreateReadbackBuffer(ID3D12Device *device, UINT64 size);
+
+    // Copy src into a readback resource; src is transitioned 'state' -> COPY_SOURCE -> 'state'
+    void CopyResourceToReadback(
+        ID3D12GraphicsCommandList *cmdList,
+        ID3D12Resource *srcResource,
+        ID3D12Resource *readbackResource,
+        UINT64 size,
+        D3D12_RESOURCE_STATES state);
+
+    // Map a readback resource and copy its first 'size' bytes out
+    void ReadbackToHost(ID3D12Resource *readbackResource, void *dst, UINT64 size);
 }
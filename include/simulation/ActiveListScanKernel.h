@@ -0,0 +1,39 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Active List Scan Kernel
+     * Exclusive scan of the per-group active counts in a single thread group; writes the
+     * indirect dispatch arguments of the active list and the active count diagnostic.
+     *
+     * Input: active count per group
+     * Output: active group offsets, active args, diagnostics
+     */
+    class ActiveListScan : public SimulationComputeKernelBase
+    {
+    public:
+        ActiveListScan(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+        {
+            SetPipelineState(cmdList);
+            cmdList->Dispatch(1, 1, 1);
+        }
+    };
+}
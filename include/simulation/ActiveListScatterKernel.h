@@ -0,0 +1,42 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Active List Scatter Kernel
+     * Writes the indices of the active particles to the active list in grid order, and
+     * copies the velocity of waiting and sleeping particles to the other ping-pong half.
+     *
+     * Input: phase, active group offsets, velocities the step starts from (bound as read)
+     * Output: active indices, velocities of the other half (bound as write)
+     */
+    class ActiveListScatter : public SimulationComputeKernelBase
+    {
+    public:
+        ActiveListScatter(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
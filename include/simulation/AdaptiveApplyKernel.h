@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Adaptive Apply Kernel
+     * Runs over all particles after the pairing. Splits marked particles into two of half the
+     * mass, the children are appended after numParticles up to the split budget, and merges
+     * mutual pairs into one particle; the other one is flagged killed for the compaction.
+     *
+     * Input: partner, particle state
+     * Output: particle state, level, split/merge counts and level histogram
+     */
+    class AdaptiveApply : public SimulationComputeKernelBase
+    {
+    public:
+        AdaptiveApply(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Adaptive Pair Kernel
+     * Runs over all particles at the end of a step. Marks fast and surface particles for
+     * splitting and lets slow, cold interior particles pick the nearest merge candidate of
+     * their level inside their smoothing length. Clears the adaptive diagnostics.
+     *
+     * Input: positions, velocity, temperature, density, level, grid of the step
+     * Output: partner per particle (active list buffer)
+     */
+    class AdaptivePair : public SimulationComputeKernelBase
+    {
+    public:
+        AdaptivePair(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Apply Delta Velocity Kernel
+     * Adds the divergence-free correction in deltaP to the velocities and clears deltaP.
+     */
+    class ApplyDeltaVelocity : public SimulationComputeKernelBase
+    {
+    public:
+        ApplyDeltaVelocity(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Classify Phase Kernel
+     * Runs over all particles at the start of a step. Puts calm, cooled particles to sleep
+     * after sleepSteps steps and wakes sleepers that are hot or touched by moving lava.
+     * Sleepers are pinned as static neighbors (zero velocity, lambda and stiffness).
+     *
+     * Input: positions, temperature, grid of the previous step
+     * Output: phase, active count per thread group
+     */
+    class ClassifyPhase : public SimulationComputeKernelBase
+    {
+    public:
+        ClassifyPhase(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
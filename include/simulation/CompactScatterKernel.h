@@ -0,0 +1,42 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Compact Scatter Kernel
+     * Moves the state of the surviving particles to their compacted index, preserving
+     * their order. Ping-pong state goes to the spare buffers, the rest to scratch.
+     *
+     * Input: particle state, phase, survivor offsets
+     * Output: spare position / velocity / temperature buffers, predicted positions, compact scratch
+     */
+    class CompactScatter : public SimulationComputeKernelBase
+    {
+    public:
+        CompactScatter(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
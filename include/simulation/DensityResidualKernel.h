@@ -0,0 +1,39 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Density Residual Kernel
+     * Reduces the density constraint |C_i| over all particles in a single thread group
+     * and stores mean / max into the diagnostics buffer slot of the current iteration.
+     *
+     * Input: constraint values (after ComputeDensity)
+     * Output: diagnostics[DensityResidual + 2 * passIndex]
+     */
+    class DensityResidual : public SimulationComputeKernelBase
+    {
+    public:
+        DensityResidual(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+        {
+            SetPipelineState(cmdList);
+            cmdList->Dispatch(1, 1, 1);
+        }
+    };
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief DFSPH Density Stiffness Kernel
+     * Stiffness of one constant density iteration from the density error, accumulated into
+     * kappa for warm starting. With PassFlagWarmStart the scaled kappa of the previous step is used.
+     *
+     * Input: density, lambda (alpha)
+     * Output: stiffness, kappa
+     */
+    class DfsphDensityStiffness : public SimulationComputeKernelBase
+    {
+    public:
+        DfsphDensityStiffness(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
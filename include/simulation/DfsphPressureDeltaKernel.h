@@ -0,0 +1,42 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief DFSPH Pressure Delta Kernel
+     * delta_i = -sum_j m (s_i + s_j) grad W_ij from the current stiffness; a position correction
+     * in the constant density pass, a velocity correction in the divergence-free pass.
+     *
+     * Input: predicted positions, stiffness
+     * Output: deltaP
+     */
+    class DfsphPressureDelta : public SimulationComputeKernelBase
+    {
+    public:
+        DfsphPressureDelta(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Emit Particles Kernel
+     * Writes the particles queued by the emitters into their slots and resets the
+     * per-particle solver state of recycled slots.
+     *
+     * Input: emit queue
+     * Output: positions, velocities, temperature, predicted positions, phase, solver state
+     */
+    class EmitParticles : public SimulationComputeKernelBase
+    {
+    public:
+        EmitParticles(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t emittedCount)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (emittedCount + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
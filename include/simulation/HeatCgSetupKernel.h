@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Heat CG Setup Kernel
+     * Builds the backward Euler heat conduction system for thermalDt, starts the
+     * Jacobi-preconditioned CG solve from the current temperatures and writes the
+     * per-group partials of r.z and r.r.
+     *
+     * Input: predicted positions, density, temperature (read buffer)
+     * Output: temperature (write buffer), diag(A), r, z, p, solver partials
+     */
+    class HeatCgSetup : public SimulationComputeKernelBase
+    {
+    public:
+        HeatCgSetup(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
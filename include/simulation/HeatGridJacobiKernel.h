@@ -0,0 +1,42 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Heat Grid Jacobi Kernel
+     * Grid heat solver. One Jacobi sweep of backward Euler conduction on the 7-point
+     * stencil; pass index selects the ping-pong half.
+     *
+     * Input: node state, node temperatures
+     * Output: node temperatures
+     */
+    class HeatGridJacobi : public SimulationComputeKernelBase
+    {
+    public:
+        HeatGridJacobi(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t nodeCount)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (nodeCount + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Heat Grid Setup Kernel
+     * Grid heat solver. Turns the accumulated sums into node temperature, conductivity and
+     * weight, starts the solve from them and clears the accumulators.
+     *
+     * Input: accumulators
+     * Output: node state, first half of the node temperatures
+     */
+    class HeatGridSetup : public SimulationComputeKernelBase
+    {
+    public:
+        HeatGridSetup(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t nodeCount)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (nodeCount + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Kill Mark Kernel
+     * Runs over all particles at the end of a step. Flags particles inside a kill plane
+     * or sink box, keeps particles merged away by the adaptive pass flagged and counts the
+     * survivors per thread group, split children included.
+     *
+     * Input: positions, kill volumes (SimParams)
+     * Output: phase, survivors per thread group
+     */
+    class KillMark : public SimulationComputeKernelBase
+    {
+    public:
+        KillMark(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
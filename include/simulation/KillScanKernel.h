@@ -0,0 +1,39 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Kill Scan Kernel
+     * Single group. Exclusive scan of the survivor counts, writes the number of killed
+     * particles to the diagnostics.
+     *
+     * Input: survivors per thread group
+     * Output: survivor offsets per thread group, diagnostics
+     */
+    class KillScan : public SimulationComputeKernelBase
+    {
+    public:
+        KillScan(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+        {
+            SetPipelineState(cmdList);
+            cmdList->Dispatch(1, 1, 1);
+        }
+    };
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Cluster Count Kernel
+     * Per group of roots: solids in clusters of two or more particles, those clusters and
+     * single-particle clusters, summed for the cluster scan. Dispatched indirectly with
+     * the rebuild arguments.
+     *
+     * Input: member count per root
+     * Output: rigid group offsets
+     */
+    class RigidClusterCount : public SimulationComputeKernelBase
+    {
+    public:
+        RigidClusterCount(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
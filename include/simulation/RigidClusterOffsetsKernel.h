@@ -0,0 +1,34 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Cluster Offsets Kernel
+     * Per group of roots: scan inside the group on top of the scanned group totals.
+     * Compacts the clusters of two or more particles in root order, places the
+     * single-particle clusters behind them and clears the rotation of changed clusters.
+     * Dispatched indirectly with the rebuild arguments.
+     *
+     * Input: member count per root, rigid group offsets, rigid args
+     * Output: rigid cluster offsets, rigid clusters, rigid rotation
+     */
+    class RigidClusterOffsets : public SimulationComputeKernelBase
+    {
+    public:
+        RigidClusterOffsets(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Cluster Scan Kernel
+     * Single group. Scans the per-group totals of the cluster count pass and writes the
+     * indirect arguments over clusters, over solid particles and over single-particle
+     * clusters.
+     *
+     * Input: rigid group offsets (totals), rigid rebuild args
+     * Output: rigid group offsets, rigid args, diagnostics
+     */
+    class RigidClusterScan : public SimulationComputeKernelBase
+    {
+    public:
+        RigidClusterScan(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+        {
+            SetPipelineState(cmdList);
+            cmdList->Dispatch(1, 1, 1);
+        }
+    };
+}
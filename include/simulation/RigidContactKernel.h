@@ -0,0 +1,32 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Contact Kernel
+     * Pushes solid particles out of fluid and other clusters closer than the rest spacing
+     * and back into the world box. Dispatched indirectly over the solids.
+     *
+     * Input: predicted positions, rigid label, rigid members
+     * Output: delta p
+     */
+    class RigidContact : public SimulationComputeKernelBase
+    {
+    public:
+        RigidContact(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
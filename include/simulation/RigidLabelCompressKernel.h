@@ -0,0 +1,33 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Label Compress Kernel
+     * Points every solid particle at its cluster root and counts the cluster members;
+     * roots whose members differ from the previous rebuild are flagged as changed.
+     * Dispatched indirectly with the rebuild arguments.
+     *
+     * Input: rigid label, previous labels in rigid members
+     * Output: rigid label, member count and changed flag per root
+     */
+    class RigidLabelCompress : public SimulationComputeKernelBase
+    {
+    public:
+        RigidLabelCompress(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Label Hook Kernel
+     * Lock-free union of solid particles closer than h; the smaller root index wins.
+     * Dispatched indirectly with the rebuild arguments.
+     *
+     * Input: positions, grid of the previous step, phase
+     * Output: rigid label
+     */
+    class RigidLabelHook : public SimulationComputeKernelBase
+    {
+    public:
+        RigidLabelHook(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
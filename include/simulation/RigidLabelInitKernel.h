@@ -0,0 +1,33 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Label Init Kernel
+     * Starts union-find: solid particles become their own cluster, member counts are
+     * cleared. The labels of the previous rebuild move to the member list until it is
+     * rebuilt (none on a full rebuild). Dispatched indirectly with the rebuild arguments.
+     *
+     * Input: phase, rigid rebuild args, rigid label
+     * Output: rigid label, rigid members, rigid cluster offsets
+     */
+    class RigidLabelInit : public SimulationComputeKernelBase
+    {
+    public:
+        RigidLabelInit(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
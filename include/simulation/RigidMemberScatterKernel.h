@@ -0,0 +1,31 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Member Scatter Kernel
+     * Groups the solid particles by cluster. Dispatched indirectly with the rebuild arguments.
+     *
+     * Input: rigid label, rigid cluster offsets
+     * Output: rigid members
+     */
+    class RigidMemberScatter : public SimulationComputeKernelBase
+    {
+    public:
+        RigidMemberScatter(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
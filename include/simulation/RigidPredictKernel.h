@@ -0,0 +1,31 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Predict Kernel
+     * Gravity prediction of the solid particles. Dispatched indirectly over the solids.
+     *
+     * Input: positions, rigid members
+     * Output: predicted positions, velocities
+     */
+    class RigidPredict : public SimulationComputeKernelBase
+    {
+    public:
+        RigidPredict(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
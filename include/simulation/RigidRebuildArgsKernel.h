@@ -0,0 +1,40 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Rebuild Args Kernel
+     * Single thread. Turns the solidified / melted counters of the classify pass into the
+     * indirect arguments of the cluster label rebuild (zero groups when nothing changed)
+     * and resets the counters. passParam != 0 forces a full rebuild.
+     *
+     * Input: rigid rebuild args counters
+     * Output: rigid rebuild args, diagnostics
+     */
+    class RigidRebuildArgs : public SimulationComputeKernelBase
+    {
+    public:
+        RigidRebuildArgs(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+        {
+            SetPipelineState(cmdList);
+            cmdList->Dispatch(1, 1, 1);
+        }
+    };
+}
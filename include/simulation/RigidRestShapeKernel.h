@@ -0,0 +1,33 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Rest Shape Kernel
+     * Clusters of two or more particles, each group strides over them, rebuild steps only.
+     * Changed clusters take the current shape as the rest shape and the rotation is reset;
+     * the others keep both. Dispatched indirectly over the clusters.
+     *
+     * Input: positions, rigid label, rigid members, rigid clusters, rigid args
+     * Output: rigid rest offset, rigid rotation
+     */
+    class RigidRestShape : public SimulationComputeKernelBase
+    {
+    public:
+        RigidRestShape(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
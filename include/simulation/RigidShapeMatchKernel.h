@@ -0,0 +1,34 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Shape Match Kernel
+     * Clusters of two or more particles, each group strides over them: rigid fit of the
+     * rest shape to the predicted positions plus contact corrections; moves the members
+     * onto the goal positions and sets their velocities. Dispatched indirectly over the
+     * clusters, capped at RIGID_MAX_CLUSTER_GROUPS groups.
+     *
+     * Input: rigid label, rigid members, rigid clusters, rigid args, rigid rest offset, delta p
+     * Output: positions, predicted positions, velocities, rigid rotation
+     */
+    class RigidShapeMatch : public SimulationComputeKernelBase
+    {
+    public:
+        RigidShapeMatch(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
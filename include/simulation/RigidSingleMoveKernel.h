@@ -0,0 +1,32 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Rigid Single Move Kernel
+     * Single-particle clusters: moves the particle onto its prediction plus the contact
+     * correction and sets its velocity. Dispatched indirectly over the singles.
+     *
+     * Input: rigid members, rigid args, delta p
+     * Output: positions, predicted positions, velocities
+     */
+    class RigidSingleMove : public SimulationComputeKernelBase
+    {
+    public:
+        RigidSingleMove(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
@@ -2,6 +2,14 @@
 #include "pch.h"
 #include "GPUsorting/GPUsorting.h"
 
+// thread group count written by the GPU, e.g. the active particle list
+struct IndirectDispatch
+{
+    ID3D12CommandSignature *commandSignature = nullptr; // single D3D12_DISPATCH_ARGUMENTS
+    ID3D12Resource *argumentBuffer = nullptr;
+    UINT64 argumentOffset = 0;
+};
+
 class SimulationComputeKernelBase
 {
     winrt::com_ptr<ID3D12RootSignature> m_rootSignature;
@@ -29,6 +37,14 @@ public:
             byteCode);
     }
 
+    void DispatchIndirect(
+        winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+        const IndirectDispatch &args)
+    {
+        SetPipelineState(cmdList);
+        cmdList->ExecuteIndirect(args.commandSignature, 1, args.argumentBuffer, args.argumentOffset, nullptr, 0);
+    }
+
 protected:
     const uint32_t k_isNotPartialBitFlag = 0;
     const uint32_t k_isPartialBitFlag = 1;
@@ -0,0 +1,32 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Solver Color Kernel
+     * Gauss-Seidel color of every active particle from the predicted positions, once
+     * per step before the first density iteration.
+     *
+     * Input: predicted positions
+     * Output: solver color
+     */
+    class SolverColor : public SimulationComputeKernelBase
+    {
+    public:
+        SolverColor(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+    };
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Solver Scalars Kernel
+     * Sums the per-group partials of a CG dot product in a single thread group and
+     * updates alpha / beta / convergence in the solver scalars buffer. The step is
+     * selected by passIndex (SOLVER_PASS_*), passCount is the number of partials.
+     *
+     * Input: solver partials
+     * Output: solver scalars, diagnostics[passParam .. passParam + 1]
+     */
+    class SolverScalars : public SimulationComputeKernelBase
+    {
+    public:
+        SolverScalars(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+        {
+            SetPipelineState(cmdList);
+            cmdList->Dispatch(1, 1, 1);
+        }
+    };
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Step Limits Kernel
+     * Reduces max speed, viscosity and thermal conductivity over all particles
+     * in a single thread group for the adaptive time step controller.
+     *
+     * Input: velocities and temperatures written this step, viscosity mu
+     * Output: diagnostics[StepLimits .. StepLimits + 2]
+     */
+    class StepLimits : public SimulationComputeKernelBase
+    {
+    public:
+        StepLimits(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+        {
+            SetPipelineState(cmdList);
+            cmdList->Dispatch(1, 1, 1);
+        }
+    };
+}
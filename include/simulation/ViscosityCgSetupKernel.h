@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+#include "SimulationComputeKernelBase.h"
+
+namespace SimulationKernels
+{
+    /**
+     * @brief Viscosity CG Setup Kernel
+     * Builds the backward Euler viscous diffusion system weighted by viscosityMu, with each
+     * row scaled by the particle's time level step, starts the Jacobi-preconditioned CG solve
+     * from the current velocities and writes the per-group partials of r.z and r.r.
+     *
+     * Input: velocity (read buffer), predicted positions, density, viscosityMu, phase
+     * Output: velocity (write buffer), diag(A), r, z, p, solver partials
+     */
+    class ViscosityCgSetup : public SimulationComputeKernelBase
+    {
+    public:
+        ViscosityCgSetup(
+            winrt::com_ptr<ID3D12Device> device,
+            const GPUSorting::DeviceInfo &info,
+            const std::vector<std::wstring> &compileArguments,
+            const std::filesystem::path &shaderPath,
+            winrt::com_ptr<ID3D12RootSignature> rootSignature) : SimulationComputeKernelBase(device,
+                                                                                             info,
+                                                                                             shaderPath,
+                                                                                             L"CSMain",
+                                                                                             compileArguments,
+                                                                                             rootSignature)
+        {
+        }
+
+        void Dispatch(
+            winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+            uint32_t numParticles)
+        {
+            SetPipelineState(cmdList);
+
+            uint32_t threadGroups = (numParticles + 255) / 256;
+            cmdList->Dispatch(threadGroups, 1, 1);
+        }
+    };
+}
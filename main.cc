@@ -5,11 +5,385 @@
 #include "framework/RenderSubsystem.h"
 #include "framework/SimulationSystem.h"
 
+#include <cstdlib>
+#include <string_view>
+
+struct RunOptions
+{
+	bool headless = false;
+};
+
+static RunOptions ParseCommandLine(int argc, char **argv)
+{
+	RunOptions options;
+	StepController::Settings stepSettings;
+	int thermalInterval = 1;
+	HeatSolverMode heatSolverMode = HeatSolverMode::Explicit;
+	ViscositySolverMode viscositySolverMode = ViscositySolverMode::Xsph;
+	std::string demPath;
+	Heightfield::RawLayout demRaw;
+	float demScale = 0.0f;
+	std::string checkpointPath;
+	int checkpointInterval = 0;
+	TrajectoryWriter::Settings trajectory;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--solver" && hasValue)
+		{
+			std::string_view mode = argv[++i];
+			SimulationSystem::SetPbfSolverMode(mode == "gs" ? PbfSolverMode::ColoredGaussSeidel : PbfSolverMode::Jacobi);
+		}
+		else if (arg == "--pressure-solver" && hasValue)
+		{
+			std::string_view solver = argv[++i];
+			SimulationSystem::SetPressureSolver(solver == "dfsph" ? PressureSolver::Dfsph : PressureSolver::Pbf);
+		}
+		else if (arg == "--dfsph-iterations" && i + 2 < argc)
+		{
+			int densityIterations = std::atoi(argv[++i]);
+			int divergenceIterations = std::atoi(argv[++i]);
+			SimulationSystem::SetDfsphIterations(densityIterations, divergenceIterations);
+		}
+		else if (arg == "--scene" && hasValue)
+		{
+			std::string_view scene = argv[++i];
+			SimulationSystem::SetInitialScene(scene == "grid"     ? InitialScene::UniformGrid
+											  : scene == "random" ? InitialScene::DenseRandom
+																  : InitialScene::DenseBottomWithSphere);
+		}
+		else if (arg == "--scene-file" && hasValue)
+		{
+			std::string path = argv[++i];
+			try
+			{
+				SimulationSystem::LoadScene(path);
+			}
+			catch (const std::exception &e)
+			{
+				std::cout << "Ignored " << arg << ": " << e.what() << "\n";
+			}
+		}
+		else if (arg == "--sampler" && hasValue)
+		{
+			std::string_view sampler = argv[++i];
+			SimulationSystem::SetSceneSampler(sampler == "relaxed" ? Scene::Sampler::Relaxed : Scene::Sampler::Lattice);
+		}
+		else if (arg == "--settled-cache" && hasValue)
+		{
+			SimulationSystem::SetSettledBlockCache(argv[++i]);
+		}
+		else if (arg == "--sampler-benchmark")
+		{
+			SimulationSystem::SetSamplerBenchmark(true);
+		}
+		else if (arg == "--particles" && hasValue)
+		{
+			SimulationSystem::SetInitialParticleCount(static_cast<uint32_t>(std::atoi(argv[++i])));
+		}
+		else if (arg == "--capacity" && hasValue)
+		{
+			SimulationSystem::SetParticleCapacity(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+		}
+		else if (arg == "--max-capacity" && hasValue)
+		{
+			SimulationSystem::SetMaxParticleCapacity(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+		}
+		else if (arg == "--emitter" && i + 4 < argc)
+		{
+			// vent at x y z ejecting upwards, rate in particles per second
+			ParticleEmitter::Settings emitter;
+			emitter.position.x = static_cast<float>(std::atof(argv[++i]));
+			emitter.position.y = static_cast<float>(std::atof(argv[++i]));
+			emitter.position.z = static_cast<float>(std::atof(argv[++i]));
+			emitter.rate = static_cast<float>(std::atof(argv[++i]));
+			SimulationSystem::AddEmitter(emitter);
+		}
+		else if ((arg == "--kill-plane" || arg == "--kill-box") && i + 6 < argc)
+		{
+			Vector3 a, b;
+			a.x = static_cast<float>(std::atof(argv[++i]));
+			a.y = static_cast<float>(std::atof(argv[++i]));
+			a.z = static_cast<float>(std::atof(argv[++i]));
+			b.x = static_cast<float>(std::atof(argv[++i]));
+			b.y = static_cast<float>(std::atof(argv[++i]));
+			b.z = static_cast<float>(std::atof(argv[++i]));
+			// plane: point and normal towards the removed side, box: min and max corner
+			bool added = arg == "--kill-plane" ? SimulationSystem::AddKillPlane(a, b) : SimulationSystem::AddKillBox(a, b);
+			if (!added)
+			{
+				std::cout << "Ignored " << arg << ", at most " << k_maxKillVolumes << " of each kind\n";
+			}
+		}
+		else if (arg == "--obstacle-box" && i + 6 < argc)
+		{
+			Vector3 boxMin, boxMax;
+			boxMin.x = static_cast<float>(std::atof(argv[++i]));
+			boxMin.y = static_cast<float>(std::atof(argv[++i]));
+			boxMin.z = static_cast<float>(std::atof(argv[++i]));
+			boxMax.x = static_cast<float>(std::atof(argv[++i]));
+			boxMax.y = static_cast<float>(std::atof(argv[++i]));
+			boxMax.z = static_cast<float>(std::atof(argv[++i]));
+			if (!SimulationSystem::AddObstacleBox(boxMin, boxMax))
+			{
+				std::cout << "Ignored " << arg << ", at most " << k_maxObstacles << " obstacles\n";
+			}
+		}
+		else if (arg == "--obstacle-sphere" && i + 4 < argc)
+		{
+			Vector3 center;
+			center.x = static_cast<float>(std::atof(argv[++i]));
+			center.y = static_cast<float>(std::atof(argv[++i]));
+			center.z = static_cast<float>(std::atof(argv[++i]));
+			float radius = static_cast<float>(std::atof(argv[++i]));
+			if (!SimulationSystem::AddObstacleSphere(center, radius))
+			{
+				std::cout << "Ignored " << arg << ", at most " << k_maxObstacles << " obstacles\n";
+			}
+		}
+		else if (arg == "--obstacle-mesh" && i + 5 < argc)
+		{
+			// OBJ file, uniform scale, then offset
+			std::string path = argv[++i];
+			float scale = static_cast<float>(std::atof(argv[++i]));
+			Vector3 offset;
+			offset.x = static_cast<float>(std::atof(argv[++i]));
+			offset.y = static_cast<float>(std::atof(argv[++i]));
+			offset.z = static_cast<float>(std::atof(argv[++i]));
+			try
+			{
+				SimulationSystem::AddObstacleMesh(path, scale, offset);
+			}
+			catch (const std::exception &e)
+			{
+				std::cout << "Ignored " << arg << ": " << e.what() << "\n";
+			}
+		}
+		else if (arg == "--wall-density" && hasValue)
+		{
+			std::string_view mode = argv[++i];
+			SimulationSystem::SetWallDensityEnabled(mode != "off");
+		}
+		else if (arg == "--mesh-benchmark")
+		{
+			SimulationSystem::SetMeshBenchmark(true);
+		}
+		else if (arg == "--restart" && hasValue)
+		{
+			// flags before it are replaced by the checkpoint's settings, flags after it override them
+			std::string path = argv[++i];
+			try
+			{
+				SimulationSystem::LoadCheckpoint(path);
+			}
+			catch (const std::exception &e)
+			{
+				std::cout << "Ignored " << arg << ": " << e.what() << "\n";
+			}
+		}
+		else if (arg == "--checkpoint" && hasValue)
+		{
+			checkpointPath = argv[++i];
+		}
+		else if (arg == "--checkpoint-interval" && hasValue)
+		{
+			checkpointInterval = std::atoi(argv[++i]);
+		}
+		else if (arg == "--trajectory" && hasValue)
+		{
+			trajectory.path = argv[++i];
+		}
+		else if (arg == "--trajectory-interval" && hasValue)
+		{
+			trajectory.interval = std::atoi(argv[++i]);
+		}
+		else if (arg == "--trajectory-attributes" && hasValue)
+		{
+			// any of p(osition), v(elocity), t(emperature), i(d)
+			std::string_view letters = argv[++i];
+			trajectory.attributes = 0;
+			trajectory.attributes |= letters.find('p') != std::string_view::npos ? TrajectoryPosition : 0u;
+			trajectory.attributes |= letters.find('v') != std::string_view::npos ? TrajectoryVelocity : 0u;
+			trajectory.attributes |= letters.find('t') != std::string_view::npos ? TrajectoryTemperature : 0u;
+			trajectory.attributes |= letters.find('i') != std::string_view::npos ? TrajectoryParticleId : 0u;
+		}
+		else if (arg == "--trajectory-encoding" && hasValue)
+		{
+			const std::string_view encoding = argv[++i];
+			trajectory.encoding = encoding == "quantized" ? TrajectoryEncoding::Quantized : TrajectoryEncoding::Raw;
+		}
+		else if (arg == "--trajectory-keyframes" && hasValue)
+		{
+			trajectory.keyframeInterval = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+		}
+		else if (arg == "--trajectory-error" && hasValue)
+		{
+			trajectory.positionError = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "--trajectory-temperature-range" && i + 2 < argc)
+		{
+			trajectory.temperatureMin = static_cast<float>(std::atof(argv[++i]));
+			trajectory.temperatureMax = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "--dem" && hasValue)
+		{
+			demPath = argv[++i];
+		}
+		else if (arg == "--dem-raw" && i + 4 < argc)
+		{
+			// headerless float32 rows, north first
+			demPath = argv[++i];
+			demRaw.cols = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			demRaw.rows = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			demRaw.cellSize = std::atof(argv[++i]);
+		}
+		else if (arg == "--dem-scale" && hasValue)
+		{
+			demScale = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "--adaptive" && i + 2 < argc)
+		{
+			int minLevel = std::atoi(argv[++i]);
+			int maxLevel = std::atoi(argv[++i]);
+			SimulationSystem::SetAdaptiveResolution(minLevel, maxLevel);
+		}
+		else if (arg == "--adaptive-interval" && hasValue)
+		{
+			SimulationSystem::SetAdaptiveInterval(std::atoi(argv[++i]));
+		}
+		else if (arg == "--pbf-iterations" && hasValue)
+		{
+			SimulationSystem::SetPbfIterations(std::atoi(argv[++i]));
+		}
+		else if (arg == "--convergence-probe")
+		{
+			SimulationSystem::SetConvergenceProbe(true);
+		}
+		else if (arg == "--thermal-interval" && hasValue)
+		{
+			thermalInterval = std::atoi(argv[++i]);
+		}
+		else if (arg == "--heat-solver" && hasValue)
+		{
+			std::string_view mode = argv[++i];
+			heatSolverMode = mode == "cg"     ? HeatSolverMode::ImplicitCG
+							 : mode == "grid" ? HeatSolverMode::Grid
+											  : HeatSolverMode::Explicit;
+		}
+		else if (arg == "--heat-cg-iterations" && hasValue)
+		{
+			SimulationSystem::SetHeatSolverIterations(std::atoi(argv[++i]));
+		}
+		else if (arg == "--viscosity-solver" && hasValue)
+		{
+			std::string_view mode = argv[++i];
+			viscositySolverMode = mode == "cg" ? ViscositySolverMode::ImplicitCG : ViscositySolverMode::Xsph;
+		}
+		else if (arg == "--viscosity-cg-iterations" && hasValue)
+		{
+			SimulationSystem::SetViscositySolverIterations(std::atoi(argv[++i]));
+		}
+		else if (arg == "--viscosity-interval" && hasValue)
+		{
+			SimulationSystem::SetViscosityInterval(std::atoi(argv[++i]));
+		}
+		else if (arg == "--sleep")
+		{
+			SimulationSystem::SetSleepingEnabled(true);
+		}
+		else if (arg == "--rigid-crust")
+		{
+			SimulationSystem::SetRigidCrustEnabled(true);
+		}
+		else if (arg == "--surface-cooling")
+		{
+			SimulationSystem::SetSurfaceCoolingEnabled(true);
+		}
+		else if (arg == "--surface-interval" && hasValue)
+		{
+			SimulationSystem::SetSurfaceInterval(std::atoi(argv[++i]));
+		}
+		else if (arg == "--headless")
+		{
+			options.headless = true;
+		}
+		else if (arg == "--fixed-dt" && hasValue)
+		{
+			stepSettings.fixedDt = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "--cfl" && hasValue)
+		{
+			stepSettings.cflNumber = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "--time-levels" && hasValue)
+		{
+			stepSettings.timeLevels = std::atoi(argv[++i]);
+		}
+		else if (arg == "--max-substeps" && hasValue)
+		{
+			stepSettings.maxSubsteps = std::atoi(argv[++i]);
+		}
+		else
+		{
+			std::cout << "Unknown argument: " << arg << "\n";
+		}
+	}
+
+	if (!demPath.empty())
+	{
+		try
+		{
+			SimulationSystem::LoadTerrain(demPath, demRaw, demScale);
+		}
+		catch (const std::exception &e)
+		{
+			std::cout << "Ignored terrain: " << e.what() << "\n";
+		}
+	}
+
+	// headless runs are reproducible: one fixed step per loop iteration, no wall clock
+	if (options.headless && stepSettings.fixedDt <= 0.0f)
+	{
+		stepSettings.fixedDt = 1.0f / 120.0f;
+	}
+	if (!trajectory.path.empty())
+	{
+		try
+		{
+			SimulationSystem::SetTrajectory(trajectory);
+		}
+		catch (const std::exception &e)
+		{
+			std::cout << "Ignored trajectory: " << e.what() << "\n";
+		}
+	}
+	if (!checkpointPath.empty())
+	{
+		SimulationSystem::SetCheckpoint(checkpointPath, checkpointInterval);
+	}
+	SimulationSystem::SetStepControllerSettings(stepSettings);
+	SimulationSystem::SetThermalInterval(thermalInterval);
+	SimulationSystem::SetHeatSolverMode(heatSolverMode);
+	SimulationSystem::SetViscositySolverMode(viscositySolverMode);
+
+	return options;
+}
+
 int main(int argc, char **argv)
 {
+	RunOptions options = ParseCommandLine(argc, argv);
+
 	RenderSubsystem::Init();
 	SimulationSystem::Init(RenderSubsystem::GetDevice().get());
 
+	if (options.headless)
+	{
+		SimulationSystem::StartSimulation();
+	}
+
 	std::chrono::steady_clock::time_point lastTime = std::chrono::steady_clock::now();
 
 	TimeAccumulator simTimeAcc;
@@ -31,13 +405,16 @@ int main(int argc, char **argv)
 			std::chrono::duration<float> deltaTime = currentTime - lastTime;
 			lastTime = currentTime;
 
+			float interval = options.headless ? SimulationSystem::GetStepControllerSettings().fixedDt : deltaTime.count();
+
 			bool simulationEnabled = SimulationSystem::IsRunning();
 
 			{
 				ConditionalScopedTimer simTimer(simulationEnabled ? &simTimeAcc : nullptr);
-				SimulationSystem::Simulate(deltaTime.count());
+				SimulationSystem::Simulate(interval);
 			}
 
+			if (!options.headless)
 			{
 				ConditionalScopedTimer renderTimer(simulationEnabled ? &renderTimeAcc : nullptr);
 				RenderSubsystem::Draw();
@@ -54,8 +431,19 @@ int main(int argc, char **argv)
 	std::cout << "Simulation avg  : " << simAvg << " ms\n";
 	std::cout << "Render avg      : " << renAvg << " ms\n";
 	std::cout << "Total avg       : " << total << " ms\n";
+	// simulated seconds per wall-clock second of simulation work
+	double simWallSeconds = simAvg * double(simTimeAcc.count()) / 1000.0;
+	double simulatedSeconds = SimulationSystem::GetSimulatedTime();
+	if (simWallSeconds > 0.0 && simulatedSeconds > 0.0)
+	{
+		std::cout << "Throughput      : " << simulatedSeconds / simWallSeconds << " sim s / s\n";
+		std::cout << "Time per sim s  : " << simWallSeconds / simulatedSeconds << " s\n";
+	}
 	std::cout << "==========================\n";
 
+	SimulationSystem::Shutdown();
+	SimulationSystem::PrintReport(std::cout);
+
 	RenderSubsystem::Destroy();
 	return 0;
 }
\ No newline at end of file
@@ -1,25 +1,27 @@
 // #11
 #include "CommonKernels.hlsl"
 
-StructuredBuffer<float3> predicted : register(t1);
+StructuredBuffer<float3> predicted : register(t7);
 StructuredBuffer<uint>   particleIndices : register(t4);
 StructuredBuffer<uint>   cellStart : register(t5);
 StructuredBuffer<uint>   cellEnd   : register(t6);
 StructuredBuffer<float>  viscCoeff : register(t13);
-StructuredBuffer<float3> velocitiesIn : register(t2); // read velocities
+StructuredBuffer<float3> velocitiesIn : register(t1); // read velocities
+StructuredBuffer<uint>   phase : register(t30);
 
-RWStructuredBuffer<float3> velocities : register(u2); // write velocities
+RWStructuredBuffer<float3> velocities : register(u1); // write velocities
 
 // TODO: check
 [numthreads(256,1,1)]
 void CSMain(uint gid : SV_DispatchThreadID)
 {
-    if (gid >= numParticles) return;
-    uint i = particleIndices[gid];
+    if (gid >= GetActiveCount()) return;
+    uint i = activeIndices[gid];
 
     float3 xi = predicted[i];
     float3 vi = velocitiesIn[i]; // read from input buffer
     float ci  = viscCoeff[i];
+    float hi  = SmoothingLength(i);
 
     if (ci <= 0.0)
     {
@@ -58,12 +60,17 @@ void CSMain(uint gid : SV_DispatchThreadID)
             float3 rij = xi - xj;
             float r2 = dot(rij, rij);
 
-            if (r2 >= h2) continue;
+            float hij = 0.5 * (hi + SmoothingLength(j));
+            if (r2 >= hij * hij) continue;
 
-            float W = cubic_kernel_height(rij);
+            float W = (ParticleMass(j) / mass) * cubic_kernel_height(rij, hij);
             dv += (velocitiesIn[j] - vi) * W;
         }
     }
 
-    velocities[i] = vi + ci * dv;
+    // a particle on time level L catches up 2^L substeps at once: compound the per substep blend
+    uint substeps = 1u << GetTimeLevel(phase[i]);
+    float blend = 1.0 - pow(saturate(1.0 - ci), (float)substeps);
+
+    velocities[i] = vi + blend * dv;
 }
\ No newline at end of file
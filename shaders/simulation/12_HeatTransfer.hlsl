@@ -11,9 +11,6 @@ StructuredBuffer<float>  temperatureIn       : register(t2);
 
 RWStructuredBuffer<float> temperatureOut     : register(u2);
 
-static const float Tenv = 300.0f;        // воздух TODO: в параметры симуляции
-static const float heatLossCoeff = 5.0f; // TODO: в параметры симуляции
-
 [numthreads(256,1,1)]
 void CSMain(uint gid : SV_DispatchThreadID)
 {
@@ -25,6 +22,8 @@ void CSMain(uint gid : SV_DispatchThreadID)
     float3 pi = predictedPositions[i];
     float  Ti = temperatureIn[i];
     float  rhoi = max(density[i], 1e-6);
+    float  hi = SmoothingLength(i);
+    float  mi = ParticleMass(i);
 
     float ki = GetThermalConductivity(Ti);
 
@@ -52,48 +51,29 @@ void CSMain(uint gid : SV_DispatchThreadID)
 
             float3 pj = predictedPositions[j];
             float3 rij = pi - pj;
-
-            float r2 = dot(rij, rij);
             // TODO: move increased kernel radius to params
-            if (r2 >= 25.0f * h2)
+            float hij = 0.5 * (hi + SmoothingLength(j));
+            if (dot(rij, rij) >= 25.0f * hij * hij)
                 continue;
 
             float Tj = temperatureIn[j];
             float rhoj = max(density[j], 1e-6);
             float kj = GetThermalConductivity(Tj);
 
-            // TODO: move increased kernel radius to params
-            float3 gradW = - 5.0f * cubic_kernel_gradient(rij / 5.0f);
-
-            float dotTerm = dot(rij, gradW);
-            float denom   = r2 + epsHeatTransfer;
-
-            float kij = (2.0 * ki * kj) / (ki + kj);
-
-            float contrib =
-                mass *
-                kij *
-                (Tj - Ti) *
-                dotTerm /
-                (rhoi * rhoj * denom);
+            float contrib = HeatConductionWeight(rij, ki, kj, rhoi, rhoj, 0.5 * (mi + ParticleMass(j)), hij) * (Tj - Ti);
 
             // TODO: analyze is ot ok
             dTdt += clamp(contrib, -0.01, 0.01);
         }
     }
 
-    float exposure = saturate((rho0 - rhoi) / rho0);
-    exposure = pow(exposure, 1.5); 
-
-    float heatLoss =
-        heatLossCoeff *
-        exposure *
-        (Ti - Tenv);
+    float heatLoss = HeatLossRate(rhoi) * (Ti - Tenv);
 
     dTdt -= heatLoss;
 
     // TODO: to params?
-    float newT = clamp(Ti + dt * dTdt, 0.01f, 2000.0f);
+    // heat transfer may run every Nth step, integrate over the whole skipped interval
+    float newT = clamp(Ti + thermalDt * dTdt, 0.01f, 2000.0f);
 
     temperatureOut[i] = newT;
 }
\ No newline at end of file
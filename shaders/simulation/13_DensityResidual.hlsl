@@ -0,0 +1,46 @@
+// #13
+#include "CommonData.hlsl"
+
+StructuredBuffer<float> constraintC : register(t9);
+
+RWStructuredBuffer<uint> diagnostics : register(u14);
+
+groupshared float gsSum[256];
+groupshared float gsMax[256];
+
+// single group: reduces |C_i| over the active particles into the diagnostics slot of iteration passIndex
+[numthreads(256,1,1)]
+void CSMain(uint tid : SV_GroupThreadID)
+{
+    float sum = 0.0;
+    float mx = 0.0;
+
+    uint activeCount = GetActiveCount();
+    for (uint gid = tid; gid < activeCount; gid += 256)
+    {
+        float c = abs(constraintC[activeIndices[gid]]);
+        sum += c;
+        mx = max(mx, c);
+    }
+
+    gsSum[tid] = sum;
+    gsMax[tid] = mx;
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint s = 128; s > 0; s >>= 1)
+    {
+        if (tid < s)
+        {
+            gsSum[tid] += gsSum[tid + s];
+            gsMax[tid] = max(gsMax[tid], gsMax[tid + s]);
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+    {
+        uint slot = DIAG_DENSITY_RESIDUAL + 2 * passIndex;
+        diagnostics[slot]     = asuint(gsSum[0] / max(activeCount, 1u));
+        diagnostics[slot + 1] = asuint(gsMax[0]);
+    }
+}
@@ -0,0 +1,52 @@
+// #14
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<uint>  particleIndices : register(t4);
+StructuredBuffer<float> viscosityMu     : register(t12);
+StructuredBuffer<float> temperatures    : register(t2); // start of step, valid also when heat transfer was skipped
+StructuredBuffer<uint>  phase           : register(t30);
+
+RWStructuredBuffer<float3> velocities   : register(u1); // velocities written this step
+RWStructuredBuffer<uint>   diagnostics  : register(u14);
+
+groupshared float3 gsMax[256];
+
+// single group: max speed, viscosity and conductivity for the time step controller
+[numthreads(256,1,1)]
+void CSMain(uint tid : SV_GroupThreadID)
+{
+    float3 mx = float3(0, 0, 0);
+
+    for (uint gid = tid; gid < numParticles; gid += 256)
+    {
+        uint i = particleIndices[gid];
+        // sleepers and rigid crust keep a stale mu, sleepers do not move; heat flows through all
+        uint state = phase[i] & PHASE_STATE_MASK;
+        float motion = state != PHASE_SLEEPING ? 1.0 : 0.0;
+        float fluid = state == PHASE_ACTIVE ? 1.0 : 0.0;
+        float3 limits = float3(
+            motion * length(velocities[i]),
+            fluid * viscosityMu[i],
+            GetThermalConductivity(temperatures[i]));
+        mx = max(mx, limits);
+    }
+
+    gsMax[tid] = mx;
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint s = 128; s > 0; s >>= 1)
+    {
+        if (tid < s)
+        {
+            gsMax[tid] = max(gsMax[tid], gsMax[tid + s]);
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+    {
+        diagnostics[DIAG_STEP_LIMITS]     = asuint(gsMax[0].x);
+        diagnostics[DIAG_STEP_LIMITS + 1] = asuint(gsMax[0].y);
+        diagnostics[DIAG_STEP_LIMITS + 2] = asuint(gsMax[0].z);
+    }
+}
@@ -0,0 +1,101 @@
+// #15
+#include "CommonKernels.hlsl"
+
+// Backward Euler heat conduction, A T' = b:
+//   A_ii = 1 + dt * loss_i + dt * sum_j w_ij,  A_ij = -dt * w_ij,  b_i = T_i + dt * loss_i * Tenv
+// Starts CG from T' = T, so r = b - A T is dt times the explicit rate of change.
+
+StructuredBuffer<float3> predictedPositions : register(t7);
+StructuredBuffer<uint>   particleIndices    : register(t4);
+StructuredBuffer<uint>   cellStart          : register(t5);
+StructuredBuffer<uint>   cellEnd            : register(t6);
+StructuredBuffer<float>  density            : register(t8);
+StructuredBuffer<float>  temperatureIn      : register(t2);
+
+RWStructuredBuffer<float>  temperatureOut   : register(u2);  // x
+RWStructuredBuffer<float>  heatDiagonal     : register(u15);
+RWStructuredBuffer<float>  heatResidual     : register(u16);
+RWStructuredBuffer<float>  heatPrecond      : register(u17);
+RWStructuredBuffer<float>  heatDirection    : register(u18);
+RWStructuredBuffer<float2> solverPartials   : register(u20); // r.z, r.r per group
+
+groupshared float2 gsSum[256];
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint group : SV_GroupID)
+{
+    float2 partial = float2(0, 0);
+
+    if (gid < numParticles)
+    {
+        uint i = particleIndices[gid];
+
+        float3 pi = predictedPositions[i];
+        float  Ti = temperatureIn[i];
+        float  rhoi = max(density[i], 1e-6);
+        float  hi = SmoothingLength(i);
+        float  mi = ParticleMass(i);
+        float  ki = GetThermalConductivity(Ti);
+
+        float wSum = 0.0;
+        float flux = 0.0;
+
+        uint3 cell = GetCellCoord(pi);
+
+        for (int dz = -1; dz <= 1; dz++)
+        for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            int3 nc = int3(cell) + int3(dx, dy, dz);
+            if (any(nc < 0) || any(nc >= int3(gridResolution)))
+                continue;
+
+            uint hash = GetCellHash(uint3(nc));
+            uint start = cellStart[hash];
+            uint end   = cellEnd[hash];
+
+            [loop]
+            for (uint idx = start; idx < end; idx++)
+            {
+                uint j = particleIndices[idx];
+                if (j == i) continue;
+
+                float3 rij = pi - predictedPositions[j];
+                float hij = 0.5 * (hi + SmoothingLength(j));
+                if (dot(rij, rij) >= 25.0f * hij * hij)
+                    continue;
+
+                float Tj = temperatureIn[j];
+                float w = HeatConductionWeight(rij, ki, GetThermalConductivity(Tj), rhoi, max(density[j], 1e-6), 0.5 * (mi + ParticleMass(j)), hij);
+                wSum += w;
+                flux += w * (Tj - Ti);
+            }
+        }
+
+        float loss = HeatLossRate(rhoi);
+        float diag = 1.0 + thermalDt * (loss + wSum);
+        float r = thermalDt * (flux - loss * (Ti - Tenv));
+        float z = r / diag;
+
+        temperatureOut[i] = Ti;
+        heatDiagonal[i] = diag;
+        heatResidual[i] = r;
+        heatPrecond[i] = z;
+        heatDirection[i] = z;
+
+        partial = float2(r * z, r * r);
+    }
+
+    gsSum[tid] = partial;
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint s = 128; s > 0; s >>= 1)
+    {
+        if (tid < s)
+            gsSum[tid] += gsSum[tid + s];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+        solverPartials[group] = gsSum[0];
+}
@@ -0,0 +1,90 @@
+// #16
+#include "CommonKernels.hlsl"
+
+// Ap = A p for the backward Euler heat system (see 15_HeatCgSetup.hlsl), matrix free
+
+StructuredBuffer<float3> predictedPositions : register(t7);
+StructuredBuffer<uint>   particleIndices    : register(t4);
+StructuredBuffer<uint>   cellStart          : register(t5);
+StructuredBuffer<uint>   cellEnd            : register(t6);
+StructuredBuffer<float>  density            : register(t8);
+StructuredBuffer<float>  temperatureIn      : register(t2); // conductivity is taken at the start of the step
+StructuredBuffer<float>  heatDirection      : register(t18);
+StructuredBuffer<uint>   solverScalars      : register(t21);
+
+RWStructuredBuffer<float>  heatProduct      : register(u19);
+RWStructuredBuffer<float2> solverPartials   : register(u20); // p.Ap per group
+
+groupshared float gsSum[256];
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint group : SV_GroupID)
+{
+    if (solverScalars[SOLVER_CONVERGED] != 0)
+        return;
+
+    float partial = 0.0;
+
+    if (gid < numParticles)
+    {
+        uint i = particleIndices[gid];
+
+        float3 pi = predictedPositions[i];
+        float  rhoi = max(density[i], 1e-6);
+        float  hi = SmoothingLength(i);
+        float  mi = ParticleMass(i);
+        float  ki = GetThermalConductivity(temperatureIn[i]);
+        float  di = heatDirection[i];
+
+        float lap = 0.0;
+
+        uint3 cell = GetCellCoord(pi);
+
+        for (int dz = -1; dz <= 1; dz++)
+        for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            int3 nc = int3(cell) + int3(dx, dy, dz);
+            if (any(nc < 0) || any(nc >= int3(gridResolution)))
+                continue;
+
+            uint hash = GetCellHash(uint3(nc));
+            uint start = cellStart[hash];
+            uint end   = cellEnd[hash];
+
+            [loop]
+            for (uint idx = start; idx < end; idx++)
+            {
+                uint j = particleIndices[idx];
+                if (j == i) continue;
+
+                float3 rij = pi - predictedPositions[j];
+                float hij = 0.5 * (hi + SmoothingLength(j));
+                if (dot(rij, rij) >= 25.0f * hij * hij)
+                    continue;
+
+                float kj = GetThermalConductivity(temperatureIn[j]);
+                float w = HeatConductionWeight(rij, ki, kj, rhoi, max(density[j], 1e-6), 0.5 * (mi + ParticleMass(j)), hij);
+                lap += w * (di - heatDirection[j]);
+            }
+        }
+
+        float ap = (1.0 + thermalDt * HeatLossRate(rhoi)) * di + thermalDt * lap;
+        heatProduct[i] = ap;
+
+        partial = di * ap;
+    }
+
+    gsSum[tid] = partial;
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint s = 128; s > 0; s >>= 1)
+    {
+        if (tid < s)
+            gsSum[tid] += gsSum[tid + s];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+        solverPartials[group] = float2(gsSum[0], 0.0);
+}
@@ -0,0 +1,74 @@
+// #17
+#include "CommonData.hlsl"
+
+// Single group: sums the per-group partials of a CG dot product and updates the solver
+// scalars. passIndex selects the step (SOLVER_PASS_*), passCount is the number of partials
+// (with PASS_FLAG_ACTIVE_LIST the thread groups of the active list), passParam the
+// diagnostics slot receiving iterations and |r| / |r0|.
+
+StructuredBuffer<float2> solverPartials : register(t20);
+
+RWStructuredBuffer<uint> solverScalars  : register(u21);
+RWStructuredBuffer<uint> diagnostics    : register(u14);
+
+groupshared float2 gsSum[256];
+
+[numthreads(256,1,1)]
+void CSMain(uint tid : SV_GroupThreadID)
+{
+    if (passIndex != SOLVER_PASS_INIT && solverScalars[SOLVER_CONVERGED] != 0)
+        return;
+
+    uint partialCount = (passFlags & PASS_FLAG_ACTIVE_LIST) ? activeArgs[0] : passCount;
+
+    float2 sum = float2(0, 0);
+    for (uint g = tid; g < partialCount; g += 256)
+        sum += solverPartials[g];
+
+    gsSum[tid] = sum;
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint s = 128; s > 0; s >>= 1)
+    {
+        if (tid < s)
+            gsSum[tid] += gsSum[tid + s];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid != 0)
+        return;
+
+    float2 total = gsSum[0];
+    float tol2 = solverTolerance * solverTolerance;
+
+    if (passIndex == SOLVER_PASS_INIT)
+    {
+        bool converged = total.y <= 1e-20;
+        solverScalars[SOLVER_RZ] = asuint(total.x);
+        solverScalars[SOLVER_RR0] = asuint(total.y);
+        solverScalars[SOLVER_RR] = asuint(total.y);
+        solverScalars[SOLVER_CONVERGED] = converged ? 1u : 0u;
+        solverScalars[SOLVER_ITERATIONS] = 0;
+    }
+    else if (passIndex == SOLVER_PASS_ALPHA)
+    {
+        float rz = asfloat(solverScalars[SOLVER_RZ]);
+        solverScalars[SOLVER_ALPHA] = asuint(total.x > 0.0 ? rz / total.x : 0.0);
+    }
+    else
+    {
+        float rz = asfloat(solverScalars[SOLVER_RZ]);
+        float rr0 = asfloat(solverScalars[SOLVER_RR0]);
+        solverScalars[SOLVER_BETA] = asuint(rz > 0.0 ? total.x / rz : 0.0);
+        solverScalars[SOLVER_RZ] = asuint(total.x);
+        solverScalars[SOLVER_RR] = asuint(total.y);
+        solverScalars[SOLVER_ITERATIONS] += 1;
+        if (total.y <= tol2 * rr0)
+            solverScalars[SOLVER_CONVERGED] = 1;
+    }
+
+    float rr0 = asfloat(solverScalars[SOLVER_RR0]);
+    float rr = asfloat(solverScalars[SOLVER_RR]);
+    diagnostics[passParam] = solverScalars[SOLVER_ITERATIONS];
+    diagnostics[passParam + 1] = asuint(rr0 > 0.0 ? sqrt(rr / rr0) : 0.0);
+}
@@ -0,0 +1,54 @@
+// #18
+#include "CommonData.hlsl"
+
+// x += alpha p, r -= alpha Ap, z = r / diag(A)
+
+StructuredBuffer<uint>   particleIndices : register(t4);
+StructuredBuffer<float>  heatDiagonal    : register(t15);
+StructuredBuffer<float>  heatDirection   : register(t18);
+StructuredBuffer<float>  heatProduct     : register(t19);
+StructuredBuffer<uint>   solverScalars   : register(t21);
+
+RWStructuredBuffer<float>  temperatureOut : register(u2); // x
+RWStructuredBuffer<float>  heatResidual   : register(u16);
+RWStructuredBuffer<float>  heatPrecond    : register(u17);
+RWStructuredBuffer<float2> solverPartials : register(u20); // r.z, r.r per group
+
+groupshared float2 gsSum[256];
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint group : SV_GroupID)
+{
+    if (solverScalars[SOLVER_CONVERGED] != 0)
+        return;
+
+    float alpha = asfloat(solverScalars[SOLVER_ALPHA]);
+    float2 partial = float2(0, 0);
+
+    if (gid < numParticles)
+    {
+        uint i = particleIndices[gid];
+
+        temperatureOut[i] += alpha * heatDirection[i];
+
+        float r = heatResidual[i] - alpha * heatProduct[i];
+        float z = r / heatDiagonal[i];
+        heatResidual[i] = r;
+        heatPrecond[i] = z;
+
+        partial = float2(r * z, r * r);
+    }
+
+    gsSum[tid] = partial;
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint s = 128; s > 0; s >>= 1)
+    {
+        if (tid < s)
+            gsSum[tid] += gsSum[tid + s];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+        solverPartials[group] = gsSum[0];
+}
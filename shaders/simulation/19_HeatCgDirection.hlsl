@@ -0,0 +1,21 @@
+// #19
+#include "CommonData.hlsl"
+
+// p = z + beta p
+
+StructuredBuffer<uint>  particleIndices : register(t4);
+StructuredBuffer<float> heatPrecond     : register(t17);
+StructuredBuffer<uint>  solverScalars   : register(t21);
+
+RWStructuredBuffer<float> heatDirection : register(u18);
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= numParticles || solverScalars[SOLVER_CONVERGED] != 0)
+        return;
+
+    uint i = particleIndices[gid];
+    float beta = asfloat(solverScalars[SOLVER_BETA]);
+    heatDirection[i] = heatPrecond[i] + beta * heatDirection[i];
+}
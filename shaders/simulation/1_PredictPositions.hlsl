@@ -2,7 +2,7 @@
 #include "CommonData.hlsl"
 
 StructuredBuffer<float3> gPositionsSrc     : register(t0);
-StructuredBuffer<uint>   particleIndices  : register(t4);
+StructuredBuffer<uint>   gPhase            : register(t30);
 
 RWStructuredBuffer<float3> gPredictedPositionsDst : register(u7);
 RWStructuredBuffer<float3> gVelocity           : register(u1);
@@ -10,17 +10,18 @@ RWStructuredBuffer<float3> gVelocity           : register(u1);
 [numthreads(256, 1, 1)]
 void CSMain(uint tid : SV_DispatchThreadID)
 {
-    if (tid >= numParticles) return;
-    uint idx = particleIndices[tid]; 
+    if (tid >= GetActiveCount()) return;
+    uint idx = activeIndices[tid]; 
 
     float3 pos = gPositionsSrc[idx];
     float3 vel = gVelocity[idx];
+    float stepDt = GetTimeLevelDt(gPhase[idx]);
 
     // Apply external forces
-    vel = vel + gravityVec * dt;
+    vel = vel + gravityVec * stepDt;
 
     // Predict new position
-    float3 posPred = pos + vel * dt;
+    float3 posPred = pos + vel * stepDt;
 
     gVelocity[idx] = vel;
     gPredictedPositionsDst[idx] = posPred;
@@ -0,0 +1,103 @@
+// #20
+#include "CommonKernels.hlsl"
+
+// Backward Euler viscous diffusion, A v' = v* / dt_i, one system shared by the three components:
+//   A_ii = 1 / dt_i + sum_j w_ij,  A_ij = -w_ij
+// Every row is divided by the particle's own step dt_i (GetTimeLevelDt), which keeps A symmetric
+// when due particles of different time levels are neighbors.
+// Starts CG from v' = v*, so r = b - A v* is the explicit viscous acceleration.
+
+StructuredBuffer<float3> predictedPositions : register(t7);
+StructuredBuffer<uint>   particleIndices    : register(t4);
+StructuredBuffer<uint>   cellStart          : register(t5);
+StructuredBuffer<uint>   cellEnd            : register(t6);
+StructuredBuffer<float>  density            : register(t8);
+StructuredBuffer<float>  viscosityMu        : register(t12);
+StructuredBuffer<float3> velocitiesIn       : register(t1); // v*
+StructuredBuffer<uint>   phase              : register(t30);
+
+RWStructuredBuffer<float3> velocities         : register(u1);  // x
+RWStructuredBuffer<float>  viscosityDiagonal  : register(u22);
+RWStructuredBuffer<float3> viscosityResidual  : register(u23);
+RWStructuredBuffer<float3> viscosityPrecond   : register(u24);
+RWStructuredBuffer<float3> viscosityDirection : register(u25);
+RWStructuredBuffer<float2> solverPartials     : register(u20); // r.z, r.r per group
+
+groupshared float2 gsSum[256];
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint group : SV_GroupID)
+{
+    float2 partial = float2(0, 0);
+
+    if (gid < GetActiveCount())
+    {
+        uint i = activeIndices[gid];
+
+        float3 pi = predictedPositions[i];
+        float3 vi = velocitiesIn[i];
+        float  rhoi = max(density[i], 1e-6);
+        float  mui = viscosityMu[i];
+        float  hi = SmoothingLength(i);
+        float  mi = ParticleMass(i);
+
+        float  wSum = 0.0;
+        float3 acc = float3(0, 0, 0);
+
+        uint3 cell = GetCellCoord(pi);
+
+        for (int dz = -1; dz <= 1; dz++)
+        for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            int3 nc = int3(cell) + int3(dx, dy, dz);
+            if (any(nc < 0) || any(nc >= int3(gridResolution)))
+                continue;
+
+            uint hash = GetCellHash(uint3(nc));
+            uint start = cellStart[hash];
+            uint end   = cellEnd[hash];
+
+            [loop]
+            for (uint idx = start; idx < end; idx++)
+            {
+                uint j = particleIndices[idx];
+                if (j == i) continue;
+
+                float3 rij = pi - predictedPositions[j];
+                float hij = 0.5 * (hi + SmoothingLength(j));
+                if (dot(rij, rij) >= hij * hij)
+                    continue;
+
+                float w = ViscousDiffusionWeight(rij, mui, viscosityMu[j], rhoi, max(density[j], 1e-6), 0.5 * (mi + ParticleMass(j)), hij);
+                wSum += w;
+                acc += w * (velocitiesIn[j] - vi);
+            }
+        }
+
+        float  diag = 1.0 / GetTimeLevelDt(phase[i]) + wSum;
+        float3 r = acc;
+        float3 z = r / diag;
+
+        velocities[i] = vi;
+        viscosityDiagonal[i] = diag;
+        viscosityResidual[i] = r;
+        viscosityPrecond[i] = z;
+        viscosityDirection[i] = z;
+
+        partial = float2(dot(r, z), dot(r, r));
+    }
+
+    gsSum[tid] = partial;
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint s = 128; s > 0; s >>= 1)
+    {
+        if (tid < s)
+            gsSum[tid] += gsSum[tid + s];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+        solverPartials[group] = gsSum[0];
+}
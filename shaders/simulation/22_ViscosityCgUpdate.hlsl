@@ -0,0 +1,53 @@
+// #22
+#include "CommonData.hlsl"
+
+// x += alpha p, r -= alpha Ap, z = r / diag(A)
+
+StructuredBuffer<float>  viscosityDiagonal  : register(t22);
+StructuredBuffer<float3> viscosityDirection : register(t25);
+StructuredBuffer<float3> viscosityProduct   : register(t26);
+StructuredBuffer<uint>   solverScalars      : register(t21);
+
+RWStructuredBuffer<float3> velocities        : register(u1); // x
+RWStructuredBuffer<float3> viscosityResidual : register(u23);
+RWStructuredBuffer<float3> viscosityPrecond  : register(u24);
+RWStructuredBuffer<float2> solverPartials    : register(u20); // r.z, r.r per group
+
+groupshared float2 gsSum[256];
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint group : SV_GroupID)
+{
+    if (solverScalars[SOLVER_CONVERGED] != 0)
+        return;
+
+    float alpha = asfloat(solverScalars[SOLVER_ALPHA]);
+    float2 partial = float2(0, 0);
+
+    if (gid < GetActiveCount())
+    {
+        uint i = activeIndices[gid];
+
+        velocities[i] += alpha * viscosityDirection[i];
+
+        float3 r = viscosityResidual[i] - alpha * viscosityProduct[i];
+        float3 z = r / viscosityDiagonal[i];
+        viscosityResidual[i] = r;
+        viscosityPrecond[i] = z;
+
+        partial = float2(dot(r, z), dot(r, r));
+    }
+
+    gsSum[tid] = partial;
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint s = 128; s > 0; s >>= 1)
+    {
+        if (tid < s)
+            gsSum[tid] += gsSum[tid + s];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+        solverPartials[group] = gsSum[0];
+}
@@ -0,0 +1,20 @@
+// #23
+#include "CommonData.hlsl"
+
+// p = z + beta p
+
+StructuredBuffer<float3> viscosityPrecond : register(t24);
+StructuredBuffer<uint>   solverScalars    : register(t21);
+
+RWStructuredBuffer<float3> viscosityDirection : register(u25);
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= GetActiveCount() || solverScalars[SOLVER_CONVERGED] != 0)
+        return;
+
+    uint i = activeIndices[gid];
+    float beta = asfloat(solverScalars[SOLVER_BETA]);
+    viscosityDirection[i] = viscosityPrecond[i] + beta * viscosityDirection[i];
+}
@@ -0,0 +1,64 @@
+// #24
+#include "CommonKernels.hlsl"
+
+// DFSPH factor alpha_i = 1 / (|sum_j m grad W_ij|^2 + sum_j |m grad W_ij|^2)
+// (the paper's alpha_i / rho_i), stored in the lambda buffer
+
+StructuredBuffer<float3> predictedPositions : register(t7);
+StructuredBuffer<uint>   particleIndices    : register(t4);
+StructuredBuffer<uint>   cellStart          : register(t5);
+StructuredBuffer<uint>   cellEnd            : register(t6);
+
+RWStructuredBuffer<float> alpha : register(u10);
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= GetActiveCount()) return;
+    uint i = activeIndices[gid];
+
+    float3 pi = predictedPositions[i];
+    float  hi = SmoothingLength(i);
+
+    float  sumGrad2 = 0.0;
+    float3 grad_i = float3(0, 0, 0);
+
+    uint3 cell = GetCellCoord(pi);
+
+    for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        int3 nc = int3(cell) + int3(dx, dy, dz);
+        if (any(nc < 0) || any(nc >= int3(gridResolution)))
+            continue;
+
+        uint hash = GetCellHash(uint3(nc));
+        uint start = cellStart[hash];
+        uint end   = cellEnd[hash];
+
+        [loop]
+        for (uint idx = start; idx < end; idx++)
+        {
+            uint j = particleIndices[idx];
+            if (j == i) continue;
+
+            float3 rij = pi - predictedPositions[j];
+            float hij = 0.5 * (hi + SmoothingLength(j));
+            if (dot(rij, rij) >= hij * hij) continue;
+
+            float3 grad_j = ParticleMass(j) * cubic_kernel_gradient(rij, hij);
+            sumGrad2 += dot(grad_j, grad_j);
+            grad_i += grad_j;
+        }
+    }
+
+    float3 wallGradient;
+    WallVolume(pi, hi, wallGradient);
+    grad_i += rho0 * wallGradient;
+
+    sumGrad2 += dot(grad_i, grad_i);
+
+    // particles with too few neighbors get no pressure
+    alpha[i] = sumGrad2 > 1e-6 ? 1.0 / sumGrad2 : 0.0;
+}
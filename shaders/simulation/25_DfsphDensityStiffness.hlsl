@@ -0,0 +1,32 @@
+// #25
+#include "CommonData.hlsl"
+
+// Constant density pass, position level: s_i = max(rho_i - rho0, 0) * alpha_i, which is
+// dt^2 * kappa_i / rho_i of the paper, so the correction x_i -= sum_j m (s_i + s_j) grad W_ij
+// does not depend on dt and the accumulated stiffness stays valid when dt changes.
+
+StructuredBuffer<float> density         : register(t8);
+StructuredBuffer<float> alpha           : register(t10);
+
+RWStructuredBuffer<float> kappa     : register(u27);
+RWStructuredBuffer<float> stiffness : register(u29);
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= GetActiveCount()) return;
+    uint i = activeIndices[gid];
+
+    if (passFlags & PASS_FLAG_WARM_START)
+    {
+        float s = DFSPH_WARM_START_SCALE * kappa[i];
+        stiffness[i] = s;
+        kappa[i] = s;
+        return;
+    }
+
+    // free surface: density below rest is not corrected
+    float s = max(density[i] - rho0, 0.0) * alpha[i];
+    stiffness[i] = s;
+    kappa[i] += s;
+}
@@ -0,0 +1,61 @@
+// #26
+#include "CommonKernels.hlsl"
+
+// delta_i = -sum_j m (s_i + s_j) grad W_ij - rho0 s_i grad V_i (walls), a position correction in the constant density
+// pass and a velocity correction in the divergence-free pass
+
+StructuredBuffer<float3> predictedPositions : register(t7);
+StructuredBuffer<uint>   particleIndices    : register(t4);
+StructuredBuffer<uint>   cellStart          : register(t5);
+StructuredBuffer<uint>   cellEnd            : register(t6);
+StructuredBuffer<float>  stiffness          : register(t29);
+
+RWStructuredBuffer<float3> deltaP : register(u11);
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= GetActiveCount()) return;
+    uint i = activeIndices[gid];
+
+    float3 pi = predictedPositions[i];
+    float  si = stiffness[i];
+    float  hi = SmoothingLength(i);
+
+    float3 delta = float3(0, 0, 0);
+
+    uint3 cell = GetCellCoord(pi);
+
+    for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        int3 nc = int3(cell) + int3(dx, dy, dz);
+        if (any(nc < 0) || any(nc >= int3(gridResolution)))
+            continue;
+
+        uint hash = GetCellHash(uint3(nc));
+        uint start = cellStart[hash];
+        uint end   = cellEnd[hash];
+
+        [loop]
+        for (uint idx = start; idx < end; idx++)
+        {
+            uint j = particleIndices[idx];
+            if (j == i) continue;
+
+            float3 rij = pi - predictedPositions[j];
+            float hij = 0.5 * (hi + SmoothingLength(j));
+            if (dot(rij, rij) >= hij * hij) continue;
+
+            delta -= ParticleMass(j) * (si + stiffness[j]) * cubic_kernel_gradient(rij, hij);
+        }
+    }
+
+    // walls at rest, with no stiffness of their own
+    float3 wallGradient;
+    WallVolume(pi, hi, wallGradient);
+    delta -= rho0 * si * wallGradient;
+
+    deltaP[i] = delta;
+}
@@ -0,0 +1,72 @@
+// #27
+#include "CommonKernels.hlsl"
+
+// Divergence-free pass, velocity level: s_i = max(D rho_i / Dt, 0) * alpha_i (dt * kappa^v_i / rho_i
+// of the paper), D rho_i / Dt = sum_j m (v_i - v_j) . grad W_ij
+
+StructuredBuffer<float3> predictedPositions : register(t7);
+StructuredBuffer<uint>   particleIndices    : register(t4);
+StructuredBuffer<uint>   cellStart          : register(t5);
+StructuredBuffer<uint>   cellEnd            : register(t6);
+StructuredBuffer<float>  alpha              : register(t10);
+
+RWStructuredBuffer<float3> velocities : register(u1);
+RWStructuredBuffer<float>  kappaV     : register(u28);
+RWStructuredBuffer<float>  stiffness  : register(u29);
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= GetActiveCount()) return;
+    uint i = activeIndices[gid];
+
+    if (passFlags & PASS_FLAG_WARM_START)
+    {
+        float s = DFSPH_WARM_START_SCALE * kappaV[i];
+        stiffness[i] = s;
+        kappaV[i] = s;
+        return;
+    }
+
+    float3 pi = predictedPositions[i];
+    float3 vi = velocities[i];
+    float  hi = SmoothingLength(i);
+
+    float divergence = 0.0;
+
+    uint3 cell = GetCellCoord(pi);
+
+    for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        int3 nc = int3(cell) + int3(dx, dy, dz);
+        if (any(nc < 0) || any(nc >= int3(gridResolution)))
+            continue;
+
+        uint hash = GetCellHash(uint3(nc));
+        uint start = cellStart[hash];
+        uint end   = cellEnd[hash];
+
+        [loop]
+        for (uint idx = start; idx < end; idx++)
+        {
+            uint j = particleIndices[idx];
+            if (j == i) continue;
+
+            float3 rij = pi - predictedPositions[j];
+            float hij = 0.5 * (hi + SmoothingLength(j));
+            if (dot(rij, rij) >= hij * hij) continue;
+
+            divergence += ParticleMass(j) * dot(vi - velocities[j], cubic_kernel_gradient(rij, hij));
+        }
+    }
+
+    float3 wallGradient;
+    WallVolume(pi, hi, wallGradient);
+    divergence += rho0 * dot(vi, wallGradient);
+
+    float s = max(divergence, 0.0) * alpha[i];
+    stiffness[i] = s;
+    kappaV[i] += s;
+}
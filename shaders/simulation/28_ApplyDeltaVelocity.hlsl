@@ -0,0 +1,16 @@
+// #28
+#include "CommonData.hlsl"
+
+RWStructuredBuffer<float3> velocities : register(u1);
+RWStructuredBuffer<float3> deltaP     : register(u11); // velocity correction of the divergence-free pass
+
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= GetActiveCount()) return;
+
+    uint i = activeIndices[gid];
+
+    velocities[i] += deltaP[i];
+    deltaP[i] = float3(0, 0, 0);
+}
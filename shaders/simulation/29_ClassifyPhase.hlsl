@@ -0,0 +1,213 @@
+// #29
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<float3> positions       : register(t0);
+StructuredBuffer<float>  temperatures    : register(t2);
+StructuredBuffer<uint>   particleIndices : register(t4);
+StructuredBuffer<uint>   cellStart       : register(t5); // grid of the previous step
+StructuredBuffer<uint>   cellEnd         : register(t6);
+
+RWStructuredBuffer<float3> velocities         : register(u1);  // velocities the step starts from
+RWStructuredBuffer<float3> predicted          : register(u7);
+RWStructuredBuffer<float>  lambda             : register(u10);
+RWStructuredBuffer<float3> deltaP             : register(u11);
+RWStructuredBuffer<float3> viscosityDirection : register(u25);
+RWStructuredBuffer<float>  dfsphKappa         : register(u27);
+RWStructuredBuffer<float>  dfsphKappaV        : register(u28);
+RWStructuredBuffer<float>  dfsphStiffness     : register(u29);
+RWStructuredBuffer<uint>   phase              : register(u30);
+RWStructuredBuffer<uint>   activeGroupOffsets : register(u33); // active count per group, scanned by #30
+RWStructuredBuffer<uint>   rigidRebuildArgs   : register(u40); // solidified / melted counters
+
+groupshared uint gsActive;
+
+// hot or fast lava within h of a sleeper wakes it up
+bool IsTouchedByMovingLava(uint i, float3 xi)
+{
+    uint3 cell = GetCellCoord(xi);
+
+    for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        int3 nc = int3(cell) + int3(dx,dy,dz);
+
+        if (nc.x < 0 || nc.y < 0 || nc.z < 0 ||
+            nc.x >= gridResolution.x ||
+            nc.y >= gridResolution.y ||
+            nc.z >= gridResolution.z)
+        {
+            continue;
+        }
+
+        uint hash = GetCellHash(uint3(nc));
+        uint start = cellStart[hash];
+        uint end   = cellEnd[hash];
+
+        for (uint idx = start; idx < end; idx++)
+        {
+            uint j = particleIndices[idx];
+            if (j == i) continue;
+
+            float3 rij = xi - positions[j];
+            if (dot(rij, rij) >= h2) continue;
+
+            if (temperatures[j] > wakeTemperature || length(velocities[j]) > wakeSpeed)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+// Largest time level whose step keeps the particle and its neighbors within h below cfl h
+// of motion. A new interval starts only where the substep counter is a multiple of its
+// length, so the levels stay nested and meet at the level boundaries.
+uint ChooseTimeLevel(uint i, float3 xi)
+{
+    if (maxTimeLevel == 0)
+        return 0;
+
+    float vmax = length(velocities[i]);
+    uint3 cell = GetCellCoord(xi);
+
+    for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        int3 nc = int3(cell) + int3(dx,dy,dz);
+
+        if (nc.x < 0 || nc.y < 0 || nc.z < 0 ||
+            nc.x >= gridResolution.x ||
+            nc.y >= gridResolution.y ||
+            nc.z >= gridResolution.z)
+        {
+            continue;
+        }
+
+        uint hash = GetCellHash(uint3(nc));
+        uint start = cellStart[hash];
+        uint end   = cellEnd[hash];
+
+        for (uint idx = start; idx < end; idx++)
+        {
+            uint j = particleIndices[idx];
+            float3 rij = xi - positions[j];
+            if (dot(rij, rij) < h2)
+                vmax = max(vmax, length(velocities[j]));
+        }
+    }
+
+    uint level = maxTimeLevel;
+    float ratio = timeLevelCfl * h / max(vmax * dt, 1e-12);
+    if (ratio < exp2((float)maxTimeLevel))
+        level = ratio >= 1.0 ? (uint)floor(log2(ratio)) : 0;
+
+    while (level > 0 && (localStep & ((1u << level) - 1)) != 0)
+        level--;
+    return level;
+}
+
+// Runs over all particles at the start of a step. Updates the phase with hysteresis
+// (solid below solidifyTemperature until meltTemperature; asleep after sleepSteps calm
+// steps, awake again above the wake thresholds), pins sleepers as static neighbors and
+// counts the active particles of each thread group. Solid particles are moved by the
+// rigid cluster passes and are not part of the active list either. With local time
+// stepping an active particle keeps its level for a whole interval and waits, pinned
+// like a sleeper but with its velocity, until the last substep of the interval.
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint groupId : SV_GroupID)
+{
+    if (tid == 0)
+        gsActive = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    if (gid < numParticles)
+    {
+        uint i = particleIndices[gid];
+        uint p = phase[i];
+        uint previous = p & PHASE_STATE_MASK;
+        uint state = previous;
+        uint calmSteps = p >> PHASE_COUNTER_SHIFT;
+
+        float3 xi = positions[i];
+        float Ti = temperatures[i];
+
+        bool solid = rigidEnabled != 0 &&
+                     (previous == PHASE_SOLID ? Ti <= meltTemperature : Ti < solidifyTemperature);
+
+        if (solid)
+        {
+            state = PHASE_SOLID;
+            calmSteps = 0;
+        }
+        else if (sleepingEnabled != 0 && previous == PHASE_SLEEPING)
+        {
+            if (Ti > wakeTemperature || IsTouchedByMovingLava(i, xi))
+            {
+                state = PHASE_ACTIVE;
+                calmSteps = 0;
+            }
+        }
+        else if (sleepingEnabled != 0)
+        {
+            bool calm = previous == PHASE_ACTIVE && Ti < sleepTemperature && length(velocities[i]) < sleepSpeed;
+            calmSteps = calm ? calmSteps + 1 : 0;
+            state = calmSteps >= sleepSteps ? PHASE_SLEEPING : PHASE_ACTIVE;
+        }
+        else
+        {
+            state = PHASE_ACTIVE;
+            calmSteps = 0;
+        }
+
+        // cluster labels are rebuilt only on steps where the solid set changed
+        if (state != previous && state == PHASE_SOLID)
+            InterlockedAdd(rigidRebuildArgs[RIGID_SOLIDIFIED], 1);
+        else if (state != previous && previous == PHASE_SOLID)
+            InterlockedAdd(rigidRebuildArgs[RIGID_MELTED], 1);
+
+        uint timeLevel = 0;
+        bool waiting = false;
+        if (state == PHASE_ACTIVE && previous == PHASE_ACTIVE)
+        {
+            timeLevel = GetTimeLevel(p);
+            if ((localStep & ((1u << timeLevel) - 1)) == 0)
+                timeLevel = ChooseTimeLevel(i, xi);
+            waiting = ((localStep + 1) & ((1u << timeLevel) - 1)) != 0;
+        }
+
+        if (waiting)
+        {
+            predicted[i] = xi;
+        }
+
+        if (state == PHASE_SLEEPING)
+        {
+            // static neighbor: no motion
+            velocities[i] = float3(0, 0, 0);
+            predicted[i] = xi;
+        }
+
+        if (state != PHASE_ACTIVE || waiting)
+        {
+            // no pressure on fluid neighbors, nothing to warm start from on return to the fluid
+            lambda[i] = 0.0;
+            deltaP[i] = float3(0, 0, 0);
+            viscosityDirection[i] = float3(0, 0, 0);
+            dfsphKappa[i] = 0.0;
+            dfsphKappaV[i] = 0.0;
+            dfsphStiffness[i] = 0.0;
+        }
+
+        phase[i] = state | (timeLevel << PHASE_TIME_LEVEL_SHIFT) | (waiting ? PHASE_WAITING : 0) |
+                   (min(calmSteps, sleepSteps) << PHASE_COUNTER_SHIFT);
+
+        if (state == PHASE_ACTIVE && !waiting)
+            InterlockedAdd(gsActive, 1);
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+    if (tid == 0)
+        activeGroupOffsets[groupId] = gsActive;
+}
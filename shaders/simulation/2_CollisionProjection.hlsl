@@ -1,7 +1,5 @@
 // #2
-#include "CommonData.hlsl"
-
-StructuredBuffer<uint> particleIndices : register(t4);
+#include "CommonKernels.hlsl"
 
 RWStructuredBuffer<float3> gPredictedPositions : register(u7);
 RWStructuredBuffer<float3> gVelocity           : register(u1);
@@ -9,8 +7,8 @@ RWStructuredBuffer<float3> gVelocity           : register(u1);
 [numthreads(256, 1, 1)]
 void CSMain(uint gid : SV_DispatchThreadID)
 {
-    if (gid >= numParticles) return;
-    uint i = particleIndices[gid.x];
+    if (gid >= GetActiveCount()) return;
+    uint i = activeIndices[gid.x];
 
     float3 q = gPredictedPositions[i];
     float3 v = gVelocity[i];
@@ -27,4 +25,17 @@ void CSMain(uint gid : SV_DispatchThreadID)
         }
         //gPredictedPositions[i] = q;
     }
-}
\ No newline at end of file
+
+    // static obstacles and terrain: the solver starts outside, the approach velocity is removed
+    float3 n = ProjectOutOfStaticGeometry(q);
+    if (any(n != 0.0))
+    {
+        float vn = dot(v, n);
+        if (vn < 0.0)
+        {
+            v -= vn * n;
+            gVelocity[i] = v;
+        }
+        gPredictedPositions[i] = q;
+    }
+}
@@ -0,0 +1,53 @@
+// #30
+#include "CommonData.hlsl"
+
+RWStructuredBuffer<uint> activeArgsOut      : register(u32);
+RWStructuredBuffer<uint> activeGroupOffsets : register(u33); // in: count per group, out: exclusive offsets
+RWStructuredBuffer<uint> diagnostics        : register(u14);
+
+groupshared uint gsScan[256];
+
+// single group: exclusive scan of the active counts of the classify groups,
+// indirect dispatch arguments over the active list
+[numthreads(256,1,1)]
+void CSMain(uint tid : SV_GroupThreadID)
+{
+    // time level histogram, filled by #31
+    if (tid < TIME_LEVEL_MAX)
+        diagnostics[DIAG_TIME_LEVELS + tid] = 0;
+
+    uint groupCount = (numParticles + 255) / 256;
+    uint carry = 0;
+
+    for (uint base = 0; base < groupCount; base += 256)
+    {
+        uint g = base + tid;
+        uint count = g < groupCount ? activeGroupOffsets[g] : 0;
+
+        // Hillis-Steele inclusive scan
+        gsScan[tid] = count;
+        GroupMemoryBarrierWithGroupSync();
+        for (uint s = 1; s < 256; s <<= 1)
+        {
+            uint v = tid >= s ? gsScan[tid - s] : 0;
+            GroupMemoryBarrierWithGroupSync();
+            gsScan[tid] += v;
+            GroupMemoryBarrierWithGroupSync();
+        }
+
+        if (g < groupCount)
+            activeGroupOffsets[g] = carry + gsScan[tid] - count;
+
+        carry += gsScan[255];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+    {
+        activeArgsOut[0] = (carry + 255) / 256;
+        activeArgsOut[1] = 1;
+        activeArgsOut[2] = 1;
+        activeArgsOut[3] = carry;
+        diagnostics[DIAG_ACTIVE_COUNT] = carry;
+    }
+}
@@ -0,0 +1,55 @@
+// #31
+#include "CommonData.hlsl"
+
+StructuredBuffer<float3> velocitiesIn   : register(t1); // velocities the step starts from (halves swapped)
+StructuredBuffer<uint> particleIndices    : register(t4);
+StructuredBuffer<uint> phase              : register(t30);
+StructuredBuffer<uint> activeGroupOffsets : register(t33);
+
+RWStructuredBuffer<float3> velocities     : register(u1); // the other half
+RWStructuredBuffer<uint> activeIndicesOut : register(u31);
+RWStructuredBuffer<uint> diagnostics      : register(u14);
+
+groupshared uint gsScan[256];
+groupshared uint gsLevels[TIME_LEVEL_MAX];
+
+// compacts the active particles into the active list, keeping the grid order
+// of particleIndices so that neighbor reads stay coherent; particles waiting for
+// their time level are left out. The step passes write velocity only for the active
+// list and the step starts from alternate halves, so waiting and sleeping particles get
+// their velocity copied to the other half: both halves then hold the velocity they will
+// resume with.
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint groupId : SV_GroupID)
+{
+    if (tid < TIME_LEVEL_MAX)
+        gsLevels[tid] = 0;
+
+    uint i = gid < numParticles ? particleIndices[gid] : 0;
+    uint p = gid < numParticles ? phase[i] : PHASE_KILLED;
+    bool fluid = (p & PHASE_STATE_MASK) == PHASE_ACTIVE;
+    uint active = fluid && (p & PHASE_WAITING) == 0 ? 1 : 0;
+
+    if (gid < numParticles && ((fluid && !active) || (p & PHASE_STATE_MASK) == PHASE_SLEEPING))
+        velocities[i] = velocitiesIn[i];
+
+    GroupMemoryBarrierWithGroupSync();
+    if (fluid)
+        InterlockedAdd(gsLevels[GetTimeLevel(p)], 1);
+
+    gsScan[tid] = active;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint s = 1; s < 256; s <<= 1)
+    {
+        uint v = tid >= s ? gsScan[tid - s] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gsScan[tid] += v;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (active)
+        activeIndicesOut[activeGroupOffsets[groupId] + gsScan[tid] - 1] = i;
+
+    if (tid < TIME_LEVEL_MAX && gsLevels[tid] > 0)
+        InterlockedAdd(diagnostics[DIAG_TIME_LEVELS + tid], gsLevels[tid]);
+}
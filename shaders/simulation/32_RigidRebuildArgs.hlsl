@@ -0,0 +1,31 @@
+// #32
+#include "CommonData.hlsl"
+
+RWStructuredBuffer<uint> rigidRebuildArgs : register(u40);
+RWStructuredBuffer<uint> diagnostics      : register(u14);
+
+// single thread: turns the solidified / melted counters of the classify pass into the
+// indirect arguments of the label rebuild. No change means zero thread groups. passParam
+// != 0 forces a full rebuild, for steps after particle indices changed (compaction,
+// restart), when the labels of the previous rebuild no longer name the same particles.
+[numthreads(1,1,1)]
+void CSMain()
+{
+    uint solidified = rigidRebuildArgs[RIGID_SOLIDIFIED];
+    uint melted = rigidRebuildArgs[RIGID_MELTED];
+
+    uint mode = RIGID_REBUILD_NONE;
+    if (passParam != 0)
+        mode = RIGID_REBUILD_FULL;
+    else if (solidified > 0 || melted > 0)
+        mode = RIGID_REBUILD_CHANGED;
+
+    rigidRebuildArgs[0] = mode != RIGID_REBUILD_NONE ? (numParticles + 255) / 256 : 0;
+    rigidRebuildArgs[1] = 1;
+    rigidRebuildArgs[2] = 1;
+    rigidRebuildArgs[RIGID_REBUILD_MODE] = mode;
+    rigidRebuildArgs[RIGID_SOLIDIFIED] = 0;
+    rigidRebuildArgs[RIGID_MELTED] = 0;
+
+    diagnostics[DIAG_RIGID + 2] = mode;
+}
@@ -0,0 +1,25 @@
+// #33
+#include "CommonData.hlsl"
+
+StructuredBuffer<uint> phase            : register(t30);
+StructuredBuffer<uint> rigidRebuildArgs : register(t40);
+
+RWStructuredBuffer<uint> rigidLabel          : register(u34);
+RWStructuredBuffer<uint> rigidMembers        : register(u36); // label of the previous rebuild until #37
+RWStructuredBuffer<uint> rigidClusterOffsets : register(u37);
+
+// every solid particle starts as its own cluster. The member list is rebuilt by #37, so
+// it holds the labels of the previous rebuild meanwhile and #35 can tell which clusters
+// kept their members; after a full rebuild no cluster counts as kept.
+[numthreads(256,1,1)]
+void CSMain(uint i : SV_DispatchThreadID)
+{
+    if (i >= numParticles) return;
+
+    bool solid = (phase[i] & PHASE_STATE_MASK) == PHASE_SOLID;
+    bool full = rigidRebuildArgs[RIGID_REBUILD_MODE] == RIGID_REBUILD_FULL;
+
+    rigidMembers[i] = full ? RIGID_NONE : rigidLabel[i];
+    rigidLabel[i] = solid ? i : RIGID_NONE;
+    rigidClusterOffsets[i] = 0;
+}
@@ -0,0 +1,90 @@
+// #34
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<float3> positions       : register(t0);
+StructuredBuffer<uint>   particleIndices : register(t4);
+StructuredBuffer<uint>   cellStart       : register(t5);
+StructuredBuffer<uint>   cellEnd         : register(t6);
+StructuredBuffer<uint>   phase           : register(t30);
+
+globallycoherent RWStructuredBuffer<uint> rigidLabel : register(u34);
+
+uint FindRoot(uint x)
+{
+    uint parent = rigidLabel[x];
+    while (parent != x)
+    {
+        x = parent;
+        parent = rigidLabel[x];
+    }
+    return x;
+}
+
+// lock-free union: the larger root is linked below the smaller one, so parents always have
+// smaller indices and every cluster ends up labeled with its smallest particle index
+void Union(uint a, uint b)
+{
+    [loop]
+    while (true)
+    {
+        a = FindRoot(a);
+        b = FindRoot(b);
+        if (a == b)
+            return;
+
+        uint lo = min(a, b);
+        uint hi = max(a, b);
+        uint previous;
+        InterlockedCompareExchange(rigidLabel[hi], hi, lo, previous);
+        if (previous == hi)
+            return;
+
+        // hi was linked by another thread in the meantime, retry from its new parent
+        a = previous;
+        b = lo;
+    }
+}
+
+// connects solid particles closer than h (union-find over the neighbor graph)
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= numParticles) return;
+    uint i = particleIndices[gid];
+    if ((phase[i] & PHASE_STATE_MASK) != PHASE_SOLID) return;
+
+    float3 xi = positions[i];
+    uint3 cell = GetCellCoord(xi);
+
+    for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        int3 nc = int3(cell) + int3(dx,dy,dz);
+
+        if (nc.x < 0 || nc.y < 0 || nc.z < 0 ||
+            nc.x >= gridResolution.x ||
+            nc.y >= gridResolution.y ||
+            nc.z >= gridResolution.z)
+        {
+            continue;
+        }
+
+        uint hash = GetCellHash(uint3(nc));
+        uint start = cellStart[hash];
+        uint end   = cellEnd[hash];
+
+        for (uint idx = start; idx < end; idx++)
+        {
+            uint j = particleIndices[idx];
+            // every pair once
+            if (j >= i) continue;
+            if ((phase[j] & PHASE_STATE_MASK) != PHASE_SOLID) continue;
+
+            float3 rij = xi - positions[j];
+            if (dot(rij, rij) >= h2) continue;
+
+            Union(i, j);
+        }
+    }
+}
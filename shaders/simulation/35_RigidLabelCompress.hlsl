@@ -0,0 +1,35 @@
+// #35
+#include "CommonData.hlsl"
+
+StructuredBuffer<uint> rigidMembers : register(t36); // label of the previous rebuild, see #33
+
+RWStructuredBuffer<uint> rigidLabel          : register(u34);
+RWStructuredBuffer<uint> rigidClusterOffsets : register(u37); // member count per root, RIGID_CHANGED flag
+
+// Points every solid particle directly at its root and counts the members of each cluster.
+// A root is flagged as changed when one of its members was in another cluster before, or
+// a member of its previous cluster is in another one now or melted; a cluster without the
+// flag has exactly the members of the previous rebuild, and so the same root.
+[numthreads(256,1,1)]
+void CSMain(uint i : SV_DispatchThreadID)
+{
+    if (i >= numParticles) return;
+
+    uint previous = rigidMembers[i];
+    uint root = rigidLabel[i];
+    if (root != RIGID_NONE)
+    {
+        // roots are not written in this pass, so the walk always ends
+        while (rigidLabel[root] != root)
+            root = rigidLabel[root];
+
+        rigidLabel[i] = root;
+        InterlockedAdd(rigidClusterOffsets[root], 1);
+        if (previous != root)
+            InterlockedOr(rigidClusterOffsets[root], RIGID_CHANGED);
+    }
+
+    // the previous cluster lost this particle
+    if (previous != RIGID_NONE && previous != root && previous < numParticles)
+        InterlockedOr(rigidClusterOffsets[previous], RIGID_CHANGED);
+}
@@ -0,0 +1,69 @@
+// #36
+#include "CommonData.hlsl"
+
+StructuredBuffer<uint> rigidRebuildArgs : register(t40);
+
+RWStructuredBuffer<uint4> rigidGroupOffsets : register(u58); // in: totals per group from #56, out: exclusive offsets
+RWStructuredBuffer<uint>  rigidArgs         : register(u41);
+RWStructuredBuffer<uint>  diagnostics       : register(u14);
+
+groupshared uint3 gsScan[256];
+
+// single group: exclusive scan of the per-group totals of #56 (solids in clusters of two
+// or more, those clusters, single-particle clusters), indirect arguments of the
+// per-cluster, per-solid and per-single passes
+[numthreads(256,1,1)]
+void CSMain(uint tid : SV_GroupThreadID)
+{
+    if (rigidRebuildArgs[RIGID_REBUILD_MODE] == RIGID_REBUILD_NONE)
+        return;
+
+    uint groupCount = (numParticles + 255) / 256;
+    uint3 carry = uint3(0, 0, 0);
+
+    for (uint base = 0; base < groupCount; base += 256)
+    {
+        uint g = base + tid;
+        uint3 value = g < groupCount ? rigidGroupOffsets[g].xyz : uint3(0, 0, 0);
+
+        // Hillis-Steele inclusive scan
+        gsScan[tid] = value;
+        GroupMemoryBarrierWithGroupSync();
+        for (uint s = 1; s < 256; s <<= 1)
+        {
+            uint3 v = tid >= s ? gsScan[tid - s] : uint3(0, 0, 0);
+            GroupMemoryBarrierWithGroupSync();
+            gsScan[tid] += v;
+            GroupMemoryBarrierWithGroupSync();
+        }
+
+        if (g < groupCount)
+            rigidGroupOffsets[g] = uint4(carry + gsScan[tid] - value, 0);
+
+        carry += gsScan[255];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+    {
+        uint clusterCount = carry.y;
+        uint singleCount = carry.z;
+        uint solidCount = carry.x + singleCount;
+
+        rigidArgs[0] = min(clusterCount, RIGID_MAX_CLUSTER_GROUPS);
+        rigidArgs[1] = 1;
+        rigidArgs[2] = 1;
+        rigidArgs[RIGID_CLUSTER_COUNT] = clusterCount;
+        rigidArgs[4] = (solidCount + 255) / 256;
+        rigidArgs[5] = 1;
+        rigidArgs[6] = 1;
+        rigidArgs[RIGID_SOLID_COUNT] = solidCount;
+        rigidArgs[8] = (singleCount + 255) / 256;
+        rigidArgs[9] = 1;
+        rigidArgs[10] = 1;
+        rigidArgs[RIGID_SINGLE_COUNT] = singleCount;
+
+        diagnostics[DIAG_RIGID] = solidCount;
+        diagnostics[DIAG_RIGID + 1] = clusterCount + singleCount;
+    }
+}
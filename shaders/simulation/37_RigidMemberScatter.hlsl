@@ -0,0 +1,21 @@
+// #37
+#include "CommonData.hlsl"
+
+StructuredBuffer<uint> rigidLabel : register(t34);
+
+RWStructuredBuffer<uint> rigidMembers        : register(u36);
+RWStructuredBuffer<uint> rigidClusterOffsets : register(u37); // used as the write cursor of each cluster
+
+// groups the solid particles by cluster; the order inside a cluster is arbitrary
+[numthreads(256,1,1)]
+void CSMain(uint i : SV_DispatchThreadID)
+{
+    if (i >= numParticles) return;
+
+    uint root = rigidLabel[i];
+    if (root == RIGID_NONE) return;
+
+    uint slot;
+    InterlockedAdd(rigidClusterOffsets[root], 1, slot);
+    rigidMembers[slot] = i;
+}
@@ -0,0 +1,60 @@
+// #38
+#include "CommonData.hlsl"
+
+StructuredBuffer<float3> positions        : register(t0);
+StructuredBuffer<uint>   rigidLabel       : register(t34);
+StructuredBuffer<uint>   rigidMembers     : register(t36);
+StructuredBuffer<uint2>  rigidClusters    : register(t38);
+StructuredBuffer<uint>   rigidRebuildArgs : register(t40);
+StructuredBuffer<uint>   rigidArgs        : register(t41);
+
+RWStructuredBuffer<float3> rigidRestOffset : register(u35);
+RWStructuredBuffer<float4> rigidRotation   : register(u39); // per root
+
+groupshared float3 gsSum[256];
+
+// Clusters of two or more, each group strides over them, rebuild steps only. A cluster
+// whose rotation #57 cleared takes its current shape as the rest shape: rest offsets
+// relative to the center of mass, rotation identity. Clusters with the members of the
+// previous rebuild keep their rest shape and rotation.
+[numthreads(256,1,1)]
+void CSMain(uint tid : SV_GroupThreadID, uint groupId : SV_GroupID)
+{
+    if (rigidRebuildArgs[RIGID_REBUILD_MODE] == RIGID_REBUILD_NONE)
+        return;
+
+    uint clusterCount = rigidArgs[RIGID_CLUSTER_COUNT];
+    for (uint cluster = groupId; cluster < clusterCount; cluster += RIGID_MAX_CLUSTER_GROUPS)
+    {
+        uint2 range = rigidClusters[cluster];
+        uint root = rigidLabel[rigidMembers[range.x]];
+        if (any(rigidRotation[root] != 0.0))
+            continue;
+
+        float3 sum = float3(0, 0, 0);
+        for (uint k = tid; k < range.y; k += 256)
+            sum += positions[rigidMembers[range.x + k]];
+
+        gsSum[tid] = sum;
+        GroupMemoryBarrierWithGroupSync();
+        for (uint s = 128; s > 0; s >>= 1)
+        {
+            if (tid < s)
+                gsSum[tid] += gsSum[tid + s];
+            GroupMemoryBarrierWithGroupSync();
+        }
+
+        float3 center = gsSum[0] / range.y;
+
+        for (uint m = tid; m < range.y; m += 256)
+        {
+            uint i = rigidMembers[range.x + m];
+            rigidRestOffset[i] = positions[i] - center;
+        }
+
+        // gsSum is reused by the next cluster
+        GroupMemoryBarrierWithGroupSync();
+        if (tid == 0)
+            rigidRotation[root] = float4(0, 0, 0, 1);
+    }
+}
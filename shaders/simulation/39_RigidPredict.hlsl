@@ -0,0 +1,22 @@
+// #39
+#include "CommonData.hlsl"
+
+StructuredBuffer<float3> positions    : register(t0);
+StructuredBuffer<uint>   rigidMembers : register(t36);
+StructuredBuffer<uint>   rigidArgs    : register(t41);
+
+RWStructuredBuffer<float3> predicted  : register(u7);
+RWStructuredBuffer<float3> velocities : register(u1);
+
+// solid particles: gravity only, contacts and the cluster shape are resolved after the fluid solve
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= rigidArgs[RIGID_SOLID_COUNT]) return;
+    uint i = rigidMembers[gid];
+
+    float3 v = velocities[i] + gravityVec * dt;
+
+    velocities[i] = v;
+    predicted[i] = positions[i] + v * dt;
+}
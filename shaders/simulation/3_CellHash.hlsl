@@ -5,12 +5,24 @@ StructuredBuffer<float3> predictedPositionBuffer : register(t7);
 
 RWStructuredBuffer<uint> hashBuffer  : register(u3);
 RWStructuredBuffer<uint> indexBuffer : register(u4);
+RWStructuredBuffer<int>  cellStart   : register(u5);
+RWStructuredBuffer<int>  cellEnd     : register(u6);
 
 [numthreads(256, 1, 1)]
 void CS_HashParticles(uint gid : SV_DispatchThreadID)
 {
+    // empty cells must not keep the range of an earlier step, which may point past numParticles;
+    // passes over the previous grid have already run
+    uint numCells = gridResolution.x * gridResolution.y * gridResolution.z;
+    if (gid < numCells)
+    {
+        cellStart[gid] = 0;
+        cellEnd[gid] = 0;
+    }
+
+    // slots past numParticles keep the UINT_MAX hash written at init and sort to the end
     if (gid >= numParticles) return;
-    uint id = indexBuffer[gid];
+    uint id = gid;
 
     float3 pos = predictedPositionBuffer[id];
     uint3 cell = GetCellCoord(pos);
@@ -0,0 +1,68 @@
+// #40
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<float3> predictedPositions : register(t7);
+StructuredBuffer<uint>   particleIndices    : register(t4);
+StructuredBuffer<uint>   cellStart          : register(t5);
+StructuredBuffer<uint>   cellEnd            : register(t6);
+StructuredBuffer<uint>   rigidLabel         : register(t34);
+StructuredBuffer<uint>   rigidMembers       : register(t36);
+StructuredBuffer<uint>   rigidArgs          : register(t41);
+
+RWStructuredBuffer<float3> deltaP : register(u11);
+
+// Contact correction of a solid particle, averaged into the cluster motion by shape
+// matching: pushed out of fluid and other clusters closer than the rest spacing, and
+// back into the world box. Fluid is pushed back by its own density constraint.
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= rigidArgs[RIGID_SOLID_COUNT]) return;
+    uint i = rigidMembers[gid];
+
+    float3 pi = predictedPositions[i];
+    uint cluster = rigidLabel[i];
+    float restSpacing = pow(mass / rho0, 1.0 / 3.0);
+
+    float3 dp = float3(0, 0, 0);
+    uint3 cell = GetCellCoord(pi);
+
+    for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        int3 nc = int3(cell) + int3(dx,dy,dz);
+
+        if (nc.x < 0 || nc.y < 0 || nc.z < 0 ||
+            nc.x >= gridResolution.x ||
+            nc.y >= gridResolution.y ||
+            nc.z >= gridResolution.z)
+        {
+            continue;
+        }
+
+        uint hash = GetCellHash(uint3(nc));
+        uint start = cellStart[hash];
+        uint end   = cellEnd[hash];
+
+        for (uint idx = start; idx < end; idx++)
+        {
+            uint j = particleIndices[idx];
+            if (rigidLabel[j] == cluster) continue;
+
+            float3 rij = pi - predictedPositions[j];
+            float dist = length(rij);
+            if (dist >= restSpacing || dist < 1e-6) continue;
+
+            // both sides take half of the overlap
+            dp += 0.5 * (restSpacing - dist) * rij / dist;
+        }
+    }
+
+    float3 worldMin = worldOrigin;
+    float3 worldMax = worldOrigin + float3(gridResolution) * cellSize;
+    float3 q = pi + dp;
+    dp += clamp(q, worldMin, worldMax) - q;
+
+    deltaP[i] = dp;
+}
@@ -0,0 +1,134 @@
+// #41
+#include "CommonData.hlsl"
+
+StructuredBuffer<uint>   rigidLabel      : register(t34);
+StructuredBuffer<uint>   rigidMembers    : register(t36);
+StructuredBuffer<uint2>  rigidClusters   : register(t38);
+StructuredBuffer<uint>   rigidArgs       : register(t41);
+StructuredBuffer<float3> rigidRestOffset : register(t35);
+StructuredBuffer<float3> deltaP          : register(t11);
+
+RWStructuredBuffer<float3> positions     : register(u0);
+RWStructuredBuffer<float3> predicted     : register(u7);
+RWStructuredBuffer<float3> velocities    : register(u1); // velocities the next step starts from
+RWStructuredBuffer<float4> rigidRotation : register(u39); // per root
+
+groupshared float3 gsCenter[256];
+groupshared float3 gsA0[256];
+groupshared float3 gsA1[256];
+groupshared float3 gsA2[256];
+groupshared float4 gsRotation;
+
+float4 QuatMul(float4 a, float4 b)
+{
+    return float4(a.w * b.xyz + b.w * a.xyz + cross(a.xyz, b.xyz), a.w * b.w - dot(a.xyz, b.xyz));
+}
+
+float3 QuatRotate(float4 q, float3 v)
+{
+    float3 t = 2.0 * cross(q.xyz, v);
+    return v + q.w * t + cross(q.xyz, t);
+}
+
+// rotational part of A (columns a0, a1, a2), warm started from the previous rotation
+// (Mueller et al. 2016, "A Robust Method to Extract the Rotational Part of Deformations")
+float4 ExtractRotation(float3 a0, float3 a1, float3 a2, float4 q)
+{
+    for (uint iter = 0; iter < 16; ++iter)
+    {
+        float3 r0 = QuatRotate(q, float3(1, 0, 0));
+        float3 r1 = QuatRotate(q, float3(0, 1, 0));
+        float3 r2 = QuatRotate(q, float3(0, 0, 1));
+
+        float3 omega = (cross(r0, a0) + cross(r1, a1) + cross(r2, a2)) /
+                       (abs(dot(r0, a0) + dot(r1, a1) + dot(r2, a2)) + 1e-9);
+        float w = length(omega);
+        if (w < 1e-9)
+            break;
+
+        q = normalize(QuatMul(float4(sin(0.5 * w) * omega / w, cos(0.5 * w)), q));
+    }
+    return q;
+}
+
+// Clusters of two or more, each group strides over them: best rigid fit of the rest shape
+// to the predicted positions plus contact corrections (translation = center of mass,
+// rotation = polar decomposition of the moment matrix). Members end on the goal positions,
+// velocities follow from the move. Single-particle clusters are moved by #58.
+[numthreads(256,1,1)]
+void CSMain(uint tid : SV_GroupThreadID, uint groupId : SV_GroupID)
+{
+    uint clusterCount = rigidArgs[RIGID_CLUSTER_COUNT];
+    for (uint cluster = groupId; cluster < clusterCount; cluster += RIGID_MAX_CLUSTER_GROUPS)
+    {
+        uint2 range = rigidClusters[cluster];
+        uint root = rigidLabel[rigidMembers[range.x]];
+
+        float3 sum = float3(0, 0, 0);
+        for (uint k = tid; k < range.y; k += 256)
+        {
+            uint i = rigidMembers[range.x + k];
+            sum += predicted[i] + deltaP[i];
+        }
+
+        gsCenter[tid] = sum;
+        GroupMemoryBarrierWithGroupSync();
+        for (uint s = 128; s > 0; s >>= 1)
+        {
+            if (tid < s)
+                gsCenter[tid] += gsCenter[tid + s];
+            GroupMemoryBarrierWithGroupSync();
+        }
+        float3 center = gsCenter[0] / range.y;
+
+        // A = sum (p_i - c) q_i^T, equal masses
+        float3 a0 = float3(0, 0, 0);
+        float3 a1 = float3(0, 0, 0);
+        float3 a2 = float3(0, 0, 0);
+        for (uint m = tid; m < range.y; m += 256)
+        {
+            uint i = rigidMembers[range.x + m];
+            float3 d = predicted[i] + deltaP[i] - center;
+            float3 q = rigidRestOffset[i];
+            a0 += d * q.x;
+            a1 += d * q.y;
+            a2 += d * q.z;
+        }
+
+        gsA0[tid] = a0;
+        gsA1[tid] = a1;
+        gsA2[tid] = a2;
+        GroupMemoryBarrierWithGroupSync();
+        for (uint r = 128; r > 0; r >>= 1)
+        {
+            if (tid < r)
+            {
+                gsA0[tid] += gsA0[tid + r];
+                gsA1[tid] += gsA1[tid + r];
+                gsA2[tid] += gsA2[tid + r];
+            }
+            GroupMemoryBarrierWithGroupSync();
+        }
+
+        if (tid == 0)
+        {
+            gsRotation = ExtractRotation(gsA0[0], gsA1[0], gsA2[0], rigidRotation[root]);
+            rigidRotation[root] = gsRotation;
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        float4 rotation = gsRotation;
+        for (uint g = tid; g < range.y; g += 256)
+        {
+            uint i = rigidMembers[range.x + g];
+            float3 goal = center + QuatRotate(rotation, rigidRestOffset[i]);
+
+            velocities[i] = (goal - positions[i]) / dt * velocityDamping;
+            positions[i] = goal;
+            predicted[i] = goal;
+        }
+
+        // the shared sums and gsRotation are reused by the next cluster
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
@@ -0,0 +1,59 @@
+// #42
+#include "CommonData.hlsl"
+
+// must match EmittedParticle in ParticleEmitter.h
+struct EmittedParticle
+{
+    float3 position;
+    float temperature;
+    float3 velocity;
+    uint slot;
+    uint id;
+    uint3 pad;
+};
+
+StructuredBuffer<EmittedParticle> emitQueue : register(t42);
+
+RWStructuredBuffer<float3> positions      : register(u0);
+RWStructuredBuffer<float3> velocities     : register(u1); // velocities the step starts from
+RWStructuredBuffer<float>  temperatures   : register(u2); // bound to the current temperature buffer
+RWStructuredBuffer<float3> predicted      : register(u7);
+RWStructuredBuffer<float>  lambda         : register(u10);
+RWStructuredBuffer<float3> deltaP         : register(u11);
+RWStructuredBuffer<float>  viscosityMu    : register(u12);
+RWStructuredBuffer<float>  viscosityCoeff : register(u13);
+RWStructuredBuffer<float>  dfsphKappa     : register(u27);
+RWStructuredBuffer<float>  dfsphKappaV    : register(u28);
+RWStructuredBuffer<float>  dfsphStiffness : register(u29);
+RWStructuredBuffer<uint>   phase          : register(u30);
+RWStructuredBuffer<uint>   rigidLabel     : register(u34);
+RWStructuredBuffer<uint>   particleId     : register(u43);
+RWStructuredBuffer<int>    particleLevel  : register(u46);
+
+// passCount: emitted particles. Writes them into their slots and clears the solver state a
+// recycled slot may still hold; the classify pass of the step picks them up as active.
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= passCount) return;
+
+    EmittedParticle e = emitQueue[gid];
+    uint i = e.slot;
+
+    positions[i] = e.position;
+    predicted[i] = e.position;
+    velocities[i] = e.velocity;
+    temperatures[i] = e.temperature;
+
+    lambda[i] = 0.0;
+    deltaP[i] = float3(0.0, 0.0, 0.0);
+    viscosityMu[i] = 0.0;
+    viscosityCoeff[i] = 0.0;
+    dfsphKappa[i] = 0.0;
+    dfsphKappaV[i] = 0.0;
+    dfsphStiffness[i] = 0.0;
+    phase[i] = PHASE_ACTIVE;
+    rigidLabel[i] = RIGID_NONE;
+    particleId[i] = e.id;
+    particleLevel[i] = 0;
+}
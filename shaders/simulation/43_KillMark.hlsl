@@ -0,0 +1,34 @@
+// #43
+#include "CommonData.hlsl"
+
+StructuredBuffer<float3> positions : register(t0);
+
+RWStructuredBuffer<uint> diagnostics        : register(u14); // split count of #48
+RWStructuredBuffer<uint> phase              : register(u30);
+RWStructuredBuffer<uint> activeGroupOffsets : register(u33); // survivors per group, scanned by #44
+
+groupshared uint gsSurvivors;
+
+// end of step: flags particles inside a kill volume and counts the survivors per group;
+// the active list of the step is no longer needed, its group offsets are reused.
+// passCount: split budget of the step, the children appended by #48 are included and
+// the particles merged away by #48 are already flagged
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint groupId : SV_GroupID)
+{
+    if (tid == 0)
+        gsSurvivors = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    if (gid < numParticles + min(diagnostics[DIAG_ADAPTIVE], passCount))
+    {
+        if ((phase[gid] & PHASE_STATE_MASK) == PHASE_KILLED || IsInKillVolume(positions[gid]))
+            phase[gid] = PHASE_KILLED;
+        else
+            InterlockedAdd(gsSurvivors, 1);
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+    if (tid == 0)
+        activeGroupOffsets[groupId] = gsSurvivors;
+}
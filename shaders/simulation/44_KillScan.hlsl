@@ -0,0 +1,43 @@
+// #44
+#include "CommonData.hlsl"
+
+RWStructuredBuffer<uint> activeGroupOffsets : register(u33); // in: survivors per group, out: exclusive offsets
+RWStructuredBuffer<uint> diagnostics        : register(u14);
+
+groupshared uint gsScan[256];
+
+// single group: exclusive scan of the survivor counts of the kill mark groups; the number
+// of killed particles is read back and decides whether the compaction runs
+[numthreads(256,1,1)]
+void CSMain(uint tid : SV_GroupThreadID)
+{
+    uint count = numParticles + min(diagnostics[DIAG_ADAPTIVE], passCount); // see #43
+    uint groupCount = (count + 255) / 256;
+    uint carry = 0;
+
+    for (uint base = 0; base < groupCount; base += 256)
+    {
+        uint g = base + tid;
+        uint count = g < groupCount ? activeGroupOffsets[g] : 0;
+
+        // Hillis-Steele inclusive scan
+        gsScan[tid] = count;
+        GroupMemoryBarrierWithGroupSync();
+        for (uint s = 1; s < 256; s <<= 1)
+        {
+            uint v = tid >= s ? gsScan[tid - s] : 0;
+            GroupMemoryBarrierWithGroupSync();
+            gsScan[tid] += v;
+            GroupMemoryBarrierWithGroupSync();
+        }
+
+        if (g < groupCount)
+            activeGroupOffsets[g] = carry + gsScan[tid] - count;
+
+        carry += gsScan[255];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+        diagnostics[DIAG_KILLED] = count - carry;
+}
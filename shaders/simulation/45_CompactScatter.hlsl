@@ -0,0 +1,54 @@
+// #45
+#include "CommonData.hlsl"
+
+StructuredBuffer<float3> positions          : register(t0);
+StructuredBuffer<float3> velocities         : register(t1);
+StructuredBuffer<float>  temperatures       : register(t2);
+StructuredBuffer<float>  density            : register(t8);
+StructuredBuffer<float>  viscosityMu        : register(t12);
+StructuredBuffer<float>  viscosityCoeff     : register(t13);
+StructuredBuffer<float>  dfsphKappa         : register(t27);
+StructuredBuffer<float>  dfsphKappaV        : register(t28);
+StructuredBuffer<uint>   phase              : register(t30);
+StructuredBuffer<uint>   activeGroupOffsets : register(t33); // survivor offsets from #44
+StructuredBuffer<uint>   particleId         : register(t43);
+StructuredBuffer<int>    particleLevel      : register(t46);
+
+// the spare halves of the ping-pong buffers receive the compacted state
+RWStructuredBuffer<float3> positionsOut    : register(u0);
+RWStructuredBuffer<float3> velocitiesOut   : register(u1);
+RWStructuredBuffer<float>  temperaturesOut : register(u2);
+RWStructuredBuffer<float3> predicted       : register(u7); // hashed by the grid rebuild after the compaction
+RWStructuredBuffer<uint4>  compactUint     : register(u44);
+RWStructuredBuffer<float4> compactFloat    : register(u45);
+
+groupshared uint gsScan[256];
+
+// survivors keep their relative order: the new index is the group offset plus the rank
+// inside the group, same grouping as #43
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint groupId : SV_GroupID)
+{
+    uint keep = gid < numParticles && (phase[gid] & PHASE_STATE_MASK) != PHASE_KILLED ? 1 : 0;
+
+    gsScan[tid] = keep;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint s = 1; s < 256; s <<= 1)
+    {
+        uint v = tid >= s ? gsScan[tid - s] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gsScan[tid] += v;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (!keep) return;
+
+    uint j = activeGroupOffsets[groupId] + gsScan[tid] - 1;
+
+    positionsOut[j] = positions[gid];
+    predicted[j] = positions[gid];
+    velocitiesOut[j] = velocities[gid];
+    temperaturesOut[j] = temperatures[gid];
+    compactUint[j] = uint4(phase[gid], particleId[gid], asuint(particleLevel[gid]), asuint(density[gid]));
+    compactFloat[j] = float4(dfsphKappa[gid], dfsphKappaV[gid], viscosityMu[gid], viscosityCoeff[gid]);
+}
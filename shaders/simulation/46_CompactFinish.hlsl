@@ -0,0 +1,45 @@
+// #46
+#include "CommonData.hlsl"
+
+StructuredBuffer<uint4>  compactUint  : register(t44);
+StructuredBuffer<float4> compactFloat : register(t45);
+
+RWStructuredBuffer<uint>  hashBuffer     : register(u3);
+RWStructuredBuffer<uint>  indexBuffer    : register(u4);
+RWStructuredBuffer<float> density        : register(u8);
+RWStructuredBuffer<float> viscosityMu    : register(u12);
+RWStructuredBuffer<float> viscosityCoeff : register(u13);
+RWStructuredBuffer<float> dfsphKappa     : register(u27);
+RWStructuredBuffer<float> dfsphKappaV    : register(u28);
+RWStructuredBuffer<uint>  phase          : register(u30);
+RWStructuredBuffer<uint>  particleId     : register(u43);
+RWStructuredBuffer<int>   particleLevel  : register(u46);
+
+// numParticles: count before the compaction, passCount: survivors. Copies the compacted
+// per-particle state back; freed slots get the UINT_MAX hash and identity sort payload
+// they had before their first use, so the full-capacity sort keeps them at the end.
+[numthreads(256,1,1)]
+void CSMain(uint i : SV_DispatchThreadID)
+{
+    if (i >= numParticles) return;
+
+    if (i < passCount)
+    {
+        uint4 u = compactUint[i];
+        float4 f = compactFloat[i];
+        phase[i] = u.x;
+        particleId[i] = u.y;
+        particleLevel[i] = asint(u.z);
+        density[i] = asfloat(u.w);
+        dfsphKappa[i] = f.x;
+        dfsphKappaV[i] = f.y;
+        viscosityMu[i] = f.z;
+        viscosityCoeff[i] = f.w;
+    }
+    else
+    {
+        phase[i] = PHASE_ACTIVE;
+        hashBuffer[i] = 0xffffffffu;
+        indexBuffer[i] = i;
+    }
+}
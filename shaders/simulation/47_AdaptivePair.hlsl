@@ -0,0 +1,97 @@
+// #47
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<float3> positions       : register(t0);
+StructuredBuffer<float>  temperatures    : register(t2); // current temperature
+StructuredBuffer<uint>   particleIndices : register(t4);
+StructuredBuffer<uint>   cellStart       : register(t5);
+StructuredBuffer<uint>   cellEnd         : register(t6);
+StructuredBuffer<float>  density         : register(t8);
+
+RWStructuredBuffer<float3> velocities  : register(u1);  // velocities the next step starts from
+RWStructuredBuffer<uint>   diagnostics : register(u14);
+RWStructuredBuffer<uint>   phase       : register(u30);
+RWStructuredBuffer<uint>   partner     : register(u31); // the active list of the step is no longer needed
+
+static const float MERGE_DENSITY_RATIO = 0.95; // interior, the neighborhood is full
+static const float SPLIT_DENSITY_RATIO = 0.8;  // free surface and flow front
+
+bool IsAdaptable(uint i)
+{
+    uint state = phase[i] & PHASE_STATE_MASK;
+    return state == PHASE_ACTIVE || state == PHASE_SLEEPING;
+}
+
+bool IsMergeCandidate(uint i)
+{
+    return IsAdaptable(i) && particleLevel[i] < maxLevel &&
+           density[i] >= MERGE_DENSITY_RATIO * rho0 &&
+           length(velocities[i]) < mergeSpeed &&
+           temperatures[i] < mergeTemperature;
+}
+
+bool IsSplitCandidate(uint i)
+{
+    return IsAdaptable(i) && particleLevel[i] > minLevel &&
+           (density[i] < SPLIT_DENSITY_RATIO * rho0 || length(velocities[i]) > splitSpeed);
+}
+
+// end of step: every particle asks to be split, proposes a merge with the nearest merge
+// candidate of its level inside its smoothing length, or asks for nothing; #48 merges the
+// pairs that chose each other. Runs on the grid of the step.
+[numthreads(256,1,1)]
+void CSMain(uint i : SV_DispatchThreadID)
+{
+    if (i == 0)
+    {
+        // split count, merged pairs and the level histogram, filled by #48
+        for (int l = 0; l < 2 + ADAPTIVE_LEVEL_MAX - ADAPTIVE_LEVEL_MIN + 1; ++l)
+            diagnostics[DIAG_ADAPTIVE + l] = 0;
+    }
+
+    if (i >= numParticles) return;
+
+    uint choice = ADAPTIVE_NO_PARTNER;
+
+    if (IsSplitCandidate(i))
+    {
+        choice = ADAPTIVE_SPLIT;
+    }
+    else if (IsMergeCandidate(i))
+    {
+        float3 xi = positions[i];
+        int li = particleLevel[i];
+        float hi = SmoothingLength(i);
+        float best = hi * hi;
+
+        int3 cell = GetCellCoord(xi);
+        for (int dz = -1; dz <= 1; dz++)
+        for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            int3 nc = cell + int3(dx, dy, dz);
+            if (any(nc < 0) || any(nc >= int3(gridResolution)))
+                continue;
+
+            uint hash = GetCellHash(uint3(nc));
+            uint start = cellStart[hash];
+            uint end   = cellEnd[hash];
+
+            [loop]
+            for (uint idx = start; idx < end; idx++)
+            {
+                uint j = particleIndices[idx];
+                if (j == i || particleLevel[j] != li) continue;
+
+                float3 rij = xi - positions[j];
+                float d2 = dot(rij, rij);
+                if (d2 >= best || !IsMergeCandidate(j)) continue;
+
+                best = d2;
+                choice = j;
+            }
+        }
+    }
+
+    partner[i] = choice;
+}
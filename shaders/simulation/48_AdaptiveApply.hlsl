@@ -0,0 +1,126 @@
+// #48
+#include "CommonKernels.hlsl"
+
+RWStructuredBuffer<float3> positions      : register(u0);
+RWStructuredBuffer<float3> velocities     : register(u1); // velocities the next step starts from
+RWStructuredBuffer<float>  temperatures   : register(u2); // bound to the current temperature buffer
+RWStructuredBuffer<float3> predicted      : register(u7);
+RWStructuredBuffer<float>  density        : register(u8);
+RWStructuredBuffer<float>  lambda         : register(u10);
+RWStructuredBuffer<float3> deltaP         : register(u11);
+RWStructuredBuffer<float>  viscosityMu    : register(u12);
+RWStructuredBuffer<float>  viscosityCoeff : register(u13);
+RWStructuredBuffer<uint>   diagnostics    : register(u14);
+RWStructuredBuffer<float>  dfsphKappa     : register(u27);
+RWStructuredBuffer<float>  dfsphKappaV    : register(u28);
+RWStructuredBuffer<float>  dfsphStiffness : register(u29);
+RWStructuredBuffer<uint>   phase          : register(u30);
+RWStructuredBuffer<uint>   partner        : register(u31); // from #47
+RWStructuredBuffer<uint>   rigidLabel     : register(u34);
+RWStructuredBuffer<uint>   particleId     : register(u43);
+RWStructuredBuffer<int>    levelOut       : register(u46); // read here too, the level SRV is not bound
+
+static const uint LEVEL_COUNT = ADAPTIVE_LEVEL_MAX - ADAPTIVE_LEVEL_MIN + 1;
+
+groupshared uint gsLevels[LEVEL_COUNT];
+
+// fixed direction per particle id, so repeated runs split the same way
+float3 SplitDirection(uint id)
+{
+    uint s = id * 747796405u + 2891336453u;
+    s = ((s >> ((s >> 28u) + 4u)) ^ s) * 277803737u;
+    s = (s >> 22u) ^ s;
+    float z = (s & 0xffffu) / 32767.5 - 1.0;
+    float phi = (s >> 16) * (6.2831853 / 65536.0);
+    float r = sqrt(max(1.0 - z * z, 0.0));
+    return float3(r * cos(phi), r * sin(phi), z);
+}
+
+// passCount: free slots for split children, appended after numParticles; passParam: id of
+// the first child. A split particle becomes two of half the mass one level finer, a mutual
+// pair becomes one particle one level coarser at the lower index, the other one is flagged
+// killed and removed by the compaction after the step. Momentum and heat are conserved.
+[numthreads(256,1,1)]
+void CSMain(uint i : SV_DispatchThreadID, uint tid : SV_GroupThreadID)
+{
+    if (tid < LEVEL_COUNT)
+        gsLevels[tid] = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint count = 0;
+    int level = 0;
+
+    if (i < numParticles)
+    {
+        uint p = partner[i];
+        level = levelOut[i];
+        count = 1;
+
+        if (p == ADAPTIVE_SPLIT)
+        {
+            uint slot;
+            InterlockedAdd(diagnostics[DIAG_ADAPTIVE], 1, slot);
+            if (slot < passCount)
+            {
+                uint c = numParticles + slot;
+                level -= 1;
+
+                // children half a smoothing length apart around the old center
+                float3 x = positions[i];
+                float3 offset = 0.25 * h * exp2(level / 3.0) * SplitDirection(particleId[i]);
+
+                positions[i] = x - offset;
+                predicted[i] = x - offset;
+                levelOut[i] = level;
+                phase[i] = (phase[i] & ~PHASE_STATE_MASK) | PHASE_ACTIVE;
+
+                positions[c] = x + offset;
+                predicted[c] = x + offset;
+                velocities[c] = velocities[i];
+                temperatures[c] = temperatures[i];
+                density[c] = density[i];
+                lambda[c] = 0.0;
+                deltaP[c] = float3(0.0, 0.0, 0.0);
+                viscosityMu[c] = viscosityMu[i];
+                viscosityCoeff[c] = viscosityCoeff[i];
+                dfsphKappa[c] = 0.0;
+                dfsphKappaV[c] = 0.0;
+                dfsphStiffness[c] = 0.0;
+                phase[c] = phase[i]; // same time level, the child lags like its parent
+                rigidLabel[c] = RIGID_NONE;
+                particleId[c] = passParam + slot;
+                levelOut[c] = level;
+                count = 2;
+            }
+        }
+        else if (p != ADAPTIVE_NO_PARTNER && partner[p] == i)
+        {
+            if (i < p)
+            {
+                // equal masses: plain averages conserve momentum and heat
+                float3 x = 0.5 * (positions[i] + positions[p]);
+                level += 1;
+
+                positions[i] = x;
+                predicted[i] = x;
+                velocities[i] = 0.5 * (velocities[i] + velocities[p]);
+                temperatures[i] = 0.5 * (temperatures[i] + temperatures[p]);
+                levelOut[i] = level;
+                phase[i] = (phase[i] & ~PHASE_STATE_MASK) | PHASE_ACTIVE;
+                phase[p] = PHASE_KILLED;
+                InterlockedAdd(diagnostics[DIAG_ADAPTIVE + 1], 1);
+            }
+            else
+            {
+                count = 0; // merged into p
+            }
+        }
+    }
+
+    if (count > 0)
+        InterlockedAdd(gsLevels[level - ADAPTIVE_LEVEL_MIN], count);
+
+    GroupMemoryBarrierWithGroupSync();
+    if (tid < LEVEL_COUNT && gsLevels[tid] > 0)
+        InterlockedAdd(diagnostics[DIAG_ADAPTIVE + 2 + tid], gsLevels[tid]);
+}
@@ -0,0 +1,40 @@
+// #49
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<float3> predictedPositions : register(t7);
+StructuredBuffer<uint>   particleIndices    : register(t4);
+StructuredBuffer<float>  temperatureIn      : register(t2);
+
+RWStructuredBuffer<uint> heatGridAccum : register(u47); // weight, w T, w k and a spare per node
+
+// particle to grid: mass weighted trilinear sums of temperature and conductivity
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= numParticles)
+        return;
+
+    uint i = particleIndices[gid];
+
+    float Ti = temperatureIn[i];
+    float ki = GetThermalConductivity(Ti);
+    float mi = ParticleMass(i) / mass;
+
+    uint3 base;
+    float3 frac;
+    GetHeatGridStencil(predictedPositions[i], base, frac);
+
+    [unroll]
+    for (uint corner = 0; corner < 8; corner++)
+    {
+        uint3 o = uint3(corner & 1, (corner >> 1) & 1, corner >> 2);
+        float w = mi * GetHeatGridWeight(o, frac) * HEAT_GRID_FIXED_SCALE;
+        if (w <= 0.0)
+            continue;
+
+        uint n = 4 * GetHeatGridIndex(base + o);
+        InterlockedAdd(heatGridAccum[n + 0], (uint)(w + 0.5));
+        InterlockedAdd(heatGridAccum[n + 1], (uint)(w * Ti + 0.5));
+        InterlockedAdd(heatGridAccum[n + 2], (uint)(w * ki + 0.5));
+    }
+}
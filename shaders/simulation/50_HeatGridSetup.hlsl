@@ -0,0 +1,29 @@
+// #50
+#include "CommonKernels.hlsl"
+
+RWStructuredBuffer<uint>   heatGridAccum       : register(u47);
+RWStructuredBuffer<float4> heatGridState       : register(u48); // T before the solve, k, weight
+RWStructuredBuffer<float>  heatGridTemperature : register(u49); // two halves, Jacobi ping-pong
+
+// per node: averages of the splatted sums, start of the solve in the first half;
+// the accumulators are cleared for the next splat
+[numthreads(256,1,1)]
+void CSMain(uint n : SV_DispatchThreadID)
+{
+    if (n >= GetHeatGridNodeCount())
+        return;
+
+    uint w  = heatGridAccum[4 * n + 0];
+    uint wT = heatGridAccum[4 * n + 1];
+    uint wk = heatGridAccum[4 * n + 2];
+
+    float T = w > 0 ? float(wT) / float(w) : Tenv;
+    float k = w > 0 ? float(wk) / float(w) : 0.0;
+
+    heatGridState[n] = float4(T, k, w / HEAT_GRID_FIXED_SCALE, 0.0);
+    heatGridTemperature[n] = T;
+
+    heatGridAccum[4 * n + 0] = 0;
+    heatGridAccum[4 * n + 1] = 0;
+    heatGridAccum[4 * n + 2] = 0;
+}
@@ -0,0 +1,63 @@
+// #51
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<float4> heatGridState : register(t48);
+
+RWStructuredBuffer<float> heatGridTemperature : register(u49);
+
+static const int3 FACE_OFFSETS[6] =
+{
+    int3(-1, 0, 0), int3(1, 0, 0),
+    int3(0, -1, 0), int3(0, 1, 0),
+    int3(0, 0, -1), int3(0, 0, 1),
+};
+
+// One Jacobi sweep of backward Euler conduction on the 7-point stencil,
+//   (1 + a sum_f k_f) T_n - a sum_f k_f T_f = T_n^0,  a = thermalDt * scale / (rho0 dx^2),
+// unconditionally stable for any thermal dt. k_f is the harmonic mean of the two nodes;
+// faces to empty nodes or out of the grid carry no flux. passIndex: sweep, reads the half
+// passIndex & 1 and writes the other one.
+[numthreads(256,1,1)]
+void CSMain(uint n : SV_DispatchThreadID)
+{
+    uint nodeCount = GetHeatGridNodeCount();
+    if (n >= nodeCount)
+        return;
+
+    uint src = (passIndex & 1) * nodeCount;
+    uint dst = nodeCount - src;
+
+    float4 s = heatGridState[n];
+    if (s.z <= 0.0)
+    {
+        heatGridTemperature[dst + n] = s.x;
+        return;
+    }
+
+    uint3 c = uint3(n % heatGridResolution.x,
+                    (n / heatGridResolution.x) % heatGridResolution.y,
+                    n / (heatGridResolution.x * heatGridResolution.y));
+
+    float a = thermalDt * HEAT_CONDUCTION_SCALE / (rho0 * heatGridSpacing * heatGridSpacing);
+    float sum = 0.0;
+    float diag = 0.0;
+
+    [unroll]
+    for (uint f = 0; f < 6; f++)
+    {
+        int3 nc = int3(c) + FACE_OFFSETS[f];
+        if (any(nc < 0) || any(nc >= int3(heatGridResolution)))
+            continue;
+
+        uint m = GetHeatGridIndex(uint3(nc));
+        float4 sm = heatGridState[m];
+        if (sm.z <= 0.0)
+            continue;
+
+        float kf = 2.0 * s.y * sm.y / max(s.y + sm.y, 1e-6);
+        sum += kf * heatGridTemperature[src + m];
+        diag += kf;
+    }
+
+    heatGridTemperature[dst + n] = (s.x + a * sum) / (1.0 + a * diag);
+}
@@ -0,0 +1,44 @@
+// #52
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<float3> predictedPositions  : register(t7);
+StructuredBuffer<uint>   particleIndices     : register(t4);
+StructuredBuffer<float>  density             : register(t8);
+StructuredBuffer<float>  temperatureIn       : register(t2);
+StructuredBuffer<float4> heatGridState       : register(t48);
+StructuredBuffer<float>  heatGridTemperature : register(t49);
+
+RWStructuredBuffer<float> temperatureOut : register(u2);
+
+// grid to particle: every particle receives the interpolated change of the grid temperature,
+// so detail below the grid spacing survives the solve; surface cooling is then applied per
+// particle, backward Euler like the CG solver. passCount: Jacobi sweeps, the result is in
+// the half passCount & 1.
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= numParticles)
+        return;
+
+    uint i = particleIndices[gid];
+    uint result = (passCount & 1) * GetHeatGridNodeCount();
+
+    uint3 base;
+    float3 frac;
+    GetHeatGridStencil(predictedPositions[i], base, frac);
+
+    float dT = 0.0;
+
+    [unroll]
+    for (uint corner = 0; corner < 8; corner++)
+    {
+        uint3 o = uint3(corner & 1, (corner >> 1) & 1, corner >> 2);
+        uint n = GetHeatGridIndex(base + o);
+        dT += GetHeatGridWeight(o, frac) * (heatGridTemperature[result + n] - heatGridState[n].x);
+    }
+
+    float rate = HeatLossRate(max(density[i], 1e-6)) * thermalDt;
+    float T = (temperatureIn[i] + dT + rate * Tenv) / (1.0 + rate);
+
+    temperatureOut[i] = clamp(T, 0.01f, 2000.0f);
+}
@@ -0,0 +1,64 @@
+// #53
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<float3> predictedPositions : register(t7);
+StructuredBuffer<uint>   particleIndices    : register(t4);
+StructuredBuffer<uint>   cellStart          : register(t5);
+StructuredBuffer<uint>   cellEnd            : register(t6);
+StructuredBuffer<float>  density            : register(t8);
+
+RWStructuredBuffer<uint> surfaceIndices : register(u50);
+RWStructuredBuffer<uint> surfaceArgs    : register(u51); // [4]: append counter, reset by #54
+
+static const float SURFACE_DENSITY_RATIO = 0.8; // sparse spray and thin sheets have no clear gradient
+
+// Free surface detection by the color field gradient grad c_i = sum_j m_j / rho_j grad W_ij,
+// which vanishes inside the fluid and grows where neighbors are missing on one side. Surface
+// particles are appended to the surface list in no particular order.
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= numParticles)
+        return;
+
+    uint i = particleIndices[gid];
+    float3 xi = predictedPositions[i];
+    float hi = SmoothingLength(i);
+    float rhoi = density[i];
+
+    float3 gradColor = float3(0.0, 0.0, 0.0);
+
+    int3 cell = GetCellCoord(xi);
+    for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        int3 nc = cell + int3(dx, dy, dz);
+        if (any(nc < 0) || any(nc >= int3(gridResolution)))
+            continue;
+
+        uint hash = GetCellHash(uint3(nc));
+        uint start = cellStart[hash];
+        uint end   = cellEnd[hash];
+
+        [loop]
+        for (uint idx = start; idx < end; idx++)
+        {
+            uint j = particleIndices[idx];
+            if (j == i) continue;
+
+            float3 rij = xi - predictedPositions[j];
+            float hij = 0.5 * (hi + SmoothingLength(j));
+            if (dot(rij, rij) >= hij * hij) continue;
+
+            gradColor += ParticleMass(j) / max(density[j], 1e-6) * cubic_kernel_gradient(rij, hij);
+        }
+    }
+
+    if (hi * length(gradColor) > surfaceThreshold || rhoi < SURFACE_DENSITY_RATIO * rho0)
+    {
+        uint slot;
+        InterlockedAdd(surfaceArgs[4], 1, slot);
+        surfaceIndices[slot] = i;
+    }
+}
@@ -0,0 +1,20 @@
+// #54
+#include "CommonData.hlsl"
+
+RWStructuredBuffer<uint> surfaceArgs : register(u51);
+RWStructuredBuffer<uint> diagnostics : register(u14);
+
+// single thread: indirect dispatch arguments over the surface list, the append counter
+// is cleared for the next classification
+[numthreads(1,1,1)]
+void CSMain()
+{
+    uint count = surfaceArgs[4];
+
+    surfaceArgs[0] = (count + 255) / 256;
+    surfaceArgs[1] = 1;
+    surfaceArgs[2] = 1;
+    surfaceArgs[3] = count;
+    surfaceArgs[4] = 0;
+    diagnostics[DIAG_SURFACE_COUNT] = count;
+}
@@ -0,0 +1,26 @@
+// #55
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<float> density        : register(t8);
+StructuredBuffer<uint>  surfaceIndices : register(t50);
+StructuredBuffer<uint>  surfaceArgs    : register(t51); // groups x, y, z, surface count
+
+RWStructuredBuffer<float> temperatures : register(u2); // result of the heat solve, cooled in place
+
+// Convection and radiation over the surface list, backward Euler over the thermal dt.
+// Radiation, ~ T^4 - Tenv^4, is linearized around the current temperature:
+//   dT/dt = -exposure * (heatLossCoeff + radiationCoeff * (T^2 + Tenv^2)(T + Tenv) / 1e9) * (T - Tenv)
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= surfaceArgs[3])
+        return;
+
+    uint i = surfaceIndices[gid];
+    float T = temperatures[i];
+
+    float radiation = radiationCoeff * (T * T + Tenv * Tenv) * (T + Tenv) * 1e-9;
+    float rate = SurfaceExposure(max(density[i], 1e-6)) * (heatLossCoeff + radiation) * thermalDt;
+
+    temperatures[i] = clamp((T + rate * Tenv) / (1.0 + rate), 0.01f, 2000.0f);
+}
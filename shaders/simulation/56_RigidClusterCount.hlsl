@@ -0,0 +1,28 @@
+// #56
+#include "CommonData.hlsl"
+
+StructuredBuffer<uint> rigidClusterOffsets : register(t37); // member count per root, RIGID_CHANGED flag
+
+RWStructuredBuffer<uint4> rigidGroupOffsets : register(u58);
+
+groupshared uint3 gsSum[256];
+
+// totals of one group of 256 roots: solids in clusters of two or more, those clusters,
+// single-particle clusters; scanned by #36
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint groupId : SV_GroupID)
+{
+    uint count = gid < numParticles ? rigidClusterOffsets[gid] & ~RIGID_CHANGED : 0;
+
+    gsSum[tid] = count > 1 ? uint3(count, 1, 0) : uint3(0, 0, count);
+    GroupMemoryBarrierWithGroupSync();
+    for (uint s = 128; s > 0; s >>= 1)
+    {
+        if (tid < s)
+            gsSum[tid] += gsSum[tid + s];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0)
+        rigidGroupOffsets[groupId] = uint4(gsSum[0], 0);
+}
@@ -0,0 +1,47 @@
+// #57
+#include "CommonData.hlsl"
+
+StructuredBuffer<uint4> rigidGroupOffsets : register(t58); // scanned by #36
+StructuredBuffer<uint>  rigidArgs         : register(t41);
+
+RWStructuredBuffer<uint>   rigidClusterOffsets : register(u37); // in: member count per root, out: first member slot
+RWStructuredBuffer<uint2>  rigidClusters       : register(u38); // first member slot, member count
+RWStructuredBuffer<float4> rigidRotation       : register(u39); // per root
+
+groupshared uint3 gsScan[256];
+
+// The same values as #56, scanned inside the group on top of the group offset: clusters of
+// two or more are compacted in root order with their members first, single-particle
+// clusters follow behind all of them. A changed cluster gets a zero rotation, which tells
+// #38 to take its current shape as the rest shape.
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID, uint tid : SV_GroupThreadID, uint groupId : SV_GroupID)
+{
+    uint word = gid < numParticles ? rigidClusterOffsets[gid] : 0;
+    uint count = word & ~RIGID_CHANGED;
+    uint3 value = count > 1 ? uint3(count, 1, 0) : uint3(0, 0, count);
+
+    // Hillis-Steele inclusive scan
+    gsScan[tid] = value;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint s = 1; s < 256; s <<= 1)
+    {
+        uint3 v = tid >= s ? gsScan[tid - s] : uint3(0, 0, 0);
+        GroupMemoryBarrierWithGroupSync();
+        gsScan[tid] += v;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint3 offset = rigidGroupOffsets[groupId].xyz + gsScan[tid] - value;
+    if (count > 1)
+    {
+        rigidClusterOffsets[gid] = offset.x;
+        rigidClusters[offset.y] = uint2(offset.x, count);
+        if (word & RIGID_CHANGED)
+            rigidRotation[gid] = float4(0, 0, 0, 0);
+    }
+    else if (count == 1)
+    {
+        rigidClusterOffsets[gid] = rigidArgs[RIGID_SOLID_COUNT] - rigidArgs[RIGID_SINGLE_COUNT] + offset.z;
+    }
+}
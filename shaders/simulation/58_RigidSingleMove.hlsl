@@ -0,0 +1,26 @@
+// #58
+#include "CommonData.hlsl"
+
+StructuredBuffer<float3> deltaP       : register(t11);
+StructuredBuffer<uint>   rigidMembers : register(t36);
+StructuredBuffer<uint>   rigidArgs    : register(t41);
+
+RWStructuredBuffer<float3> positions  : register(u0);
+RWStructuredBuffer<float3> predicted  : register(u7);
+RWStructuredBuffer<float3> velocities : register(u1); // velocities the next step starts from
+
+// Single-particle clusters: the rigid fit of one particle is its prediction plus the
+// contact correction, so it moves there directly instead of taking a group of #41.
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    uint singleCount = rigidArgs[RIGID_SINGLE_COUNT];
+    if (gid >= singleCount) return;
+    uint i = rigidMembers[rigidArgs[RIGID_SOLID_COUNT] - singleCount + gid];
+
+    float3 goal = predicted[i] + deltaP[i];
+
+    velocities[i] = (goal - positions[i]) / dt * velocityDamping;
+    positions[i] = goal;
+    predicted[i] = goal;
+}
@@ -0,0 +1,18 @@
+// #59
+#include "CommonKernels.hlsl"
+
+StructuredBuffer<float3> predicted : register(t7);
+
+RWStructuredBuffer<uint> solverColor : register(u59);
+
+// Gauss-Seidel color of every active particle, from the predicted positions before the
+// first solver iteration. Fixed for the whole step: a particle moved across a block
+// boundary by one color must not be corrected again by another.
+[numthreads(256,1,1)]
+void CSMain(uint gid : SV_DispatchThreadID)
+{
+    if (gid >= GetActiveCount()) return;
+
+    uint i = activeIndices[gid];
+    solverColor[i] = GetSolverColor(predicted[i]);
+}
@@ -7,15 +7,22 @@ StructuredBuffer<uint> particleIndecies : register(t4);
 StructuredBuffer<uint> cellStart : register(t5);
 StructuredBuffer<uint> cellEnd   : register(t6);
 
+StructuredBuffer<uint> solverColor : register(t59);
+
 RWStructuredBuffer<float> density     : register(u8);
 RWStructuredBuffer<float> constraintC : register(u9);
 
 [numthreads(256,1,1)]
 void CSMain(uint gid : SV_DispatchThreadID)
 {
-    if (gid >= numParticles) return;
-    uint i = particleIndecies[gid];
+    if (gid >= GetActiveCount()) return;
+    uint i = activeIndices[gid];
+
+    // Gauss-Seidel sweep: other colors keep the density of their own pass
+    if ((passFlags & PASS_FLAG_COLOR_FILTER) && solverColor[i] != passIndex) return;
+
     float3 qi = predictedPositions[i];
+    float hi = SmoothingLength(i);
 
     int3 cell = GetCellCoord(qi);
 
@@ -48,12 +55,16 @@ void CSMain(uint gid : SV_DispatchThreadID)
 
             float3 r = qi - qj;
             float dist2 = dot(r,r);
-            if (dist2 >= h2) continue;
+            float hij = 0.5 * (hi + SmoothingLength(j));
+            if (dist2 >= hij * hij) continue;
 
-            rho += mass * cubic_kernel_height(r);
+            rho += ParticleMass(j) * cubic_kernel_height(r, hij);
         }
     }
 
+    // walls as fluid at rest density
+    float3 wallGradient;
+    rho += rho0 * WallVolume(qi, hi, wallGradient);
 
     density[i] = rho;
     constraintC[i] = rho / rho0 - 1.0;
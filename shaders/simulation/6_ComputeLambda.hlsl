@@ -7,6 +7,7 @@ StructuredBuffer<uint> cellStart : register(t5);
 StructuredBuffer<uint> cellEnd   : register(t6);
 
 StructuredBuffer<float> constraintC : register(t9);
+StructuredBuffer<uint>  solverColor : register(t59);
 
 RWStructuredBuffer<float> lambda : register(u10);
 
@@ -15,12 +16,16 @@ static const float lambdaMax = 10.0f;
 [numthreads(256,1,1)]
 void CSMain(uint gid : SV_DispatchThreadID)
 {
-    if (gid >= numParticles) return;
-    uint i = particleIndecies[gid];
+    if (gid >= GetActiveCount()) return;
+    uint i = activeIndices[gid];
+
+    // Gauss-Seidel sweep: other colors keep the lambda of their own pass
+    if ((passFlags & PASS_FLAG_COLOR_FILTER) && solverColor[i] != passIndex) return;
 
     float3 pi = predictedPositions[i];
 
     float Ci = constraintC[i]; 
+    float hi = SmoothingLength(i);
 
     float sumGrad2 = 0.0;
     float3 grad_i = float3(0,0,0);
@@ -50,17 +55,24 @@ void CSMain(uint gid : SV_DispatchThreadID)
             float3 pj = predictedPositions[j];
             float3 rij = pi - pj;
 
-            if (dot(rij, rij) >= h2) continue;
+            float hij = 0.5 * (hi + SmoothingLength(j));
+            if (dot(rij, rij) >= hij * hij) continue;
 
-            float3 gradW = cubic_kernel_gradient(rij);
+            float3 gradW = cubic_kernel_gradient(rij, hij);
+            float mj = ParticleMass(j);
 
-            float3 grad_j = - (mass / rho0) * gradW;
+            float3 grad_j = - (mj / rho0) * gradW;
             sumGrad2 += dot(grad_j, grad_j);
 
-            grad_i += (mass / rho0) * gradW; 
+            grad_i += (mj / rho0) * gradW; 
         }
     }
 
+    // the walls do not move, they only add to the gradient wrt i
+    float3 wallGradient;
+    WallVolume(pi, hi, wallGradient);
+    grad_i += wallGradient;
+
     // добавляем вклад градиента wrt i
     sumGrad2 += dot(grad_i, grad_i);
 
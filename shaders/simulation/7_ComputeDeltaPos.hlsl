@@ -7,6 +7,7 @@ StructuredBuffer<uint>   cellStart        : register(t5);
 StructuredBuffer<uint>   cellEnd          : register(t6);
 
 StructuredBuffer<float> lambda            : register(t10); // read lambda
+StructuredBuffer<uint>  solverColor       : register(t59); // fixed for the step by #59
 
 RWStructuredBuffer<float3> deltaP          : register(u11); // write deltaP
 
@@ -18,18 +19,24 @@ static const float deltaQ  = 0.2f;      // in units of h
 [numthreads(256,1,1)]
 void CSMain(uint gid : SV_DispatchThreadID)
 {
-    if (gid >= numParticles) return;
+    if (gid >= GetActiveCount()) return;
 
-    uint i = particleIndices[gid];
+    uint i = activeIndices[gid];
     float3 pi = predicted[i];
     float3 dpi = float3(0,0,0);
 
+    // Gauss-Seidel sweep: other colors keep a zero correction for this pass
+    if ((passFlags & PASS_FLAG_COLOR_FILTER) && solverColor[i] != passIndex)
+    {
+        deltaP[i] = dpi;
+        return;
+    }
+
     float li = lambda[i];
 
     int3 cell = GetCellCoord(pi);
 
-    // Precompute kernel value at deltaQ
-    float Wdq = cubic_kernel_height(float3(deltaQ * h, 0, 0));
+    float hi = SmoothingLength(i);
 
     for (int dz = -1; dz <= 1; dz++)
     for (int dy = -1; dy <= 1; dy++)
@@ -58,19 +65,27 @@ void CSMain(uint gid : SV_DispatchThreadID)
             float3 rij = pi - pj;
 
             float dist2 = dot(rij, rij);
-            if (dist2 >= h2) continue;
+            float hij = 0.5 * (hi + SmoothingLength(j));
+            if (dist2 >= hij * hij) continue;
 
-            float3 gradW = cubic_kernel_gradient(rij);
+            float3 gradW = cubic_kernel_gradient(rij, hij);
             float lj = lambda[j];
 
-            // tensile instability correction
-            float W = cubic_kernel_height(rij);
+            // tensile instability correction, kernel value at deltaQ of the pair
+            float W = cubic_kernel_height(rij, hij);
+            float Wdq = cubic_kernel_height(float3(deltaQ * hij, 0, 0), hij);
             float scorr = -kTensile * pow(W / Wdq, nTensile);
 
-            dpi += (li + lj + scorr) * gradW;
+            // heavier neighbors push harder
+            dpi += (li + lj + scorr) * (ParticleMass(j) / mass) * gradW;
         }
     }
 
+    // walls push back with the particle's own lambda
+    float3 wallGradient;
+    WallVolume(pi, hi, wallGradient);
+    dpi += li * (rho0 / mass) * wallGradient;
+
     float maxDelta = 5.0f * h;
 
     float len = length(dpi);
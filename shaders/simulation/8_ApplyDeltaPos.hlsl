@@ -1,8 +1,6 @@
 // #8
 #include "CommonData.hlsl"
 
-StructuredBuffer<uint> particleIndices : register(t4);
-
 RWStructuredBuffer<float3> predicted : register(u7); // q_i*
 RWStructuredBuffer<float3> deltaP    : register(u11); // Δp_i
 
@@ -10,9 +8,9 @@ RWStructuredBuffer<float3> deltaP    : register(u11); // Δp_i
 [numthreads(256,1,1)]
 void CSMain(uint gid : SV_DispatchThreadID)
 {
-    if (gid >= numParticles) return;
+    if (gid >= GetActiveCount()) return;
 
-    uint i = particleIndices[gid];
+    uint i = activeIndices[gid];
 
     float3 dp = deltaP[i];
 
@@ -1,18 +1,19 @@
 // #9
-#include "CommonData.hlsl"
+#include "CommonKernels.hlsl"
 
 RWStructuredBuffer<float3> positions  : register(u0);
 RWStructuredBuffer<float3> predicted  : register(u7);
 RWStructuredBuffer<float3> velocities : register(u1);
-StructuredBuffer<uint>     particleIndices : register(t4);
+
+StructuredBuffer<uint> phase : register(t30);
 
 static const float collisionvelocityDamping = 0.2f;
 
 [numthreads(256,1,1)]
 void CSMain(uint gid : SV_DispatchThreadID)
 {
-    if (gid >= numParticles) return;
-    uint i = particleIndices[gid];
+    if (gid >= GetActiveCount()) return;
+    uint i = activeIndices[gid];
 
     float3 x_old = positions[i];
     float3 x_new = predicted[i];
@@ -21,7 +22,7 @@ void CSMain(uint gid : SV_DispatchThreadID)
     float3 worldMin = worldOrigin;
     float3 worldMax = worldOrigin + float3(gridResolution) * cellSize;
 
-    float3 v = (x_new - x_old) / dt;
+    float3 v = (x_new - x_old) / GetTimeLevelDt(phase[i]);
 
     // --- X axis ---
     if (x_new.x < worldMin.x)
@@ -65,6 +66,12 @@ void CSMain(uint gid : SV_DispatchThreadID)
             v.z *= -collisionvelocityDamping;
     }
 
+    // --- static obstacles and terrain ---
+    float3 n = ProjectOutOfStaticGeometry(x_new);
+    float vn = dot(v, n);
+    if (vn < 0.0)
+        v -= (1.0 + collisionvelocityDamping) * vn * n;
+
     // Optional damping
     v *= velocityDamping;
 
@@ -14,6 +14,45 @@
 // t9  ConstraintC
 // t10 Lambda
 // t11 ViscosityCoeff
+// t14 Diagnostics
+// t15 HeatDiagonal
+// t16 HeatResidual
+// t17 HeatPrecond
+// t18 HeatDirection
+// t19 HeatProduct
+// t20 SolverPartials
+// t21 SolverScalars
+// t22 ViscosityDiagonal
+// t23 ViscosityResidual
+// t24 ViscosityPrecond
+// t25 ViscosityDirection
+// t26 ViscosityProduct
+// t27 DfsphKappa
+// t28 DfsphKappaV
+// t29 DfsphStiffness
+// t30 Phase
+// t31 ActiveIndices
+// t32 ActiveArgs
+// t33 ActiveGroupOffsets
+// t34 RigidLabel
+// t35 RigidRestOffset
+// t36 RigidMembers
+// t37 RigidClusterOffsets
+// t38 RigidClusters
+// t39 RigidRotation
+// t40 RigidRebuildArgs
+// t41 RigidArgs
+// t42 EmitQueue
+// t43 ParticleId
+// t44 CompactUint
+// t45 CompactFloat
+// t46 ParticleLevel
+// t52 ObstacleSdf
+// t53 TerrainHeights
+// t54 MeshNodes
+// t55 MeshTriangles
+// t56 MeshCellRoots
+// t57 BoundaryVolumeMap
 
 // ---------- UAV ----------
 // u0  PositionsRW
@@ -30,9 +69,47 @@
 // u11 DeltaP
 // u12  ViscosityMu
 // u13 ViscosityCoeffRW
+// u14 DiagnosticsRW
+// u15 HeatDiagonalRW
+// u16 HeatResidualRW
+// u17 HeatPrecondRW
+// u18 HeatDirectionRW
+// u19 HeatProductRW
+// u20 SolverPartialsRW
+// u21 SolverScalarsRW
+// u22 ViscosityDiagonalRW
+// u23 ViscosityResidualRW
+// u24 ViscosityPrecondRW
+// u25 ViscosityDirectionRW
+// u26 ViscosityProductRW
+// u27 DfsphKappaRW
+// u28 DfsphKappaVRW
+// u29 DfsphStiffnessRW
+// u30 PhaseRW
+// u31 ActiveIndicesRW
+// u32 ActiveArgsRW
+// u33 ActiveGroupOffsetsRW
+// u34 RigidLabelRW
+// u35 RigidRestOffsetRW
+// u36 RigidMembersRW
+// u37 RigidClusterOffsetsRW
+// u38 RigidClustersRW
+// u39 RigidRotationRW
+// u40 RigidRebuildArgsRW
+// u41 RigidArgsRW
+// u42 EmitQueueRW
+// u43 ParticleIdRW
+// u44 CompactUintRW
+// u45 CompactFloatRW
+// u46 ParticleLevelRW
+
+static const uint KILL_VOLUME_MAX = 4;
+static const uint TIME_LEVEL_MAX = 8;
+static const uint OBSTACLE_MAX = 8;
 
 // ---------- CB ----------
 // b0  SimParams
+// b1  PassConstants (root constants)
 
 cbuffer SimParams : register(b0)
 {
@@ -64,4 +141,298 @@ cbuffer SimParams : register(b0)
     float muMinViscosity;     // minimum mu after clamp
     float muMaxViscosity;     // maximum mu after clamp
     float muNormMaxViscosity; // value of mu that maps to viscCoeff=1 (for normalization)
+
+    float thermalDt;          // time accumulated since the previous heat transfer pass
+    float solverTolerance;    // implicit heat / viscosity solves: stop at |r| <= tol * |r0|
+    float2 padThermal;
+
+    float sleepTemperature;   // particles below this temperature and sleepSpeed may fall asleep
+    float wakeTemperature;    // sleepers above this temperature wake up, > sleepTemperature
+    float sleepSpeed;
+    float wakeSpeed;          // sleepers touched by faster or hotter lava wake up, > sleepSpeed
+
+    uint sleepSteps;          // consecutive calm steps before a particle falls asleep
+    uint sleepingEnabled;
+    float2 padSleep;
+
+    float solidifyTemperature; // particles below this temperature join rigid crust clusters
+    float meltTemperature;     // solid particles above this temperature return to the fluid, > solidifyTemperature
+    uint rigidEnabled;
+    float padRigid;
+
+    uint killPlaneCount;
+    uint killBoxCount;
+    float2 padKill;
+    float4 killPlanes[KILL_VOLUME_MAX]; // xyz normal towards the removed side, w = dot(normal, point on plane)
+    float4 killBoxMin[KILL_VOLUME_MAX];  // sinks
+    float4 killBoxMax[KILL_VOLUME_MAX];
+
+    uint adaptiveEnabled;
+    int minLevel;             // finest level, split particles do not go below
+    int maxLevel;             // coarsest level, its smoothing length fits into one grid cell
+    float maxSmoothingLength; // h 2^(maxLevel/3), h without adaptive resolution
+
+    float mergeSpeed;         // interior particles slower and colder than this are merged in pairs
+    float mergeTemperature;
+    float splitSpeed;         // surface particles and particles faster than this are split, > mergeSpeed
+    float padAdaptive;
+
+    uint maxTimeLevel;        // local time stepping: a level L particle advances every 2^L substeps, 0 = global dt
+    uint localStep;           // substep counter, a level L interval starts on multiples of 2^L
+    float timeLevelCfl;       // level from the largest speed within h: 2^L dt <= cfl h / |v|
+    float padTimeLevel;
+    float4 levelDt[TIME_LEVEL_MAX / 4]; // step of a due level L particle: the last 2^L substeps together
+
+    uint3 heatGridResolution; // grid heat solver: neighbor grid cells subdivided
+    float heatGridSpacing;
+
+    uint surfaceCoolingEnabled; // cooling only over the surface list, not in the heat solvers
+    float surfaceThreshold;     // h |grad color| above which a particle is on the free surface
+    float radiationCoeff;       // radiative loss rate of a fully exposed particle near 1000 K, 1/s
+    float padSurface;
+
+    uint obstacleCount;
+    float obstacleMargin;     // particles are kept this far outside the obstacle surfaces
+    float2 padObstacle;
+    float4 obstacleOrigin[OBSTACLE_MAX]; // static obstacles: xyz position of sample 0, w sample spacing
+    uint4 obstacleGrid[OBSTACLE_MAX];    // xyz samples per axis, w first sample in obstacleSdf
+
+    uint2 terrainDims;        // terrain heightfield: samples along x and z, 0 without terrain
+    float2 terrainOrigin;     // world xz of sample (0, 0)
+    float terrainSpacing;
+    float3 padTerrain;
+
+    uint meshNodeCount;       // triangle mesh obstacles: BVH nodes, 0 without meshes
+    float meshQueryRadius;    // particles behind a face up to this depth are pushed back out
+    float2 padMesh;
+
+    uint wallDensityEnabled;  // the walls of the domain box add to density through the boundary volume map
+    float3 padWall;
 };
+
+cbuffer PassConstants : register(b1)
+{
+    uint passIndex;  // iteration / color index of the current dispatch
+    uint passCount;
+    uint passFlags;  // PASS_FLAG_*
+    uint passParam;  // kernel specific, e.g. diagnostics slot of a solver
+};
+
+static const uint PASS_FLAG_COLOR_FILTER = 1u; // only particles of color passIndex are processed
+static const uint PASS_FLAG_WARM_START = 2u;   // DFSPH: stiffness from the previous step instead of the current error
+static const uint PASS_FLAG_ACTIVE_LIST = 4u;  // solver scalars: one partial per active thread group instead of passCount
+
+// diagnostics buffer layout (see DiagnosticsSlot)
+static const uint DIAG_DENSITY_RESIDUAL = 0; // 2 per probed iteration
+static const uint DIAG_STEP_LIMITS = 128;    // max |v|, max mu, max k
+static const uint DIAG_HEAT_SOLVER = 132;      // iterations, |r| / |r0|
+static const uint DIAG_VISCOSITY_SOLVER = 134; // iterations, |r| / |r0|
+static const uint DIAG_ACTIVE_COUNT = 136;     // particles in the active list
+static const uint DIAG_RIGID = 138;            // solid particles, clusters, rebuild mode of the step
+static const uint DIAG_KILLED = 141;           // particles inside kill volumes at the end of the step
+static const uint DIAG_ADAPTIVE = 142;         // split, merged pairs, then particles per level from ADAPTIVE_LEVEL_MIN
+static const uint DIAG_TIME_LEVELS = 157;      // active particles per time level
+static const uint DIAG_SURFACE_COUNT = 165;    // particles in the surface list
+
+// solver scalars buffer layout (see SolverScalar)
+static const uint SOLVER_RZ = 0;
+static const uint SOLVER_ALPHA = 1;
+static const uint SOLVER_BETA = 2;
+static const uint SOLVER_RR0 = 3;
+static const uint SOLVER_RR = 4;
+static const uint SOLVER_CONVERGED = 5;
+static const uint SOLVER_ITERATIONS = 6;
+
+// passIndex of the solver scalars kernel
+static const uint SOLVER_PASS_INIT = 0;  // partials hold r.z, r.r of the initial residual
+static const uint SOLVER_PASS_ALPHA = 1; // partials hold p.Ap
+static const uint SOLVER_PASS_BETA = 2;  // partials hold r.z, r.r after the update
+
+// DFSPH: share of the previous step's stiffness used as the warm start, density and divergence
+static const float DFSPH_WARM_START_SCALE = 0.5;
+
+// particle phase: state in the low byte, then the time level and the waiting flag,
+// consecutive calm steps in the upper half
+static const uint PHASE_ACTIVE = 0;
+static const uint PHASE_SLEEPING = 1;
+static const uint PHASE_SOLID = 2; // member of a rigid crust cluster, moved by shape matching
+static const uint PHASE_KILLED = 3; // inside a kill volume or merged away, removed by the compaction after the step
+static const uint PHASE_STATE_MASK = 0xffu;
+static const uint PHASE_TIME_LEVEL_SHIFT = 8;
+static const uint PHASE_TIME_LEVEL_MASK = 0xf00u;
+static const uint PHASE_WAITING = 0x1000u; // active, not due this substep: held in place as a static neighbor
+static const uint PHASE_COUNTER_SHIFT = 16;
+
+uint GetTimeLevel(uint p)
+{
+    return (p & PHASE_TIME_LEVEL_MASK) >> PHASE_TIME_LEVEL_SHIFT;
+}
+
+// time a due particle catches up with, dt without local time stepping
+float GetTimeLevelDt(uint p)
+{
+    uint level = GetTimeLevel(p);
+    return levelDt[level >> 2][level & 3];
+}
+
+// Active particle list, rebuilt at the start of every step (29-31). Passes that only move
+// awake particles are dispatched indirectly over it; sleepers stay in the neighbor grid.
+StructuredBuffer<uint> activeIndices : register(t31);
+StructuredBuffer<uint> activeArgs    : register(t32); // thread groups x, y, z, active count
+
+uint GetActiveCount()
+{
+    return activeArgs[3];
+}
+
+// rigid crust clusters (32-41, 56-58): labels are rebuilt only on steps where particles
+// solidified or melted
+static const uint RIGID_NONE = 0xffffffffu;
+static const uint RIGID_REBUILD_NONE = 0;
+static const uint RIGID_REBUILD_CHANGED = 1; // clusters whose members did not change keep their rest shape
+static const uint RIGID_REBUILD_FULL = 2;    // particle indices changed, every cluster takes a new rest shape
+static const uint RIGID_CHANGED = 0x80000000u; // flag on the member count of a root whose members changed
+
+// rigid rebuild args layout: dispatch x, y, z, mode; solidified, melted counters of the step
+static const uint RIGID_REBUILD_MODE = 3;
+static const uint RIGID_SOLIDIFIED = 4;
+static const uint RIGID_MELTED = 5;
+
+// rigid args layout: dispatch over clusters of two or more particles at 0, over solid
+// particles at 4, over single-particle clusters at 8. Members are grouped by cluster with
+// the singles at the end, from RIGID_SOLID_COUNT - RIGID_SINGLE_COUNT.
+static const uint RIGID_CLUSTER_COUNT = 3;
+static const uint RIGID_SOLID_COUNT = 7;
+static const uint RIGID_SINGLE_COUNT = 11;
+// the per-cluster passes stride over the clusters with at most this many groups
+static const uint RIGID_MAX_CLUSTER_GROUPS = 65535;
+
+// kill volumes: outflow planes and sink boxes
+bool IsInKillVolume(float3 x)
+{
+    for (uint p = 0; p < killPlaneCount; ++p)
+    {
+        if (dot(killPlanes[p].xyz, x) >= killPlanes[p].w)
+            return true;
+    }
+    for (uint b = 0; b < killBoxCount; ++b)
+    {
+        if (all(x >= killBoxMin[b].xyz) && all(x <= killBoxMax[b].xyz))
+            return true;
+    }
+    return false;
+}
+
+// adaptive resolution (47-48): levels and their particle counts in the diagnostics
+static const int ADAPTIVE_LEVEL_MIN = -6;
+static const int ADAPTIVE_LEVEL_MAX = 6;
+static const uint ADAPTIVE_NO_PARTNER = 0xffffffffu;
+static const uint ADAPTIVE_SPLIT = 0xfffffffeu;
+
+// static obstacles: signed distance grids, negative inside, stored one after another
+StructuredBuffer<float> obstacleSdf : register(t52);
+
+static const float OBSTACLE_FAR = 1e30;
+
+// trilinear distance and its gradient, OBSTACLE_FAR outside the grid of the obstacle
+float SampleObstacle(uint o, float3 x, out float3 gradient)
+{
+    gradient = float3(0.0, 0.0, 0.0);
+
+    float spacing = obstacleOrigin[o].w;
+    uint3 dims = obstacleGrid[o].xyz;
+    float3 g = (x - obstacleOrigin[o].xyz) / spacing;
+    if (any(g < 0.0) || any(g >= float3(dims - 1)))
+        return OBSTACLE_FAR;
+
+    uint3 c = (uint3)g;
+    float3 f = g - float3(c);
+    uint sy = dims.x;
+    uint sz = dims.x * dims.y;
+    uint base = obstacleGrid[o].w + c.x + c.y * sy + c.z * sz;
+
+    float d000 = obstacleSdf[base];
+    float d100 = obstacleSdf[base + 1];
+    float d010 = obstacleSdf[base + sy];
+    float d110 = obstacleSdf[base + sy + 1];
+    float d001 = obstacleSdf[base + sz];
+    float d101 = obstacleSdf[base + sz + 1];
+    float d011 = obstacleSdf[base + sz + sy];
+    float d111 = obstacleSdf[base + sz + sy + 1];
+
+    float d00 = lerp(d000, d100, f.x);
+    float d10 = lerp(d010, d110, f.x);
+    float d01 = lerp(d001, d101, f.x);
+    float d11 = lerp(d011, d111, f.x);
+    float d0 = lerp(d00, d10, f.y);
+    float d1 = lerp(d01, d11, f.y);
+
+    gradient.x = lerp(lerp(d100 - d000, d110 - d010, f.y), lerp(d101 - d001, d111 - d011, f.y), f.z);
+    gradient.y = lerp(d10 - d00, d11 - d01, f.z);
+    gradient.z = d1 - d0;
+    gradient /= spacing;
+    return lerp(d0, d1, f.z);
+}
+
+// pushes x out to obstacleMargin from the closest obstacle, O(1) per obstacle; returns the
+// outward normal of the contact, zero without one
+float3 ProjectOutOfObstacles(inout float3 x)
+{
+    float best = OBSTACLE_FAR;
+    float3 normal = float3(0.0, 0.0, 0.0);
+    for (uint o = 0; o < obstacleCount; ++o)
+    {
+        float3 gradient;
+        float d = SampleObstacle(o, x, gradient);
+        if (d < best)
+        {
+            best = d;
+            normal = gradient;
+        }
+    }
+
+    float len = length(normal);
+    if (best >= obstacleMargin || len < 1e-6)
+        return float3(0.0, 0.0, 0.0);
+
+    normal /= len;
+    x += (obstacleMargin - best) * normal;
+    return normal;
+}
+
+// terrain: world heights on a regular xz grid, resampled from the elevation raster at load
+StructuredBuffer<float> terrainHeights : register(t53);
+
+// bilinear height under x and the upward normal there, clamped to the edge of the terrain
+float SampleTerrain(float3 x, out float3 normal)
+{
+    float2 g = clamp((x.xz - terrainOrigin) / terrainSpacing, 0.0, float2(terrainDims - 1));
+    uint2 c = min((uint2)g, terrainDims - 2);
+    float2 f = g - float2(c);
+    uint base = c.x + c.y * terrainDims.x;
+
+    float h00 = terrainHeights[base];
+    float h10 = terrainHeights[base + 1];
+    float h01 = terrainHeights[base + terrainDims.x];
+    float h11 = terrainHeights[base + terrainDims.x + 1];
+
+    float dhdx = lerp(h10 - h00, h11 - h01, f.y) / terrainSpacing;
+    float dhdz = lerp(h01 - h00, h11 - h10, f.x) / terrainSpacing;
+    normal = normalize(float3(-dhdx, 1.0, -dhdz));
+    return lerp(lerp(h00, h10, f.x), lerp(h01, h11, f.x), f.y);
+}
+
+// lifts x to obstacleMargin above the ground; returns the terrain normal of a contact, zero without one
+float3 ProjectAboveTerrain(inout float3 x)
+{
+    if (terrainDims.x == 0)
+        return float3(0.0, 0.0, 0.0);
+
+    float3 normal;
+    float ground = SampleTerrain(x, normal) + obstacleMargin;
+    if (x.y >= ground)
+        return float3(0.0, 0.0, 0.0);
+
+    x.y = ground;
+    return normal;
+}
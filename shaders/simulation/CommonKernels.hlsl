@@ -17,6 +17,15 @@ uint GetCellHash(uint3 c)
          + c.z * gridResolution.x * gridResolution.y;
 }
 
+// 8-coloring of a lattice of the largest smoothing length for the Gauss-Seidel solver:
+// two distinct blocks of the same color are at least that far apart, so they do not interact.
+// Evaluated once per step by #59, so a particle keeps its color while the solver moves it.
+uint GetSolverColor(float3 p)
+{
+    int3 c = (int3)floor((p - worldOrigin) / maxSmoothingLength);
+    return uint(c.x & 1) | (uint(c.y & 1) << 1) | (uint(c.z & 1) << 2);
+}
+
 
 
 float GetThermalConductivity(float T)
@@ -51,12 +60,12 @@ float3 spiky_kernel_gradient(float3 r)
     return f * (r / dist);
 }
 
-float cubic_kernel_height(float3 r)
+float cubic_kernel_height(float3 r, float hr)
 {
     float dist = length(r);
-    if (dist > h) return 0.0;
-    float q = dist / h;
-    float k = 8.0 / (PI * h*h*h); // cubic spline normalization in 3D
+    if (dist > hr) return 0.0;
+    float q = dist / hr;
+    float k = 8.0 / (PI * hr*hr*hr); // cubic spline normalization in 3D
     if (q <= 0.5)
     {
         float q2 = q*q;
@@ -67,14 +76,14 @@ float cubic_kernel_height(float3 r)
     return k * (2.0 * t*t*t);
 }
 
-float3 cubic_kernel_gradient(float3 r)
+float3 cubic_kernel_gradient(float3 r, float hr)
 {
     float dist = length(r);
-    if (dist > h || dist < 1e-6) return float3(0,0,0);
-    float q = dist / h;
-    float invDist = 1.0 / (dist * h);
+    if (dist > hr || dist < 1e-6) return float3(0,0,0);
+    float q = dist / hr;
+    float invDist = 1.0 / (dist * hr);
     float3 gradq = r * invDist; // d(q)/d(r) * r/|r| => r/(dist*h)
-    float l = 48.0 / (PI * h*h*h);
+    float l = 48.0 / (PI * hr*hr*hr);
     if (q <= 0.5)
     {
         return l * q * (3.0*q - 2.0) * gradq;
@@ -82,3 +91,308 @@ float3 cubic_kernel_gradient(float3 r)
     float factor = 1.0 - q;
     return l * (-factor * factor) * gradq;
 }
+
+// Adaptive resolution: a particle of level L carries mass * 2^L and a smoothing length of
+// h * 2^(L/3), so it has as many neighbors as a base particle. Pairs use the mean mass and
+// the mean smoothing length, which keeps every pair weight symmetric.
+StructuredBuffer<int> particleLevel : register(t46);
+
+float ParticleMass(uint i)
+{
+    return adaptiveEnabled != 0 ? mass * exp2((float)particleLevel[i]) : mass;
+}
+
+float SmoothingLength(uint i)
+{
+    return adaptiveEnabled != 0 ? h * exp2(particleLevel[i] / 3.0) : h;
+}
+
+// Walls without boundary particles (BoundaryVolumeMap.h): the part V of the kernel behind a
+// wall, tabulated over q = distance / smoothing length, is filled with fluid at rest density.
+StructuredBuffer<float2> boundaryVolumeMap : register(t57);
+static const uint BOUNDARY_MAP_INTERVALS = 64;
+
+// x: V(q), y: dV/dq; V(-q) = 1 - V(q) for particles pushed past the wall
+float2 SampleBoundaryVolume(float q)
+{
+    float s = saturate(abs(q)) * BOUNDARY_MAP_INTERVALS;
+    uint k = min((uint)s, BOUNDARY_MAP_INTERVALS - 1);
+    float2 v = lerp(boundaryVolumeMap[k], boundaryVolumeMap[k + 1], s - k);
+    return q < 0.0 ? float2(1.0 - v.x, v.y) : v;
+}
+
+// summed kernel volume of the domain box walls within hx of x, and its gradient wrt x;
+// rho0 times them stands in for sum_b m W_ib and sum_b m grad W_ib over boundary particles
+float WallVolume(float3 x, float hx, out float3 gradient)
+{
+    gradient = float3(0.0, 0.0, 0.0);
+    if (wallDensityEnabled == 0)
+        return 0.0;
+
+    float3 below = (x - worldOrigin) / hx;
+    float3 above = (worldOrigin + float3(gridResolution) * cellSize - x) / hx;
+    float volume = 0.0;
+    [unroll]
+    for (uint axis = 0; axis < 3; ++axis)
+    {
+        if (below[axis] < 1.0)
+        {
+            float2 v = SampleBoundaryVolume(below[axis]);
+            volume += v.x;
+            gradient[axis] += v.y / hx;
+        }
+        if (above[axis] < 1.0)
+        {
+            float2 v = SampleBoundaryVolume(above[axis]);
+            volume += v.x;
+            gradient[axis] -= v.y / hx;
+        }
+    }
+    return volume;
+}
+
+static const float Tenv = 300.0f;        // воздух TODO: в параметры симуляции
+static const float heatLossCoeff = 5.0f; // TODO: в параметры симуляции
+
+// SPH conduction weight, dT_i/dt = sum_j w_ij (T_j - T_i); w_ij >= 0 and symmetric in i, j
+// mij, hij: pair mass and smoothing length
+float HeatConductionWeight(float3 rij, float ki, float kj, float rhoi, float rhoj, float mij, float hij)
+{
+    float r2 = dot(rij, rij);
+    // TODO: move increased kernel radius to params
+    if (r2 >= 25.0f * hij * hij)
+        return 0.0;
+
+    float3 gradW = - 5.0f * cubic_kernel_gradient(rij / 5.0f, hij);
+
+    float dotTerm = dot(rij, gradW);
+    float denom   = r2 + epsHeatTransfer;
+
+    float kij = (2.0 * ki * kj) / (ki + kj);
+
+    return mij * kij * dotTerm / (rhoi * rhoj * denom);
+}
+
+// The weight above spreads the cubic kernel to 5h through rij / 5 without renormalizing it,
+// which makes the sum 5^5 / 2 times the continuum conduction term div(k grad T) / rho.
+// The grid solver applies the same factor so that both solvers diffuse heat alike.
+static const float HEAT_CONDUCTION_SCALE = 1562.5;
+
+// grid heat solver: particle sums are accumulated as fixed point so that integer
+// atomics can be used and the result does not depend on the thread order
+static const float HEAT_GRID_FIXED_SCALE = 256.0;
+
+uint GetHeatGridIndex(uint3 c)
+{
+    return c.x + heatGridResolution.x * (c.y + heatGridResolution.y * c.z);
+}
+
+uint GetHeatGridNodeCount()
+{
+    return heatGridResolution.x * heatGridResolution.y * heatGridResolution.z;
+}
+
+// trilinear stencil around p over the cell centered nodes: lower corner and upper weights
+void GetHeatGridStencil(float3 p, out uint3 base, out float3 frac)
+{
+    float3 g = (p - worldOrigin) / heatGridSpacing - 0.5;
+    float3 lo = clamp(floor(g), 0.0, float3(heatGridResolution) - 2.0);
+    base = uint3(lo);
+    frac = saturate(g - lo);
+}
+
+// weight of the corner o (0 or 1 per axis) of the stencil
+float GetHeatGridWeight(uint3 o, float3 frac)
+{
+    float3 w = lerp(1.0 - frac, frac, float3(o));
+    return w.x * w.y * w.z;
+}
+
+// fraction of the particle open to the air, from its missing density
+float SurfaceExposure(float rhoi)
+{
+    float exposure = saturate((rho0 - rhoi) / rho0);
+    return pow(exposure, 1.5);
+}
+
+// surface cooling inside the heat solvers, dT_i/dt = -rate * (T_i - Tenv); 0 when the
+// surface list pass (#55) cools instead
+float HeatLossRate(float rhoi)
+{
+    return surfaceCoolingEnabled != 0 ? 0.0 : heatLossCoeff * SurfaceExposure(rhoi);
+}
+
+// SPH viscous diffusion weight, dv_i/dt = sum_j w_ij (v_j - v_i) with mu_ij = (mu_i + mu_j) / 2;
+// w_ij >= 0 and symmetric in i, j; mij, hij: pair mass and smoothing length
+float ViscousDiffusionWeight(float3 rij, float mui, float muj, float rhoi, float rhoj, float mij, float hij)
+{
+    float r2 = dot(rij, rij);
+    if (r2 >= hij * hij)
+        return 0.0;
+
+    float3 gradW = - cubic_kernel_gradient(rij, hij);
+
+    return mij * (mui + muj) * dot(rij, gradW) / (rhoi * rhoj * (r2 + 0.01 * hij * hij));
+}
+
+// triangle mesh obstacles: BVH over all meshes, triangles in leaf order (MeshBvh.h)
+struct MeshBvhNode
+{
+    float3 boundsMin;
+    uint leftOrFirst; // children leftOrFirst and leftOrFirst + 1, or the first triangle of a leaf
+    float3 boundsMax;
+    uint count;       // triangles of a leaf, 0 for inner nodes
+};
+
+struct MeshTriangle
+{
+    float3 a;
+    float3 b;
+    float3 c;
+};
+
+StructuredBuffer<MeshBvhNode> meshNodes : register(t54);
+StructuredBuffer<MeshTriangle> meshTriangles : register(t55);
+// per neighbor grid cell, the subtrees holding every triangle within meshQueryRadius of the cell
+StructuredBuffer<uint> meshCellRoots : register(t56);
+
+static const uint MESH_NO_NODE = 0xffffffffu;
+static const uint MESH_ROOTS_PER_CELL = 8;
+static const uint MESH_STACK_SIZE = 32;
+
+// Ericson, Real-Time Collision Detection 5.1.5
+float3 ClosestPointOnTriangle(float3 p, MeshTriangle t)
+{
+    float3 ab = t.b - t.a;
+    float3 ac = t.c - t.a;
+    float3 ap = p - t.a;
+    float d1 = dot(ab, ap);
+    float d2 = dot(ac, ap);
+    if (d1 <= 0.0 && d2 <= 0.0)
+        return t.a;
+
+    float3 bp = p - t.b;
+    float d3 = dot(ab, bp);
+    float d4 = dot(ac, bp);
+    if (d3 >= 0.0 && d4 <= d3)
+        return t.b;
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+        return t.a + ab * (d1 / (d1 - d3));
+
+    float3 cp = p - t.c;
+    float d5 = dot(ab, cp);
+    float d6 = dot(ac, cp);
+    if (d6 >= 0.0 && d5 <= d6)
+        return t.c;
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+        return t.a + ac * (d2 / (d2 - d6));
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+        return t.b + (t.c - t.b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    float denom = 1.0 / (va + vb + vc);
+    return t.a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+float MeshNodeDistanceSq(float3 p, MeshBvhNode node)
+{
+    float3 d = max(max(node.boundsMin - p, p - node.boundsMax), 0.0);
+    return dot(d, d);
+}
+
+// closest triangle within meshQueryRadius, traversing only the subtrees of the cell of x;
+// false without one
+bool FindClosestMeshPoint(float3 x, out float3 closest, out uint triangleIndex)
+{
+    closest = x;
+    triangleIndex = MESH_NO_NODE;
+    float bestSq = meshQueryRadius * meshQueryRadius;
+
+    uint rootBase = GetCellHash(GetCellCoord(x)) * MESH_ROOTS_PER_CELL;
+    for (uint r = 0; r < MESH_ROOTS_PER_CELL; ++r)
+    {
+        uint root = meshCellRoots[rootBase + r];
+        if (root == MESH_NO_NODE)
+            break;
+
+        uint stack[MESH_STACK_SIZE];
+        uint top = 0;
+        stack[top++] = root;
+        while (top > 0)
+        {
+            MeshBvhNode node = meshNodes[stack[--top]];
+            if (MeshNodeDistanceSq(x, node) >= bestSq)
+                continue;
+
+            if (node.count > 0)
+            {
+                for (uint t = node.leftOrFirst; t < node.leftOrFirst + node.count; ++t)
+                {
+                    float3 q = ClosestPointOnTriangle(x, meshTriangles[t]);
+                    float3 d = x - q;
+                    float dSq = dot(d, d);
+                    if (dSq < bestSq)
+                    {
+                        bestSq = dSq;
+                        closest = q;
+                        triangleIndex = t;
+                    }
+                }
+                continue;
+            }
+
+            // nearer child on top of the stack
+            uint a = node.leftOrFirst;
+            uint b = a + 1;
+            bool aFirst = MeshNodeDistanceSq(x, meshNodes[a]) <= MeshNodeDistanceSq(x, meshNodes[b]);
+            stack[top++] = aFirst ? b : a;
+            stack[top++] = aFirst ? a : b;
+        }
+    }
+    return triangleIndex != MESH_NO_NODE;
+}
+
+// pushes x in front of the closest mesh face when it is behind it, and out to obstacleMargin
+// when it is closer; returns the outward normal of the contact, zero without one
+float3 ProjectOutOfMeshes(inout float3 x)
+{
+    if (meshNodeCount == 0)
+        return float3(0.0, 0.0, 0.0);
+
+    float3 q;
+    uint t;
+    if (!FindClosestMeshPoint(x, q, t))
+        return float3(0.0, 0.0, 0.0);
+
+    MeshTriangle tri = meshTriangles[t];
+    float3 faceNormal = normalize(cross(tri.b - tri.a, tri.c - tri.a));
+    float3 d = x - q;
+    float dist = length(d);
+
+    float3 normal;
+    if (dot(d, faceNormal) < 0.0)
+        normal = faceNormal;
+    else if (dist < obstacleMargin)
+        normal = dist > 1e-6 ? d / dist : faceNormal;
+    else
+        return float3(0.0, 0.0, 0.0);
+
+    x = q + obstacleMargin * normal;
+    return normal;
+}
+
+// obstacles, meshes, then terrain; the normal of the last contact, zero without one
+float3 ProjectOutOfStaticGeometry(inout float3 x)
+{
+    float3 n = ProjectOutOfObstacles(x);
+    float3 nm = ProjectOutOfMeshes(x);
+    float3 nt = ProjectAboveTerrain(x);
+    if (any(nt != 0.0))
+        return nt;
+    return any(nm != 0.0) ? nm : n;
+}
@@ -0,0 +1,49 @@
+#include "pch.h"
+
+#include "framework/BoundaryVolumeMap.h"
+
+namespace
+{
+// must match cubic_kernel_height in CommonKernels.hlsl for a support radius of 1
+double CubicKernel(double r)
+{
+    constexpr double k = 8.0 / 3.14159265358979323846;
+    if (r >= 1.0)
+        return 0.0;
+    if (r <= 0.5)
+        return k * (6.0 * r * r * r - 6.0 * r * r + 1.0);
+    const double t = 1.0 - r;
+    return k * 2.0 * t * t * t;
+}
+}
+
+BoundaryVolumeMap BoundaryVolumeMap::CubicHalfSpace(uint32_t intervals, uint32_t steps)
+{
+    // A(z) = 2 pi int_z^1 r W(r) dr is the kernel integrated over the plane at height z,
+    // V(q) = int_q^1 A(z) dz; both are accumulated from q = 1 down with the trapezoid rule
+    const uint32_t n = intervals * steps;
+    const double dz = 1.0 / n;
+    std::vector<double> area(n + 1, 0.0);
+    for (uint32_t k = n; k-- > 0;)
+    {
+        const double r0 = k * dz;
+        const double r1 = (k + 1) * dz;
+        area[k] = area[k + 1] + 3.14159265358979323846 * dz * (r0 * CubicKernel(r0) + r1 * CubicKernel(r1));
+    }
+
+    BoundaryVolumeMap map;
+    map.samples.resize(intervals + 1);
+    double volume = 0.0;
+    for (uint32_t k = n + 1; k-- > 0;)
+    {
+        if (k < n)
+        {
+            volume += 0.5 * dz * (area[k] + area[k + 1]);
+        }
+        if (k % steps == 0)
+        {
+            map.samples[k / steps] = Vector2(static_cast<float>(volume), static_cast<float>(-area[k]));
+        }
+    }
+    return map;
+}
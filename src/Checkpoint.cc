@@ -0,0 +1,116 @@
+#include "pch.h"
+
+#include "framework/Checkpoint.h"
+
+#include <string_view>
+
+namespace
+{
+constexpr char k_checkpointMagic[8] = {'L', 'A', 'V', 'A', 'C', 'K', 'P', 'T'};
+constexpr uint64_t k_chunkAlignment = 64;
+
+uint64_t AlignChunk(uint64_t offset)
+{
+    return (offset + k_chunkAlignment - 1) & ~(k_chunkAlignment - 1);
+}
+
+bool TagEquals(const char (&tag)[8], std::string_view name)
+{
+    return name.size() <= sizeof(tag) && memcmp(tag, name.data(), name.size()) == 0 &&
+           (name.size() == sizeof(tag) || tag[name.size()] == '\0');
+}
+}
+
+uint64_t Checkpoint::Write(const std::filesystem::path &path, const std::vector<Source> &sources)
+{
+    std::vector<Chunk> table(sources.size());
+    uint64_t offset = AlignChunk(sizeof(Header) + table.size() * sizeof(Chunk));
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        const Source &source = sources[i];
+        if (source.tag.empty() || source.tag.size() > sizeof(Chunk::tag))
+        {
+            throw std::runtime_error("Bad checkpoint chunk tag '" + std::string(source.tag) + "'");
+        }
+        Chunk &chunk = table[i];
+        memcpy(chunk.tag, source.tag.data(), source.tag.size());
+        chunk.offset = offset;
+        chunk.bytes = source.bytes;
+        chunk.elementStride = source.elementStride;
+        offset = AlignChunk(offset + source.bytes);
+    }
+
+    Header header = {};
+    memcpy(header.magic, k_checkpointMagic, sizeof(k_checkpointMagic));
+    header.version = k_version;
+    header.chunkCount = static_cast<uint32_t>(table.size());
+    header.fileBytes = offset;
+
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        MappedFile out = MappedFile::Open(tempPath, header.fileBytes);
+        uint8_t *data = out.GetData();
+        memcpy(data, &header, sizeof(header));
+        memcpy(data + sizeof(header), table.data(), table.size() * sizeof(Chunk));
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            if (sources[i].bytes > 0)
+            {
+                memcpy(data + table[i].offset, sources[i].data, sources[i].bytes);
+            }
+        }
+        out.Flush();
+    }
+    std::filesystem::rename(tempPath, path);
+    return header.fileBytes;
+}
+
+std::unique_ptr<Checkpoint> Checkpoint::Open(const std::filesystem::path &path)
+{
+    auto checkpoint = std::make_unique<Checkpoint>();
+    checkpoint->file = MappedFile::Open(path);
+    const uint64_t fileBytes = checkpoint->file.bytes;
+    const uint8_t *data = checkpoint->file.GetData();
+
+    Header &header = checkpoint->header;
+    if (fileBytes >= sizeof(header))
+    {
+        memcpy(&header, data, sizeof(header));
+    }
+    if (memcmp(header.magic, k_checkpointMagic, sizeof(k_checkpointMagic)) != 0)
+    {
+        throw std::runtime_error(path.string() + " is not a checkpoint");
+    }
+    if (header.version > k_version)
+    {
+        throw std::runtime_error(path.string() + " was written by a newer version (" + std::to_string(header.version) + ")");
+    }
+    if (header.fileBytes != fileBytes || sizeof(Header) + uint64_t(header.chunkCount) * sizeof(Chunk) > fileBytes)
+    {
+        throw std::runtime_error(path.string() + " is truncated");
+    }
+
+    checkpoint->chunks.resize(header.chunkCount);
+    memcpy(checkpoint->chunks.data(), data + sizeof(header), checkpoint->chunks.size() * sizeof(Chunk));
+    for (const Chunk &chunk : checkpoint->chunks)
+    {
+        if (chunk.offset > fileBytes || chunk.bytes > fileBytes - chunk.offset)
+        {
+            throw std::runtime_error(path.string() + " has a chunk outside the file");
+        }
+    }
+    return checkpoint;
+}
+
+const Checkpoint::Chunk *Checkpoint::Find(std::string_view tag) const
+{
+    for (const Chunk &chunk : chunks)
+    {
+        if (TagEquals(chunk.tag, tag))
+        {
+            return &chunk;
+        }
+    }
+    return nullptr;
+}
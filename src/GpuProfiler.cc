@@ -0,0 +1,130 @@
+#include "pch.h"
+
+#include "framework/GpuProfiler.h"
+#include "framework/UploadHelpers.h"
+
+#include <iomanip>
+
+void GpuProfiler::Init(ID3D12Device *device, ID3D12CommandQueue *queue, UINT maxTimestamps)
+{
+    m_maxTimestamps = maxTimestamps;
+
+    D3D12_QUERY_HEAP_DESC heapDesc{};
+    heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    heapDesc.Count = maxTimestamps;
+    ThrowIfFailed(device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(m_queryHeap.put())));
+
+    m_readback = UploadHelpers::CreateReadbackBuffer(device, UINT64(maxTimestamps) * sizeof(uint64_t));
+
+    uint64_t frequency = 1;
+    ThrowIfFailed(queue->GetTimestampFrequency(&frequency));
+    m_msPerTick = 1000.0 / double(frequency);
+
+    m_timestamps.resize(maxTimestamps, 0);
+}
+
+void GpuProfiler::BeginFrame()
+{
+    m_used = 0;
+    m_openScopes.clear();
+    m_closedScopes.clear();
+}
+
+UINT GpuProfiler::Mark(ID3D12GraphicsCommandList *cmdList)
+{
+    // a full heap drops the timestamp instead of writing past the query heap
+    if (m_used >= m_maxTimestamps)
+    {
+        ++m_droppedMarks;
+        return k_noMark;
+    }
+    UINT index = m_used++;
+    cmdList->EndQuery(m_queryHeap.get(), D3D12_QUERY_TYPE_TIMESTAMP, index);
+    return index;
+}
+
+void GpuProfiler::BeginScope(ID3D12GraphicsCommandList *cmdList, const char *name)
+{
+    m_openScopes.push_back({name, Mark(cmdList)});
+}
+
+void GpuProfiler::EndScope(ID3D12GraphicsCommandList *cmdList)
+{
+    assert(!m_openScopes.empty());
+    OpenScope scope = m_openScopes.back();
+    m_openScopes.pop_back();
+    m_closedScopes.push_back({scope.name, scope.begin, Mark(cmdList)});
+}
+
+void GpuProfiler::Resolve(ID3D12GraphicsCommandList *cmdList)
+{
+    if (m_used == 0)
+        return;
+    cmdList->ResolveQueryData(m_queryHeap.get(), D3D12_QUERY_TYPE_TIMESTAMP, 0, m_used, m_readback.get(), 0);
+}
+
+void GpuProfiler::EndFrame()
+{
+    if (m_used == 0)
+        return;
+
+    UploadHelpers::ReadbackToHost(m_readback.get(), m_timestamps.data(), UINT64(m_used) * sizeof(uint64_t));
+
+    ++m_frames;
+
+    // scopes may run several times per frame (e.g. substeps), sum them up
+    std::vector<double> frameMs(m_stats.size(), 0.0);
+    std::vector<bool> ran(m_stats.size(), false);
+    for (const ClosedScope &scope : m_closedScopes)
+    {
+        if (scope.begin == k_noMark || scope.end == k_noMark)
+            continue;
+
+        auto it = std::find_if(m_stats.begin(), m_stats.end(),
+                               [&](const ScopeStats &s)
+                               { return s.name == scope.name; });
+        size_t idx = static_cast<size_t>(it - m_stats.begin());
+        if (it == m_stats.end())
+        {
+            m_stats.push_back({scope.name, {}});
+            frameMs.push_back(0.0);
+            ran.push_back(false);
+        }
+        frameMs[idx] += GetElapsedMs(scope.begin, scope.end);
+        ran[idx] = true;
+    }
+
+    for (size_t i = 0; i < m_stats.size(); ++i)
+    {
+        if (ran[i])
+            m_stats[i].executed.add(frameMs[i]);
+    }
+}
+
+double GpuProfiler::GetElapsedMs(UINT fromMark, UINT toMark) const
+{
+    if (fromMark >= m_used || toMark >= m_used)
+        return 0.0;
+    return double(m_timestamps[toMark] - m_timestamps[fromMark]) * m_msPerTick;
+}
+
+void GpuProfiler::PrintReport(std::ostream &os) const
+{
+    os << "\n=== GPU Stage Timings ===\n";
+    os << std::left << std::setw(24) << "stage"
+       << std::right << std::setw(10) << "ran"
+       << std::setw(14) << "avg/run ms"
+       << std::setw(14) << "avg/step ms" << "\n";
+    for (const ScopeStats &s : m_stats)
+    {
+        double perRun = s.executed.average();
+        double perStep = m_frames ? perRun * double(s.executed.count()) / double(m_frames) : 0.0;
+        os << std::left << std::setw(24) << s.name
+           << std::right << std::setw(10) << s.executed.count()
+           << std::setw(14) << perRun
+           << std::setw(14) << perStep << "\n";
+    }
+    if (m_droppedMarks > 0)
+        os << "dropped marks: " << m_droppedMarks << " (more than " << m_maxTimestamps << " per frame)\n";
+    os << "=========================\n";
+}
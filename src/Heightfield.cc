@@ -0,0 +1,310 @@
+#include "pch.h"
+
+#include "framework/Heightfield.h"
+#include "framework/MappedFile.h"
+#include "framework/ParallelFor.h"
+
+#include <cctype>
+#include <charconv>
+#include <limits>
+#include <string_view>
+
+namespace
+{
+constexpr char k_cacheMagic[8] = {'L', 'A', 'V', 'A', 'D', 'E', 'M', '1'};
+constexpr uint32_t k_cacheVersion = 1;
+constexpr uint32_t k_tileSize = 64;     // 16 KiB of floats per tile
+constexpr uint64_t k_headerBytes = 256; // tiles start behind the header
+static_assert(sizeof(Heightfield::CacheHeader) <= k_headerBytes);
+
+size_t TileOffset(uint32_t col, uint32_t row, uint32_t tilesX)
+{
+    const size_t tile = size_t(row / k_tileSize) * tilesX + col / k_tileSize;
+    return tile * k_tileSize * k_tileSize + (row % k_tileSize) * k_tileSize + col % k_tileSize;
+}
+
+// whitespace separated tokens of an ASCII grid
+struct TokenReader
+{
+    const char *cursor;
+    const char *end;
+
+    std::string_view Next()
+    {
+        while (cursor < end && std::isspace(static_cast<unsigned char>(*cursor)))
+            ++cursor;
+        const char *start = cursor;
+        while (cursor < end && !std::isspace(static_cast<unsigned char>(*cursor)))
+            ++cursor;
+        return std::string_view(start, cursor - start);
+    }
+};
+
+template <typename T>
+T ParseNumber(std::string_view token, const std::filesystem::path &path)
+{
+    if (token.empty())
+    {
+        throw std::runtime_error("Unexpected end of " + path.string());
+    }
+    T value = {};
+    auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (ec != std::errc() || ptr != token.data() + token.size())
+    {
+        throw std::runtime_error("Bad number '" + std::string(token) + "' in " + path.string());
+    }
+    return value;
+}
+
+std::string ToLower(std::string_view s)
+{
+    std::string out(s);
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    return out;
+}
+
+int64_t GetSourceTime(const std::filesystem::path &path)
+{
+    return static_cast<int64_t>(std::filesystem::last_write_time(path).time_since_epoch().count());
+}
+
+// Streams the source into a tiled cache through a writable mapping, so neither side has to
+// fit in memory. Written to a temporary file first and renamed when complete.
+void BuildCache(const std::filesystem::path &source, const std::filesystem::path &cachePath,
+                const Heightfield::RawLayout &raw)
+{
+    MappedFile src = MappedFile::Open(source);
+    const char *text = static_cast<const char *>(src.view.get());
+
+    Heightfield::CacheHeader header = {};
+    memcpy(header.magic, k_cacheMagic, sizeof(k_cacheMagic));
+    header.version = k_cacheVersion;
+    header.tileSize = k_tileSize;
+    header.sourceBytes = src.bytes;
+    header.sourceTime = GetSourceTime(source);
+
+    const bool ascii = ToLower(source.extension().string()) == ".asc";
+    TokenReader reader = {text, text + src.bytes};
+    float noData = raw.noData;
+
+    if (ascii)
+    {
+        // ncols, nrows, xllcorner|xllcenter, yllcorner|yllcenter, cellsize, optional nodata_value
+        bool cornerX = false;
+        bool cornerY = false;
+        for (;;)
+        {
+            const char *keyStart = reader.cursor;
+            std::string_view token = reader.Next();
+            if (token.empty() || !std::isalpha(static_cast<unsigned char>(token[0])))
+            {
+                reader.cursor = keyStart;
+                break;
+            }
+            const std::string key = ToLower(token);
+            const double value = ParseNumber<double>(reader.Next(), source);
+            if (key == "ncols")
+            {
+                header.cols = static_cast<uint32_t>(value);
+            }
+            else if (key == "nrows")
+            {
+                header.rows = static_cast<uint32_t>(value);
+            }
+            else if (key == "xllcorner" || key == "xllcenter")
+            {
+                header.minX = value;
+                cornerX = key == "xllcorner";
+            }
+            else if (key == "yllcorner" || key == "yllcenter")
+            {
+                header.minY = value;
+                cornerY = key == "yllcorner";
+            }
+            else if (key == "cellsize")
+            {
+                header.cellSize = value;
+            }
+            else if (key == "nodata_value")
+            {
+                noData = static_cast<float>(value);
+            }
+        }
+        // samples sit at the cell centers
+        header.minX += cornerX ? 0.5 * header.cellSize : 0.0;
+        header.minY += cornerY ? 0.5 * header.cellSize : 0.0;
+    }
+    else
+    {
+        header.cols = raw.cols;
+        header.rows = raw.rows;
+        header.cellSize = raw.cellSize;
+        header.minX = raw.minX;
+        header.minY = raw.minY;
+        if (src.bytes < uint64_t(raw.cols) * raw.rows * sizeof(float))
+        {
+            throw std::runtime_error(source.string() + " is smaller than the given raster size");
+        }
+    }
+
+    if (header.cols < 2 || header.rows < 2 || !(header.cellSize > 0.0))
+    {
+        throw std::runtime_error("Bad raster size or cell size in " + source.string());
+    }
+
+    const uint32_t tilesX = (header.cols + k_tileSize - 1) / k_tileSize;
+    const uint32_t tilesY = (header.rows + k_tileSize - 1) / k_tileSize;
+    const uint64_t cacheBytes = k_headerBytes + uint64_t(tilesX) * tilesY * k_tileSize * k_tileSize * sizeof(float);
+
+    std::filesystem::path tempPath = cachePath;
+    tempPath += ".tmp";
+    {
+        MappedFile cache = MappedFile::Open(tempPath, cacheBytes);
+        float *tiles = reinterpret_cast<float *>(static_cast<uint8_t *>(cache.view.get()) + k_headerBytes);
+
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        float minHeight = std::numeric_limits<float>::max();
+        float maxHeight = std::numeric_limits<float>::lowest();
+
+        if (ascii)
+        {
+            // sequential: where a value starts in the text depends on all values before it
+            for (uint32_t row = 0; row < header.rows; ++row)
+            {
+                for (uint32_t col = 0; col < header.cols; ++col)
+                {
+                    float v = ParseNumber<float>(reader.Next(), source);
+                    if (v == noData)
+                    {
+                        v = nan;
+                    }
+                    else
+                    {
+                        minHeight = std::min(minHeight, v);
+                        maxHeight = std::max(maxHeight, v);
+                    }
+                    tiles[TileOffset(col, row, tilesX)] = v;
+                }
+            }
+        }
+        else
+        {
+            const float *values = reinterpret_cast<const float *>(text);
+            std::vector<float> rowMin(header.rows, minHeight);
+            std::vector<float> rowMax(header.rows, maxHeight);
+            ParallelFor(0, header.rows, [&](uint32_t row)
+                        {
+                const float *rowValues = values + size_t(row) * header.cols;
+                for (uint32_t col = 0; col < header.cols; ++col)
+                {
+                    float v = rowValues[col];
+                    if (v == noData || std::isnan(v))
+                    {
+                        v = nan;
+                    }
+                    else
+                    {
+                        rowMin[row] = std::min(rowMin[row], v);
+                        rowMax[row] = std::max(rowMax[row], v);
+                    }
+                    tiles[TileOffset(col, row, tilesX)] = v;
+                } }, 16);
+            minHeight = *std::min_element(rowMin.begin(), rowMin.end());
+            maxHeight = *std::max_element(rowMax.begin(), rowMax.end());
+        }
+
+        if (minHeight > maxHeight)
+        {
+            throw std::runtime_error("No valid samples in " + source.string());
+        }
+        header.minHeight = minHeight;
+        header.maxHeight = maxHeight;
+        memcpy(cache.view.get(), &header, sizeof(header));
+    }
+    std::filesystem::rename(tempPath, cachePath);
+}
+}
+
+std::unique_ptr<Heightfield> Heightfield::Open(const std::filesystem::path &path, const RawLayout &raw)
+{
+    std::filesystem::path cachePath = path;
+    cachePath += ".tiles";
+    const bool ascii = ToLower(path.extension().string()) == ".asc";
+    const uint64_t sourceBytes = std::filesystem::file_size(path);
+    const int64_t sourceTime = GetSourceTime(path);
+
+    auto heightfield = std::make_unique<Heightfield>();
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        if (std::filesystem::exists(cachePath))
+        {
+            MappedFile cache = MappedFile::Open(cachePath);
+            CacheHeader header = {};
+            if (cache.bytes >= k_headerBytes)
+            {
+                memcpy(&header, cache.view.get(), sizeof(header));
+            }
+
+            const uint32_t tilesX = (header.cols + k_tileSize - 1) / k_tileSize;
+            const uint32_t tilesY = (header.rows + k_tileSize - 1) / k_tileSize;
+            const bool current =
+                memcmp(header.magic, k_cacheMagic, sizeof(k_cacheMagic)) == 0 && header.version == k_cacheVersion &&
+                header.tileSize == k_tileSize && header.sourceBytes == sourceBytes && header.sourceTime == sourceTime &&
+                cache.bytes == k_headerBytes + uint64_t(tilesX) * tilesY * k_tileSize * k_tileSize * sizeof(float) &&
+                (ascii || (header.cols == raw.cols && header.rows == raw.rows && header.cellSize == raw.cellSize &&
+                           header.minX == raw.minX && header.minY == raw.minY));
+            if (current)
+            {
+                heightfield->header = header;
+                heightfield->tilesX = tilesX;
+                heightfield->cacheBytes = cache.bytes;
+                heightfield->file = std::move(cache.file);
+                heightfield->mapping = std::move(cache.mapping);
+                heightfield->view = std::move(cache.view);
+                heightfield->tiles = reinterpret_cast<const float *>(
+                    static_cast<const uint8_t *>(heightfield->view.get()) + k_headerBytes);
+                return heightfield;
+            }
+        }
+
+        if (attempt == 0)
+        {
+            BuildCache(path, cachePath, raw);
+            heightfield->cacheRebuilt = true;
+        }
+    }
+    throw std::runtime_error("Cannot build the tile cache of " + path.string());
+}
+
+float Heightfield::GetHeight(uint32_t col, uint32_t row) const
+{
+    const float v = tiles[TileOffset(col, row, tilesX)];
+    return std::isnan(v) ? header.minHeight : v;
+}
+
+float Heightfield::SampleHeight(double x, double y) const
+{
+    const double gc = std::clamp((x - header.minX) / header.cellSize, 0.0, double(header.cols - 1));
+    const double gr = std::clamp((GetMaxY() - y) / header.cellSize, 0.0, double(header.rows - 1));
+    const uint32_t c0 = std::min(static_cast<uint32_t>(gc), header.cols - 2);
+    const uint32_t r0 = std::min(static_cast<uint32_t>(gr), header.rows - 2);
+    const float fc = static_cast<float>(gc - c0);
+    const float fr = static_cast<float>(gr - r0);
+
+    const float north = std::lerp(GetHeight(c0, r0), GetHeight(c0 + 1, r0), fc);
+    const float south = std::lerp(GetHeight(c0, r0 + 1), GetHeight(c0 + 1, r0 + 1), fc);
+    return std::lerp(north, south, fr);
+}
+
+std::vector<float> Heightfield::Resample(double x0, double y0, double spacing, uint32_t nx, uint32_t ny) const
+{
+    std::vector<float> out(size_t(nx) * ny);
+    ParallelFor(0, ny, [&](uint32_t j)
+                {
+        for (uint32_t i = 0; i < nx; ++i)
+        {
+            out[size_t(j) * nx + i] = SampleHeight(x0 + i * spacing, y0 + j * spacing);
+        } }, 4);
+    return out;
+}
@@ -0,0 +1,44 @@
+#include "pch.h"
+
+#include "framework/MappedFile.h"
+
+MappedFile MappedFile::Open(const std::filesystem::path &path, uint64_t createBytes)
+{
+    const bool create = createBytes > 0;
+    MappedFile m;
+    m.file.reset(CreateFileW(path.c_str(), create ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ,
+                             nullptr, create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!m.file)
+    {
+        throw std::runtime_error("Cannot open " + path.string());
+    }
+
+    m.bytes = createBytes;
+    if (!create)
+    {
+        LARGE_INTEGER size = {};
+        if (!GetFileSizeEx(m.file.get(), &size) || size.QuadPart == 0)
+        {
+            throw std::runtime_error("Empty file " + path.string());
+        }
+        m.bytes = static_cast<uint64_t>(size.QuadPart);
+    }
+
+    m.mapping.reset(CreateFileMappingW(m.file.get(), nullptr, create ? PAGE_READWRITE : PAGE_READONLY,
+                                       static_cast<DWORD>(m.bytes >> 32), static_cast<DWORD>(m.bytes), nullptr));
+    if (m.mapping)
+    {
+        m.view.reset(MapViewOfFile(m.mapping.get(), create ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!m.view)
+    {
+        throw std::runtime_error("Cannot map " + path.string());
+    }
+    return m;
+}
+
+void MappedFile::Flush() const
+{
+    FlushViewOfFile(view.get(), 0);
+    FlushFileBuffers(file.get());
+}
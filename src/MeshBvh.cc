@@ -0,0 +1,515 @@
+#include "pch.h"
+
+#include "framework/MeshBvh.h"
+#include "framework/ParallelFor.h"
+
+#include <atomic>
+#include <execution>
+
+namespace
+{
+constexpr uint32_t k_binCount = 12;
+constexpr uint32_t k_maxLeafSize = 4;
+constexpr uint32_t k_parallelThreshold = 16384; // smaller subtrees are built on one thread
+constexpr float k_far = 1e30f;
+
+float Axis(const Vector3 &v, int axis)
+{
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+struct Aabb
+{
+    Vector3 min = Vector3(k_far);
+    Vector3 max = Vector3(-k_far);
+
+    void Grow(const Vector3 &p)
+    {
+        min = Vector3::Min(min, p);
+        max = Vector3::Max(max, p);
+    }
+    void Grow(const Aabb &box)
+    {
+        min = Vector3::Min(min, box.min);
+        max = Vector3::Max(max, box.max);
+    }
+    float HalfArea() const
+    {
+        const Vector3 e = max - min;
+        return e.x < 0.0f ? 0.0f : e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+    bool Overlaps(const Vector3 &boxMin, const Vector3 &boxMax) const
+    {
+        return min.x <= boxMax.x && max.x >= boxMin.x && min.y <= boxMax.y && max.y >= boxMin.y &&
+               min.z <= boxMax.z && max.z >= boxMin.z;
+    }
+};
+
+bool NodeOverlaps(const MeshBvhNode &node, const Vector3 &boxMin, const Vector3 &boxMax)
+{
+    return Aabb{node.boundsMin, node.boundsMax}.Overlaps(boxMin, boxMax);
+}
+
+float DistanceSqToBox(const Vector3 &p, const Vector3 &boxMin, const Vector3 &boxMax)
+{
+    const Vector3 d = Vector3::Max(Vector3::Max(boxMin - p, p - boxMax), Vector3::Zero);
+    return d.LengthSquared();
+}
+
+// Ericson, Real-Time Collision Detection 5.1.5
+Vector3 ClosestPointOnTriangle(const Vector3 &p, const MeshTriangle &t)
+{
+    const Vector3 ab = t.b - t.a;
+    const Vector3 ac = t.c - t.a;
+    const Vector3 ap = p - t.a;
+    const float d1 = ab.Dot(ap);
+    const float d2 = ac.Dot(ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return t.a;
+
+    const Vector3 bp = p - t.b;
+    const float d3 = ab.Dot(bp);
+    const float d4 = ac.Dot(bp);
+    if (d3 >= 0.0f && d4 <= d3)
+        return t.b;
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return t.a + ab * (d1 / (d1 - d3));
+
+    const Vector3 cp = p - t.c;
+    const float d5 = ab.Dot(cp);
+    const float d6 = ac.Dot(cp);
+    if (d6 >= 0.0f && d5 <= d6)
+        return t.c;
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return t.a + ac * (d2 / (d2 - d6));
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        return t.b + (t.c - t.b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    const float denom = 1.0f / (va + vb + vc);
+    return t.a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+void TestTriangle(const Vector3 &p, const MeshTriangle &t, uint32_t index, float &bestSq, MeshHit &hit)
+{
+    const Vector3 q = ClosestPointOnTriangle(p, t);
+    const float dSq = Vector3::DistanceSquared(p, q);
+    if (dSq < bestSq)
+    {
+        bestSq = dSq;
+        hit.point = q;
+        hit.triangle = index;
+    }
+}
+
+struct BuildContext
+{
+    std::vector<Aabb> bounds;
+    std::vector<Vector3> centroids;
+    std::vector<uint32_t> order;
+    std::vector<MeshBvhNode> &nodes;
+    std::atomic<uint32_t> nodeCount = 1;
+    std::atomic<uint32_t> depth = 0;
+};
+
+void BuildNode(BuildContext &ctx, uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth)
+{
+    Aabb box;
+    Aabb centroidBox;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        box.Grow(ctx.bounds[ctx.order[i]]);
+        centroidBox.Grow(ctx.centroids[ctx.order[i]]);
+    }
+
+    // nodes were sized for the worst case up front, references stay valid across threads
+    MeshBvhNode &node = ctx.nodes[nodeIndex];
+    node.boundsMin = box.min;
+    node.boundsMax = box.max;
+    node.leftOrFirst = begin;
+    node.count = end - begin;
+
+    uint32_t seenDepth = ctx.depth.load();
+    while (seenDepth < depth && !ctx.depth.compare_exchange_weak(seenDepth, depth))
+    {
+    }
+
+    const uint32_t count = end - begin;
+    if (count <= k_maxLeafSize || depth >= MeshBvh::k_maxDepth)
+    {
+        return;
+    }
+
+    // binned SAH over the centroid bounds, costs relative to one triangle test
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    float bestCost = k_far;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float lo = Axis(centroidBox.min, axis);
+        const float extent = Axis(centroidBox.max, axis) - lo;
+        if (extent <= 0.0f)
+            continue;
+
+        Aabb binBounds[k_binCount];
+        uint32_t binCounts[k_binCount] = {};
+        const float scale = k_binCount / extent;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const uint32_t t = ctx.order[i];
+            const uint32_t bin = std::min(k_binCount - 1, static_cast<uint32_t>((Axis(ctx.centroids[t], axis) - lo) * scale));
+            binBounds[bin].Grow(ctx.bounds[t]);
+            binCounts[bin]++;
+        }
+
+        float rightCost[k_binCount] = {};
+        Aabb right;
+        uint32_t rightCount = 0;
+        for (uint32_t bin = k_binCount - 1; bin > 0; --bin)
+        {
+            right.Grow(binBounds[bin]);
+            rightCount += binCounts[bin];
+            rightCost[bin] = rightCount * right.HalfArea();
+        }
+
+        Aabb left;
+        uint32_t leftCount = 0;
+        for (uint32_t split = 1; split < k_binCount; ++split)
+        {
+            left.Grow(binBounds[split - 1]);
+            leftCount += binCounts[split - 1];
+            const float cost = leftCount * left.HalfArea() + rightCost[split];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    const float area = std::max(box.HalfArea(), 1e-20f);
+    if (bestAxis < 0 || 1.0f + bestCost / area >= static_cast<float>(count))
+    {
+        return;
+    }
+
+    const float lo = Axis(centroidBox.min, bestAxis);
+    const float scale = k_binCount / (Axis(centroidBox.max, bestAxis) - lo);
+    auto middle = std::partition(ctx.order.begin() + begin, ctx.order.begin() + end, [&](uint32_t t)
+                                 { return std::min(k_binCount - 1, static_cast<uint32_t>((Axis(ctx.centroids[t], bestAxis) - lo) * scale)) < bestSplit; });
+    const uint32_t mid = static_cast<uint32_t>(middle - ctx.order.begin());
+    if (mid == begin || mid == end)
+    {
+        return;
+    }
+
+    const uint32_t left = ctx.nodeCount.fetch_add(2);
+    node.leftOrFirst = left;
+    node.count = 0;
+
+    auto buildChild = [&](uint32_t child)
+    {
+        if (child == 0)
+            BuildNode(ctx, left, begin, mid, depth + 1);
+        else
+            BuildNode(ctx, left + 1, mid, end, depth + 1);
+    };
+    if (count >= k_parallelThreshold)
+    {
+        ParallelFor(0, 2, buildChild, 1);
+    }
+    else
+    {
+        buildChild(0);
+        buildChild(1);
+    }
+}
+}
+
+void MeshBvh::Build(const TriangleMesh &mesh)
+{
+    std::vector<MeshTriangle> source;
+    source.reserve(mesh.GetTriangleCount());
+    for (size_t t = 0; t < mesh.GetTriangleCount(); ++t)
+    {
+        MeshTriangle tri = {mesh.vertices[mesh.indices[3 * t]], mesh.vertices[mesh.indices[3 * t + 1]],
+                            mesh.vertices[mesh.indices[3 * t + 2]]};
+        if ((tri.b - tri.a).Cross(tri.c - tri.a).LengthSquared() > 0.0f)
+        {
+            source.push_back(tri);
+        }
+    }
+
+    nodes.clear();
+    triangles.clear();
+    depth = 0;
+    if (source.empty())
+    {
+        return;
+    }
+
+    const uint32_t count = static_cast<uint32_t>(source.size());
+    nodes.resize(2 * size_t(count) - 1);
+    BuildContext ctx = {std::vector<Aabb>(count), std::vector<Vector3>(count), std::vector<uint32_t>(count), nodes};
+    ParallelFor(0, count, [&](uint32_t t)
+                {
+        Aabb box;
+        box.Grow(source[t].a);
+        box.Grow(source[t].b);
+        box.Grow(source[t].c);
+        ctx.bounds[t] = box;
+        ctx.centroids[t] = (box.min + box.max) * 0.5f;
+        ctx.order[t] = t; });
+
+    BuildNode(ctx, 0, 0, count, 0);
+
+    nodes.resize(ctx.nodeCount.load());
+    depth = ctx.depth.load();
+    triangles.resize(count);
+    ParallelFor(0, count, [&](uint32_t i)
+                { triangles[i] = source[ctx.order[i]]; });
+}
+
+MeshHit MeshBvh::ClosestPoint(const Vector3 &p, float maxDistance) const
+{
+    MeshHit hit = {p, maxDistance, k_noTriangle};
+    if (nodes.empty())
+    {
+        return hit;
+    }
+
+    float bestSq = maxDistance * maxDistance;
+    uint32_t stack[64];
+    uint32_t top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const MeshBvhNode &node = nodes[stack[--top]];
+        if (DistanceSqToBox(p, node.boundsMin, node.boundsMax) >= bestSq)
+            continue;
+
+        if (node.count > 0)
+        {
+            for (uint32_t t = node.leftOrFirst; t < node.leftOrFirst + node.count; ++t)
+            {
+                TestTriangle(p, triangles[t], t, bestSq, hit);
+            }
+            continue;
+        }
+
+        // nearer child on top of the stack
+        const uint32_t a = node.leftOrFirst;
+        const uint32_t b = node.leftOrFirst + 1;
+        const bool aFirst = DistanceSqToBox(p, nodes[a].boundsMin, nodes[a].boundsMax) <=
+                            DistanceSqToBox(p, nodes[b].boundsMin, nodes[b].boundsMax);
+        stack[top++] = aFirst ? b : a;
+        stack[top++] = aFirst ? a : b;
+    }
+
+    hit.distance = std::sqrt(bestSq);
+    return hit;
+}
+
+void MeshBvh::ClosestPoints(const std::vector<Vector3> &points, float maxDistance, float bucketSize,
+                            std::vector<MeshHit> &out) const
+{
+    out.resize(points.size());
+    const uint32_t count = static_cast<uint32_t>(points.size());
+    if (count == 0)
+    {
+        return;
+    }
+
+    // 21 bits per axis of the bucket coordinate, then the query index. Coordinates outside
+    // the 21 bits would wrap onto the key of a distant bucket; those queries get k_unbucketed,
+    // sort to the end and traverse the tree on their own.
+    constexpr int64_t k_bucketRange = int64_t(1) << 20;
+    constexpr uint64_t k_unbucketed = ~uint64_t(0);
+    auto bucketCoord = [&](float v)
+    { return static_cast<int64_t>(std::floor(v / bucketSize)); };
+    auto inRange = [&](float v)
+    {
+        const float c = std::floor(v / bucketSize);
+        return c >= -float(k_bucketRange) && c < float(k_bucketRange);
+    };
+    std::vector<std::pair<uint64_t, uint32_t>> keys(count);
+    ParallelFor(0, count, [&](uint32_t i)
+                {
+        const Vector3 &p = points[i];
+        if (!inRange(p.x) || !inRange(p.y) || !inRange(p.z))
+        {
+            keys[i] = {k_unbucketed, i};
+            return;
+        }
+        const uint64_t x = uint64_t(bucketCoord(p.x) + k_bucketRange);
+        const uint64_t y = uint64_t(bucketCoord(p.y) + k_bucketRange);
+        const uint64_t z = uint64_t(bucketCoord(p.z) + k_bucketRange);
+        keys[i] = {(z << 42) | (y << 21) | x, i}; });
+    std::sort(std::execution::par, keys.begin(), keys.end());
+
+    uint32_t bucketed = count;
+    while (bucketed > 0 && keys[bucketed - 1].first == k_unbucketed)
+    {
+        --bucketed;
+    }
+    ParallelFor(bucketed, count, [&](uint32_t k)
+                { out[keys[k].second] = ClosestPoint(points[keys[k].second], maxDistance); });
+
+    std::vector<uint32_t> bucketStart;
+    for (uint32_t i = 0; i < bucketed; ++i)
+    {
+        if (i == 0 || keys[i].first != keys[i - 1].first)
+        {
+            bucketStart.push_back(i);
+        }
+    }
+    bucketStart.push_back(bucketed);
+
+    struct Candidate
+    {
+        Vector3 boundsMin;
+        Vector3 boundsMax;
+        float distance; // from the bucket center to the bounds
+        uint32_t triangle;
+    };
+
+    ParallelFor(0, static_cast<uint32_t>(bucketStart.size() - 1), [&](uint32_t bucket)
+                {
+        const uint32_t begin = bucketStart[bucket];
+        const uint32_t end = bucketStart[bucket + 1];
+        const Vector3 &first = points[keys[begin].second];
+        const Vector3 cell(static_cast<float>(bucketCoord(first.x)), static_cast<float>(bucketCoord(first.y)),
+                           static_cast<float>(bucketCoord(first.z)));
+        const Vector3 boxMin = cell * bucketSize - Vector3(maxDistance);
+        const Vector3 boxMax = (cell + Vector3(1.0f)) * bucketSize + Vector3(maxDistance);
+        const Vector3 center = (cell + Vector3(0.5f)) * bucketSize;
+
+        // one traversal per bucket
+        thread_local std::vector<Candidate> candidates;
+        candidates.clear();
+        if (!nodes.empty())
+        {
+            uint32_t stack[64];
+            uint32_t top = 0;
+            stack[top++] = 0;
+            while (top > 0)
+            {
+                const MeshBvhNode &node = nodes[stack[--top]];
+                if (!NodeOverlaps(node, boxMin, boxMax))
+                    continue;
+                if (node.count > 0)
+                {
+                    for (uint32_t t = node.leftOrFirst; t < node.leftOrFirst + node.count; ++t)
+                    {
+                        const MeshTriangle &tri = triangles[t];
+                        const Vector3 lo = Vector3::Min(Vector3::Min(tri.a, tri.b), tri.c);
+                        const Vector3 hi = Vector3::Max(Vector3::Max(tri.a, tri.b), tri.c);
+                        candidates.push_back({lo, hi, std::sqrt(DistanceSqToBox(center, lo, hi)), t});
+                    }
+                    continue;
+                }
+                stack[top++] = node.leftOrFirst;
+                stack[top++] = node.leftOrFirst + 1;
+            }
+        }
+
+        // nearest bounds first: the best distance of a query shrinks early, and once the
+        // bounds are farther than that from the center plus the query's offset, all the
+        // remaining ones are too
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b)
+                  { return a.distance < b.distance; });
+
+        for (uint32_t k = begin; k < end; ++k)
+        {
+            const uint32_t i = keys[k].second;
+            const Vector3 &p = points[i];
+            const float offset = Vector3::Distance(p, center);
+            MeshHit hit = {p, maxDistance, k_noTriangle};
+            float bestSq = maxDistance * maxDistance;
+            for (const Candidate &c : candidates)
+            {
+                const float lowerBound = c.distance - offset;
+                if (lowerBound > 0.0f && lowerBound * lowerBound >= bestSq)
+                    break;
+                if (DistanceSqToBox(p, c.boundsMin, c.boundsMax) >= bestSq)
+                    continue;
+                TestTriangle(p, triangles[c.triangle], c.triangle, bestSq, hit);
+            }
+            hit.distance = std::sqrt(bestSq);
+            out[i] = hit;
+        } }, 1);
+}
+
+std::vector<uint32_t> MeshBvh::CollectCellRoots(const Vector3 &origin, float cellSize, const uint32_t resolution[3],
+                                                float radius, uint32_t rootsPerCell) const
+{
+    const uint32_t cellCount = resolution[0] * resolution[1] * resolution[2];
+    std::vector<uint32_t> roots(size_t(cellCount) * rootsPerCell, k_noNode);
+    if (nodes.empty())
+    {
+        return roots;
+    }
+
+    ParallelFor(0, cellCount, [&](uint32_t cell)
+                {
+        const uint32_t c[3] = {cell % resolution[0], (cell / resolution[0]) % resolution[1], cell / (resolution[0] * resolution[1])};
+        float lo[3];
+        float hi[3];
+        const float o[3] = {origin.x, origin.y, origin.z};
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            lo[axis] = c[axis] == 0 ? -k_far : o[axis] + c[axis] * cellSize - radius;
+            hi[axis] = c[axis] + 1 == resolution[axis] ? k_far : o[axis] + (c[axis] + 1) * cellSize + radius;
+        }
+        const Vector3 boxMin(lo[0], lo[1], lo[2]);
+        const Vector3 boxMax(hi[0], hi[1], hi[2]);
+
+        // frontier of overlapping subtrees, refined while the children still fit
+        uint32_t *list = roots.data() + size_t(cell) * rootsPerCell;
+        uint32_t size = 0;
+        if (NodeOverlaps(nodes[0], boxMin, boxMax))
+        {
+            list[size++] = 0;
+        }
+        for (uint32_t k = 0; k < size;)
+        {
+            const MeshBvhNode &node = nodes[list[k]];
+            if (node.count > 0)
+            {
+                ++k;
+                continue;
+            }
+            const bool left = NodeOverlaps(nodes[node.leftOrFirst], boxMin, boxMax);
+            const bool right = NodeOverlaps(nodes[node.leftOrFirst + 1], boxMin, boxMax);
+            const uint32_t children = (left ? 1 : 0) + (right ? 1 : 0);
+            if (size - 1 + children > rootsPerCell)
+            {
+                ++k;
+                continue;
+            }
+            // replace the node by its overlapping children and look at the first of them next
+            const uint32_t first = left ? node.leftOrFirst : node.leftOrFirst + 1;
+            if (children == 0)
+            {
+                list[k] = list[--size];
+            }
+            else
+            {
+                list[k] = first;
+                if (children == 2)
+                    list[size++] = node.leftOrFirst + 1;
+            }
+        }
+        for (uint32_t k = size; k < rootsPerCell; ++k)
+        {
+            list[k] = k_noNode;
+        } }, 16);
+
+    return roots;
+}
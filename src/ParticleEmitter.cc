@@ -0,0 +1,86 @@
+#include "pch.h"
+
+#include "framework/ParticleEmitter.h"
+
+#include <bit>
+#include <sstream>
+
+void ParticleSlotPool::Reset(uint32_t capacityIn, uint32_t liveCount)
+{
+    capacity = capacityIn;
+    liveEnd = std::min(liveCount, capacity);
+}
+
+void ParticleSlotPool::Grow(uint32_t capacityIn)
+{
+    assert(capacityIn >= capacity);
+    capacity = capacityIn;
+}
+
+uint32_t ParticleSlotPool::Acquire()
+{
+    return liveEnd < capacity ? liveEnd++ : UINT32_MAX;
+}
+
+ParticleEmitter::ParticleEmitter(const Settings &settingsIn, unsigned seed)
+    : settings(settingsIn), rng(seed)
+{
+    settings.direction.Normalize();
+
+    // any vector not parallel to the direction spans the disc
+    Vector3 helper = std::abs(settings.direction.y) < 0.9f ? Vector3(0.0f, 1.0f, 0.0f) : Vector3(1.0f, 0.0f, 0.0f);
+    tangent = settings.direction.Cross(helper);
+    tangent.Normalize();
+    bitangent = settings.direction.Cross(tangent);
+}
+
+uint32_t ParticleEmitter::Emit(float dt, ParticleSlotPool &pool, EmittedParticle *out, uint32_t maxCount)
+{
+    carried += settings.rate * dt;
+    uint32_t wanted = static_cast<uint32_t>(carried);
+    uint32_t count = std::min({wanted, maxCount, pool.GetAvailable()});
+    // particles that did not fit are dropped, not queued for later steps
+    carried -= static_cast<float>(wanted);
+
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> temperature(settings.temperatureMin, settings.temperatureMax);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        // uniform over the disc
+        float r = settings.radius * std::sqrt(unit(rng));
+        float phi = 6.2831853f * unit(rng);
+
+        // spread along the stream as if emitted continuously over dt
+        float along = settings.speed * dt * unit(rng);
+
+        EmittedParticle &p = out[i];
+        p.position = settings.position + tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) +
+                     settings.direction * along;
+        p.velocity = settings.direction * settings.speed;
+        p.temperature = temperature(rng);
+        p.slot = pool.Acquire();
+    }
+
+    return count;
+}
+
+std::string ParticleEmitter::SaveState() const
+{
+    // the remainder as raw bits, so it round-trips exactly
+    std::ostringstream os;
+    os << std::bit_cast<uint32_t>(carried) << ' ' << rng;
+    return os.str();
+}
+
+void ParticleEmitter::RestoreState(const std::string &state)
+{
+    std::istringstream is(state);
+    uint32_t carriedBits = 0;
+    is >> carriedBits >> rng;
+    if (!is)
+    {
+        throw std::runtime_error("Bad emitter state");
+    }
+    carried = std::bit_cast<float>(carriedBits);
+}
@@ -0,0 +1,838 @@
+#include "pch.h"
+
+#include "framework/Scene.h"
+#include "framework/CounterRng.h"
+#include "framework/ParallelFor.h"
+
+#include <cfloat>
+#include <charconv>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string_view>
+
+namespace
+{
+std::string_view NextToken(std::string_view &line)
+{
+    const size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos)
+    {
+        line = {};
+        return {};
+    }
+    const size_t end = line.find_first_of(" \t\r", start);
+    std::string_view token = line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+    line = end == std::string_view::npos ? std::string_view() : line.substr(end);
+    return token;
+}
+
+// the keys of one item with their values; keys has the number of values per allowed key
+class ItemReader
+{
+public:
+    ItemReader(const std::filesystem::path &pathIn, size_t lineNumberIn, std::string_view keyword, std::string_view rest,
+               std::initializer_list<std::pair<std::string_view, int>> keys)
+        : path(pathIn), lineNumber(lineNumberIn)
+    {
+        for (std::string_view key = NextToken(rest); !key.empty(); key = NextToken(rest))
+        {
+            auto allowed = std::find_if(keys.begin(), keys.end(), [&](const auto &k)
+                                        { return k.first == key; });
+            if (allowed == keys.end())
+            {
+                Fail("unknown key '" + std::string(key) + "' for " + std::string(keyword));
+            }
+            std::vector<std::string_view> &values = entries[key];
+            values.clear();
+            for (int i = 0; i < allowed->second; ++i)
+            {
+                const std::string_view value = NextToken(rest);
+                if (value.empty())
+                {
+                    Fail(std::string(key) + " needs " + std::to_string(allowed->second) + " value(s)");
+                }
+                values.push_back(value);
+            }
+        }
+    }
+
+    [[noreturn]] void Fail(const std::string &message) const
+    {
+        throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": " + message);
+    }
+
+    bool Has(std::string_view key) const { return entries.count(key) > 0; }
+
+    void Require(std::string_view key) const
+    {
+        if (!Has(key))
+        {
+            Fail("missing " + std::string(key));
+        }
+    }
+
+    float Number(std::string_view key, size_t index = 0) const
+    {
+        Require(key);
+        const std::string_view token = entries.at(key)[index];
+        float value = 0.0f;
+        auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+        if (ec != std::errc() || ptr != token.data() + token.size() || !std::isfinite(value))
+        {
+            Fail("bad number '" + std::string(token) + "'");
+        }
+        return value;
+    }
+
+    Vector3 Vector(std::string_view key, size_t first = 0) const
+    {
+        return Vector3(Number(key, first), Number(key, first + 1), Number(key, first + 2));
+    }
+
+    std::string_view Text(std::string_view key) const
+    {
+        Require(key);
+        return entries.at(key)[0];
+    }
+
+    // temperature lo hi into a range, if given
+    void TemperatureRange(std::string_view key, float &low, float &high) const
+    {
+        if (Has(key))
+        {
+            low = Number(key, 0);
+            high = Number(key, 1);
+            if (high < low)
+            {
+                Fail("temperature range is reversed");
+            }
+        }
+    }
+
+private:
+    const std::filesystem::path &path;
+    size_t lineNumber;
+    std::map<std::string_view, std::vector<std::string_view>, std::less<>> entries;
+};
+
+using MeshTriangleCorners = std::array<Vector3, 3>;
+
+struct LatticePoint
+{
+    int32_t i;     // lattice coordinate along x
+    uint32_t fill; // first fill containing the point
+};
+
+// Where the line through (y, z) along x crosses the triangle. Points on a shared edge belong
+// to exactly one of the two triangles (top-left rule), so closed meshes give even counts.
+bool RowCrossing(const MeshTriangleCorners &t, double y, double z, double &x)
+{
+    const Vector3 *a = &t[0];
+    const Vector3 *b = &t[1];
+    const Vector3 *c = &t[2];
+    double area = (double(b->y) - a->y) * (double(c->z) - a->z) - (double(b->z) - a->z) * (double(c->y) - a->y);
+    if (area == 0.0)
+    {
+        return false;
+    }
+    if (area < 0.0)
+    {
+        std::swap(b, c);
+        area = -area;
+    }
+    // weight of the corner opposite to the edge p0 -> p1
+    auto weight = [&](const Vector3 &p0, const Vector3 &p1, double &w)
+    {
+        const double dy = double(p1.y) - p0.y;
+        const double dz = double(p1.z) - p0.z;
+        w = dy * (z - p0.z) - dz * (y - p0.y);
+        return w > 0.0 || (w == 0.0 && (dz < 0.0 || (dz == 0.0 && dy > 0.0)));
+    };
+    double wa = 0.0, wb = 0.0, wc = 0.0;
+    if (!weight(*b, *c, wa) || !weight(*c, *a, wb) || !weight(*a, *b, wc))
+    {
+        return false;
+    }
+    x = (wa * a->x + wb * b->x + wc * c->x) / area;
+    return true;
+}
+
+void GetFillBounds(const Scene::Region &fill, Vector3 &boundsMin, Vector3 &boundsMax)
+{
+    switch (fill.shape)
+    {
+    case Scene::Shape::Sphere:
+        boundsMin = fill.center - Vector3(fill.radius);
+        boundsMax = fill.center + Vector3(fill.radius);
+        break;
+    case Scene::Shape::Mesh:
+        boundsMin = Vector3(FLT_MAX);
+        boundsMax = Vector3(-FLT_MAX);
+        for (const Vector3 &v : fill.mesh.vertices)
+        {
+            boundsMin = Vector3::Min(boundsMin, v);
+            boundsMax = Vector3::Max(boundsMax, v);
+        }
+        break;
+    default:
+        boundsMin = fill.boxMin;
+        boundsMax = fill.boxMax;
+        break;
+    }
+}
+
+void GetFillsBounds(const Scene &scene, Vector3 &boundsMin, Vector3 &boundsMax)
+{
+    boundsMin = Vector3(FLT_MAX);
+    boundsMax = Vector3(-FLT_MAX);
+    for (const Scene::Region &fill : scene.fills)
+    {
+        Vector3 fillMin, fillMax;
+        GetFillBounds(fill, fillMin, fillMax);
+        boundsMin = Vector3::Min(boundsMin, fillMin);
+        boundsMax = Vector3::Max(boundsMax, fillMax);
+    }
+}
+
+MeshTriangleCorners GetCorners(const TriangleMesh &mesh, size_t t)
+{
+    return {mesh.vertices[mesh.indices[3 * t]], mesh.vertices[mesh.indices[3 * t + 1]],
+            mesh.vertices[mesh.indices[3 * t + 2]]};
+}
+
+// The fills sampled on the lattice (i + 0.5) * spacing, one row along x per (j, k).
+class FillLattice
+{
+public:
+    FillLattice(const Scene &sceneIn, float spacingIn) : scene(sceneIn), spacing(spacingIn)
+    {
+        Vector3 boundsMin, boundsMax;
+        GetFillsBounds(scene, boundsMin, boundsMax);
+        if (scene.fills.empty() || !(spacing > 0.0f))
+        {
+            return;
+        }
+        first[0] = FirstIndex(boundsMin.y);
+        first[1] = FirstIndex(boundsMin.z);
+        const int64_t countY = int64_t(LastIndex(boundsMax.y)) - first[0] + 1;
+        const int64_t countZ = int64_t(LastIndex(boundsMax.z)) - first[1] + 1;
+        if (countY <= 0 || countZ <= 0)
+        {
+            return;
+        }
+        if (countY * countZ > UINT32_MAX)
+        {
+            throw std::runtime_error("Scene spacing " + std::to_string(spacing) + " gives too many lattice rows");
+        }
+        rowsY = static_cast<uint32_t>(countY);
+        rowCount = static_cast<uint32_t>(countY * countZ);
+
+        // mesh fills: the crossings of every row with the surface, sorted along x
+        meshCrossings.resize(scene.fills.size());
+        for (size_t f = 0; f < scene.fills.size(); ++f)
+        {
+            if (scene.fills[f].shape == Scene::Shape::Mesh)
+            {
+                CollectCrossings(scene.fills[f].mesh, meshCrossings[f]);
+            }
+        }
+    }
+
+    uint32_t GetRowCount() const { return rowCount; }
+
+    Vector3 GetPosition(int32_t i, uint32_t row) const
+    {
+        return Vector3((i + 0.5f) * spacing, (first[0] + int32_t(row % rowsY) + 0.5f) * spacing,
+                       (first[1] + int32_t(row / rowsY) + 0.5f) * spacing);
+    }
+
+    // lattice coordinates of a row, for the random numbers
+    void GetRowIndex(uint32_t row, int32_t &j, int32_t &k) const
+    {
+        j = first[0] + int32_t(row % rowsY);
+        k = first[1] + int32_t(row / rowsY);
+    }
+
+    // the points of a row, each with the first fill that contains it
+    void RowPoints(uint32_t row, std::vector<LatticePoint> &points) const
+    {
+        points.clear();
+        const Vector3 rowStart = GetPosition(0, row);
+        const double y = rowStart.y;
+        const double z = rowStart.z;
+        for (uint32_t f = 0; f < scene.fills.size(); ++f)
+        {
+            const Scene::Region &fill = scene.fills[f];
+            switch (fill.shape)
+            {
+            case Scene::Shape::Box:
+                if (y >= fill.boxMin.y && y <= fill.boxMax.y && z >= fill.boxMin.z && z <= fill.boxMax.z)
+                {
+                    AddInterval(fill.boxMin.x, fill.boxMax.x, f, points);
+                }
+                break;
+            case Scene::Shape::Sphere:
+            {
+                const double dy = y - fill.center.y;
+                const double dz = z - fill.center.z;
+                const double halfChord2 = double(fill.radius) * fill.radius - dy * dy - dz * dz;
+                if (halfChord2 >= 0.0)
+                {
+                    const double halfChord = std::sqrt(halfChord2);
+                    AddInterval(fill.center.x - halfChord, fill.center.x + halfChord, f, points);
+                }
+                break;
+            }
+            case Scene::Shape::Mesh:
+            {
+                // inside between the first and second crossing, the third and fourth, ...
+                const std::vector<float> &crossings = meshCrossings[f][row];
+                for (size_t c = 0; c + 1 < crossings.size(); c += 2)
+                {
+                    AddInterval(crossings[c], crossings[c + 1], f, points);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        // overlapping fills: the first one keeps the point
+        std::sort(points.begin(), points.end(), [](const LatticePoint &a, const LatticePoint &b)
+                  { return a.i != b.i ? a.i < b.i : a.fill < b.fill; });
+        points.erase(std::unique(points.begin(), points.end(), [](const LatticePoint &a, const LatticePoint &b)
+                                 { return a.i == b.i; }),
+                     points.end());
+    }
+
+private:
+    int32_t FirstIndex(double coordinate) const { return static_cast<int32_t>(std::ceil(coordinate / spacing - 0.5)); }
+    int32_t LastIndex(double coordinate) const { return static_cast<int32_t>(std::floor(coordinate / spacing - 0.5)); }
+
+    void AddInterval(double x0, double x1, uint32_t fill, std::vector<LatticePoint> &points) const
+    {
+        for (int32_t i = FirstIndex(x0), last = LastIndex(x1); i <= last; ++i)
+        {
+            points.push_back({i, fill});
+        }
+    }
+
+    void CollectCrossings(const TriangleMesh &mesh, std::vector<std::vector<float>> &rows) const
+    {
+        // triangles by the rows their yz bounds cover, then the rows in parallel
+        std::vector<std::vector<uint32_t>> rowTriangles(rowCount);
+        const size_t triangleCount = mesh.GetTriangleCount();
+        for (uint32_t t = 0; t < triangleCount; ++t)
+        {
+            const MeshTriangleCorners corners = GetCorners(mesh, t);
+            const float minY = std::min({corners[0].y, corners[1].y, corners[2].y});
+            const float maxY = std::max({corners[0].y, corners[1].y, corners[2].y});
+            const float minZ = std::min({corners[0].z, corners[1].z, corners[2].z});
+            const float maxZ = std::max({corners[0].z, corners[1].z, corners[2].z});
+            const int32_t j0 = std::max(FirstIndex(minY), first[0]);
+            const int32_t j1 = std::min(LastIndex(maxY), first[0] + int32_t(rowsY) - 1);
+            const int32_t k0 = std::max(FirstIndex(minZ), first[1]);
+            const int32_t k1 = std::min(LastIndex(maxZ), first[1] + int32_t(rowCount / rowsY) - 1);
+            for (int32_t k = k0; k <= k1; ++k)
+            {
+                for (int32_t j = j0; j <= j1; ++j)
+                {
+                    rowTriangles[uint32_t(k - first[1]) * rowsY + uint32_t(j - first[0])].push_back(t);
+                }
+            }
+        }
+
+        rows.assign(rowCount, {});
+        ParallelFor(0, rowCount, [&](uint32_t row)
+                    {
+            const Vector3 rowStart = GetPosition(0, row);
+            for (uint32_t t : rowTriangles[row])
+            {
+                double x = 0.0;
+                if (RowCrossing(GetCorners(mesh, t), rowStart.y, rowStart.z, x))
+                {
+                    rows[row].push_back(static_cast<float>(x));
+                }
+            }
+            std::sort(rows[row].begin(), rows[row].end()); }, 64);
+    }
+
+    const Scene &scene;
+    float spacing;
+    int32_t first[2] = {0, 0}; // lattice coordinates of the first row along y and z
+    uint32_t rowsY = 0;
+    uint32_t rowCount = 0;
+    std::vector<std::vector<std::vector<float>>> meshCrossings; // by fill, then row
+};
+
+uint64_t CountPoints(const Scene &scene, float spacing)
+{
+    const FillLattice lattice(scene, spacing);
+    std::vector<uint32_t> counts(lattice.GetRowCount());
+    ParallelFor(0, lattice.GetRowCount(), [&](uint32_t row)
+                {
+        thread_local std::vector<LatticePoint> points;
+        lattice.RowPoints(row, points);
+        counts[row] = static_cast<uint32_t>(points.size()); }, 64);
+    return std::accumulate(counts.begin(), counts.end(), uint64_t(0));
+}
+
+bool Contains(const Scene::Region &region, const Vector3 &p)
+{
+    switch (region.shape)
+    {
+    case Scene::Shape::All:
+        return true;
+    case Scene::Shape::Above:
+        return p.y >= region.boxMin.y;
+    case Scene::Shape::Below:
+        return p.y < region.boxMin.y;
+    case Scene::Shape::Box:
+        return p.x >= region.boxMin.x && p.y >= region.boxMin.y && p.z >= region.boxMin.z && p.x <= region.boxMax.x &&
+               p.y <= region.boxMax.y && p.z <= region.boxMax.z;
+    case Scene::Shape::Sphere:
+        return Vector3::DistanceSquared(p, region.center) <= region.radius * region.radius;
+    default:
+        return false;
+    }
+}
+
+// The first fill containing an arbitrary point. Mesh fills count the crossings of the ray
+// along +x, through the triangles binned by their yz bounds; an odd count is inside.
+class FillTest
+{
+public:
+    FillTest(const Scene &sceneIn, float binSizeIn) : scene(sceneIn), binSize(binSizeIn)
+    {
+        meshBins.resize(scene.fills.size());
+        for (size_t f = 0; f < scene.fills.size(); ++f)
+        {
+            if (scene.fills[f].shape != Scene::Shape::Mesh)
+            {
+                continue;
+            }
+            const TriangleMesh &mesh = scene.fills[f].mesh;
+            Vector3 boundsMin, boundsMax;
+            GetFillBounds(scene.fills[f], boundsMin, boundsMax);
+            MeshBins &bins = meshBins[f];
+            bins.first[0] = Bin(boundsMin.y);
+            bins.first[1] = Bin(boundsMin.z);
+            bins.count[0] = Bin(boundsMax.y) - bins.first[0] + 1;
+            bins.count[1] = Bin(boundsMax.z) - bins.first[1] + 1;
+            bins.triangles.resize(size_t(bins.count[0]) * bins.count[1]);
+            for (uint32_t t = 0; t < mesh.GetTriangleCount(); ++t)
+            {
+                const MeshTriangleCorners corners = GetCorners(mesh, t);
+                const int32_t j0 = Bin(std::min({corners[0].y, corners[1].y, corners[2].y})) - bins.first[0];
+                const int32_t j1 = Bin(std::max({corners[0].y, corners[1].y, corners[2].y})) - bins.first[0];
+                const int32_t k0 = Bin(std::min({corners[0].z, corners[1].z, corners[2].z})) - bins.first[1];
+                const int32_t k1 = Bin(std::max({corners[0].z, corners[1].z, corners[2].z})) - bins.first[1];
+                for (int32_t k = k0; k <= k1; ++k)
+                {
+                    for (int32_t j = j0; j <= j1; ++j)
+                    {
+                        bins.triangles[size_t(k) * bins.count[0] + j].push_back(t);
+                    }
+                }
+            }
+        }
+    }
+
+    // UINT32_MAX when no fill contains p
+    uint32_t Find(const Vector3 &p) const
+    {
+        for (uint32_t f = 0; f < scene.fills.size(); ++f)
+        {
+            const Scene::Region &fill = scene.fills[f];
+            if (fill.shape == Scene::Shape::Mesh ? InsideMesh(f, p) : Contains(fill, p))
+            {
+                return f;
+            }
+        }
+        return UINT32_MAX;
+    }
+
+private:
+    struct MeshBins
+    {
+        int32_t first[2] = {0, 0}; // bin coordinates along y and z
+        int32_t count[2] = {0, 0};
+        std::vector<std::vector<uint32_t>> triangles;
+    };
+
+    int32_t Bin(float coordinate) const { return static_cast<int32_t>(std::floor(coordinate / binSize)); }
+
+    bool InsideMesh(uint32_t f, const Vector3 &p) const
+    {
+        const MeshBins &bins = meshBins[f];
+        const int32_t j = Bin(p.y) - bins.first[0];
+        const int32_t k = Bin(p.z) - bins.first[1];
+        if (j < 0 || k < 0 || j >= bins.count[0] || k >= bins.count[1])
+        {
+            return false;
+        }
+        bool inside = false;
+        for (uint32_t t : bins.triangles[size_t(k) * bins.count[0] + j])
+        {
+            double x = 0.0;
+            if (RowCrossing(GetCorners(scene.fills[f].mesh, t), p.y, p.z, x) && x > p.x)
+            {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    const Scene &scene;
+    float binSize;
+    std::vector<MeshBins> meshBins; // by fill, empty for other shapes
+};
+
+// temperature range of a particle of the fill at p, later temperature fields win
+const Scene::Region &GetTemperatureRange(const Scene &scene, uint32_t fill, const Vector3 &p)
+{
+    const Scene::Region *range = &scene.fills[fill];
+    for (const Scene::Region &field : scene.temperatureFields)
+    {
+        range = Contains(field, p) ? &field : range;
+    }
+    return *range;
+}
+} // namespace
+
+Scene Scene::Load(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot open " + path.string());
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+    const std::filesystem::path directory = path.parent_path();
+
+    Scene scene;
+    size_t lineNumber = 0;
+    size_t lineStart = 0;
+    while (lineStart < text.size())
+    {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+        {
+            lineEnd = text.size();
+        }
+        std::string_view line(text.data() + lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+
+        const std::string_view keyword = NextToken(line);
+        auto read = [&](std::initializer_list<std::pair<std::string_view, int>> keys)
+        { return ItemReader(path, lineNumber, keyword, line, keys); };
+        auto loadMesh = [&](const ItemReader &item)
+        {
+            TriangleMesh mesh;
+            mesh.Append(TriangleMesh::LoadObj(directory / item.Text("path")), item.Has("scale") ? item.Number("scale") : 1.0f,
+                        item.Has("offset") ? item.Vector("offset") : Vector3::Zero);
+            return mesh;
+        };
+
+        if (keyword.empty())
+        {
+            continue;
+        }
+        else if (keyword == "spacing" || keyword == "particles" || keyword == "jitter" || keyword == "seed")
+        {
+            const std::string_view token = NextToken(line);
+            double value = 0.0;
+            auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (token.empty() || ec != std::errc() || !(value >= 0.0) || !NextToken(line).empty())
+            {
+                throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": " + std::string(keyword) +
+                                         " needs one non-negative number");
+            }
+            if (keyword == "spacing")
+            {
+                scene.spacing = static_cast<float>(value);
+            }
+            else if (keyword == "particles")
+            {
+                scene.particleCount = static_cast<uint32_t>(std::min(value, double(UINT32_MAX)));
+            }
+            else if (keyword == "jitter")
+            {
+                scene.jitter = static_cast<float>(std::min(value, 1.0));
+            }
+            else
+            {
+                scene.seed = static_cast<uint64_t>(value);
+            }
+        }
+        else if (keyword == "sampler")
+        {
+            const std::string_view name = NextToken(line);
+            if ((name != "lattice" && name != "relaxed") || !NextToken(line).empty())
+            {
+                throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) +
+                                         ": sampler needs lattice or relaxed");
+            }
+            scene.sampler = name == "relaxed" ? Sampler::Relaxed : Sampler::Lattice;
+        }
+        else if (keyword == "block" || keyword == "sphere" || keyword == "mesh")
+        {
+            const ItemReader item = read({{"min", 3}, {"max", 3}, {"center", 3}, {"radius", 1}, {"path", 1},
+                                          {"scale", 1}, {"offset", 3}, {"temperature", 2}});
+            Region fill;
+            if (keyword == "block")
+            {
+                fill.shape = Shape::Box;
+                fill.boxMin = item.Vector("min");
+                fill.boxMax = item.Vector("max");
+            }
+            else if (keyword == "sphere")
+            {
+                fill.shape = Shape::Sphere;
+                fill.center = item.Vector("center");
+                fill.radius = item.Number("radius");
+            }
+            else
+            {
+                fill.shape = Shape::Mesh;
+                fill.mesh = loadMesh(item);
+            }
+            item.TemperatureRange("temperature", fill.temperatureMin, fill.temperatureMax);
+            scene.fills.push_back(std::move(fill));
+        }
+        else if (keyword == "temperature")
+        {
+            const ItemReader item =
+                read({{"all", 0}, {"above", 1}, {"below", 1}, {"box", 6}, {"sphere", 4}, {"range", 2}});
+            Region field;
+            const int regions = item.Has("all") + item.Has("above") + item.Has("below") + item.Has("box") + item.Has("sphere");
+            if (regions != 1)
+            {
+                item.Fail("temperature needs one of all, above, below, box, sphere");
+            }
+            if (item.Has("above") || item.Has("below"))
+            {
+                field.shape = item.Has("above") ? Shape::Above : Shape::Below;
+                field.boxMin.y = item.Number(item.Has("above") ? "above" : "below");
+            }
+            else if (item.Has("box"))
+            {
+                field.shape = Shape::Box;
+                field.boxMin = item.Vector("box");
+                field.boxMax = item.Vector("box", 3);
+            }
+            else if (item.Has("sphere"))
+            {
+                field.shape = Shape::Sphere;
+                field.center = item.Vector("sphere");
+                field.radius = item.Number("sphere", 3);
+            }
+            item.Require("range");
+            item.TemperatureRange("range", field.temperatureMin, field.temperatureMax);
+            scene.temperatureFields.push_back(field);
+        }
+        else if (keyword == "emitter")
+        {
+            const ItemReader item = read({{"position", 3}, {"direction", 3}, {"radius", 1}, {"speed", 1},
+                                          {"rate", 1}, {"temperature", 2}});
+            ParticleEmitter::Settings emitter;
+            emitter.position = item.Vector("position");
+            emitter.direction = item.Has("direction") ? item.Vector("direction") : emitter.direction;
+            emitter.radius = item.Has("radius") ? item.Number("radius") : emitter.radius;
+            emitter.speed = item.Has("speed") ? item.Number("speed") : emitter.speed;
+            emitter.rate = item.Has("rate") ? item.Number("rate") : emitter.rate;
+            item.TemperatureRange("temperature", emitter.temperatureMin, emitter.temperatureMax);
+            scene.emitters.push_back(emitter);
+        }
+        else if (keyword == "obstacle-box" || keyword == "obstacle-sphere" || keyword == "obstacle-mesh")
+        {
+            const ItemReader item =
+                read({{"min", 3}, {"max", 3}, {"center", 3}, {"radius", 1}, {"path", 1}, {"scale", 1}, {"offset", 3}});
+            Obstacle obstacle;
+            if (keyword == "obstacle-box")
+            {
+                obstacle.shape = Shape::Box;
+                obstacle.boxMin = item.Vector("min");
+                obstacle.boxMax = item.Vector("max");
+            }
+            else if (keyword == "obstacle-sphere")
+            {
+                obstacle.shape = Shape::Sphere;
+                obstacle.center = item.Vector("center");
+                obstacle.radius = item.Number("radius");
+            }
+            else
+            {
+                obstacle.shape = Shape::Mesh;
+                obstacle.path = directory / item.Text("path");
+                obstacle.scale = item.Has("scale") ? item.Number("scale") : 1.0f;
+                obstacle.offset = item.Has("offset") ? item.Vector("offset") : Vector3::Zero;
+            }
+            scene.obstacles.push_back(obstacle);
+        }
+        else if (keyword == "kill-plane" || keyword == "kill-box")
+        {
+            const ItemReader item = read({{"point", 3}, {"normal", 3}, {"min", 3}, {"max", 3}});
+            KillVolume kill;
+            kill.plane = keyword == "kill-plane";
+            kill.a = item.Vector(kill.plane ? "point" : "min");
+            kill.b = item.Vector(kill.plane ? "normal" : "max");
+            scene.killVolumes.push_back(kill);
+        }
+        else
+        {
+            throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": unknown item '" +
+                                     std::string(keyword) + "'");
+        }
+    }
+    return scene;
+}
+
+float Scene::ResolveSpacing(float defaultSpacing) const
+{
+    if (spacing > 0.0f)
+    {
+        return spacing;
+    }
+    if (particleCount == 0 || fills.empty())
+    {
+        return defaultSpacing;
+    }
+    // the count scales with spacing^-3; two corrections from the default land close to the target
+    float resolved = defaultSpacing;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        const uint64_t count = CountPoints(*this, resolved);
+        if (count == 0)
+        {
+            break;
+        }
+        resolved *= static_cast<float>(std::cbrt(double(count) / particleCount));
+    }
+    return resolved;
+}
+
+void Scene::Generate(float latticeSpacing, std::vector<Vector3> &positions, std::vector<float> &temperatures) const
+{
+    const FillLattice lattice(*this, latticeSpacing);
+    const uint32_t rowCount = lattice.GetRowCount();
+
+    // count per row, then every row writes at its prefix sum
+    std::vector<uint64_t> offsets(size_t(rowCount) + 1, 0);
+    ParallelFor(0, rowCount, [&](uint32_t row)
+                {
+        thread_local std::vector<LatticePoint> points;
+        lattice.RowPoints(row, points);
+        offsets[row + 1] = points.size(); }, 64);
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    if (offsets.back() > UINT32_MAX)
+    {
+        throw std::runtime_error("Scene has more than 2^32 particles at spacing " + std::to_string(latticeSpacing));
+    }
+
+    positions.resize(offsets.back());
+    temperatures.resize(offsets.back());
+    const CounterRng rng(seed);
+    ParallelFor(0, rowCount, [&](uint32_t row)
+                {
+        thread_local std::vector<LatticePoint> points;
+        lattice.RowPoints(row, points);
+        int32_t j = 0, k = 0;
+        lattice.GetRowIndex(row, j, k);
+        for (size_t n = 0; n < points.size(); ++n)
+        {
+            const LatticePoint &point = points[n];
+            // the lattice coordinates are the counter, independent of threads and fill order
+            const std::array<uint32_t, 4> random = rng.Generate(uint32_t(point.i), uint32_t(j), uint32_t(k), 0);
+            Vector3 p = lattice.GetPosition(point.i, row);
+            p.x += (CounterRng::ToUnit(random[0]) - 0.5f) * jitter * latticeSpacing;
+            p.y += (CounterRng::ToUnit(random[1]) - 0.5f) * jitter * latticeSpacing;
+            p.z += (CounterRng::ToUnit(random[2]) - 0.5f) * jitter * latticeSpacing;
+
+            const Region &range = GetTemperatureRange(*this, point.fill, p);
+            const float u = CounterRng::ToUnit(random[3]);
+            positions[offsets[row] + n] = p;
+            temperatures[offsets[row] + n] = range.temperatureMin + u * (range.temperatureMax - range.temperatureMin);
+        } }, 64);
+}
+
+void Scene::Generate(const SettledBlock &block, std::vector<Vector3> &positions, std::vector<float> &temperatures) const
+{
+    positions.clear();
+    temperatures.clear();
+    if (fills.empty() || block.points.empty())
+    {
+        return;
+    }
+    // tiles of the block over the bounds of the fills, each tile in parallel
+    Vector3 boundsMin, boundsMax;
+    GetFillsBounds(*this, boundsMin, boundsMax);
+    int32_t first[3];
+    uint64_t count[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        first[axis] = static_cast<int32_t>(std::floor((&boundsMin.x)[axis] / block.size));
+        count[axis] = static_cast<int64_t>(std::floor((&boundsMax.x)[axis] / block.size)) - first[axis] + 1;
+    }
+    if (count[0] * count[1] * count[2] > UINT32_MAX)
+    {
+        throw std::runtime_error("Scene fills span too many settled blocks");
+    }
+    const uint32_t tileCount = static_cast<uint32_t>(count[0] * count[1] * count[2]);
+    auto tileIndex = [&](uint32_t tile, int32_t index[3])
+    {
+        index[0] = first[0] + int32_t(tile % count[0]);
+        index[1] = first[1] + int32_t((tile / count[0]) % count[1]);
+        index[2] = first[2] + int32_t(tile / (count[0] * count[1]));
+    };
+    const uint32_t blockCount = static_cast<uint32_t>(block.points.size());
+    const FillTest test(*this, block.size / std::cbrt(float(blockCount)));
+
+    // the fill of every block point per tile, then every tile writes at its prefix sum
+    std::vector<uint64_t> offsets(size_t(tileCount) + 1, 0);
+    ParallelFor(0, tileCount, [&](uint32_t tile)
+                {
+        int32_t index[3];
+        tileIndex(tile, index);
+        const Vector3 origin = Vector3(float(index[0]), float(index[1]), float(index[2])) * block.size;
+        uint64_t inside = 0;
+        for (const Vector3 &q : block.points)
+        {
+            inside += test.Find(origin + q) != UINT32_MAX ? 1 : 0;
+        }
+        offsets[tile + 1] = inside; }, 1);
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    if (offsets.back() > UINT32_MAX)
+    {
+        throw std::runtime_error("Scene has more than 2^32 particles");
+    }
+
+    positions.resize(offsets.back());
+    temperatures.resize(offsets.back());
+    const CounterRng rng(seed);
+    ParallelFor(0, tileCount, [&](uint32_t tile)
+                {
+        int32_t index[3];
+        tileIndex(tile, index);
+        const Vector3 origin = Vector3(float(index[0]), float(index[1]), float(index[2])) * block.size;
+        uint64_t next = offsets[tile];
+        for (uint32_t n = 0; n < blockCount; ++n)
+        {
+            const Vector3 p = origin + block.points[n];
+            const uint32_t fill = test.Find(p);
+            if (fill == UINT32_MAX)
+            {
+                continue;
+            }
+            const Region &range = GetTemperatureRange(*this, fill, p);
+            const float u = CounterRng::ToUnit(rng.Generate(uint32_t(index[0]), uint32_t(index[1]), uint32_t(index[2]), n)[0]);
+            positions[next] = p;
+            temperatures[next] = range.temperatureMin + u * (range.temperatureMax - range.temperatureMin);
+            ++next;
+        } }, 1);
+}
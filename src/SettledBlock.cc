@@ -0,0 +1,483 @@
+#include "pch.h"
+
+#include "framework/SettledBlock.h"
+#include "framework/CounterRng.h"
+#include "framework/MappedFile.h"
+#include "framework/ParallelFor.h"
+
+#include <sstream>
+
+namespace
+{
+constexpr char k_cacheMagic[8] = {'S', 'E', 'T', 'T', 'L', 'E', 'D', 0};
+constexpr uint32_t k_cacheVersion = 1;
+constexpr int k_packIterations = 100;     // repulsion from the random start
+constexpr float k_packStep = 0.1f;        // of the mean spacing per iteration and neighbor
+constexpr int k_relaxRounds = 12;         // density constraints, then rescaling to rho0
+constexpr int k_relaxIterations = 10;     // per round
+constexpr float k_relaxFactor = 0.25f;    // of the Jacobi position correction, larger ones clump
+constexpr float k_relaxTolerance = 5e-3f; // max |rho / rho0 - 1| that ends the relaxation
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    SettledBlock::Key key;
+    uint32_t count;
+    float size;
+    float densityError;
+};
+
+// must match cubic_kernel_height and cubic_kernel_gradient in CommonKernels.hlsl
+float CubicKernel(float dist, float h)
+{
+    if (dist > h)
+        return 0.0f;
+    const float q = dist / h;
+    const float k = 8.0f / (3.14159265359f * h * h * h);
+    if (q <= 0.5f)
+        return k * (6.0f * q * q * q - 6.0f * q * q + 1.0f);
+    const float t = 1.0f - q;
+    return k * 2.0f * t * t * t;
+}
+
+Vector3 CubicGradient(const Vector3 &r, float dist, float h)
+{
+    if (dist > h || dist < 1e-6f)
+        return Vector3::Zero;
+    const float q = dist / h;
+    const float l = 48.0f / (3.14159265359f * h * h * h);
+    const float factor = q <= 0.5f ? l * q * (3.0f * q - 2.0f) : -l * (1.0f - q) * (1.0f - q);
+    return r * (factor / (dist * h));
+}
+
+// Points sorted by cells of at least the search radius, by counting sort. Periodic grids
+// wrap around and need 3 cells per axis, so that no cell is visited twice.
+class NeighborGrid
+{
+public:
+    NeighborGrid(const std::vector<Vector3> &pointsIn, float radius, float periodicSizeIn)
+        : points(pointsIn), periodicSize(periodicSizeIn)
+    {
+        const uint32_t count = static_cast<uint32_t>(points.size());
+        if (periodicSize > 0.0f)
+        {
+            const int cells = static_cast<int>(periodicSize / radius);
+            if (cells < 3)
+            {
+                throw std::runtime_error("Periodic block of " + std::to_string(periodicSize) + " is smaller than 3 kernel radii");
+            }
+            dims[0] = dims[1] = dims[2] = cells;
+            cellSize = periodicSize / cells;
+        }
+        else if (count > 0)
+        {
+            origin = points[0];
+            Vector3 boundsMax = points[0];
+            for (const Vector3 &p : points)
+            {
+                origin = Vector3::Min(origin, p);
+                boundsMax = Vector3::Max(boundsMax, p);
+            }
+            // sparse point sets get larger cells instead of mostly empty ones
+            const Vector3 extent = boundsMax - origin;
+            const double volume = double(extent.x + radius) * (extent.y + radius) * (extent.z + radius);
+            cellSize = std::max(radius, static_cast<float>(std::cbrt(volume / (4.0 * count))));
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                dims[axis] = static_cast<int>((&extent.x)[axis] / cellSize) + 1;
+            }
+        }
+
+        const size_t cellCount = size_t(dims[0]) * dims[1] * dims[2];
+        cellStart.assign(cellCount + 1, 0);
+        std::vector<uint32_t> cellOf(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            int c[3];
+            GetCell(points[i], c);
+            cellOf[i] = static_cast<uint32_t>((size_t(c[2]) * dims[1] + c[1]) * dims[0] + c[0]);
+            ++cellStart[cellOf[i] + 1];
+        }
+        std::partial_sum(cellStart.begin(), cellStart.end(), cellStart.begin());
+        order.resize(count);
+        std::vector<uint32_t> next(cellStart.begin(), cellStart.end() - 1);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            order[next[cellOf[i]]++] = i;
+        }
+    }
+
+    // fn(j, p - points[j]) for the points in the 27 cells around p, the nearest periodic image
+    template <typename Fn>
+    void ForEachNeighbor(const Vector3 &p, Fn &&fn) const
+    {
+        int c[3];
+        GetCell(p, c);
+        for (int dz = -1; dz <= 1; ++dz)
+        {
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    int n[3] = {c[0] + dx, c[1] + dy, c[2] + dz};
+                    bool inside = true;
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        if (periodicSize > 0.0f)
+                        {
+                            n[axis] = (n[axis] + dims[axis]) % dims[axis];
+                        }
+                        inside = inside && n[axis] >= 0 && n[axis] < dims[axis];
+                    }
+                    if (!inside)
+                    {
+                        continue;
+                    }
+                    const size_t cell = (size_t(n[2]) * dims[1] + n[1]) * dims[0] + n[0];
+                    for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; ++k)
+                    {
+                        const uint32_t j = order[k];
+                        Vector3 r = p - points[j];
+                        if (periodicSize > 0.0f)
+                        {
+                            r.x -= periodicSize * std::round(r.x / periodicSize);
+                            r.y -= periodicSize * std::round(r.y / periodicSize);
+                            r.z -= periodicSize * std::round(r.z / periodicSize);
+                        }
+                        fn(j, r);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    void GetCell(const Vector3 &p, int c[3]) const
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            c[axis] = std::clamp(static_cast<int>(std::floor(((&p.x)[axis] - (&origin.x)[axis]) / cellSize)), 0, dims[axis] - 1);
+        }
+    }
+
+    const std::vector<Vector3> &points;
+    float periodicSize;
+    Vector3 origin;
+    float cellSize = 1.0f;
+    int dims[3] = {1, 1, 1};
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> order;
+};
+
+float MeanDensity(const std::vector<Vector3> &points, float h, float mass, float size)
+{
+    std::vector<float> densities;
+    ComputeSphDensities(points, h, mass, densities, size);
+    return static_cast<float>(std::accumulate(densities.begin(), densities.end(), 0.0) / densities.size());
+}
+
+Vector3 Wrap(Vector3 p, float size)
+{
+    p.x -= size * std::floor(p.x / size);
+    p.y -= size * std::floor(p.y / size);
+    p.z -= size * std::floor(p.z / size);
+    // rounding can land exactly on size
+    return Vector3::Min(p, Vector3(std::nextafter(size, 0.0f)));
+}
+
+// One Jacobi iteration of repulsion within radius, falling off as (1 - r / radius)^2. Unlike
+// the kernel gradient it does not vanish for close pairs, so points spread evenly instead of
+// clumping.
+void PackStep(std::vector<Vector3> &points, float size, float radius, float step)
+{
+    const uint32_t count = static_cast<uint32_t>(points.size());
+    const NeighborGrid grid(points, radius, size);
+    std::vector<Vector3> moved(count);
+    ParallelFor(0, count, [&](uint32_t i)
+                {
+        Vector3 push = Vector3::Zero;
+        grid.ForEachNeighbor(points[i], [&](uint32_t j, const Vector3 &r)
+                             {
+            const float dist = r.Length();
+            if (j != i && dist < radius && dist > 0.0f)
+            {
+                const float t = 1.0f - dist / radius;
+                push += r * (t * t / dist);
+            } });
+        moved[i] = Wrap(points[i] + push * step, size); }, 256);
+    points.swap(moved);
+}
+
+// one Jacobi iteration of position based density constraints towards the mean density
+void RelaxStep(std::vector<Vector3> &points, float size, float h, float mass)
+{
+    const uint32_t count = static_cast<uint32_t>(points.size());
+    std::vector<float> densities;
+    ComputeSphDensities(points, h, mass, densities, size);
+    const float target = static_cast<float>(std::accumulate(densities.begin(), densities.end(), 0.0) / count);
+    const float volume = mass / target;
+
+    const NeighborGrid grid(points, h, size);
+    std::vector<float> lambdas(count);
+    ParallelFor(0, count, [&](uint32_t i)
+                {
+        Vector3 gradient = Vector3::Zero;
+        float gradientSum = 0.0f;
+        grid.ForEachNeighbor(points[i], [&](uint32_t j, const Vector3 &r)
+                             {
+            if (j != i)
+            {
+                const Vector3 g = CubicGradient(r, r.Length(), h) * volume;
+                gradient += g;
+                gradientSum += g.LengthSquared();
+            } });
+        lambdas[i] = -(densities[i] / target - 1.0f) / (gradient.LengthSquared() + gradientSum + 1e-6f); }, 256);
+
+    std::vector<Vector3> moved(count);
+    ParallelFor(0, count, [&](uint32_t i)
+                {
+        Vector3 delta = Vector3::Zero;
+        grid.ForEachNeighbor(points[i], [&](uint32_t j, const Vector3 &r)
+                             {
+            if (j != i)
+            {
+                delta += CubicGradient(r, r.Length(), h) * ((lambdas[i] + lambdas[j]) * volume);
+            } });
+        moved[i] = Wrap(points[i] + delta * k_relaxFactor, size); }, 256);
+    points.swap(moved);
+}
+
+// scales the block until its mean density is rho0; the density falls as the block grows
+void ScaleToRestDensity(SettledBlock &block)
+{
+    const SettledBlock::Key &key = block.key;
+    std::vector<Vector3> scaled(block.points.size());
+    auto densityAt = [&](float factor)
+    {
+        for (size_t i = 0; i < scaled.size(); ++i)
+        {
+            scaled[i] = block.points[i] * factor;
+        }
+        return MeanDensity(scaled, key.h, key.mass, block.size * factor);
+    };
+    float low = 0.8f;
+    float high = 1.25f;
+    while (densityAt(low) < key.rho0 && low > 0.1f)
+    {
+        low *= 0.8f;
+    }
+    while (densityAt(high) > key.rho0 && high < 10.0f)
+    {
+        high *= 1.25f;
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        const float mid = 0.5f * (low + high);
+        (densityAt(mid) > key.rho0 ? low : high) = mid;
+    }
+    const float factor = 0.5f * (low + high);
+    for (Vector3 &p : block.points)
+    {
+        p = p * factor;
+    }
+    block.size *= factor;
+}
+
+std::filesystem::path GetCachePath(const std::filesystem::path &directory, const SettledBlock::Key &key)
+{
+    // exact float bits, nearby parameters get their own block
+    auto bits = [](float value)
+    {
+        uint32_t b = 0;
+        memcpy(&b, &value, sizeof(b));
+        return b;
+    };
+    std::ostringstream name;
+    name << "settled_" << std::hex << bits(key.h) << "_" << bits(key.mass) << "_" << bits(key.rho0) << std::dec << "_"
+         << key.perAxis << "_" << key.seed << ".block";
+    return directory / name.str();
+}
+} // namespace
+
+void ComputeSphDensities(const std::vector<Vector3> &points, float h, float mass, std::vector<float> &densities,
+                         float periodicSize)
+{
+    const uint32_t count = static_cast<uint32_t>(points.size());
+    densities.resize(count);
+    const NeighborGrid grid(points, h, periodicSize);
+    const float h2 = h * h;
+    ParallelFor(0, count, [&](uint32_t i)
+                {
+        float rho = 0.0f;
+        grid.ForEachNeighbor(points[i], [&](uint32_t, const Vector3 &r)
+                             {
+            const float dist2 = r.LengthSquared();
+            if (dist2 < h2)
+            {
+                rho += mass * CubicKernel(std::sqrt(dist2), h);
+            } });
+        densities[i] = rho; }, 256);
+}
+
+float GetLatticeRestSpacing(float h, float mass, float rho0)
+{
+    if (mass * CubicKernel(0.0f, h) >= rho0)
+    {
+        return 0.0f;
+    }
+    auto latticeDensity = [&](double spacing)
+    {
+        const int reach = static_cast<int>(h / spacing);
+        double rho = 0.0;
+        for (int z = -reach; z <= reach; ++z)
+        {
+            for (int y = -reach; y <= reach; ++y)
+            {
+                for (int x = -reach; x <= reach; ++x)
+                {
+                    rho += mass * CubicKernel(static_cast<float>(spacing * std::sqrt(double(x * x + y * y + z * z))), h);
+                }
+            }
+        }
+        return rho;
+    };
+    // at a spacing of h only the particle itself counts, which is below rho0
+    double low = 0.5 * h;
+    double high = h;
+    while (latticeDensity(low) < rho0 && low > 1e-3 * h)
+    {
+        high = low;
+        low *= 0.5;
+    }
+    for (int i = 0; i < 40; ++i)
+    {
+        const double mid = 0.5 * (low + high);
+        (latticeDensity(mid) > rho0 ? low : high) = mid;
+    }
+    return static_cast<float>(0.5 * (low + high));
+}
+
+SettledBlock SettledBlock::Relax(const Key &key)
+{
+    const float spacing = GetLatticeRestSpacing(key.h, key.mass, key.rho0);
+    if (spacing == 0.0f)
+    {
+        throw std::runtime_error("A particle of mass " + std::to_string(key.mass) + " alone is denser than rho0 = " +
+                                 std::to_string(key.rho0) + " at h = " + std::to_string(key.h));
+    }
+
+    SettledBlock block;
+    block.key = key;
+    block.size = key.perAxis * spacing;
+    // stratified random start, spread into blue noise instead of back onto the lattice
+    const CounterRng rng(key.seed);
+    const uint32_t count = key.perAxis * key.perAxis * key.perAxis;
+    block.points.resize(count);
+    ParallelFor(0, count, [&](uint32_t i)
+                {
+        const uint32_t x = i % key.perAxis;
+        const uint32_t y = (i / key.perAxis) % key.perAxis;
+        const uint32_t z = i / (key.perAxis * key.perAxis);
+        const std::array<uint32_t, 4> random = rng.Generate(x, y, z, 0);
+        block.points[i] = Vector3(x + CounterRng::ToUnit(random[0]), y + CounterRng::ToUnit(random[1]),
+                                  z + CounterRng::ToUnit(random[2])) * spacing; });
+
+    // even spreading first, then density constraints measured with the simulation's kernel;
+    // these can clump particles when neighbors are many, so the best round is kept
+    const float meanSpacing = block.size / key.perAxis;
+    for (int i = 0; i < k_packIterations; ++i)
+    {
+        PackStep(block.points, block.size, 2.0f * meanSpacing, k_packStep * meanSpacing);
+    }
+    block.iterations = k_packIterations;
+    ScaleToRestDensity(block);
+
+    std::vector<float> densities;
+    auto maxError = [&](const SettledBlock &candidate)
+    {
+        ComputeSphDensities(candidate.points, key.h, key.mass, densities, candidate.size);
+        float error = 0.0f;
+        for (float rho : densities)
+        {
+            error = std::max(error, std::abs(rho / key.rho0 - 1.0f));
+        }
+        return error;
+    };
+    block.densityError = maxError(block);
+    SettledBlock candidate = block;
+    for (int round = 0; round < k_relaxRounds && block.densityError >= k_relaxTolerance; ++round)
+    {
+        for (int i = 0; i < k_relaxIterations; ++i)
+        {
+            RelaxStep(candidate.points, candidate.size, key.h, key.mass);
+        }
+        candidate.iterations += k_relaxIterations;
+        ScaleToRestDensity(candidate);
+        candidate.densityError = maxError(candidate);
+        if (candidate.densityError >= block.densityError)
+        {
+            break;
+        }
+        block = candidate;
+    }
+    return block;
+}
+
+SettledBlock SettledBlock::Load(Key key, const std::filesystem::path &cacheDirectory)
+{
+    const float spacing = GetLatticeRestSpacing(key.h, key.mass, key.rho0);
+    if (spacing > 0.0f)
+    {
+        key.perAxis = std::max({key.perAxis, 8u, static_cast<uint32_t>(std::ceil(3.5f * key.h / spacing))});
+    }
+    if (cacheDirectory.empty())
+    {
+        return Relax(key);
+    }
+
+    const std::filesystem::path path = GetCachePath(cacheDirectory, key);
+    if (std::filesystem::exists(path))
+    {
+        MappedFile file = MappedFile::Open(path);
+        CacheHeader header = {};
+        if (file.bytes >= sizeof(header))
+        {
+            memcpy(&header, file.GetData(), sizeof(header));
+        }
+        const bool current = memcmp(header.magic, k_cacheMagic, sizeof(k_cacheMagic)) == 0 &&
+                             header.version == k_cacheVersion && memcmp(&header.key, &key, sizeof(key)) == 0 &&
+                             file.bytes == sizeof(header) + uint64_t(header.count) * sizeof(Vector3);
+        if (current)
+        {
+            SettledBlock block;
+            block.key = key;
+            block.size = header.size;
+            block.densityError = header.densityError;
+            block.points.resize(header.count);
+            memcpy(block.points.data(), file.GetData() + sizeof(header), header.count * sizeof(Vector3));
+            block.cached = true;
+            return block;
+        }
+    }
+
+    SettledBlock block = Relax(key);
+    CacheHeader header = {};
+    memcpy(header.magic, k_cacheMagic, sizeof(k_cacheMagic));
+    header.version = k_cacheVersion;
+    header.key = key;
+    header.count = static_cast<uint32_t>(block.points.size());
+    header.size = block.size;
+    header.densityError = block.densityError;
+
+    std::filesystem::create_directories(cacheDirectory);
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        MappedFile file = MappedFile::Open(tempPath, sizeof(header) + block.points.size() * sizeof(Vector3));
+        memcpy(file.GetData(), &header, sizeof(header));
+        memcpy(file.GetData() + sizeof(header), block.points.data(), block.points.size() * sizeof(Vector3));
+    }
+    std::filesystem::rename(tempPath, path);
+    return block;
+}
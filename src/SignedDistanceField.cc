@@ -0,0 +1,158 @@
+#include "pch.h"
+
+#include "framework/SignedDistanceField.h"
+#include "framework/ParallelFor.h"
+
+namespace
+{
+constexpr float k_far = 1e30f;
+constexpr int k_sweepRounds = 2; // of 8 sweep directions each
+
+// upwind solution of |grad d| = 1 from the smaller neighbor of each axis
+float SolveEikonal(float a, float b, float c, float spacing)
+{
+    if (a > b)
+        std::swap(a, b);
+    if (b > c)
+        std::swap(b, c);
+    if (a > b)
+        std::swap(a, b);
+
+    float d = a + spacing;
+    if (d > b)
+    {
+        d = 0.5f * (a + b + std::sqrt(std::max(2.0f * spacing * spacing - (a - b) * (a - b), 0.0f)));
+        if (d > c)
+        {
+            const float s = a + b + c;
+            d = (s + std::sqrt(std::max(s * s - 3.0f * (a * a + b * b + c * c - spacing * spacing), 0.0f))) / 3.0f;
+        }
+    }
+    return d;
+}
+}
+
+SignedDistanceField SignedDistanceField::Voxelize(
+    const Vector3 &boundsMin,
+    const Vector3 &boundsMax,
+    float spacing,
+    const std::function<bool(const Vector3 &)> &inside,
+    uint32_t padding)
+{
+    SignedDistanceField sdf;
+    sdf.spacing = spacing;
+    sdf.origin = boundsMin - Vector3(static_cast<float>(padding) * spacing);
+
+    const float extent[3] = {boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z};
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        sdf.dims[axis] = static_cast<uint32_t>(std::ceil(std::max(extent[axis], 0.0f) / spacing)) + 1 + 2 * padding;
+    }
+
+    const uint32_t nx = sdf.dims[0];
+    const uint32_t ny = sdf.dims[1];
+    const uint32_t nz = sdf.dims[2];
+    const size_t strideY = nx;
+    const size_t strideZ = size_t(nx) * ny;
+    const size_t count = sdf.GetSampleCount();
+
+    std::vector<uint8_t> occupied(count);
+    ParallelFor(0, nz, [&](uint32_t z)
+                {
+        for (uint32_t y = 0; y < ny; ++y)
+        {
+            for (uint32_t x = 0; x < nx; ++x)
+            {
+                occupied[sdf.GetIndex(x, y, z)] = inside(sdf.GetPosition(x, y, z)) ? 1 : 0;
+            }
+        } }, 1);
+
+    // the surface lies between two samples of different occupancy, half a spacing from each
+    std::vector<float> &d = sdf.samples;
+    d.assign(count, k_far);
+    std::vector<uint8_t> fixed(count);
+    ParallelFor(0, nz, [&](uint32_t z)
+                {
+        for (uint32_t y = 0; y < ny; ++y)
+        {
+            for (uint32_t x = 0; x < nx; ++x)
+            {
+                const size_t i = sdf.GetIndex(x, y, z);
+                const uint8_t o = occupied[i];
+                const bool surface = (x > 0 && occupied[i - 1] != o) || (x + 1 < nx && occupied[i + 1] != o) ||
+                                     (y > 0 && occupied[i - strideY] != o) || (y + 1 < ny && occupied[i + strideY] != o) ||
+                                     (z > 0 && occupied[i - strideZ] != o) || (z + 1 < nz && occupied[i + strideZ] != o);
+                if (surface)
+                {
+                    d[i] = 0.5f * spacing;
+                    fixed[i] = 1;
+                }
+            }
+        } }, 1);
+
+    // unsigned distance on both sides at once. A sample only reads its axis neighbors, which
+    // lie on the previous and the next diagonal of the sweep, so one diagonal runs in parallel.
+    for (int round = 0; round < k_sweepRounds; ++round)
+    {
+        for (int sweep = 0; sweep < 8; ++sweep)
+        {
+            const bool flipX = (sweep & 1) != 0;
+            const bool flipY = (sweep & 2) != 0;
+            const bool flipZ = (sweep & 4) != 0;
+
+            for (uint32_t diagonal = 0; diagonal + 2 < nx + ny + nz; ++diagonal)
+            {
+                const uint32_t xBegin = diagonal > ny + nz - 2 ? diagonal - (ny + nz - 2) : 0;
+                const uint32_t xEnd = std::min(diagonal, nx - 1) + 1;
+
+                ParallelFor(xBegin, xEnd, [&](uint32_t sx)
+                            {
+                    const uint32_t rest = diagonal - sx;
+                    const uint32_t yBegin = rest > nz - 1 ? rest - (nz - 1) : 0;
+                    const uint32_t yEnd = std::min(rest, ny - 1) + 1;
+                    for (uint32_t sy = yBegin; sy < yEnd; ++sy)
+                    {
+                        const uint32_t x = flipX ? nx - 1 - sx : sx;
+                        const uint32_t y = flipY ? ny - 1 - sy : sy;
+                        const uint32_t z = flipZ ? nz - 1 - (rest - sy) : rest - sy;
+                        const size_t i = sdf.GetIndex(x, y, z);
+                        if (fixed[i])
+                            continue;
+
+                        const float a = std::min(x > 0 ? d[i - 1] : k_far, x + 1 < nx ? d[i + 1] : k_far);
+                        const float b = std::min(y > 0 ? d[i - strideY] : k_far, y + 1 < ny ? d[i + strideY] : k_far);
+                        const float c = std::min(z > 0 ? d[i - strideZ] : k_far, z + 1 < nz ? d[i + strideZ] : k_far);
+                        if (std::min({a, b, c}) >= k_far)
+                            continue;
+
+                        d[i] = std::min(d[i], SolveEikonal(a, b, c, spacing));
+                    } }, 16);
+            }
+        }
+    }
+
+    ParallelFor(0, nz, [&](uint32_t z)
+                {
+        const size_t begin = z * strideZ;
+        for (size_t i = begin; i < begin + strideZ; ++i)
+        {
+            if (occupied[i])
+                d[i] = -d[i];
+        } }, 1);
+
+    return sdf;
+}
+
+SignedDistanceField SignedDistanceField::Box(const Vector3 &boxMin, const Vector3 &boxMax, float spacing)
+{
+    return Voxelize(boxMin, boxMax, spacing, [&](const Vector3 &p)
+                    { return p.x >= boxMin.x && p.x <= boxMax.x && p.y >= boxMin.y && p.y <= boxMax.y &&
+                             p.z >= boxMin.z && p.z <= boxMax.z; });
+}
+
+SignedDistanceField SignedDistanceField::Sphere(const Vector3 &center, float radius, float spacing)
+{
+    const Vector3 extent(radius);
+    return Voxelize(center - extent, center + extent, spacing, [&](const Vector3 &p)
+                    { return Vector3::DistanceSquared(p, center) <= radius * radius; });
+}
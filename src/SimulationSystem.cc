@@ -5,10 +5,63 @@
 #include "framework/ShaderCompiler.h"
 #include "framework/RenderSubsystem.h"
 #include "framework/UploadHelpers.h"
+#include "framework/ParallelFor.h"
 #include "GPUSorting/OneSweep.h"
 #include <random>
+#include <bit>
+
+namespace
+{
+// checkpoint chunks besides the per-particle ones
+constexpr std::string_view k_chunkParams = "PARAMS";
+constexpr std::string_view k_chunkRunState = "RUNSTATE";
+constexpr std::string_view k_chunkEmitters = "EMITTERS";
+constexpr std::string_view k_chunkPosition = "POSITION";
+constexpr std::string_view k_chunkTemperature = "TEMP";
+constexpr std::string_view k_chunkParticleId = "ID";
+
+struct CheckpointRunState
+{
+    uint64_t stepIndex;
+    double simulatedTime;
+    uint32_t nextParticleId;
+    float thermalAccumDt;
+    StepController::State stepState;
+};
+
+// per-particle chunks, in the order of GetCheckpointBuffers; numParticles elements each
+struct CheckpointAttribute
+{
+    std::string_view tag;
+    uint32_t stride;
+};
+constexpr CheckpointAttribute k_checkpointAttributes[] = {
+    {k_chunkPosition, sizeof(Vector3)},
+    {"VELOCITY", sizeof(Vector3)},
+    {k_chunkTemperature, sizeof(float)},
+    {k_chunkParticleId, sizeof(uint32_t)},
+    {"LEVEL", sizeof(int32_t)},
+    {"PHASE", sizeof(uint32_t)},
+    {"KAPPA", sizeof(float)},
+    {"KAPPAV", sizeof(float)},
+};
+}
 
 // Particle generation helpers
+std::vector<DirectX::SimpleMath::Vector3> SimulationSystem::GenerateScenePositions(InitialScene scene, UINT numParticles)
+{
+    switch (scene)
+    {
+    case InitialScene::UniformGrid:
+        return GenerateUniformGridPositions(numParticles);
+    case InitialScene::DenseRandom:
+        return GenerateDenseRandomPositions(numParticles);
+    case InitialScene::DenseBottomWithSphere:
+    default:
+        return GenerateDenseBottomWithSphere(numParticles);
+    }
+}
+
 std::vector<DirectX::SimpleMath::Vector3> SimulationSystem::GenerateUniformGridPositions(UINT numParticles)
 {
     std::vector<DirectX::SimpleMath::Vector3> out;
@@ -119,7 +172,63 @@ void SimulationSystem::GenerateTemperaturesForPositions(
 void SimulationSystem::Init(ID3D12Device *device)
 {
     auto alloc = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
-    InitSimulationBuffers(device, *alloc, m_maxParticlesCount, m_gridCellsCount);
+    if (m_restart)
+    {
+        // later SetInitialParticleCount calls do not change the restored set
+        m_initialParticleCount = m_simParams.numParticles;
+        m_maxParticleCapacity = std::max(m_maxParticleCapacity, m_initialParticleCount);
+    }
+    std::vector<DirectX::SimpleMath::Vector3> scenePositions;
+    std::vector<float> sceneTemps;
+    if (m_sceneSampler && !m_restart)
+    {
+        if (!m_scene)
+        {
+            m_scene = std::make_unique<Scene>(GetBuiltInScene());
+        }
+        m_scene->sampler = *m_sceneSampler;
+    }
+    if (m_scene && !m_scene->fills.empty() && !m_restart)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const float h = m_simParams.h;
+        const float mass = m_simParams.mass;
+        const float rho0 = m_simParams.rho0;
+        if (m_scene->sampler == Scene::Sampler::Relaxed)
+        {
+            try
+            {
+                const auto blockStart = std::chrono::steady_clock::now();
+                m_settledBlock = std::make_unique<SettledBlock>(SettledBlock::Load(
+                    {h, mass, rho0, k_settledBlockPerAxis, static_cast<uint32_t>(m_scene->seed)}, m_settledBlockCache));
+                m_settledBlockMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - blockStart).count();
+                m_sceneSpacing = m_settledBlock->size / std::cbrt(static_cast<float>(m_settledBlock->points.size()));
+                m_scene->Generate(*m_settledBlock, scenePositions, sceneTemps);
+            }
+            catch (const std::exception &e)
+            {
+                std::cout << "Relaxed sampler unavailable, using the lattice: " << e.what() << "\n";
+                m_scene->sampler = Scene::Sampler::Lattice;
+            }
+        }
+        if (m_scene->sampler == Scene::Sampler::Lattice)
+        {
+            // lattice spacing at which the SPH density is rho0, else the rest volume per particle
+            const float restSpacing = GetLatticeRestSpacing(h, mass, rho0);
+            m_sceneSpacing = m_scene->ResolveSpacing(restSpacing > 0.0f ? restSpacing : std::cbrt(mass / rho0));
+            m_scene->Generate(m_sceneSpacing, scenePositions, sceneTemps);
+        }
+        m_sceneGenerateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (scenePositions.empty())
+        {
+            throw std::runtime_error("Scene fills contain no particles at spacing " + std::to_string(m_sceneSpacing));
+        }
+        m_initialParticleCount = static_cast<uint32_t>(scenePositions.size());
+        m_maxParticleCapacity = std::max(m_maxParticleCapacity, m_initialParticleCount);
+    }
+    // the initial particles always fit, emitters grow the capacity later
+    m_particleCapacity = std::min(std::max(m_particleCapacity, m_initialParticleCount), m_maxParticleCapacity);
+    InitSimulationBuffers(device, *alloc, m_particleCapacity, m_gridCellsCount);
 
     CreateSimulationRootSignature(device);
 
@@ -128,11 +237,52 @@ void SimulationSystem::Init(ID3D12Device *device)
     m_simParams.dt = 1.0f / 60.0f;
     m_simParams.epsHeatTransfer = m_simParams.h2;
     m_simParams.cellSize = m_simParams.h * 4.0f; // TODO: be careful with this
+    // the neighbor search covers one cell around the particle, the coarsest level has to fit
+    m_simParams.maxSmoothingLength = m_simParams.adaptiveEnabled != 0
+                                         ? m_simParams.h * std::exp2(m_simParams.maxLevel / 3.0f)
+                                         : m_simParams.h;
     // grid resolution: cubic approximation
     int gridRes = std::max(1, (int)std::round(std::cbrt((double)m_gridCellsCount)));
     m_simParams.gridResolution[0] = gridRes;
     m_simParams.gridResolution[1] = gridRes;
     m_simParams.gridResolution[2] = gridRes;
+    std::vector<float> hostTerrainHeights;
+    if (m_terrain)
+    {
+        hostTerrainHeights = FitWorldToTerrain(gridRes);
+    }
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        m_simParams.heatGridResolution[axis] = m_simParams.gridResolution[axis] * m_heatGridSubdivision;
+    }
+    m_simParams.heatGridSpacing = m_simParams.cellSize / m_heatGridSubdivision;
+
+    // obstacle distance grids one after another in the obstacle buffer
+    std::vector<float> hostObstacleSdf;
+    m_simParams.obstacleCount = static_cast<uint32_t>(m_obstacles.size());
+    m_simParams.obstacleMargin = 0.25f * m_simParams.h;
+    for (size_t o = 0; o < m_obstacles.size(); ++o)
+    {
+        const SignedDistanceField &sdf = m_obstacles[o];
+        m_simParams.obstacleOrigin[o] = Vector4(sdf.origin.x, sdf.origin.y, sdf.origin.z, sdf.spacing);
+        m_simParams.obstacleGrid[o][0] = sdf.dims[0];
+        m_simParams.obstacleGrid[o][1] = sdf.dims[1];
+        m_simParams.obstacleGrid[o][2] = sdf.dims[2];
+        m_simParams.obstacleGrid[o][3] = static_cast<uint32_t>(hostObstacleSdf.size());
+        hostObstacleSdf.insert(hostObstacleSdf.end(), sdf.samples.begin(), sdf.samples.end());
+    }
+
+    // mesh obstacles, queried around each particle up to one smoothing length deep
+    std::vector<uint32_t> hostMeshCellRoots;
+    m_simParams.meshQueryRadius = m_simParams.h;
+    if (m_obstacleMesh.GetTriangleCount() > 0)
+    {
+        BuildMeshObstacles(hostMeshCellRoots);
+        if (m_meshBenchmark)
+        {
+            RunMeshBenchmark();
+        }
+    }
 
     const UINT64 cbSizeUnaligned = sizeof(SimParams);
     const UINT64 cbSize = Align256(cbSizeUnaligned);
@@ -163,30 +313,182 @@ void SimulationSystem::Init(ID3D12Device *device)
 
     CreateSimulationKernels();
 
-    std::vector<DirectX::SimpleMath::Vector3> hostPositions = GenerateDenseBottomWithSphere(m_maxParticlesCount);
+    m_profiler.Init(device, RenderSubsystem::GetCommandQueue());
+    m_diagnostics.assign(static_cast<size_t>(DiagnosticsSlot::NumberOfDiagnosticsSlots), 0u);
+    m_diagnosticsReadback = UploadHelpers::CreateReadbackBuffer(
+        device, UINT64(DiagnosticsSlot::NumberOfDiagnosticsSlots) * sizeof(uint32_t));
+
+    const UINT initialCount = m_initialParticleCount > 0 ? std::min<UINT>(m_initialParticleCount, m_particleCapacity) : m_particleCapacity;
+    m_slotPool.Reset(m_particleCapacity, initialCount);
+
+    // a restart reads the particles straight from the mapped checkpoint
+    const auto restoreStart = std::chrono::steady_clock::now();
+    std::vector<DirectX::SimpleMath::Vector3> hostPositions;
+    std::vector<float> hostTemps;
+    std::vector<uint32_t> hostIds;
+    const void *positionData = nullptr;
+    const void *tempData = nullptr;
+    const void *idData = nullptr;
+    if (m_restart)
+    {
+        positionData = m_restart->GetData(*m_restart->Find(k_chunkPosition));
+        tempData = m_restart->GetData(*m_restart->Find(k_chunkTemperature));
+        idData = m_restart->GetData(*m_restart->Find(k_chunkParticleId));
+    }
+    else if (!scenePositions.empty())
+    {
+        hostPositions = std::move(scenePositions);
+        hostTemps = std::move(sceneTemps);
+    }
+    else
+    {
+        hostPositions = GenerateScenePositions(m_initialScene, initialCount);
+        // generate temperatures for the positions (centralized helper)
+        GenerateTemperaturesForPositions(hostPositions, hostTemps);
+    }
+    if (!m_restart)
+    {
+        // stable ids, emitters continue after the initial particles
+        hostIds.resize(initialCount);
+        std::iota(hostIds.begin(), hostIds.end(), 0u);
+        m_nextParticleId = initialCount;
+        positionData = hostPositions.data();
+        tempData = hostTemps.data();
+        idData = hostIds.data();
+    }
 
     // create upload buffer and copy positions into GPU position buffers using one command list
-    UINT64 uploadSize = UINT64(m_maxParticlesCount) * sizeof(DirectX::SimpleMath::Vector3);
+    UINT64 uploadSize = UINT64(initialCount) * sizeof(DirectX::SimpleMath::Vector3);
     auto uploadResource = UploadHelpers::CreateUploadBuffer(device, uploadSize);
 
     // copy data to upload resource (positions)
     void *pUpload = nullptr;
     ThrowIfFailed(uploadResource->Map(0, &readRange, &pUpload));
-    memcpy(pUpload, hostPositions.data(), (size_t)uploadSize);
+    memcpy(pUpload, positionData, (size_t)uploadSize);
     uploadResource->Unmap(0, nullptr);
 
-    // generate temperatures for the positions (centralized helper)
-    std::vector<float> hostTemps;
-    GenerateTemperaturesForPositions(hostPositions, hostTemps);
-
     // upload temperature buffer
-    UINT64 tempUploadSize = UINT64(m_maxParticlesCount) * sizeof(float);
+    UINT64 tempUploadSize = UINT64(initialCount) * sizeof(float);
     auto uploadTempResource = UploadHelpers::CreateUploadBuffer(device, tempUploadSize);
     void *pUploadTemp = nullptr;
     ThrowIfFailed(uploadTempResource->Map(0, &readRange, &pUploadTemp));
-    memcpy(pUploadTemp, hostTemps.data(), (size_t)tempUploadSize);
+    memcpy(pUploadTemp, tempData, (size_t)tempUploadSize);
     uploadTempResource->Unmap(0, nullptr);
 
+    UINT64 idUploadSize = UINT64(initialCount) * sizeof(uint32_t);
+    auto uploadIdResource = UploadHelpers::CreateUploadBuffer(device, idUploadSize);
+    void *pUploadId = nullptr;
+    ThrowIfFailed(uploadIdResource->Map(0, &readRange, &pUploadId));
+    memcpy(pUploadId, idData, (size_t)idUploadSize);
+    uploadIdResource->Unmap(0, nullptr);
+
+    // terrain heights, the buffer size is known only now
+    particleScratchBuffers.terrainHeights = std::make_shared<StructuredBuffer>();
+    particleScratchBuffers.terrainHeights->Init(device, static_cast<UINT>(std::max<size_t>(hostTerrainHeights.size(), 1)), sizeof(float));
+    particleScratchBuffers.terrainHeights->CreateSRV(device, *alloc, m_srvBase + BufferSrvIndex::TerrainHeights);
+    particleScratchBuffers.terrainHeights->CreateUAV(device, *alloc, m_uavBase + BufferUavIndex::TerrainHeights);
+
+    winrt::com_ptr<ID3D12Resource> uploadTerrainResource;
+    const UINT64 terrainUploadSize = UINT64(hostTerrainHeights.size()) * sizeof(float);
+    if (terrainUploadSize > 0)
+    {
+        uploadTerrainResource = UploadHelpers::CreateUploadBuffer(device, terrainUploadSize);
+        void *pUploadTerrain = nullptr;
+        ThrowIfFailed(uploadTerrainResource->Map(0, &readRange, &pUploadTerrain));
+        memcpy(pUploadTerrain, hostTerrainHeights.data(), (size_t)terrainUploadSize);
+        uploadTerrainResource->Unmap(0, nullptr);
+    }
+
+    // write-once buffers: mesh BVH, triangles and per-cell subtrees (empty placeholders
+    // without meshes) and the boundary volume map of the walls
+    const BoundaryVolumeMap wallMap = BoundaryVolumeMap::CubicHalfSpace(k_boundaryMapIntervals);
+    if (!m_restart)
+    {
+        MeasureInitialDensity(hostPositions, wallMap);
+    }
+    if (m_samplerBenchmark)
+    {
+        RunSamplerBenchmark();
+    }
+    auto createStaticBuffer = [&](std::shared_ptr<StructuredBuffer> &buffer, size_t count, UINT stride,
+                                  BufferSrvIndex srvIndex, BufferUavIndex uavIndex)
+    {
+        buffer = std::make_shared<StructuredBuffer>();
+        buffer->Init(device, static_cast<UINT>(std::max<size_t>(count, 1)), stride);
+        buffer->CreateSRV(device, *alloc, m_srvBase + srvIndex);
+        buffer->CreateUAV(device, *alloc, m_uavBase + uavIndex);
+    };
+    createStaticBuffer(particleScratchBuffers.meshNodes, m_meshBvh.GetNodes().size(), sizeof(MeshBvhNode),
+                       BufferSrvIndex::MeshNodes, BufferUavIndex::MeshNodes);
+    createStaticBuffer(particleScratchBuffers.meshTriangles, m_meshBvh.GetTriangles().size(), sizeof(MeshTriangle),
+                       BufferSrvIndex::MeshTriangles, BufferUavIndex::MeshTriangles);
+    createStaticBuffer(particleScratchBuffers.meshCellRoots, hostMeshCellRoots.size(), sizeof(uint32_t),
+                       BufferSrvIndex::MeshCellRoots, BufferUavIndex::MeshCellRoots);
+    createStaticBuffer(particleScratchBuffers.boundaryVolumeMap, wallMap.samples.size(), sizeof(Vector2),
+                       BufferSrvIndex::BoundaryVolumeMap, BufferUavIndex::BoundaryVolumeMap);
+
+    struct StaticUpload
+    {
+        const void *data;
+        UINT64 size;
+        ID3D12Resource *target;
+        winrt::com_ptr<ID3D12Resource> upload;
+    };
+    std::vector<StaticUpload> staticUploads = {
+        {m_meshBvh.GetNodes().data(), UINT64(m_meshBvh.GetNodes().size()) * sizeof(MeshBvhNode),
+         particleScratchBuffers.meshNodes->resource.get()},
+        {m_meshBvh.GetTriangles().data(), UINT64(m_meshBvh.GetTriangles().size()) * sizeof(MeshTriangle),
+         particleScratchBuffers.meshTriangles->resource.get()},
+        {hostMeshCellRoots.data(), UINT64(hostMeshCellRoots.size()) * sizeof(uint32_t),
+         particleScratchBuffers.meshCellRoots->resource.get()},
+        {wallMap.samples.data(), UINT64(wallMap.samples.size()) * sizeof(Vector2),
+         particleScratchBuffers.boundaryVolumeMap->resource.get()},
+    };
+    if (m_restart)
+    {
+        // the remaining particle state, into both sides of swap buffers
+        const auto restoredBuffers = GetCheckpointBuffers();
+        for (size_t a = 0; a < restoredBuffers.size(); ++a)
+        {
+            const std::string_view tag = k_checkpointAttributes[a].tag;
+            if (tag == k_chunkPosition || tag == k_chunkTemperature || tag == k_chunkParticleId)
+            {
+                continue;
+            }
+            const Checkpoint::Chunk &chunk = *m_restart->Find(tag);
+            for (StructuredBuffer *target : {restoredBuffers[a].first, restoredBuffers[a].second})
+            {
+                if (target)
+                {
+                    staticUploads.push_back({m_restart->GetData(chunk), chunk.bytes, target->resource.get()});
+                }
+            }
+        }
+    }
+    for (StaticUpload &staticUpload : staticUploads)
+    {
+        if (staticUpload.size == 0)
+        {
+            continue;
+        }
+        staticUpload.upload = UploadHelpers::CreateUploadBuffer(device, staticUpload.size);
+        void *pUploadStatic = nullptr;
+        ThrowIfFailed(staticUpload.upload->Map(0, &readRange, &pUploadStatic));
+        memcpy(pUploadStatic, staticUpload.data, (size_t)staticUpload.size);
+        staticUpload.upload->Unmap(0, nullptr);
+    }
+
+    winrt::com_ptr<ID3D12Resource> uploadObstacleResource;
+    const UINT64 obstacleUploadSize = UINT64(hostObstacleSdf.size()) * sizeof(float);
+    if (obstacleUploadSize > 0)
+    {
+        uploadObstacleResource = UploadHelpers::CreateUploadBuffer(device, obstacleUploadSize);
+        void *pUploadObstacle = nullptr;
+        ThrowIfFailed(uploadObstacleResource->Map(0, &readRange, &pUploadObstacle));
+        memcpy(pUploadObstacle, hostObstacleSdf.data(), (size_t)obstacleUploadSize);
+        uploadObstacleResource->Unmap(0, nullptr);
+    }
+
     // prepare single command allocator/list to perform GPU copies for both swap buffers
     winrt::com_ptr<ID3D12CommandAllocator> cmdAlloc;
     winrt::com_ptr<ID3D12GraphicsCommandList> cmdList;
@@ -228,6 +530,51 @@ void SimulationSystem::Init(ID3D12Device *device)
         D3D12_RESOURCE_STATE_COMMON,
         D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
+    UploadHelpers::CopyBufferToResource(
+        cmdList.get(),
+        uploadIdResource.get(),
+        particleScratchBuffers.particleId->resource.get(),
+        idUploadSize,
+        D3D12_RESOURCE_STATE_COMMON,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    if (terrainUploadSize > 0)
+    {
+        UploadHelpers::CopyBufferToResource(
+            cmdList.get(),
+            uploadTerrainResource.get(),
+            particleScratchBuffers.terrainHeights->resource.get(),
+            terrainUploadSize,
+            D3D12_RESOURCE_STATE_COMMON,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }
+
+    if (obstacleUploadSize > 0)
+    {
+        UploadHelpers::CopyBufferToResource(
+            cmdList.get(),
+            uploadObstacleResource.get(),
+            particleScratchBuffers.obstacleSdf->resource.get(),
+            obstacleUploadSize,
+            D3D12_RESOURCE_STATE_COMMON,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }
+
+    for (const StaticUpload &staticUpload : staticUploads)
+    {
+        if (staticUpload.size == 0)
+        {
+            continue;
+        }
+        UploadHelpers::CopyBufferToResource(
+            cmdList.get(),
+            staticUpload.upload.get(),
+            staticUpload.target,
+            staticUpload.size,
+            D3D12_RESOURCE_STATE_COMMON,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }
+
     ThrowIfFailed(cmdList->Close());
     ID3D12CommandList *lists[] = {cmdList.get()};
     auto queue = RenderSubsystem::GetCommandQueue();
@@ -239,9 +586,35 @@ void SimulationSystem::Init(ID3D12Device *device)
     uint64_t fenceVal = 1;
     RenderSubsystem::WaitForFence(fence.get(), fenceVal);
 
-    InitSortIndexBuffers(device, *alloc, m_maxParticlesCount);
+    InitSortIndexBuffers(device, *alloc, m_particleCapacity);
+
+    m_simParams.numParticles = initialCount;
+
+    if (m_restart)
+    {
+        CheckpointRunState state = {};
+        m_restart->Read(k_chunkRunState, state);
+        m_stepIndex = state.stepIndex;
+        m_restartStep = state.stepIndex;
+        m_restartTime = state.simulatedTime;
+        m_lastCheckpointStep = state.stepIndex;
+        m_nextParticleId = state.nextParticleId;
+        m_thermalAccumDt = state.thermalAccumDt;
+        m_stepController.SetState(state.stepState);
+        // rigid clusters are not stored, they are rebuilt from the restored phases
+        m_rigidFullRebuildPending = true;
+        m_restart.reset();
+        m_restartLoadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - restoreStart).count();
+    }
+    if (m_trajectory)
+    {
+        // quantized trajectories use the neighbor grid cells as cubes unless an error bound is given
+        m_trajectory->SetQuantizationGrid(m_simParams.worldOrigin, m_simParams.cellSize);
+    }
+
+    m_emitUpload = UploadHelpers::CreateUploadBuffer(device, UINT64(m_maxEmittedPerStep) * sizeof(EmittedParticle));
+    ThrowIfFailed(m_emitUpload->Map(0, &readRange, reinterpret_cast<void **>(&m_emitUploadData)));
 
-    m_simParams.numParticles = m_maxParticlesCount;
     ThrowIfFailed(m_simParamsUpload->Map(0, &readRange, &pData));
     memcpy(pData, &m_simParams, sizeof(SimParams));
     m_simParamsUpload->Unmap(0, nullptr);
@@ -270,7 +643,7 @@ void SimulationSystem::CreateSimulationRootSignature(ID3D12Device *device)
         static_cast<UINT>(BufferUavIndex::NumberOfUavSlots) - 3,
         3); // u3+
 
-    CD3DX12_ROOT_PARAMETER rootParams[9];
+    CD3DX12_ROOT_PARAMETER rootParams[10];
 
     for (int i = 0; i < 8; ++i)
     {
@@ -279,6 +652,7 @@ void SimulationSystem::CreateSimulationRootSignature(ID3D12Device *device)
     }
 
     rootParams[8].InitAsConstantBufferView(0); // b0
+    rootParams[9].InitAsConstants(sizeof(PassConstants) / sizeof(uint32_t), 1); // b1
 
     CD3DX12_ROOT_SIGNATURE_DESC desc;
     desc.Init(
@@ -349,6 +723,162 @@ void SimulationSystem::CreateSimulationKernels()
     m_heatTransfer = std::make_unique<SimulationKernels::HeatTransfer>(
         devicePtr, devInfo, compileArgs, shaderBase / L"12_HeatTransfer.hlsl", m_rootSignature);
 
+    m_densityResidual = std::make_unique<SimulationKernels::DensityResidual>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"13_DensityResidual.hlsl", m_rootSignature);
+
+    m_stepLimits = std::make_unique<SimulationKernels::StepLimits>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"14_StepLimits.hlsl", m_rootSignature);
+
+    m_heatCgSetup = std::make_unique<SimulationKernels::HeatCgSetup>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"15_HeatCgSetup.hlsl", m_rootSignature);
+
+    m_heatCgApply = std::make_unique<SimulationKernels::HeatCgApply>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"16_HeatCgApply.hlsl", m_rootSignature);
+
+    m_solverScalars = std::make_unique<SimulationKernels::SolverScalars>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"17_SolverScalars.hlsl", m_rootSignature);
+
+    m_heatCgUpdate = std::make_unique<SimulationKernels::HeatCgUpdate>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"18_HeatCgUpdate.hlsl", m_rootSignature);
+
+    m_heatCgDirection = std::make_unique<SimulationKernels::HeatCgDirection>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"19_HeatCgDirection.hlsl", m_rootSignature);
+
+    m_viscosityCgSetup = std::make_unique<SimulationKernels::ViscosityCgSetup>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"20_ViscosityCgSetup.hlsl", m_rootSignature);
+
+    m_viscosityCgApply = std::make_unique<SimulationKernels::ViscosityCgApply>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"21_ViscosityCgApply.hlsl", m_rootSignature);
+
+    m_viscosityCgUpdate = std::make_unique<SimulationKernels::ViscosityCgUpdate>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"22_ViscosityCgUpdate.hlsl", m_rootSignature);
+
+    m_viscosityCgDirection = std::make_unique<SimulationKernels::ViscosityCgDirection>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"23_ViscosityCgDirection.hlsl", m_rootSignature);
+
+    m_dfsphFactor = std::make_unique<SimulationKernels::DfsphFactor>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"24_DfsphFactor.hlsl", m_rootSignature);
+
+    m_dfsphDensityStiffness = std::make_unique<SimulationKernels::DfsphDensityStiffness>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"25_DfsphDensityStiffness.hlsl", m_rootSignature);
+
+    m_dfsphPressureDelta = std::make_unique<SimulationKernels::DfsphPressureDelta>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"26_DfsphPressureDelta.hlsl", m_rootSignature);
+
+    m_dfsphDivergenceStiffness = std::make_unique<SimulationKernels::DfsphDivergenceStiffness>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"27_DfsphDivergenceStiffness.hlsl", m_rootSignature);
+
+    m_applyDeltaVelocity = std::make_unique<SimulationKernels::ApplyDeltaVelocity>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"28_ApplyDeltaVelocity.hlsl", m_rootSignature);
+
+    m_classifyPhase = std::make_unique<SimulationKernels::ClassifyPhase>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"29_ClassifyPhase.hlsl", m_rootSignature);
+
+    m_activeListScan = std::make_unique<SimulationKernels::ActiveListScan>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"30_ActiveListScan.hlsl", m_rootSignature);
+
+    m_activeListScatter = std::make_unique<SimulationKernels::ActiveListScatter>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"31_ActiveListScatter.hlsl", m_rootSignature);
+
+    m_rigidRebuildArgs = std::make_unique<SimulationKernels::RigidRebuildArgs>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"32_RigidRebuildArgs.hlsl", m_rootSignature);
+
+    m_rigidLabelInit = std::make_unique<SimulationKernels::RigidLabelInit>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"33_RigidLabelInit.hlsl", m_rootSignature);
+
+    m_rigidLabelHook = std::make_unique<SimulationKernels::RigidLabelHook>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"34_RigidLabelHook.hlsl", m_rootSignature);
+
+    m_rigidLabelCompress = std::make_unique<SimulationKernels::RigidLabelCompress>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"35_RigidLabelCompress.hlsl", m_rootSignature);
+
+    m_rigidClusterScan = std::make_unique<SimulationKernels::RigidClusterScan>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"36_RigidClusterScan.hlsl", m_rootSignature);
+
+    m_rigidMemberScatter = std::make_unique<SimulationKernels::RigidMemberScatter>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"37_RigidMemberScatter.hlsl", m_rootSignature);
+
+    m_rigidRestShape = std::make_unique<SimulationKernels::RigidRestShape>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"38_RigidRestShape.hlsl", m_rootSignature);
+
+    m_rigidPredict = std::make_unique<SimulationKernels::RigidPredict>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"39_RigidPredict.hlsl", m_rootSignature);
+
+    m_rigidContact = std::make_unique<SimulationKernels::RigidContact>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"40_RigidContact.hlsl", m_rootSignature);
+
+    m_rigidShapeMatch = std::make_unique<SimulationKernels::RigidShapeMatch>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"41_RigidShapeMatch.hlsl", m_rootSignature);
+
+    m_emitParticles = std::make_unique<SimulationKernels::EmitParticles>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"42_EmitParticles.hlsl", m_rootSignature);
+
+    m_killMark = std::make_unique<SimulationKernels::KillMark>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"43_KillMark.hlsl", m_rootSignature);
+
+    m_killScan = std::make_unique<SimulationKernels::KillScan>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"44_KillScan.hlsl", m_rootSignature);
+
+    m_compactScatter = std::make_unique<SimulationKernels::CompactScatter>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"45_CompactScatter.hlsl", m_rootSignature);
+
+    m_compactFinish = std::make_unique<SimulationKernels::CompactFinish>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"46_CompactFinish.hlsl", m_rootSignature);
+
+    m_adaptivePair = std::make_unique<SimulationKernels::AdaptivePair>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"47_AdaptivePair.hlsl", m_rootSignature);
+
+    m_adaptiveApply = std::make_unique<SimulationKernels::AdaptiveApply>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"48_AdaptiveApply.hlsl", m_rootSignature);
+
+    m_heatGridSplat = std::make_unique<SimulationKernels::HeatGridSplat>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"49_HeatGridSplat.hlsl", m_rootSignature);
+
+    m_heatGridSetup = std::make_unique<SimulationKernels::HeatGridSetup>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"50_HeatGridSetup.hlsl", m_rootSignature);
+
+    m_heatGridJacobi = std::make_unique<SimulationKernels::HeatGridJacobi>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"51_HeatGridJacobi.hlsl", m_rootSignature);
+
+    m_heatGridGather = std::make_unique<SimulationKernels::HeatGridGather>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"52_HeatGridGather.hlsl", m_rootSignature);
+
+    m_surfaceClassify = std::make_unique<SimulationKernels::SurfaceClassify>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"53_SurfaceClassify.hlsl", m_rootSignature);
+
+    m_surfaceArgs = std::make_unique<SimulationKernels::SurfaceArgs>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"54_SurfaceArgs.hlsl", m_rootSignature);
+
+    m_surfaceCooling = std::make_unique<SimulationKernels::SurfaceCooling>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"55_SurfaceCooling.hlsl", m_rootSignature);
+
+    m_rigidClusterCount = std::make_unique<SimulationKernels::RigidClusterCount>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"56_RigidClusterCount.hlsl", m_rootSignature);
+
+    m_rigidClusterOffsets = std::make_unique<SimulationKernels::RigidClusterOffsets>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"57_RigidClusterOffsets.hlsl", m_rootSignature);
+
+    m_rigidSingleMove = std::make_unique<SimulationKernels::RigidSingleMove>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"58_RigidSingleMove.hlsl", m_rootSignature);
+
+    m_solverColor = std::make_unique<SimulationKernels::SolverColor>(
+        devicePtr, devInfo, compileArgs, shaderBase / L"59_SolverColor.hlsl", m_rootSignature);
+
+    // dispatches over the active list take their group count from the active args buffer
+    D3D12_INDIRECT_ARGUMENT_DESC dispatchArgument{};
+    dispatchArgument.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+    D3D12_COMMAND_SIGNATURE_DESC signatureDesc{};
+    signatureDesc.ByteStride = 4 * sizeof(uint32_t); // dispatch arguments + active count
+    signatureDesc.NumArgumentDescs = 1;
+    signatureDesc.pArgumentDescs = &dispatchArgument;
+    ThrowIfFailed(devicePtr->CreateCommandSignature(&signatureDesc, nullptr, IID_PPV_ARGS(m_dispatchSignature.put())));
+    m_activeDispatch = {m_dispatchSignature.get(), particleScratchBuffers.activeArgs->resource.get(), 0};
+    m_rigidRebuildDispatch = {m_dispatchSignature.get(), particleScratchBuffers.rigidRebuildArgs->resource.get(), 0};
+    m_rigidClusterDispatch = {m_dispatchSignature.get(), particleScratchBuffers.rigidArgs->resource.get(), 0};
+    m_rigidSolidDispatch = {m_dispatchSignature.get(), particleScratchBuffers.rigidArgs->resource.get(), 4 * sizeof(uint32_t)};
+    m_rigidSingleDispatch = {m_dispatchSignature.get(), particleScratchBuffers.rigidArgs->resource.get(), 8 * sizeof(uint32_t)};
+    m_surfaceDispatch = {m_dispatchSignature.get(), particleScratchBuffers.surfaceArgs->resource.get(), 0};
+
     m_oneSweep = std::make_unique<OneSweep>(devicePtr, devInfo, GPUSorting::ORDER_ASCENDING, GPUSorting::KEY_UINT32, GPUSorting::PAYLOAD_UINT32);
     m_oneSweep->SetAllBuffers(
         sortBuffers.hashBuffers[0]->resource,
@@ -356,7 +886,7 @@ void SimulationSystem::CreateSimulationKernels()
         sortBuffers.hashBuffers[1]->resource,
         sortBuffers.indexBuffers[1]->resource,
         true);
-    m_oneSweep->UpdateSize(m_maxParticlesCount, false);
+    m_oneSweep->UpdateSize(m_particleCapacity, false);
 }
 
 // TODO: move to some utility file
@@ -427,6 +957,11 @@ void SimulationSystem::InitSimulationBuffers(
         numParticles,
         sizeof(DirectX::SimpleMath::Vector3));
 
+    particleScratchBuffers.solverColor = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(uint32_t));
+
     particleScratchBuffers.viscosityMu = CreateBuffer(
         device,
         numParticles,
@@ -452,86 +987,384 @@ void SimulationSystem::InitSimulationBuffers(
         numParticles,
         sizeof(uint32_t));
 
-    for (int i = 0; i < 2; ++i)
-    {
-        sortBuffers.hashBuffers[i] = CreateBuffer(
-            device,
-            numParticles,
-            sizeof(uint32_t));
+    particleScratchBuffers.activeIndices = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(uint32_t));
 
-        sortBuffers.indexBuffers[i] = CreateBuffer(
-            device,
-            numParticles,
-            sizeof(uint32_t));
-    }
+    particleScratchBuffers.activeArgs = CreateBuffer(
+        device,
+        4,
+        sizeof(uint32_t));
 
-    particleSwapBuffers.position.buffers[0]->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Position);
-    particleSwapBuffers.position.buffers[0]->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Position);
+    particleScratchBuffers.activeGroupOffsets = CreateBuffer(
+        device,
+        (numParticles + 255) / 256,
+        sizeof(uint32_t));
 
-    particleScratchBuffers.predictedPosition->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::PredictedPosition);
-    particleScratchBuffers.predictedPosition->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::PredictedPosition);
+    particleScratchBuffers.rigidLabel = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(uint32_t));
 
-    particleSwapBuffers.velocity.buffers[0]->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Velocity);
-    particleSwapBuffers.velocity.buffers[0]->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Velocity);
+    particleScratchBuffers.rigidRestOffset = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(DirectX::SimpleMath::Vector3));
 
-    sortBuffers.hashBuffers[0]->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ParticleHash);
-    sortBuffers.hashBuffers[0]->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ParticleHash);
-    sortBuffers.indexBuffers[0]->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::SortedIndices);
-    sortBuffers.indexBuffers[0]->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::SortedIndices);
-    particleScratchBuffers.cellStart->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::CellStart);
-    particleScratchBuffers.cellStart->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::CellStart);
-    particleScratchBuffers.cellEnd->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::CellEnd);
-    particleScratchBuffers.cellEnd->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::CellEnd);
+    particleScratchBuffers.rigidMembers = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(uint32_t));
 
-    particleSwapBuffers.temperature.buffers[0]->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Temperature);
-    particleSwapBuffers.temperature.buffers[0]->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Temperature);
+    particleScratchBuffers.rigidClusterOffsets = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(uint32_t));
 
-    particleScratchBuffers.density->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Density);
-    particleScratchBuffers.density->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Density);
+    particleScratchBuffers.rigidClusters = CreateBuffer(
+        device,
+        numParticles,
+        2 * sizeof(uint32_t));
 
-    particleScratchBuffers.constraintC->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ConstraintC);
-    particleScratchBuffers.constraintC->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ConstraintC);
+    particleScratchBuffers.rigidRotation = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(DirectX::SimpleMath::Vector4));
 
-    particleScratchBuffers.lambda->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Lambda);
-    particleScratchBuffers.lambda->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Lambda);
+    particleScratchBuffers.rigidRebuildArgs = CreateBuffer(
+        device,
+        8,
+        sizeof(uint32_t));
 
-    particleScratchBuffers.deltaP->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::DeltaP);
-    particleScratchBuffers.deltaP->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::DeltaP);
+    particleScratchBuffers.rigidArgs = CreateBuffer(
+        device,
+        12,
+        sizeof(uint32_t));
 
-    particleScratchBuffers.viscosityMu->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ViscosityMu);
-    particleScratchBuffers.viscosityMu->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ViscosityMu);
+    particleScratchBuffers.rigidGroupOffsets = CreateBuffer(
+        device,
+        (numParticles + 255) / 256,
+        4 * sizeof(uint32_t));
 
-    particleScratchBuffers.viscosityCoeff->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ViscosityCoeff);
-    particleScratchBuffers.viscosityCoeff->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ViscosityCoeff);
+    particleScratchBuffers.surfaceIndices = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(uint32_t));
 
-    // swap buffers
-    particleSwapBuffers.position.buffers[1]->CreateSRV(device, allocGPU, m_pingPongSrvBase + BufferSrvIndex::Position);
-    particleSwapBuffers.position.buffers[1]->CreateUAV(device, allocGPU, m_pingPongUavBase + BufferUavIndex::Position);
+    particleScratchBuffers.surfaceArgs = CreateBuffer(
+        device,
+        8,
+        sizeof(uint32_t));
 
-    particleSwapBuffers.temperature.buffers[1]->CreateSRV(device, allocGPU, m_pingPongSrvBase + BufferSrvIndex::Temperature);
-    particleSwapBuffers.temperature.buffers[1]->CreateUAV(device, allocGPU, m_pingPongUavBase + BufferUavIndex::Temperature);
+    size_t obstacleSamples = 0;
+    for (const SignedDistanceField &sdf : m_obstacles)
+    {
+        obstacleSamples += sdf.samples.size();
+    }
+    particleScratchBuffers.obstacleSdf = CreateBuffer(
+        device,
+        static_cast<UINT>(std::max<size_t>(obstacleSamples, 1)),
+        sizeof(float));
 
-    particleSwapBuffers.velocity.buffers[1]->CreateSRV(device, allocGPU, m_pingPongSrvBase + BufferSrvIndex::Velocity);
-    particleSwapBuffers.velocity.buffers[1]->CreateUAV(device, allocGPU, m_pingPongUavBase + BufferUavIndex::Velocity);
+    particleScratchBuffers.emitQueue = CreateBuffer(
+        device,
+        m_maxEmittedPerStep,
+        sizeof(EmittedParticle));
 
-    InitTemperatureBuffer(device, numParticles);
-}
+    particleScratchBuffers.particleId = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(uint32_t));
 
-void SimulationSystem::InitSortIndexBuffers(ID3D12Device *device, DescriptorAllocator &alloc, UINT numParticles)
-{
-    std::vector<uint32_t> hostIndices(m_maxParticlesCount);
-    std::iota(hostIndices.begin(), hostIndices.end(), 0u);
+    particleScratchBuffers.compactUint = CreateBuffer(
+        device,
+        numParticles,
+        4 * sizeof(uint32_t));
 
-    UINT64 uploadSize = UINT64(m_maxParticlesCount) * sizeof(uint32_t);
+    particleScratchBuffers.compactFloat = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(DirectX::SimpleMath::Vector4));
 
-    auto uploadResource = UploadHelpers::CreateUploadBuffer(device, uploadSize);
+    particleScratchBuffers.particleLevel = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(int32_t));
 
-    void *pUpload = nullptr;
-    D3D12_RANGE readRange{0, 0}; // CPU write-only
-    ThrowIfFailed(uploadResource->Map(0, &readRange, &pUpload));
-    memcpy(pUpload, hostIndices.data(), uploadSize);
+    particleScratchBuffers.diagnostics = CreateBuffer(
+        device,
+        static_cast<UINT>(DiagnosticsSlot::NumberOfDiagnosticsSlots),
+        sizeof(uint32_t));
+
+    particleScratchBuffers.heatDiagonal = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(float));
+
+    particleScratchBuffers.heatResidual = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(float));
+
+    particleScratchBuffers.heatPrecond = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(float));
+
+    particleScratchBuffers.heatDirection = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(float));
+
+    particleScratchBuffers.heatProduct = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(float));
+
+    particleScratchBuffers.heatGridAccum = CreateBuffer(
+        device,
+        m_heatGridNodeCount * 4,
+        sizeof(uint32_t));
+
+    particleScratchBuffers.heatGridState = CreateBuffer(
+        device,
+        m_heatGridNodeCount,
+        sizeof(DirectX::SimpleMath::Vector4));
+
+    particleScratchBuffers.heatGridTemperature = CreateBuffer(
+        device,
+        m_heatGridNodeCount * 2,
+        sizeof(float));
+
+    particleScratchBuffers.viscosityDiagonal = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(float));
+
+    particleScratchBuffers.viscosityResidual = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(DirectX::SimpleMath::Vector3));
+
+    particleScratchBuffers.viscosityPrecond = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(DirectX::SimpleMath::Vector3));
+
+    particleScratchBuffers.viscosityDirection = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(DirectX::SimpleMath::Vector3));
+
+    particleScratchBuffers.viscosityProduct = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(DirectX::SimpleMath::Vector3));
+
+    particleScratchBuffers.dfsphKappa = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(float));
+
+    particleScratchBuffers.dfsphKappaV = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(float));
+
+    particleScratchBuffers.dfsphStiffness = CreateBuffer(
+        device,
+        numParticles,
+        sizeof(float));
+
+    particleScratchBuffers.solverPartials = CreateBuffer(
+        device,
+        (numParticles + 255) / 256,
+        sizeof(DirectX::SimpleMath::Vector2));
+
+    particleScratchBuffers.solverScalars = CreateBuffer(
+        device,
+        static_cast<UINT>(SolverScalar::NumberOfSolverScalars),
+        sizeof(uint32_t));
+
+    for (int i = 0; i < 2; ++i)
+    {
+        sortBuffers.hashBuffers[i] = CreateBuffer(
+            device,
+            numParticles,
+            sizeof(uint32_t));
+
+        sortBuffers.indexBuffers[i] = CreateBuffer(
+            device,
+            numParticles,
+            sizeof(uint32_t));
+    }
+
+    particleSwapBuffers.position.buffers[0]->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Position);
+    particleSwapBuffers.position.buffers[0]->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Position);
+
+    particleScratchBuffers.predictedPosition->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::PredictedPosition);
+    particleScratchBuffers.predictedPosition->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::PredictedPosition);
+
+    particleSwapBuffers.velocity.buffers[0]->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Velocity);
+    particleSwapBuffers.velocity.buffers[0]->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Velocity);
+
+    sortBuffers.hashBuffers[0]->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ParticleHash);
+    sortBuffers.hashBuffers[0]->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ParticleHash);
+    sortBuffers.indexBuffers[0]->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::SortedIndices);
+    sortBuffers.indexBuffers[0]->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::SortedIndices);
+    particleScratchBuffers.cellStart->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::CellStart);
+    particleScratchBuffers.cellStart->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::CellStart);
+    particleScratchBuffers.cellEnd->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::CellEnd);
+    particleScratchBuffers.cellEnd->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::CellEnd);
+
+    particleSwapBuffers.temperature.buffers[0]->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Temperature);
+    particleSwapBuffers.temperature.buffers[0]->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Temperature);
+
+    particleScratchBuffers.density->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Density);
+    particleScratchBuffers.density->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Density);
+
+    particleScratchBuffers.constraintC->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ConstraintC);
+    particleScratchBuffers.constraintC->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ConstraintC);
+
+    particleScratchBuffers.lambda->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Lambda);
+    particleScratchBuffers.lambda->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Lambda);
+    particleScratchBuffers.solverColor->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::SolverColor);
+    particleScratchBuffers.solverColor->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::SolverColor);
+
+    particleScratchBuffers.deltaP->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::DeltaP);
+    particleScratchBuffers.deltaP->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::DeltaP);
+
+    particleScratchBuffers.viscosityMu->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ViscosityMu);
+    particleScratchBuffers.viscosityMu->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ViscosityMu);
+
+    particleScratchBuffers.viscosityCoeff->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ViscosityCoeff);
+    particleScratchBuffers.viscosityCoeff->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ViscosityCoeff);
+
+    particleScratchBuffers.diagnostics->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Diagnostics);
+    particleScratchBuffers.diagnostics->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Diagnostics);
+
+    particleScratchBuffers.heatDiagonal->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::HeatDiagonal);
+    particleScratchBuffers.heatDiagonal->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::HeatDiagonal);
+    particleScratchBuffers.heatResidual->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::HeatResidual);
+    particleScratchBuffers.heatResidual->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::HeatResidual);
+    particleScratchBuffers.heatPrecond->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::HeatPrecond);
+    particleScratchBuffers.heatPrecond->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::HeatPrecond);
+    particleScratchBuffers.heatDirection->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::HeatDirection);
+    particleScratchBuffers.heatDirection->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::HeatDirection);
+    particleScratchBuffers.heatProduct->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::HeatProduct);
+    particleScratchBuffers.heatProduct->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::HeatProduct);
+    particleScratchBuffers.heatGridAccum->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::HeatGridAccum);
+    particleScratchBuffers.heatGridAccum->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::HeatGridAccum);
+    particleScratchBuffers.heatGridState->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::HeatGridState);
+    particleScratchBuffers.heatGridState->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::HeatGridState);
+    particleScratchBuffers.heatGridTemperature->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::HeatGridTemperature);
+    particleScratchBuffers.heatGridTemperature->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::HeatGridTemperature);
+
+    particleScratchBuffers.viscosityDiagonal->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ViscosityDiagonal);
+    particleScratchBuffers.viscosityDiagonal->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ViscosityDiagonal);
+    particleScratchBuffers.viscosityResidual->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ViscosityResidual);
+    particleScratchBuffers.viscosityResidual->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ViscosityResidual);
+    particleScratchBuffers.viscosityPrecond->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ViscosityPrecond);
+    particleScratchBuffers.viscosityPrecond->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ViscosityPrecond);
+    particleScratchBuffers.viscosityDirection->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ViscosityDirection);
+    particleScratchBuffers.viscosityDirection->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ViscosityDirection);
+    particleScratchBuffers.viscosityProduct->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ViscosityProduct);
+    particleScratchBuffers.viscosityProduct->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ViscosityProduct);
+
+    particleScratchBuffers.dfsphKappa->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::DfsphKappa);
+    particleScratchBuffers.dfsphKappa->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::DfsphKappa);
+    particleScratchBuffers.dfsphKappaV->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::DfsphKappaV);
+    particleScratchBuffers.dfsphKappaV->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::DfsphKappaV);
+    particleScratchBuffers.dfsphStiffness->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::DfsphStiffness);
+    particleScratchBuffers.dfsphStiffness->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::DfsphStiffness);
+
+    particleScratchBuffers.solverPartials->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::SolverPartials);
+    particleScratchBuffers.solverPartials->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::SolverPartials);
+    particleScratchBuffers.solverScalars->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::SolverScalars);
+    particleScratchBuffers.solverScalars->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::SolverScalars);
+
+    particleScratchBuffers.phase->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::Phase);
+    particleScratchBuffers.phase->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::Phase);
+    particleScratchBuffers.activeIndices->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ActiveIndices);
+    particleScratchBuffers.activeIndices->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ActiveIndices);
+    particleScratchBuffers.activeArgs->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ActiveArgs);
+    particleScratchBuffers.activeArgs->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ActiveArgs);
+    particleScratchBuffers.activeGroupOffsets->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ActiveGroupOffsets);
+    particleScratchBuffers.activeGroupOffsets->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ActiveGroupOffsets);
+
+    particleScratchBuffers.rigidLabel->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::RigidLabel);
+    particleScratchBuffers.rigidLabel->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::RigidLabel);
+    particleScratchBuffers.rigidRestOffset->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::RigidRestOffset);
+    particleScratchBuffers.rigidRestOffset->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::RigidRestOffset);
+    particleScratchBuffers.rigidMembers->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::RigidMembers);
+    particleScratchBuffers.rigidMembers->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::RigidMembers);
+    particleScratchBuffers.rigidClusterOffsets->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::RigidClusterOffsets);
+    particleScratchBuffers.rigidClusterOffsets->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::RigidClusterOffsets);
+    particleScratchBuffers.rigidClusters->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::RigidClusters);
+    particleScratchBuffers.rigidClusters->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::RigidClusters);
+    particleScratchBuffers.rigidRotation->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::RigidRotation);
+    particleScratchBuffers.rigidRotation->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::RigidRotation);
+    particleScratchBuffers.rigidRebuildArgs->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::RigidRebuildArgs);
+    particleScratchBuffers.rigidRebuildArgs->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::RigidRebuildArgs);
+    particleScratchBuffers.rigidArgs->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::RigidArgs);
+    particleScratchBuffers.rigidArgs->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::RigidArgs);
+    particleScratchBuffers.rigidGroupOffsets->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::RigidGroupOffsets);
+    particleScratchBuffers.rigidGroupOffsets->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::RigidGroupOffsets);
+    particleScratchBuffers.surfaceIndices->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::SurfaceIndices);
+    particleScratchBuffers.surfaceIndices->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::SurfaceIndices);
+    particleScratchBuffers.surfaceArgs->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::SurfaceArgs);
+    particleScratchBuffers.surfaceArgs->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::SurfaceArgs);
+    particleScratchBuffers.obstacleSdf->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ObstacleSdf);
+    particleScratchBuffers.obstacleSdf->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ObstacleSdf);
+
+    particleScratchBuffers.emitQueue->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::EmitQueue);
+    particleScratchBuffers.emitQueue->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::EmitQueue);
+
+    particleScratchBuffers.particleId->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ParticleId);
+    particleScratchBuffers.particleId->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ParticleId);
+    particleScratchBuffers.compactUint->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::CompactUint);
+    particleScratchBuffers.compactUint->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::CompactUint);
+    particleScratchBuffers.compactFloat->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::CompactFloat);
+    particleScratchBuffers.compactFloat->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::CompactFloat);
+    particleScratchBuffers.particleLevel->CreateSRV(device, allocGPU, m_srvBase + BufferSrvIndex::ParticleLevel);
+    particleScratchBuffers.particleLevel->CreateUAV(device, allocGPU, m_uavBase + BufferUavIndex::ParticleLevel);
+
+    // swap buffers
+    particleSwapBuffers.position.buffers[1]->CreateSRV(device, allocGPU, m_pingPongSrvBase + BufferSrvIndex::Position);
+    particleSwapBuffers.position.buffers[1]->CreateUAV(device, allocGPU, m_pingPongUavBase + BufferUavIndex::Position);
+
+    particleSwapBuffers.temperature.buffers[1]->CreateSRV(device, allocGPU, m_pingPongSrvBase + BufferSrvIndex::Temperature);
+    particleSwapBuffers.temperature.buffers[1]->CreateUAV(device, allocGPU, m_pingPongUavBase + BufferUavIndex::Temperature);
+
+    particleSwapBuffers.velocity.buffers[1]->CreateSRV(device, allocGPU, m_pingPongSrvBase + BufferSrvIndex::Velocity);
+    particleSwapBuffers.velocity.buffers[1]->CreateUAV(device, allocGPU, m_pingPongUavBase + BufferUavIndex::Velocity);
+
+    InitTemperatureBuffer(device, numParticles);
+}
+
+void SimulationSystem::InitSortIndexBuffers(ID3D12Device *device, DescriptorAllocator &alloc, UINT numParticles)
+{
+    std::vector<uint32_t> hostIndices(numParticles);
+    std::iota(hostIndices.begin(), hostIndices.end(), 0u);
+
+    UINT64 uploadSize = UINT64(numParticles) * sizeof(uint32_t);
+
+    auto uploadResource = UploadHelpers::CreateUploadBuffer(device, uploadSize);
+
+    void *pUpload = nullptr;
+    D3D12_RANGE readRange{0, 0}; // CPU write-only
+    ThrowIfFailed(uploadResource->Map(0, &readRange, &pUpload));
+    memcpy(pUpload, hostIndices.data(), uploadSize);
     uploadResource->Unmap(0, nullptr);
 
+    // unused slots hash to UINT_MAX so the full-capacity sort moves them behind the live particles
+    auto uploadHashResource = UploadHelpers::CreateUploadBuffer(device, uploadSize);
+    void *pUploadHash = nullptr;
+    ThrowIfFailed(uploadHashResource->Map(0, &readRange, &pUploadHash));
+    memset(pUploadHash, 0xff, uploadSize);
+    uploadHashResource->Unmap(0, nullptr);
+
     winrt::com_ptr<ID3D12CommandAllocator> cmdAlloc;
     winrt::com_ptr<ID3D12GraphicsCommandList> cmdList;
     ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(cmdAlloc.put())));
@@ -543,6 +1376,9 @@ void SimulationSystem::InitSortIndexBuffers(ID3D12Device *device, DescriptorAllo
     auto dstRes2 = sortBuffers.indexBuffers[1]->resource.get();
     UploadHelpers::CopyBufferToResource(cmdList.get(), uploadResource.get(), dstRes2, uploadSize, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
+    auto dstRes3 = sortBuffers.hashBuffers[0]->resource.get();
+    UploadHelpers::CopyBufferToResource(cmdList.get(), uploadHashResource.get(), dstRes3, uploadSize, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
     ThrowIfFailed(cmdList->Close());
     ID3D12CommandList *lists[] = {cmdList.get()};
     auto queue = RenderSubsystem::GetCommandQueue();
@@ -687,6 +1523,13 @@ void SimulationSystem::SetSimulationConstantRootSig(
     cmdList->SetComputeRootConstantBufferView(8, cbAddress);
 }
 
+void SimulationSystem::SetPassConstants(
+    ID3D12GraphicsCommandList *cmdList,
+    const PassConstants &constants)
+{
+    cmdList->SetComputeRoot32BitConstants(9, sizeof(PassConstants) / sizeof(uint32_t), &constants, 0);
+}
+
 void SimulationSystem::SetRootSigAndDescTables(ID3D12GraphicsCommandList *cmdList, DescriptorAllocator &allocGPU)
 {
     ID3D12DescriptorHeap *heaps[] = {allocGPU.GetHeap()};
@@ -704,18 +1547,69 @@ void SimulationSystem::SetRootSigAndDescTables(ID3D12GraphicsCommandList *cmdLis
     SetSimulationConstantRootSig(
         cmdList,
         m_simParamsUpload->GetGPUVirtualAddress());
+
+    SetPassConstants(cmdList, {});
 }
 #pragma endregion
 
 #pragma region SIMULATE
-static winrt::com_ptr<ID3D12Fence> fence = nullptr;
-void SimulationSystem::Simulate(float dt)
+void SimulationSystem::Simulate(float interval)
 {
     if (!isRunning)
     {
         return;
     }
 
+    float substepDt = 0.0f;
+    int substeps = m_stepController.PlanInterval(interval, substepDt);
+    for (int i = 0; i < substeps; ++i)
+    {
+        SimulateStep(substepDt);
+    }
+
+    if (m_checkpointInterval > 0 && !m_checkpointPath.empty() &&
+        m_stepIndex - m_lastCheckpointStep >= uint64_t(m_checkpointInterval))
+    {
+        // a skipped save waits for the next interval
+        SaveCheckpoint(m_checkpointPath);
+        m_lastCheckpointStep = m_stepIndex;
+    }
+
+    if (m_trajectory && substeps > 0 && m_frameIndex++ % m_trajectory->GetSettings().interval == 0)
+    {
+        CaptureTrajectory();
+    }
+}
+
+void SimulationSystem::CaptureTrajectory()
+{
+    const uint32_t attributes = m_trajectory->GetSettings().attributes;
+    std::vector<std::shared_ptr<StructuredBuffer>> sources;
+    if (attributes & TrajectoryPosition)
+    {
+        sources.push_back(particleSwapBuffers.position.GetReadBuffer());
+    }
+    if (attributes & TrajectoryVelocity)
+    {
+        // the write side holds the velocity after viscosity, which the next step starts from
+        sources.push_back(particleSwapBuffers.velocity.GetWriteBuffer());
+    }
+    if (attributes & TrajectoryTemperature)
+    {
+        sources.push_back(particleSwapBuffers.temperature.GetReadBuffer());
+    }
+    if (attributes & TrajectoryParticleId)
+    {
+        sources.push_back(particleScratchBuffers.particleId);
+    }
+    const TrajectoryWriter::Frame frame = {m_stepIndex, m_restartTime + m_stepController.GetSimulatedTime(),
+                                           m_simParams.numParticles};
+    m_trajectory->Capture(RenderSubsystem::GetDevice().get(), RenderSubsystem::GetCommandQueue(), frame, sources);
+}
+
+static winrt::com_ptr<ID3D12Fence> fence = nullptr;
+void SimulationSystem::SimulateStep(float dt)
+{
     winrt::com_ptr<ID3D12Device> device = RenderSubsystem::GetDevice();
 
     static int fenceVal;
@@ -726,6 +1620,22 @@ void SimulationSystem::Simulate(float dt)
     }
 
     m_simParams.dt = dt;
+    m_stepController.BeginSubstep(dt, m_simParams);
+
+    // slow stages run every Nth step, heat transfer integrates over the accumulated time
+    const bool runThermal = m_stepIndex % m_thermalInterval == 0;
+    const bool runViscosity = m_stepIndex % m_viscosityInterval == 0;
+    m_thermalAccumDt += dt;
+    m_simParams.thermalDt = m_thermalAccumDt;
+    m_heatSolvedThisStep = runThermal && m_heatSolverMode == HeatSolverMode::ImplicitCG;
+    if (runThermal)
+    {
+        m_thermalAccumDt = 0.0f;
+    }
+    ++m_stepIndex;
+
+    // new particles extend the live range before numParticles goes to the GPU
+    const uint32_t emittedCount = QueueEmittedParticles(dt);
 
     // copy updated SimParams into the upload constant buffer
     D3D12_RANGE readRange{0, 0};
@@ -747,16 +1657,47 @@ void SimulationSystem::Simulate(float dt)
 
     const uint32_t numParticles = static_cast<uint32_t>(m_simParams.numParticles);
 
+    m_profiler.BeginFrame();
+
+    if (emittedCount > 0)
+    {
+        m_profiler.BeginScope(cmdList.get(), "emit");
+        EmitParticles(cmdList, emittedCount);
+        m_profiler.EndScope(cmdList.get());
+    }
+
+    // 0) Sleep / wake classification, dynamics below only touch the active list
+    m_profiler.BeginScope(cmdList.get(), "active list");
+    BuildActiveList(cmdList, numParticles);
+    m_profiler.EndScope(cmdList.get());
+
+    if (m_simParams.rigidEnabled != 0)
+    {
+        m_profiler.BeginScope(cmdList.get(), "rigid rebuild");
+        RebuildRigidClusters(cmdList);
+        m_profiler.EndScope(cmdList.get());
+    }
+
     // 1) Predict positions
-    m_predictPositions->Dispatch(cmdList, numParticles);
+    m_profiler.BeginScope(cmdList.get(), "predict");
+    m_predictPositions->DispatchIndirect(cmdList, m_activeDispatch);
+    if (m_simParams.rigidEnabled != 0)
+    {
+        m_rigidPredict->DispatchIndirect(cmdList, m_rigidSolidDispatch);
+    }
     UAVBarrierSingle(cmdList, particleScratchBuffers.predictedPosition->resource);
+    m_profiler.EndScope(cmdList.get());
 
     // 2) Simple collision projection (in-place on predicted/velocity buffers)
-    m_collisionProjection->Dispatch(cmdList, numParticles);
+    m_profiler.BeginScope(cmdList.get(), "collision");
+    m_collisionProjection->DispatchIndirect(cmdList, m_activeDispatch);
     UAVBarrierSingle(cmdList, particleScratchBuffers.predictedPosition->resource);
+    m_profiler.EndScope(cmdList.get());
 
     // 3) Compute spatial hash into sort buffers
-    m_cellHash->Dispatch(cmdList, numParticles);
+    m_profiler.BeginScope(cmdList.get(), "cell hash");
+    m_cellHash->Dispatch(cmdList, std::max<uint32_t>(numParticles, m_gridCellsCount));
+    m_profiler.EndScope(cmdList.get());
     // UAVBarrierSingle(cmdList, sortBuffers.hashBuffers[0]->resource);
 
     ThrowIfFailed(cmdList->Close());
@@ -776,51 +1717,173 @@ void SimulationSystem::Simulate(float dt)
     RenderSubsystem::WaitForFence(fence.get(), fenceVal);
 
     SetRootSigAndDescTables(cmdList.get(), *allocGPU);
+    // buffers decay to COMMON between command lists
+    TransitionDispatchArgs(cmdList.get(), *particleScratchBuffers.activeArgs, D3D12_RESOURCE_STATE_COMMON);
+    if (m_simParams.rigidEnabled != 0)
+    {
+        TransitionDispatchArgs(cmdList.get(), *particleScratchBuffers.rigidArgs, D3D12_RESOURCE_STATE_COMMON);
+    }
 
     // 5) (hash->cell start)
+    m_profiler.BeginScope(cmdList.get(), "cell ranges");
     m_hashToIndex->Dispatch(cmdList, numParticles);
     UAVBarrierSingle(cmdList, particleScratchBuffers.cellStart->resource);
     UAVBarrierSingle(cmdList, particleScratchBuffers.cellEnd->resource);
+    m_profiler.EndScope(cmdList.get());
 
-    // 6) PBF solver iterations
-    for (int iter = 0; iter < 10; ++iter)
+    // 6) Density solver iterations
+    if (m_pressureSolver == PressureSolver::Dfsph)
     {
-        // Compute density
-        m_computeDensity->Dispatch(cmdList, numParticles);
-        UAVBarrierSingle(cmdList, particleScratchBuffers.density->resource);
-
-        // Compute lambda
-        m_computeLambda->Dispatch(cmdList, numParticles);
-        UAVBarrierSingle(cmdList, particleScratchBuffers.lambda->resource);
-
-        // Compute position corrections
-        m_computeDeltaPos->Dispatch(cmdList, numParticles);
-        UAVBarrierSingle(cmdList, particleScratchBuffers.deltaP->resource);
-
-        // Apply corrections
-        m_applyDeltaPos->Dispatch(cmdList, numParticles);
-        UAVBarrierSingle(cmdList, particleScratchBuffers.predictedPosition->resource);
+        m_profiler.BeginScope(cmdList.get(), "dfsph density");
+        SolveDensityDfsph(cmdList);
+        m_profiler.EndScope(cmdList.get());
+    }
+    else
+    {
+        m_profiler.BeginScope(cmdList.get(), "pbf solver");
+        SolveDensityConstraints(cmdList);
+        m_profiler.EndScope(cmdList.get());
     }
 
     // 7) Update positions and velocities (write to position and velocity dst buffers)
-    m_updatePosVel->Dispatch(cmdList, numParticles);
+    m_profiler.BeginScope(cmdList.get(), "update pos/vel");
+    m_updatePosVel->DispatchIndirect(cmdList, m_activeDispatch);
     UAVBarrierSingle(cmdList, particleSwapBuffers.position.GetWriteBuffer()->resource);
     UAVBarrierSingle(cmdList, particleSwapBuffers.velocity.GetWriteBuffer()->resource);
+    m_profiler.EndScope(cmdList.get());
+
+    if (m_pressureSolver == PressureSolver::Dfsph)
+    {
+        m_profiler.BeginScope(cmdList.get(), "dfsph divergence");
+        SolveDivergenceDfsph(cmdList);
+        m_profiler.EndScope(cmdList.get());
+    }
 
     // 8) Viscosity: compute viscosity mu and coefficient from temperature
-    m_viscosity->Dispatch(cmdList, numParticles);
-    UAVBarrierSingle(cmdList, particleScratchBuffers.viscosityCoeff->resource);
+    if (runViscosity)
+    {
+        m_profiler.BeginScope(cmdList.get(), "viscosity");
+        m_viscosity->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, particleScratchBuffers.viscosityCoeff->resource);
+        m_profiler.EndScope(cmdList.get());
+    }
 
-    // 9) Apply viscosity to velocities
-    m_applyViscosity->Dispatch(cmdList, numParticles);
-    UAVBarrierSingle(cmdList, particleSwapBuffers.velocity.GetWriteBuffer()->resource);
+    // 9) Apply viscosity to velocities: v* from UpdatePositionVelocity becomes the read buffer,
+    // the result goes to the write buffer, which the next step starts from
+    m_profiler.BeginScope(cmdList.get(), "apply viscosity");
     particleSwapBuffers.velocity.Swap();
-    // SetVelocityPingPongRootSig(cmdList.get(), *allocGPU);
+    SetVelocityPingPongRootSig(cmdList.get(), *allocGPU);
+    if (m_viscositySolverMode == ViscositySolverMode::ImplicitCG)
+    {
+        SolveViscosityImplicit(cmdList);
+    }
+    else
+    {
+        m_applyViscosity->DispatchIndirect(cmdList, m_activeDispatch);
+    }
+    UAVBarrierSingle(cmdList, particleSwapBuffers.velocity.GetWriteBuffer()->resource);
+    m_profiler.EndScope(cmdList.get());
 
-    // 10) Heat transfer (temperature diffusion)
-    m_heatTransfer->Dispatch(cmdList, numParticles);
-    UAVBarrierSingle(cmdList, particleSwapBuffers.temperature.GetWriteBuffer()->resource);
-    particleSwapBuffers.temperature.Swap();
+    // 9b) Rigid crust: contacts with the updated fluid, then shape matching per cluster;
+    // velocities go to the buffer the next step starts from
+    if (m_simParams.rigidEnabled != 0)
+    {
+        m_profiler.BeginScope(cmdList.get(), "rigid crust");
+        SolveRigidClusters(cmdList);
+        m_profiler.EndScope(cmdList.get());
+    }
+
+    // 10) Heat transfer (temperature diffusion), radiation and convection only at the free surface
+    const bool surfaceCooling = m_simParams.surfaceCoolingEnabled != 0;
+    const bool runSurface = surfaceCooling && (m_surfaceListStale || m_stepIndex % m_surfaceInterval == 0);
+    if (runSurface)
+    {
+        m_profiler.BeginScope(cmdList.get(), "surface list");
+        m_surfaceClassify->Dispatch(cmdList, numParticles);
+        UAVBarrierSingle(cmdList, particleScratchBuffers.surfaceArgs->resource);
+        m_surfaceArgs->Dispatch(cmdList);
+        m_profiler.EndScope(cmdList.get());
+        m_surfaceListStale = false;
+    }
+
+    if (runThermal)
+    {
+        m_profiler.BeginScope(cmdList.get(), "heat transfer");
+        if (m_heatSolverMode == HeatSolverMode::ImplicitCG)
+        {
+            SolveHeatImplicit(cmdList, numParticles);
+        }
+        else if (m_heatSolverMode == HeatSolverMode::Grid)
+        {
+            SolveHeatGrid(cmdList, numParticles);
+        }
+        else
+        {
+            m_heatTransfer->Dispatch(cmdList, numParticles);
+        }
+        UAVBarrierSingle(cmdList, particleSwapBuffers.temperature.GetWriteBuffer()->resource);
+        if (surfaceCooling)
+        {
+            TransitionDispatchArgs(cmdList.get(), *particleScratchBuffers.surfaceArgs,
+                                   runSurface ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_COMMON);
+            m_surfaceCooling->DispatchIndirect(cmdList, m_surfaceDispatch);
+            UAVBarrierSingle(cmdList, particleSwapBuffers.temperature.GetWriteBuffer()->resource);
+        }
+        particleSwapBuffers.temperature.Swap();
+        m_profiler.EndScope(cmdList.get());
+    }
+
+    // 11) Maxima for the next step size
+    m_profiler.BeginScope(cmdList.get(), "step limits");
+    m_stepLimits->Dispatch(cmdList);
+    UAVBarrierSingle(cmdList, particleScratchBuffers.diagnostics->resource);
+    m_profiler.EndScope(cmdList.get());
+
+    // 12) Adaptive resolution on the grid of the step: children of splits are appended behind
+    // numParticles, merged particles are flagged killed and removed with the kill volumes
+    const bool runAdaptive = m_simParams.adaptiveEnabled != 0 && m_stepIndex % m_adaptiveInterval == 0;
+    const uint32_t splitBudget = runAdaptive ? std::min(m_slotPool.GetCapacity() - numParticles, numParticles) : 0;
+    if (runAdaptive)
+    {
+        m_profiler.BeginScope(cmdList.get(), "adaptive");
+        m_adaptivePair->Dispatch(cmdList, numParticles);
+        UAVBarrierSingle(cmdList, nullptr);
+
+        // the current temperature is the read buffer, bind it as u2 like the emitter does
+        particleSwapBuffers.temperature.Swap();
+        SetTemperaturePingPongRootSig(cmdList.get(), *allocGPU);
+        SetPassConstants(cmdList.get(), {0, splitBudget, PassFlagNone, m_nextParticleId});
+
+        m_adaptiveApply->Dispatch(cmdList, numParticles);
+
+        SetPassConstants(cmdList.get(), {});
+        particleSwapBuffers.temperature.Swap();
+        SetTemperaturePingPongRootSig(cmdList.get(), *allocGPU);
+        UAVBarrierSingle(cmdList, nullptr);
+        m_profiler.EndScope(cmdList.get());
+    }
+
+    // 13) Kill volumes: only flags and counts, the compaction runs after the readback if needed
+    const bool hasKillVolumes = m_simParams.killPlaneCount + m_simParams.killBoxCount > 0;
+    if (hasKillVolumes || runAdaptive)
+    {
+        m_profiler.BeginScope(cmdList.get(), "kill mark");
+        SetPassConstants(cmdList.get(), {0, splitBudget, PassFlagNone, 0});
+        m_killMark->Dispatch(cmdList, numParticles + splitBudget);
+        UAVBarrierSingle(cmdList, particleScratchBuffers.activeGroupOffsets->resource);
+        m_killScan->Dispatch(cmdList);
+        SetPassConstants(cmdList.get(), {});
+        UAVBarrierSingle(cmdList, particleScratchBuffers.diagnostics->resource);
+        m_profiler.EndScope(cmdList.get());
+    }
+
+    UploadHelpers::CopyResourceToReadback(
+        cmdList.get(),
+        particleScratchBuffers.diagnostics->resource.get(),
+        m_diagnosticsReadback.get(),
+        UINT64(DiagnosticsSlot::NumberOfDiagnosticsSlots) * sizeof(uint32_t),
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    m_profiler.Resolve(cmdList.get());
 
     ThrowIfFailed(cmdList->Close());
     ID3D12CommandList *lists2[] = {cmdList.get()};
@@ -829,23 +1892,1789 @@ void SimulationSystem::Simulate(float dt)
 
     fenceVal++;
     RenderSubsystem::WaitForFence(fence.get(), fenceVal);
-}
-#pragma endregion
 
-// TODO: move to StructuredBuffer?
-#pragma region GETTERS
-D3D12_GPU_DESCRIPTOR_HANDLE SimulationSystem::GetPositionBufferSRV()
-{
-    auto alloc = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
-    UINT idx = particleSwapBuffers.position.GetReadBuffer()->srvIndex;
-    return alloc->GetGpuHandle(idx);
+    m_profiler.EndFrame();
+    ReadDiagnostics();
+
+    if (runAdaptive)
+    {
+        ApplyAdaptiveResolution(splitBudget);
+    }
+    else if (hasKillVolumes && m_lastKilledCount > 0)
+    {
+        CompactParticles(numParticles - m_lastKilledCount);
+    }
 }
 
-D3D12_GPU_DESCRIPTOR_HANDLE SimulationSystem::GetTemperatureBufferSRV()
+void SimulationSystem::ApplyAdaptiveResolution(uint32_t splitBudget)
 {
-    auto alloc = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
-    UINT idx = particleSwapBuffers.temperature.GetReadBuffer()->srvIndex;
-    return alloc->GetGpuHandle(idx);
+    const UINT slot = static_cast<UINT>(DiagnosticsSlot::Adaptive);
+    const uint32_t splits = std::min(m_diagnostics[slot], splitBudget);
+    const uint32_t merges = m_diagnostics[slot + 1];
+    m_splitTotal += splits;
+    m_mergeTotal += merges;
+
+    // the children are live now; the kill scan already counted them among the survivors
+    m_simParams.numParticles += splits;
+    m_slotPool.Append(splits);
+    m_nextParticleId += splits;
+
+    if (splits > 0)
+    {
+        // the compaction runs over the children too
+        D3D12_RANGE readRange{0, 0};
+        void *pData = nullptr;
+        ThrowIfFailed(m_simParamsUpload->Map(0, &readRange, &pData));
+        memcpy(pData, &m_simParams, sizeof(SimParams));
+        m_simParamsUpload->Unmap(0, nullptr);
+    }
+
+    if (m_lastKilledCount > 0)
+    {
+        CompactParticles(m_simParams.numParticles - m_lastKilledCount);
+        // merged particles are not kill volume losses
+        m_killedTotal -= merges;
+    }
+    else if (splits > 0)
+    {
+        RebuildGrid();
+    }
+
+    // histogram of the particles before the compaction; a level L particle stands for
+    // 2^(L - minLevel) particles of a simulation at the finest level
+    m_levelCounts.assign(m_diagnostics.begin() + slot + 2,
+                         m_diagnostics.begin() + slot + 2 + (k_adaptiveLevelMax - k_adaptiveLevelMin + 1));
+    double uniform = 0.0;
+    for (int level = m_simParams.minLevel; level <= m_simParams.maxLevel; ++level)
+    {
+        uniform += m_levelCounts[level - k_adaptiveLevelMin] * std::exp2(double(level - m_simParams.minLevel));
+    }
+    m_adaptiveSamples.push_back({m_stepController.GetSimulatedTime(), m_simParams.numParticles, uniform});
+}
+
+uint32_t SimulationSystem::QueueEmittedParticles(float dt)
+{
+    if (m_emitters.empty())
+    {
+        return 0;
+    }
+
+    // grow before the emitters run out of slots, doubling keeps the number of growths logarithmic
+    uint32_t pending = 0;
+    for (const ParticleEmitter &emitter : m_emitters)
+    {
+        pending += emitter.GetPendingCount(dt);
+    }
+    pending = std::min<uint32_t>(pending, m_maxEmittedPerStep);
+    if (pending > m_slotPool.GetAvailable() && m_particleCapacity < m_maxParticleCapacity)
+    {
+        const uint64_t needed = uint64_t(m_particleCapacity) + pending - m_slotPool.GetAvailable();
+        const uint64_t doubled = 2 * uint64_t(m_particleCapacity);
+        GrowCapacity(static_cast<uint32_t>(std::min<uint64_t>(std::max(needed, doubled), m_maxParticleCapacity)));
+    }
+
+    ScopedTimer timer(m_emitQueueStats);
+
+    uint32_t count = 0;
+    for (ParticleEmitter &emitter : m_emitters)
+    {
+        count += emitter.Emit(dt, m_slotPool, m_emitUploadData + count, m_maxEmittedPerStep - count);
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        m_emitUploadData[i].id = m_nextParticleId++;
+    }
+
+    m_simParams.numParticles = m_slotPool.LiveEnd();
+    m_emittedTotal += count;
+    m_emittedStats.add(count);
+    return count;
+}
+
+void SimulationSystem::EmitParticles(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+    uint32_t emittedCount)
+{
+    std::shared_ptr<DescriptorAllocator> allocGPU = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
+    auto &queue = *particleScratchBuffers.emitQueue;
+
+    // promoted from COMMON to COPY_DEST by the copy
+    cmdList->CopyBufferRegion(queue.resource.get(), 0, m_emitUpload.get(), 0, UINT64(emittedCount) * sizeof(EmittedParticle));
+    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+        queue.resource.get(),
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    cmdList->ResourceBarrier(1, &barrier);
+
+    // the temperature the step starts from is the read buffer, bind it as u2 for this pass
+    particleSwapBuffers.temperature.Swap();
+    SetTemperaturePingPongRootSig(cmdList.get(), *allocGPU);
+    SetPassConstants(cmdList.get(), {0, emittedCount, PassFlagNone, 0});
+
+    m_emitParticles->Dispatch(cmdList, emittedCount);
+
+    SetPassConstants(cmdList.get(), {});
+    particleSwapBuffers.temperature.Swap();
+    SetTemperaturePingPongRootSig(cmdList.get(), *allocGPU);
+    UAVBarrierSingle(cmdList, nullptr);
+}
+
+void SimulationSystem::CompactParticles(uint32_t survivors)
+{
+    // Rare path, submitted after the step: compaction, then the grid of the step is rebuilt for
+    // the new indices, since the next step starts with passes over the previous grid.
+    ScopedTimer timer(m_compactionStats);
+
+    winrt::com_ptr<ID3D12Device> device = RenderSubsystem::GetDevice();
+    std::shared_ptr<DescriptorAllocator> allocGPU = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
+    auto queue = RenderSubsystem::GetCommandQueue();
+    const uint32_t numParticles = m_simParams.numParticles;
+
+    winrt::com_ptr<ID3D12CommandAllocator> cmdAlloc;
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList;
+    ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(cmdAlloc.put())));
+    ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, cmdAlloc.get(), nullptr, IID_PPV_ARGS(cmdList.put())));
+
+    winrt::com_ptr<ID3D12Fence> compactFence;
+    ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(compactFence.put())));
+    uint64_t fenceVal = 0;
+
+    auto submit = [&]()
+    {
+        ThrowIfFailed(cmdList->Close());
+        ID3D12CommandList *lists[] = {cmdList.get()};
+        queue->ExecuteCommandLists(1, lists);
+        RenderSubsystem::WaitForFence(compactFence.get(), ++fenceVal);
+        ThrowIfFailed(cmdList->Reset(cmdAlloc.get(), nullptr));
+    };
+
+    SetRootSigAndDescTables(cmdList.get(), *allocGPU);
+
+    // current state is read, the spare ping-pong halves are written: position read -> write,
+    // velocity write (the next step starts from it) -> read, temperature read -> write
+    particleSwapBuffers.velocity.Swap();
+    SetPingPongBufferRootSig(cmdList.get(), particleSwapBuffers.position, 0, 1, *allocGPU);
+    SetVelocityPingPongRootSig(cmdList.get(), *allocGPU);
+
+    m_compactScatter->Dispatch(cmdList, numParticles);
+    UAVBarrierSingle(cmdList, nullptr);
+
+    SetPassConstants(cmdList.get(), {0, survivors, PassFlagNone, 0});
+    m_compactFinish->Dispatch(cmdList, numParticles);
+    SetPassConstants(cmdList.get(), {});
+    submit();
+
+    particleSwapBuffers.position.Swap();
+    particleSwapBuffers.temperature.Swap();
+
+    m_simParams.numParticles = survivors;
+    D3D12_RANGE readRange{0, 0};
+    void *pData = nullptr;
+    ThrowIfFailed(m_simParamsUpload->Map(0, &readRange, &pData));
+    memcpy(pData, &m_simParams, sizeof(SimParams));
+    m_simParamsUpload->Unmap(0, nullptr);
+
+    // grid over the compacted predicted positions (= positions)
+    RebuildGrid();
+
+    // the emitters refill from the new end, indices of solids changed
+    m_slotPool.Reset(m_slotPool.GetCapacity(), survivors);
+    m_rigidFullRebuildPending = true;
+    m_surfaceListStale = true;
+    m_killedTotal += numParticles - survivors;
+}
+
+void SimulationSystem::RebuildGrid()
+{
+    winrt::com_ptr<ID3D12Device> device = RenderSubsystem::GetDevice();
+    std::shared_ptr<DescriptorAllocator> allocGPU = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
+    auto queue = RenderSubsystem::GetCommandQueue();
+    const uint32_t numParticles = m_simParams.numParticles;
+
+    winrt::com_ptr<ID3D12CommandAllocator> cmdAlloc;
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList;
+    ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(cmdAlloc.put())));
+    ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, cmdAlloc.get(), nullptr, IID_PPV_ARGS(cmdList.put())));
+
+    winrt::com_ptr<ID3D12Fence> gridFence;
+    ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(gridFence.put())));
+    uint64_t fenceVal = 0;
+
+    auto submit = [&]()
+    {
+        ThrowIfFailed(cmdList->Close());
+        ID3D12CommandList *lists[] = {cmdList.get()};
+        queue->ExecuteCommandLists(1, lists);
+        RenderSubsystem::WaitForFence(gridFence.get(), ++fenceVal);
+        ThrowIfFailed(cmdList->Reset(cmdAlloc.get(), nullptr));
+    };
+
+    SetRootSigAndDescTables(cmdList.get(), *allocGPU);
+    m_cellHash->Dispatch(cmdList, std::max<uint32_t>(numParticles, m_gridCellsCount));
+    submit();
+
+    m_oneSweep->Sort();
+
+    SetRootSigAndDescTables(cmdList.get(), *allocGPU);
+    m_hashToIndex->Dispatch(cmdList, numParticles);
+    submit();
+}
+
+void SimulationSystem::GrowCapacity(uint32_t newCapacity)
+{
+    // Runs between steps while the GPU is idle. Each per-particle buffer is replaced by a larger
+    // one with the old contents at the front, and its views are rewritten at the same descriptor
+    // indices, so root tables and the renderer keep working unchanged.
+    const auto start = std::chrono::steady_clock::now();
+    const uint32_t oldCapacity = m_particleCapacity;
+
+    winrt::com_ptr<ID3D12Device> device = RenderSubsystem::GetDevice();
+    std::shared_ptr<DescriptorAllocator> allocGPU = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
+    auto queue = RenderSubsystem::GetCommandQueue();
+
+    winrt::com_ptr<ID3D12CommandAllocator> cmdAlloc;
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList;
+    ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(cmdAlloc.put())));
+    ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, cmdAlloc.get(), nullptr, IID_PPV_ARGS(cmdList.put())));
+
+    std::shared_ptr<StructuredBuffer> *perParticle[] = {
+        &particleSwapBuffers.position.buffers[0],
+        &particleSwapBuffers.position.buffers[1],
+        &particleSwapBuffers.velocity.buffers[0],
+        &particleSwapBuffers.velocity.buffers[1],
+        &particleSwapBuffers.temperature.buffers[0],
+        &particleSwapBuffers.temperature.buffers[1],
+        &particleScratchBuffers.predictedPosition,
+        &particleScratchBuffers.density,
+        &particleScratchBuffers.constraintC,
+        &particleScratchBuffers.lambda,
+        &particleScratchBuffers.deltaP,
+        &particleScratchBuffers.solverColor,
+        &particleScratchBuffers.viscosityMu,
+        &particleScratchBuffers.viscosityCoeff,
+        &particleScratchBuffers.phase,
+        &particleScratchBuffers.activeIndices,
+        &particleScratchBuffers.rigidLabel,
+        &particleScratchBuffers.rigidRestOffset,
+        &particleScratchBuffers.rigidMembers,
+        &particleScratchBuffers.rigidClusterOffsets,
+        &particleScratchBuffers.rigidClusters,
+        &particleScratchBuffers.rigidRotation,
+        &particleScratchBuffers.particleId,
+        &particleScratchBuffers.compactUint,
+        &particleScratchBuffers.compactFloat,
+        &particleScratchBuffers.particleLevel,
+        &particleScratchBuffers.surfaceIndices,
+        &particleScratchBuffers.heatDiagonal,
+        &particleScratchBuffers.heatResidual,
+        &particleScratchBuffers.heatPrecond,
+        &particleScratchBuffers.heatDirection,
+        &particleScratchBuffers.heatProduct,
+        &particleScratchBuffers.viscosityDiagonal,
+        &particleScratchBuffers.viscosityResidual,
+        &particleScratchBuffers.viscosityPrecond,
+        &particleScratchBuffers.viscosityDirection,
+        &particleScratchBuffers.viscosityProduct,
+        &particleScratchBuffers.dfsphKappa,
+        &particleScratchBuffers.dfsphKappaV,
+        &particleScratchBuffers.dfsphStiffness,
+        &sortBuffers.hashBuffers[0],
+        &sortBuffers.hashBuffers[1],
+        &sortBuffers.indexBuffers[0],
+        &sortBuffers.indexBuffers[1],
+    };
+    // one element per thread group
+    std::shared_ptr<StructuredBuffer> *perGroup[] = {
+        &particleScratchBuffers.activeGroupOffsets,
+        &particleScratchBuffers.rigidGroupOffsets,
+        &particleScratchBuffers.solverPartials,
+    };
+
+    // the old resources have to outlive the copies
+    std::vector<std::shared_ptr<StructuredBuffer>> retired;
+    UINT64 bytes = 0;
+    auto grow = [&](std::shared_ptr<StructuredBuffer> &buffer, UINT count)
+    {
+        auto grown = CreateBuffer(device.get(), count, buffer->elementStride);
+        // promoted from COMMON to COPY_SOURCE / COPY_DEST by the copy
+        cmdList->CopyBufferRegion(grown->resource.get(), 0, buffer->resource.get(), 0, UINT64(buffer->elementCount) * buffer->elementStride);
+        if (buffer->srvIndex != UINT_MAX)
+        {
+            grown->CreateSRV(device.get(), *allocGPU, buffer->srvIndex);
+        }
+        if (buffer->uavIndex != UINT_MAX)
+        {
+            grown->CreateUAV(device.get(), *allocGPU, buffer->uavIndex);
+        }
+        bytes += UINT64(count) * buffer->elementStride;
+        retired.push_back(buffer);
+        buffer = grown;
+    };
+
+    for (auto *buffer : perParticle)
+    {
+        grow(*buffer, newCapacity);
+    }
+    for (auto *buffer : perGroup)
+    {
+        grow(*buffer, (newCapacity + 255) / 256);
+    }
+
+    // new slots keep the sort invariant: hash UINT_MAX, identity payload
+    const uint32_t added = newCapacity - oldCapacity;
+    const UINT64 tailSize = UINT64(added) * sizeof(uint32_t);
+    auto uploadHash = UploadHelpers::CreateUploadBuffer(device.get(), tailSize);
+    auto uploadIndex = UploadHelpers::CreateUploadBuffer(device.get(), tailSize);
+    D3D12_RANGE readRange{0, 0};
+    void *pUpload = nullptr;
+    ThrowIfFailed(uploadHash->Map(0, &readRange, &pUpload));
+    memset(pUpload, 0xff, tailSize);
+    uploadHash->Unmap(0, nullptr);
+    ThrowIfFailed(uploadIndex->Map(0, &readRange, &pUpload));
+    std::iota(static_cast<uint32_t *>(pUpload), static_cast<uint32_t *>(pUpload) + added, oldCapacity);
+    uploadIndex->Unmap(0, nullptr);
+
+    const UINT64 tailOffset = UINT64(oldCapacity) * sizeof(uint32_t);
+    cmdList->CopyBufferRegion(sortBuffers.hashBuffers[0]->resource.get(), tailOffset, uploadHash.get(), 0, tailSize);
+    cmdList->CopyBufferRegion(sortBuffers.indexBuffers[0]->resource.get(), tailOffset, uploadIndex.get(), 0, tailSize);
+    cmdList->CopyBufferRegion(sortBuffers.indexBuffers[1]->resource.get(), tailOffset, uploadIndex.get(), 0, tailSize);
+
+    ThrowIfFailed(cmdList->Close());
+    ID3D12CommandList *lists[] = {cmdList.get()};
+    queue->ExecuteCommandLists(1, lists);
+
+    winrt::com_ptr<ID3D12Fence> growFence;
+    ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(growFence.put())));
+    RenderSubsystem::WaitForFence(growFence.get(), 1);
+
+    // the sort scratch follows the key count
+    m_oneSweep->SetAllBuffers(
+        sortBuffers.hashBuffers[0]->resource,
+        sortBuffers.indexBuffers[0]->resource,
+        sortBuffers.hashBuffers[1]->resource,
+        sortBuffers.indexBuffers[1]->resource,
+        true);
+    m_oneSweep->UpdateSize(newCapacity, true);
+
+    m_particleCapacity = newCapacity;
+    m_slotPool.Grow(newCapacity);
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_capacityGrowths.push_back({m_stepIndex, oldCapacity, newCapacity, bytes, ms});
+}
+
+void SimulationSystem::BuildActiveList(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+    uint32_t numParticles)
+{
+    // Runs over all particles in the grid order of the previous step. Sleepers keep their
+    // position in the neighbor grid and are read as static neighbors by the active ones.
+    auto &scratch = particleScratchBuffers;
+
+    m_classifyPhase->Dispatch(cmdList, numParticles);
+    // sleepers reset velocity, predicted position and solver state
+    UAVBarrierSingle(cmdList, nullptr);
+
+    m_activeListScan->Dispatch(cmdList);
+    // offsets, and the time level histogram cleared for the scatter
+    UAVBarrierSingle(cmdList, nullptr);
+
+    // with the velocity halves swapped, so the scatter also copies the velocity of waiting and
+    // sleeping particles to the half the step does not start from
+    std::shared_ptr<DescriptorAllocator> allocGPU = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
+    particleSwapBuffers.velocity.Swap();
+    SetVelocityPingPongRootSig(cmdList.get(), *allocGPU);
+    m_activeListScatter->Dispatch(cmdList, numParticles);
+    particleSwapBuffers.velocity.Swap();
+    SetVelocityPingPongRootSig(cmdList.get(), *allocGPU);
+    UAVBarrierSingle(cmdList, scratch.activeIndices->resource);
+    UAVBarrierSingle(cmdList, particleSwapBuffers.velocity.GetReadBuffer()->resource);
+
+    TransitionDispatchArgs(cmdList.get(), *scratch.activeArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+}
+
+void SimulationSystem::RebuildRigidClusters(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+{
+    // The classify pass counted particles that solidified or melted. Without changes the
+    // rebuild arguments hold zero thread groups and the single-group passes return early,
+    // so steady crust costs only a few empty dispatches. The labels are always recomputed
+    // from scratch, but clusters whose members did not change keep their rest shape and
+    // rotation; only after particle indices changed does every cluster take a new one.
+    auto &scratch = particleScratchBuffers;
+
+    SetPassConstants(cmdList.get(), {0, 0, PassFlagNone, m_rigidFullRebuildPending ? 1u : 0u});
+    m_rigidRebuildArgs->Dispatch(cmdList);
+    SetPassConstants(cmdList.get(), {});
+    TransitionDispatchArgs(cmdList.get(), *scratch.rigidRebuildArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    m_rigidFullRebuildPending = false;
+
+    m_rigidLabelInit->DispatchIndirect(cmdList, m_rigidRebuildDispatch);
+    UAVBarrierSingle(cmdList, scratch.rigidLabel->resource);
+    UAVBarrierSingle(cmdList, scratch.rigidMembers->resource);
+    UAVBarrierSingle(cmdList, scratch.rigidClusterOffsets->resource);
+
+    m_rigidLabelHook->DispatchIndirect(cmdList, m_rigidRebuildDispatch);
+    UAVBarrierSingle(cmdList, scratch.rigidLabel->resource);
+
+    m_rigidLabelCompress->DispatchIndirect(cmdList, m_rigidRebuildDispatch);
+    UAVBarrierSingle(cmdList, scratch.rigidLabel->resource);
+    UAVBarrierSingle(cmdList, scratch.rigidClusterOffsets->resource);
+
+    // explicit, the scan may not write the arguments
+    auto toUav = CD3DX12_RESOURCE_BARRIER::Transition(
+        scratch.rigidArgs->resource.get(),
+        D3D12_RESOURCE_STATE_COMMON,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    cmdList->ResourceBarrier(1, &toUav);
+
+    // cluster totals per group, scanned by one group, then offsets inside each group
+    m_rigidClusterCount->DispatchIndirect(cmdList, m_rigidRebuildDispatch);
+    UAVBarrierSingle(cmdList, scratch.rigidGroupOffsets->resource);
+
+    m_rigidClusterScan->Dispatch(cmdList);
+    UAVBarrierSingle(cmdList, scratch.rigidGroupOffsets->resource);
+    TransitionDispatchArgs(cmdList.get(), *scratch.rigidArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    m_rigidClusterOffsets->DispatchIndirect(cmdList, m_rigidRebuildDispatch);
+    UAVBarrierSingle(cmdList, scratch.rigidClusterOffsets->resource);
+    UAVBarrierSingle(cmdList, scratch.rigidClusters->resource);
+    UAVBarrierSingle(cmdList, scratch.rigidRotation->resource);
+
+    m_rigidMemberScatter->DispatchIndirect(cmdList, m_rigidRebuildDispatch);
+    UAVBarrierSingle(cmdList, scratch.rigidMembers->resource);
+
+    m_rigidRestShape->DispatchIndirect(cmdList, m_rigidClusterDispatch);
+    UAVBarrierSingle(cmdList, scratch.rigidRestOffset->resource);
+    UAVBarrierSingle(cmdList, scratch.rigidRotation->resource);
+}
+
+void SimulationSystem::SolveRigidClusters(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+{
+    // one rotation and translation per cluster instead of per-particle solver iterations
+    auto &scratch = particleScratchBuffers;
+
+    m_rigidContact->DispatchIndirect(cmdList, m_rigidSolidDispatch);
+    UAVBarrierSingle(cmdList, scratch.deltaP->resource);
+
+    // single-particle clusters have nothing to fit and move per particle instead
+    m_rigidShapeMatch->DispatchIndirect(cmdList, m_rigidClusterDispatch);
+    m_rigidSingleMove->DispatchIndirect(cmdList, m_rigidSingleDispatch);
+    UAVBarrierSingle(cmdList, particleSwapBuffers.position.GetReadBuffer()->resource);
+    UAVBarrierSingle(cmdList, scratch.predictedPosition->resource);
+    UAVBarrierSingle(cmdList, particleSwapBuffers.velocity.GetWriteBuffer()->resource);
+}
+
+void SimulationSystem::TransitionDispatchArgs(
+    ID3D12GraphicsCommandList *cmdList,
+    const StructuredBuffer &args,
+    D3D12_RESOURCE_STATES before)
+{
+    // read by ExecuteIndirect and by the shaders (activeArgs, rigidArgs)
+    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+        args.resource.get(),
+        before,
+        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    cmdList->ResourceBarrier(1, &barrier);
+}
+
+void SimulationSystem::SolveDensityConstraints(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+{
+    // Gauss-Seidel: corrections of one color are applied before the next color
+    // recomputes its density and lambda, so later colors see the updated positions.
+    // Particles inside one color block are still updated Jacobi-style. Colors are fixed
+    // at the start of the step and each color pass recomputes only its own particles;
+    // neighbors of other colors keep the lambda of their latest pass.
+    const bool gaussSeidel = m_pbfSolverMode == PbfSolverMode::ColoredGaussSeidel;
+    const uint32_t colorCount = gaussSeidel ? 8 : 1;
+
+    m_probeMarks.clear();
+
+    if (gaussSeidel)
+    {
+        m_solverColor->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, particleScratchBuffers.solverColor->resource);
+    }
+
+    for (int iter = 0; iter < m_pbfIterations; ++iter)
+    {
+        const bool probe = m_convergenceProbe && iter < static_cast<int>(k_maxProbedSolverIterations);
+        UINT iterBegin = probe ? m_profiler.Mark(cmdList.get()) : 0;
+
+        for (uint32_t color = 0; color < colorCount; ++color)
+        {
+            // the first pass of the step covers every color, the neighbors need a lambda
+            const bool allColors = !gaussSeidel || (iter == 0 && color == 0);
+            SetPassConstants(cmdList.get(), {color, colorCount, allColors ? PassFlagNone : PassFlagColorFilter});
+
+            // Compute density
+            m_computeDensity->DispatchIndirect(cmdList, m_activeDispatch);
+            UAVBarrierSingle(cmdList, particleScratchBuffers.density->resource);
+
+            // Compute lambda
+            m_computeLambda->DispatchIndirect(cmdList, m_activeDispatch);
+            UAVBarrierSingle(cmdList, particleScratchBuffers.lambda->resource);
+
+            if (gaussSeidel)
+            {
+                SetPassConstants(cmdList.get(), {color, colorCount, PassFlagColorFilter});
+            }
+
+            // Compute position corrections
+            m_computeDeltaPos->DispatchIndirect(cmdList, m_activeDispatch);
+            UAVBarrierSingle(cmdList, particleScratchBuffers.deltaP->resource);
+
+            // Apply corrections
+            m_applyDeltaPos->DispatchIndirect(cmdList, m_activeDispatch);
+            UAVBarrierSingle(cmdList, particleScratchBuffers.predictedPosition->resource);
+        }
+
+        if (probe)
+        {
+            ProbeDensityResidual(cmdList, iter, iterBegin);
+        }
+    }
+
+    SetPassConstants(cmdList.get(), {});
+}
+
+void SimulationSystem::ProbeDensityResidual(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+    int iteration,
+    UINT iterationBeginMark)
+{
+    UINT iterEnd = m_profiler.Mark(cmdList.get());
+    m_probeMarks.emplace_back(iterationBeginMark, iterEnd);
+
+    // residual of the corrected positions, not counted as solver time
+    SetPassConstants(cmdList.get(), {static_cast<uint32_t>(iteration)});
+    m_computeDensity->DispatchIndirect(cmdList, m_activeDispatch);
+    UAVBarrierSingle(cmdList, particleScratchBuffers.density->resource);
+    m_densityResidual->Dispatch(cmdList);
+    UAVBarrierSingle(cmdList, particleScratchBuffers.diagnostics->resource);
+    SetPassConstants(cmdList.get(), {});
+}
+
+void SimulationSystem::SolveDensityDfsph(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+{
+    // Constant density pass at position level on the predicted positions. The gravity-only
+    // prediction plays the role of the paper's predicted velocity, corrections move x* and
+    // UpdatePositionVelocity turns them into velocity changes.
+    auto &scratch = particleScratchBuffers;
+    m_probeMarks.clear();
+
+    m_computeDensity->DispatchIndirect(cmdList, m_activeDispatch);
+    UAVBarrierSingle(cmdList, scratch.density->resource);
+    m_dfsphFactor->DispatchIndirect(cmdList, m_activeDispatch);
+    UAVBarrierSingle(cmdList, scratch.lambda->resource);
+
+    for (int iter = -1; iter < m_dfsphDensityIterations; ++iter)
+    {
+        // iteration -1 applies the warm start from the previous step
+        const bool warmStart = iter < 0;
+        const bool probe = m_convergenceProbe && !warmStart && iter < static_cast<int>(k_maxProbedSolverIterations);
+        UINT iterBegin = probe ? m_profiler.Mark(cmdList.get()) : 0;
+
+        if (!warmStart)
+        {
+            m_computeDensity->DispatchIndirect(cmdList, m_activeDispatch);
+            UAVBarrierSingle(cmdList, scratch.density->resource);
+        }
+
+        SetPassConstants(cmdList.get(), {0, 0, warmStart ? PassFlagWarmStart : PassFlagNone});
+        m_dfsphDensityStiffness->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, scratch.dfsphStiffness->resource);
+        SetPassConstants(cmdList.get(), {});
+
+        m_dfsphPressureDelta->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, scratch.deltaP->resource);
+
+        m_applyDeltaPos->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, scratch.predictedPosition->resource);
+
+        if (probe)
+        {
+            ProbeDensityResidual(cmdList, iter, iterBegin);
+        }
+    }
+}
+
+void SimulationSystem::SolveDivergenceDfsph(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+{
+    // Divergence-free pass on the new velocities with alpha of this step; the paper runs
+    // it at the start of the next step, which uses the same positions.
+    auto &scratch = particleScratchBuffers;
+    auto velocity = particleSwapBuffers.velocity.GetWriteBuffer();
+
+    for (int iter = -1; iter < m_dfsphDivergenceIterations; ++iter)
+    {
+        const bool warmStart = iter < 0;
+
+        SetPassConstants(cmdList.get(), {0, 0, warmStart ? PassFlagWarmStart : PassFlagNone});
+        m_dfsphDivergenceStiffness->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, scratch.dfsphStiffness->resource);
+        SetPassConstants(cmdList.get(), {});
+
+        m_dfsphPressureDelta->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, scratch.deltaP->resource);
+
+        m_applyDeltaVelocity->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, velocity->resource);
+    }
+}
+
+void SimulationSystem::SolveHeatImplicit(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+    uint32_t numParticles)
+{
+    // Every iteration is recorded up front; once the residual drops below the tolerance
+    // the scalars kernel raises the converged flag and the remaining dispatches return
+    // immediately, so no CPU round trip is needed inside the solve.
+    const uint32_t partialCount = (numParticles + 255) / 256;
+    auto &scratch = particleScratchBuffers;
+
+    m_heatCgSetup->Dispatch(cmdList, numParticles);
+    UAVBarrierSingle(cmdList, scratch.solverPartials->resource);
+    UAVBarrierSingle(cmdList, scratch.heatDirection->resource);
+    UAVBarrierSingle(cmdList, particleSwapBuffers.temperature.GetWriteBuffer()->resource);
+
+    DispatchSolverScalars(cmdList, SolverPassInit, partialCount, DiagnosticsSlot::HeatSolver);
+
+    for (int iter = 0; iter < m_heatSolverIterations; ++iter)
+    {
+        // Ap, p.Ap
+        m_heatCgApply->Dispatch(cmdList, numParticles);
+        UAVBarrierSingle(cmdList, scratch.heatProduct->resource);
+        UAVBarrierSingle(cmdList, scratch.solverPartials->resource);
+
+        DispatchSolverScalars(cmdList, SolverPassAlpha, partialCount, DiagnosticsSlot::HeatSolver);
+
+        // x, r, z, r.z
+        m_heatCgUpdate->Dispatch(cmdList, numParticles);
+        UAVBarrierSingle(cmdList, scratch.heatPrecond->resource);
+        UAVBarrierSingle(cmdList, scratch.solverPartials->resource);
+
+        DispatchSolverScalars(cmdList, SolverPassBeta, partialCount, DiagnosticsSlot::HeatSolver);
+
+        // p
+        m_heatCgDirection->Dispatch(cmdList, numParticles);
+        UAVBarrierSingle(cmdList, scratch.heatDirection->resource);
+    }
+
+    SetPassConstants(cmdList.get(), {});
+}
+
+void SimulationSystem::SolveHeatGrid(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+    uint32_t numParticles)
+{
+    // Cost scales with the grid nodes instead of the 5h particle neighborhoods. Fixed number of
+    // sweeps, no residual check; backward Euler keeps any thermal dt stable.
+    auto &scratch = particleScratchBuffers;
+
+    m_heatGridSplat->Dispatch(cmdList, numParticles);
+    UAVBarrierSingle(cmdList, scratch.heatGridAccum->resource);
+
+    m_heatGridSetup->Dispatch(cmdList, m_heatGridNodeCount);
+    UAVBarrierSingle(cmdList, nullptr);
+
+    for (int iter = 0; iter < m_heatSolverIterations; ++iter)
+    {
+        SetPassConstants(cmdList.get(), {static_cast<uint32_t>(iter)});
+        m_heatGridJacobi->Dispatch(cmdList, m_heatGridNodeCount);
+        UAVBarrierSingle(cmdList, scratch.heatGridTemperature->resource);
+    }
+
+    SetPassConstants(cmdList.get(), {0, static_cast<uint32_t>(m_heatSolverIterations)});
+    m_heatGridGather->Dispatch(cmdList, numParticles);
+    SetPassConstants(cmdList.get(), {});
+}
+
+void SimulationSystem::SolveViscosityImplicit(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList)
+{
+    // same scheme as SolveHeatImplicit, on float3 velocities of the active particles;
+    // the partial count is the group count of the active list, known only on the GPU
+    const uint32_t partialCount = 0;
+    auto &scratch = particleScratchBuffers;
+
+    m_viscosityCgSetup->DispatchIndirect(cmdList, m_activeDispatch);
+    UAVBarrierSingle(cmdList, scratch.solverPartials->resource);
+    UAVBarrierSingle(cmdList, scratch.viscosityDirection->resource);
+    UAVBarrierSingle(cmdList, particleSwapBuffers.velocity.GetWriteBuffer()->resource);
+
+    DispatchSolverScalars(cmdList, SolverPassInit, partialCount, DiagnosticsSlot::ViscositySolver);
+
+    for (int iter = 0; iter < m_viscositySolverIterations; ++iter)
+    {
+        // Ap, p.Ap
+        m_viscosityCgApply->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, scratch.viscosityProduct->resource);
+        UAVBarrierSingle(cmdList, scratch.solverPartials->resource);
+
+        DispatchSolverScalars(cmdList, SolverPassAlpha, partialCount, DiagnosticsSlot::ViscositySolver);
+
+        // v, r, z, r.z
+        m_viscosityCgUpdate->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, scratch.viscosityPrecond->resource);
+        UAVBarrierSingle(cmdList, scratch.solverPartials->resource);
+
+        DispatchSolverScalars(cmdList, SolverPassBeta, partialCount, DiagnosticsSlot::ViscositySolver);
+
+        // p
+        m_viscosityCgDirection->DispatchIndirect(cmdList, m_activeDispatch);
+        UAVBarrierSingle(cmdList, scratch.viscosityDirection->resource);
+    }
+
+    SetPassConstants(cmdList.get(), {});
+}
+
+void SimulationSystem::DispatchSolverScalars(
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList,
+    SolverPass pass,
+    uint32_t partialCount,
+    DiagnosticsSlot diagnosticsSlot)
+{
+    const uint32_t flags = partialCount == 0 ? PassFlagActiveList : PassFlagNone;
+    SetPassConstants(cmdList.get(), {pass, partialCount, flags, static_cast<uint32_t>(diagnosticsSlot)});
+    m_solverScalars->Dispatch(cmdList);
+    UAVBarrierSingle(cmdList, particleScratchBuffers.solverScalars->resource);
+}
+
+void SimulationSystem::ReadDiagnostics()
+{
+    UploadHelpers::ReadbackToHost(
+        m_diagnosticsReadback.get(),
+        m_diagnostics.data(),
+        m_diagnostics.size() * sizeof(uint32_t));
+
+    StepLimitValues limits;
+    limits.maxSpeed = GetDiagnosticFloat(DiagnosticsSlot::StepLimits, 0);
+    limits.maxViscosity = GetDiagnosticFloat(DiagnosticsSlot::StepLimits, 1);
+    limits.maxConductivity = GetDiagnosticFloat(DiagnosticsSlot::StepLimits, 2);
+    m_stepController.UpdateLimits(limits, m_simParams);
+
+    m_lastActiveCount = m_diagnostics[static_cast<UINT>(DiagnosticsSlot::ActiveCount)];
+    m_lastKilledCount = m_diagnostics[static_cast<UINT>(DiagnosticsSlot::Killed)];
+    m_minActiveCount = std::min(m_minActiveCount, m_lastActiveCount);
+    m_activeCountStats.add(m_lastActiveCount);
+
+    if (m_simParams.surfaceCoolingEnabled != 0)
+    {
+        m_lastSurfaceCount = m_diagnostics[static_cast<UINT>(DiagnosticsSlot::SurfaceCount)];
+        m_surfaceCountStats.add(m_lastSurfaceCount);
+    }
+
+    const UINT timeLevelSlot = static_cast<UINT>(DiagnosticsSlot::TimeLevels);
+    for (int level = 0; level < k_maxTimeLevels; ++level)
+    {
+        m_timeLevelTotals[level] += m_diagnostics[timeLevelSlot + level];
+    }
+
+    if (m_simParams.rigidEnabled != 0)
+    {
+        const UINT rigidSlot = static_cast<UINT>(DiagnosticsSlot::Rigid);
+        m_rigidSolidStats.add(m_diagnostics[rigidSlot]);
+        m_rigidClusterStats.add(m_diagnostics[rigidSlot + 1]);
+        m_rigidRebuilds[std::min<uint32_t>(m_diagnostics[rigidSlot + 2], 2)]++;
+    }
+
+    if (m_heatSolvedThisStep)
+    {
+        m_heatSolverIterationStats.add(m_diagnostics[static_cast<UINT>(DiagnosticsSlot::HeatSolver)]);
+        m_heatSolverResidualStats.add(GetDiagnosticFloat(DiagnosticsSlot::HeatSolver, 1));
+    }
+
+    if (m_viscositySolverMode == ViscositySolverMode::ImplicitCG)
+    {
+        m_viscositySolverIterationStats.add(m_diagnostics[static_cast<UINT>(DiagnosticsSlot::ViscositySolver)]);
+        m_viscositySolverResidualStats.add(GetDiagnosticFloat(DiagnosticsSlot::ViscositySolver, 1));
+    }
+
+    double elapsedMs = 0.0;
+    for (size_t k = 0; k < m_probeMarks.size(); ++k)
+    {
+        elapsedMs += m_profiler.GetElapsedMs(m_probeMarks[k].first, m_probeMarks[k].second);
+        m_convergenceLog.AddSample(
+            k,
+            elapsedMs,
+            GetDiagnosticFloat(DiagnosticsSlot::DensityResidual, static_cast<UINT>(2 * k)),
+            GetDiagnosticFloat(DiagnosticsSlot::DensityResidual, static_cast<UINT>(2 * k + 1)));
+    }
+}
+
+float SimulationSystem::GetDiagnosticFloat(DiagnosticsSlot slot, UINT offset)
+{
+    return std::bit_cast<float>(m_diagnostics[static_cast<UINT>(slot) + offset]);
+}
+
+void SimulationSystem::AddEmitter(const ParticleEmitter::Settings &settings)
+{
+    // fixed seed per emitter, runs stay reproducible
+    m_emitters.emplace_back(settings, static_cast<unsigned>(m_emitters.size() + 1));
+}
+
+bool SimulationSystem::AddKillPlane(const Vector3 &point, const Vector3 &normal)
+{
+    if (m_simParams.killPlaneCount >= k_maxKillVolumes)
+    {
+        return false;
+    }
+    Vector3 n = normal;
+    n.Normalize();
+    m_simParams.killPlanes[m_simParams.killPlaneCount++] = Vector4(n.x, n.y, n.z, n.Dot(point));
+    return true;
+}
+
+bool SimulationSystem::AddKillBox(const Vector3 &boxMin, const Vector3 &boxMax)
+{
+    if (m_simParams.killBoxCount >= k_maxKillVolumes)
+    {
+        return false;
+    }
+    m_simParams.killBoxMin[m_simParams.killBoxCount] = Vector4(boxMin.x, boxMin.y, boxMin.z, 0.0f);
+    m_simParams.killBoxMax[m_simParams.killBoxCount] = Vector4(boxMax.x, boxMax.y, boxMax.z, 0.0f);
+    m_simParams.killBoxCount++;
+    return true;
+}
+
+bool SimulationSystem::AddObstacle(SignedDistanceField sdf)
+{
+    if (m_obstacles.size() >= k_maxObstacles)
+    {
+        return false;
+    }
+    m_obstacles.push_back(std::move(sdf));
+    return true;
+}
+
+bool SimulationSystem::AddObstacleBox(const Vector3 &boxMin, const Vector3 &boxMax)
+{
+    if (m_obstacles.size() >= k_maxObstacles)
+    {
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    m_obstacles.push_back(SignedDistanceField::Box(boxMin, boxMax, GetObstacleSpacing()));
+    m_obstacleBuildStats.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+bool SimulationSystem::AddObstacleSphere(const Vector3 &center, float radius)
+{
+    if (m_obstacles.size() >= k_maxObstacles)
+    {
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    m_obstacles.push_back(SignedDistanceField::Sphere(center, radius, GetObstacleSpacing()));
+    m_obstacleBuildStats.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+void SimulationSystem::LoadTerrain(const std::filesystem::path &path, const Heightfield::RawLayout &raw, float scale)
+{
+    const auto start = std::chrono::steady_clock::now();
+    m_terrain = Heightfield::Open(path, raw);
+    m_terrainLoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_terrainScale = std::max(scale, 0.0f);
+}
+
+Scene SimulationSystem::GetBuiltInScene()
+{
+    // GenerateDenseBottomWithSphere and GenerateTemperaturesForPositions
+    Scene scene;
+    Scene::Region bottom;
+    bottom.shape = Scene::Shape::Box;
+    bottom.boxMin = Vector3(0.0f, 0.0f, 0.0f);
+    bottom.boxMax = Vector3(5.0f, 1.0f, 5.0f);
+    scene.fills.push_back(bottom);
+    Scene::Region sphere;
+    sphere.shape = Scene::Shape::Sphere;
+    sphere.center = Vector3(2.5f, 2.82f, 2.5f);
+    sphere.radius = 1.0f;
+    scene.fills.push_back(sphere);
+    Scene::Region hot;
+    hot.shape = Scene::Shape::Above;
+    hot.boxMin.y = 1.8f;
+    hot.temperatureMin = 1200.0f;
+    hot.temperatureMax = 1400.0f;
+    scene.temperatureFields.push_back(hot);
+    return scene;
+}
+
+void SimulationSystem::MeasureInitialDensity(const std::vector<DirectX::SimpleMath::Vector3> &positions,
+                                             const BoundaryVolumeMap &wallMap)
+{
+    std::vector<float> densities;
+    ComputeSphDensities(positions, m_simParams.h, m_simParams.mass, densities);
+
+    // walls as fluid at rest density, as WallVolume in CommonKernels.hlsl
+    const Vector3 worldMax = m_simParams.worldOrigin + Vector3(float(m_simParams.gridResolution[0]),
+                                                               float(m_simParams.gridResolution[1]),
+                                                               float(m_simParams.gridResolution[2])) * m_simParams.cellSize;
+    auto wallVolume = [&](float q)
+    {
+        const float s = std::min(std::abs(q), 1.0f) * k_boundaryMapIntervals;
+        const uint32_t k = std::min(static_cast<uint32_t>(s), k_boundaryMapIntervals - 1);
+        const float v = wallMap.samples[k].x + (wallMap.samples[k + 1].x - wallMap.samples[k].x) * (s - k);
+        return q < 0.0f ? 1.0f - v : v;
+    };
+
+    DensityError error = {positions.size(), 0.0, 0.0, 0.0};
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        float rho = densities[i];
+        if (m_simParams.wallDensityEnabled != 0)
+        {
+            const Vector3 below = (positions[i] - m_simParams.worldOrigin) / m_simParams.h;
+            const Vector3 above = (worldMax - positions[i]) / m_simParams.h;
+            for (float q : {below.x, below.y, below.z, above.x, above.y, above.z})
+            {
+                rho += q < 1.0f ? m_simParams.rho0 * wallVolume(q) : 0.0f;
+            }
+        }
+        const double c = rho / m_simParams.rho0 - 1.0;
+        error.meanError += std::abs(c);
+        error.maxError = std::max(error.maxError, std::abs(c));
+        error.compressed += c > 0.01 ? 1.0 : 0.0;
+    }
+    error.meanError /= std::max<size_t>(positions.size(), 1);
+    error.compressed /= std::max<size_t>(positions.size(), 1);
+    m_initialDensity = error;
+}
+
+void SimulationSystem::RunSamplerBenchmark()
+{
+    const float h = m_simParams.h;
+    const float mass = m_simParams.mass;
+    const float rho0 = m_simParams.rho0;
+    // a box of 12 h without walls; particles within h of its faces lack neighbors and are left out
+    const float edge = 12.0f * h;
+    const UINT restCount = static_cast<UINT>(std::round(edge * edge * edge * rho0 / mass));
+    Scene box;
+    Scene::Region fill;
+    fill.shape = Scene::Shape::Box;
+    fill.boxMin = Vector3::Zero;
+    fill.boxMax = Vector3(edge);
+    box.fills.push_back(fill);
+
+    std::vector<float> temperatures;
+    auto measure = [&](const std::string &sampler, auto &&generate)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const std::vector<Vector3> positions = generate();
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<float> densities;
+        ComputeSphDensities(positions, h, mass, densities);
+        DensityError error = {};
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            const Vector3 &p = positions[i];
+            if (std::min({p.x, p.y, p.z}) < h || std::max({p.x, p.y, p.z}) > edge - h)
+            {
+                continue;
+            }
+            const double c = densities[i] / rho0 - 1.0;
+            error.particles++;
+            error.meanError += std::abs(c);
+            error.maxError = std::max(error.maxError, std::abs(c));
+            error.compressed += c > 0.01 ? 1.0 : 0.0;
+        }
+        error.meanError /= std::max<size_t>(error.particles, 1);
+        error.compressed /= std::max<size_t>(error.particles, 1);
+        m_samplerBenchmarkSamples.push_back({sampler, ms, error});
+    };
+
+    // the built-in generators with the particle count of the rest volume
+    measure("grid", [&]
+            {
+        std::vector<Vector3> positions = GenerateUniformGridPositions(restCount);
+        for (Vector3 &p : positions)
+        {
+            p *= edge;
+        }
+        return positions; });
+    measure("stratified random", [&]
+            {
+        std::vector<Vector3> positions = GenerateDenseRandomPositions(restCount);
+        for (Vector3 &p : positions)
+        {
+            p *= edge;
+        }
+        return positions; });
+    measure("uniform random", [&]
+            {
+        // as the bottom layer of GenerateDenseBottomWithSphere
+        std::mt19937 rng(1337);
+        std::uniform_real_distribution<float> u(0.0f, edge);
+        std::vector<Vector3> positions(restCount);
+        for (Vector3 &p : positions)
+        {
+            p = Vector3(u(rng), u(rng), u(rng));
+        }
+        return positions; });
+    measure("lattice, rest volume", [&]
+            {
+        std::vector<Vector3> positions;
+        box.Generate(std::cbrt(mass / rho0), positions, temperatures);
+        return positions; });
+
+    const float restSpacing = GetLatticeRestSpacing(h, mass, rho0);
+    if (restSpacing > 0.0f)
+    {
+        measure("lattice, SPH rest", [&]
+                {
+            std::vector<Vector3> positions;
+            box.Generate(restSpacing, positions, temperatures);
+            return positions; });
+        measure("relaxed", [&]
+                {
+            const SettledBlock block = SettledBlock::Load({h, mass, rho0, k_settledBlockPerAxis, 1}, m_settledBlockCache);
+            std::vector<Vector3> positions;
+            box.Generate(block, positions, temperatures);
+            return positions; });
+    }
+}
+
+void SimulationSystem::LoadScene(const std::filesystem::path &path)
+{
+    const auto start = std::chrono::steady_clock::now();
+    auto scene = std::make_unique<Scene>(Scene::Load(path));
+    for (const Scene::Obstacle &obstacle : scene->obstacles)
+    {
+        bool added = true;
+        switch (obstacle.shape)
+        {
+        case Scene::Shape::Box:
+            added = AddObstacleBox(obstacle.boxMin, obstacle.boxMax);
+            break;
+        case Scene::Shape::Sphere:
+            added = AddObstacleSphere(obstacle.center, obstacle.radius);
+            break;
+        default:
+            AddObstacleMesh(obstacle.path, obstacle.scale, obstacle.offset);
+            break;
+        }
+        if (!added)
+        {
+            throw std::runtime_error(path.string() + " has more than " + std::to_string(k_maxObstacles) + " obstacles");
+        }
+    }
+    for (const Scene::KillVolume &kill : scene->killVolumes)
+    {
+        if (!(kill.plane ? AddKillPlane(kill.a, kill.b) : AddKillBox(kill.a, kill.b)))
+        {
+            throw std::runtime_error(path.string() + " has more than " + std::to_string(k_maxKillVolumes) +
+                                     (kill.plane ? " kill planes" : " kill boxes"));
+        }
+    }
+    for (const ParticleEmitter::Settings &emitter : scene->emitters)
+    {
+        AddEmitter(emitter);
+    }
+    m_scene = std::move(scene);
+    m_scenePath = path;
+    m_sceneLoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<float> SimulationSystem::FitWorldToTerrain(int cubicResolution)
+{
+    const Heightfield &terrain = *m_terrain;
+    const double extentX = terrain.GetMaxX() - terrain.GetMinX();
+    const double extentZ = terrain.GetMaxY() - terrain.GetMinY(); // map north is world +z
+    const double cellSize = m_simParams.cellSize;
+
+    double scale = m_terrainScale > 0.0f ? m_terrainScale : cubicResolution * cellSize / std::max(extentX, extentZ);
+    auto cellsAlong = [&](double extent)
+    { return std::max(1u, static_cast<uint32_t>(std::ceil(extent * scale / cellSize))); };
+
+    // the footprint has to fit into the cells of the neighbor grid, height gets what is left
+    uint32_t cellsX = cellsAlong(extentX);
+    uint32_t cellsZ = cellsAlong(extentZ);
+    if (uint64_t(cellsX) * cellsZ > m_gridCellsCount)
+    {
+        while (uint64_t(cellsX) * cellsZ > m_gridCellsCount)
+        {
+            scale *= 0.99 * std::sqrt(double(m_gridCellsCount) / (double(cellsX) * cellsZ));
+            cellsX = cellsAlong(extentX);
+            cellsZ = cellsAlong(extentZ);
+        }
+        std::cout << "Terrain scale reduced to " << scale << " to fit " << m_gridCellsCount << " grid cells\n";
+    }
+    m_terrainScale = static_cast<float>(scale);
+    m_simParams.gridResolution[0] = cellsX;
+    m_simParams.gridResolution[1] = std::max(1u, m_gridCellsCount / (cellsX * cellsZ));
+    m_simParams.gridResolution[2] = cellsZ;
+    m_simParams.worldOrigin = Vector3(0.0f, 0.0f, 0.0f);
+
+    // sampled like the obstacles, heights above the lowest point of the terrain
+    const float spacing = GetObstacleSpacing();
+    const uint32_t samplesX = std::max(2u, static_cast<uint32_t>(std::ceil(extentX * scale / spacing)) + 1);
+    const uint32_t samplesZ = std::max(2u, static_cast<uint32_t>(std::ceil(extentZ * scale / spacing)) + 1);
+    m_simParams.terrainDims[0] = samplesX;
+    m_simParams.terrainDims[1] = samplesZ;
+    m_simParams.terrainOrigin[0] = m_simParams.worldOrigin.x;
+    m_simParams.terrainOrigin[1] = m_simParams.worldOrigin.z;
+    m_simParams.terrainSpacing = spacing;
+
+    std::vector<float> heights = terrain.Resample(terrain.GetMinX(), terrain.GetMinY(), spacing / scale, samplesX, samplesZ);
+    const float minHeight = terrain.GetMinHeight();
+    for (float &height : heights)
+    {
+        height = m_simParams.worldOrigin.y + (height - minHeight) * m_terrainScale;
+    }
+    return heights;
+}
+
+void SimulationSystem::AddObstacleMesh(const std::filesystem::path &path, float scale, const Vector3 &offset)
+{
+    const auto start = std::chrono::steady_clock::now();
+    m_obstacleMesh.Append(TriangleMesh::LoadObj(path), scale, offset);
+    m_obstacleMeshFiles++;
+    m_meshLoadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SimulationSystem::BuildMeshObstacles(std::vector<uint32_t> &cellRoots)
+{
+    const auto start = std::chrono::steady_clock::now();
+    m_meshBvh.Build(m_obstacleMesh);
+    // the meshes are static, the subtrees near each cell are found once instead of per particle
+    cellRoots = m_meshBvh.CollectCellRoots(m_simParams.worldOrigin, m_simParams.cellSize, m_simParams.gridResolution,
+                                           m_simParams.meshQueryRadius, k_meshRootsPerCell);
+    m_meshBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_simParams.meshNodeCount = static_cast<uint32_t>(m_meshBvh.GetNodes().size());
+
+    size_t lists = 0;
+    size_t roots = 0;
+    for (size_t cell = 0; cell < cellRoots.size(); cell += k_meshRootsPerCell)
+    {
+        const auto first = cellRoots.begin() + cell;
+        const size_t count = std::find(first, first + k_meshRootsPerCell, MeshBvh::k_noNode) - first;
+        lists += count > 0 ? 1 : 0;
+        roots += count;
+    }
+    m_meshAvgCellRoots = lists > 0 ? double(roots) / lists : 0.0;
+}
+
+void SimulationSystem::RunMeshBenchmark()
+{
+    const size_t triangleCount = m_obstacleMesh.GetTriangleCount();
+    Vector3 boundsMin(std::numeric_limits<float>::max());
+    Vector3 boundsMax(-std::numeric_limits<float>::max());
+    for (const Vector3 &v : m_obstacleMesh.vertices)
+    {
+        boundsMin = Vector3::Min(boundsMin, v);
+        boundsMax = Vector3::Max(boundsMax, v);
+    }
+    const Vector3 pad(m_simParams.h);
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> ux(boundsMin.x - pad.x, boundsMax.x + pad.x);
+    std::uniform_real_distribution<float> uy(boundsMin.y - pad.y, boundsMax.y + pad.y);
+    std::uniform_real_distribution<float> uz(boundsMin.z - pad.z, boundsMax.z + pad.z);
+    std::vector<Vector3> queries(200000);
+    for (Vector3 &q : queries)
+    {
+        q = Vector3(ux(rng), uy(rng), uz(rng));
+    }
+
+    const float radius = m_simParams.meshQueryRadius;
+    std::vector<MeshHit> hits;
+    for (size_t fraction : {64, 16, 4, 1})
+    {
+        TriangleMesh part;
+        part.vertices = m_obstacleMesh.vertices;
+        part.indices.assign(m_obstacleMesh.indices.begin(), m_obstacleMesh.indices.begin() + 3 * std::max<size_t>(triangleCount / fraction, 1));
+
+        MeshBvh bvh;
+        auto start = std::chrono::steady_clock::now();
+        bvh.Build(part);
+        const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // batched: bucketed like the neighbor grid cells
+        start = std::chrono::steady_clock::now();
+        bvh.ClosestPoints(queries, radius, m_simParams.cellSize, hits);
+        const double batchedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        ParallelFor(0, static_cast<uint32_t>(queries.size()), [&](uint32_t i)
+                    { hits[i] = bvh.ClosestPoint(queries[i], radius); });
+        const double singleSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        m_meshBenchmarkSamples.push_back({part.GetTriangleCount(), bvh.GetDepth(), buildMs,
+                                          queries.size() / std::max(batchedSec, 1e-9),
+                                          queries.size() / std::max(singleSec, 1e-9)});
+    }
+}
+
+void SimulationSystem::LoadCheckpoint(const std::filesystem::path &path)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<Checkpoint> checkpoint = Checkpoint::Open(path);
+
+    SimParams params = {};
+    CheckpointRunState state = {};
+    if (!checkpoint->Read(k_chunkParams, params) || !checkpoint->Read(k_chunkRunState, state))
+    {
+        throw std::runtime_error(path.string() + " was written by an incompatible build");
+    }
+    if (params.numParticles == 0)
+    {
+        throw std::runtime_error(path.string() + " holds no particles");
+    }
+    for (const CheckpointAttribute &attribute : k_checkpointAttributes)
+    {
+        const Checkpoint::Chunk *chunk = checkpoint->Find(attribute.tag);
+        if (!chunk || chunk->elementStride != attribute.stride ||
+            chunk->bytes != uint64_t(params.numParticles) * attribute.stride)
+        {
+            throw std::runtime_error(path.string() + " has no valid " + std::string(attribute.tag) + " chunk");
+        }
+    }
+
+    // per emitter: settings, state length, state text
+    std::vector<ParticleEmitter> emitters;
+    if (const Checkpoint::Chunk *chunk = checkpoint->Find(k_chunkEmitters))
+    {
+        const uint8_t *cursor = checkpoint->GetData(*chunk);
+        const uint8_t *end = cursor + chunk->bytes;
+        while (cursor < end)
+        {
+            ParticleEmitter::Settings settings;
+            uint32_t stateBytes = 0;
+            if (size_t(end - cursor) < sizeof(settings) + sizeof(stateBytes))
+            {
+                throw std::runtime_error(path.string() + " has a truncated emitter");
+            }
+            memcpy(&settings, cursor, sizeof(settings));
+            memcpy(&stateBytes, cursor + sizeof(settings), sizeof(stateBytes));
+            cursor += sizeof(settings) + sizeof(stateBytes);
+            if (size_t(end - cursor) < stateBytes)
+            {
+                throw std::runtime_error(path.string() + " has a truncated emitter");
+            }
+            emitters.emplace_back(settings);
+            emitters.back().RestoreState(std::string(reinterpret_cast<const char *>(cursor), stateBytes));
+            cursor += stateBytes;
+        }
+    }
+
+    // static geometry is not stored, Init sets it up again from what is given
+    params.obstacleCount = 0;
+    params.terrainDims[0] = 0;
+    params.terrainDims[1] = 0;
+    params.meshNodeCount = 0;
+
+    m_simParams = params;
+    m_emitters = std::move(emitters);
+    m_restart = std::move(checkpoint);
+    m_restartPath = path;
+    m_restartLoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SimulationSystem::SetCheckpoint(const std::filesystem::path &path, int intervalSteps)
+{
+    m_checkpointPath = path;
+    m_checkpointInterval = std::max(intervalSteps, 0);
+}
+
+std::vector<std::pair<StructuredBuffer *, StructuredBuffer *>> SimulationSystem::GetCheckpointBuffers()
+{
+    auto swapBuffer = [](const PingPongBuffer &buffer, UINT liveIndex) -> std::pair<StructuredBuffer *, StructuredBuffer *>
+    {
+        return {buffer.buffers[liveIndex].get(), buffer.buffers[1 - liveIndex].get()};
+    };
+    return {
+        swapBuffer(particleSwapBuffers.position, particleSwapBuffers.position.readIndex),
+        // the next step starts from the write side, the read side holds v* before viscosity
+        swapBuffer(particleSwapBuffers.velocity, particleSwapBuffers.velocity.writeIndex),
+        swapBuffer(particleSwapBuffers.temperature, particleSwapBuffers.temperature.readIndex),
+        {particleScratchBuffers.particleId.get(), nullptr},
+        {particleScratchBuffers.particleLevel.get(), nullptr},
+        {particleScratchBuffers.phase.get(), nullptr},
+        {particleScratchBuffers.dfsphKappa.get(), nullptr},
+        {particleScratchBuffers.dfsphKappaV.get(), nullptr},
+    };
+}
+
+bool SimulationSystem::SaveCheckpoint(const std::filesystem::path &path)
+{
+    FinishCheckpointWrite(false);
+    if (m_checkpointWrite.valid())
+    {
+        ++m_checkpointsSkipped;
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+
+    winrt::com_ptr<ID3D12Device> device = RenderSubsystem::GetDevice();
+    auto queue = RenderSubsystem::GetCommandQueue();
+    const uint32_t numParticles = m_simParams.numParticles;
+    const auto buffers = GetCheckpointBuffers();
+
+    // the chunks one after another in one readback buffer
+    std::array<UINT64, std::size(k_checkpointAttributes)> offsets = {};
+    UINT64 readbackBytes = 0;
+    for (size_t a = 0; a < offsets.size(); ++a)
+    {
+        offsets[a] = readbackBytes;
+        readbackBytes += UINT64(numParticles) * k_checkpointAttributes[a].stride;
+    }
+    if (readbackBytes > m_checkpointReadbackBytes)
+    {
+        m_checkpointReadback = UploadHelpers::CreateReadbackBuffer(device.get(), readbackBytes);
+        m_checkpointReadbackBytes = readbackBytes;
+    }
+
+    winrt::com_ptr<ID3D12CommandAllocator> cmdAlloc;
+    winrt::com_ptr<ID3D12GraphicsCommandList> cmdList;
+    ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(cmdAlloc.put())));
+    ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, cmdAlloc.get(), nullptr, IID_PPV_ARGS(cmdList.put())));
+    for (size_t a = 0; a < offsets.size() && numParticles > 0; ++a)
+    {
+        // promoted from COMMON to COPY_SOURCE by the copy
+        cmdList->CopyBufferRegion(m_checkpointReadback.get(), offsets[a], buffers[a].first->resource.get(), 0,
+                                  UINT64(numParticles) * k_checkpointAttributes[a].stride);
+    }
+    ThrowIfFailed(cmdList->Close());
+    ID3D12CommandList *lists[] = {cmdList.get()};
+    queue->ExecuteCommandLists(1, lists);
+
+    winrt::com_ptr<ID3D12Fence> checkpointFence;
+    ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(checkpointFence.put())));
+    RenderSubsystem::WaitForFence(checkpointFence.get(), 1);
+
+    // host state is copied, the step loop goes on changing the originals
+    const SimParams params = m_simParams;
+    const CheckpointRunState state = {m_stepIndex, m_restartTime + m_stepController.GetSimulatedTime(), m_nextParticleId,
+                                      m_thermalAccumDt, m_stepController.GetState()};
+    std::vector<uint8_t> emitterBytes;
+    for (const ParticleEmitter &emitter : m_emitters)
+    {
+        const std::string emitterState = emitter.SaveState();
+        const uint32_t stateBytes = static_cast<uint32_t>(emitterState.size());
+        const auto *settings = reinterpret_cast<const uint8_t *>(&emitter.GetSettings());
+        emitterBytes.insert(emitterBytes.end(), settings, settings + sizeof(ParticleEmitter::Settings));
+        emitterBytes.insert(emitterBytes.end(), reinterpret_cast<const uint8_t *>(&stateBytes),
+                            reinterpret_cast<const uint8_t *>(&stateBytes) + sizeof(stateBytes));
+        emitterBytes.insert(emitterBytes.end(), emitterState.begin(), emitterState.end());
+    }
+
+    m_checkpointWrite = std::async(
+        std::launch::async,
+        [path, params, state, emitterBytes = std::move(emitterBytes), readback = m_checkpointReadback, offsets, readbackBytes, numParticles]()
+        {
+            const auto writeStart = std::chrono::steady_clock::now();
+            void *mapped = nullptr;
+            D3D12_RANGE readRange{0, static_cast<SIZE_T>(readbackBytes)};
+            ThrowIfFailed(readback->Map(0, &readRange, &mapped));
+            auto unmap = wil::scope_exit([&]
+                                         {
+                D3D12_RANGE writtenRange{0, 0};
+                readback->Unmap(0, &writtenRange); });
+
+            std::vector<Checkpoint::Source> sources = {
+                {k_chunkParams, &params, sizeof(params), sizeof(params)},
+                {k_chunkRunState, &state, sizeof(state)},
+                {k_chunkEmitters, emitterBytes.data(), emitterBytes.size()},
+            };
+            for (size_t a = 0; a < offsets.size(); ++a)
+            {
+                const CheckpointAttribute &attribute = k_checkpointAttributes[a];
+                sources.push_back({attribute.tag, static_cast<const uint8_t *>(mapped) + offsets[a],
+                                   UINT64(numParticles) * attribute.stride, attribute.stride});
+            }
+            const uint64_t bytes = Checkpoint::Write(path, sources);
+            return CheckpointWrite{bytes, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - writeStart).count()};
+        });
+
+    m_checkpointStallStats.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+void SimulationSystem::FinishCheckpointWrite(bool wait)
+{
+    if (!m_checkpointWrite.valid() ||
+        (!wait && m_checkpointWrite.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+    {
+        return;
+    }
+    try
+    {
+        const CheckpointWrite result = m_checkpointWrite.get();
+        ++m_checkpointsWritten;
+        m_checkpointBytes = result.bytes;
+        m_checkpointWriteStats.add(result.ms);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Checkpoint failed: " << e.what() << "\n";
+    }
+}
+
+void SimulationSystem::SetTrajectory(const TrajectoryWriter::Settings &settings)
+{
+    m_trajectory = std::make_unique<TrajectoryWriter>(settings);
+}
+
+void SimulationSystem::Shutdown()
+{
+    if (!m_checkpointPath.empty())
+    {
+        FinishCheckpointWrite(true);
+        SaveCheckpoint(m_checkpointPath);
+    }
+    FinishCheckpointWrite(true);
+    if (m_trajectory)
+    {
+        m_trajectory->Finish();
+    }
+}
+
+void SimulationSystem::SetAdaptiveResolution(int minLevel, int maxLevel)
+{
+    m_simParams.adaptiveEnabled = 1u;
+    m_simParams.minLevel = std::clamp(minLevel, k_adaptiveLevelMin, 0);
+    m_simParams.maxLevel = std::clamp(maxLevel, 0, k_adaptiveLevelMax);
+}
+
+void SimulationSystem::SetRigidCrustEnabled(bool enabled)
+{
+    m_simParams.rigidEnabled = enabled ? 1u : 0u;
+    // labels are not maintained while disabled
+    m_rigidFullRebuildPending = true;
+}
+
+void SimulationSystem::SetThermalInterval(int steps)
+{
+    m_thermalInterval = std::max(steps, 1);
+
+    StepController::Settings settings = m_stepController.GetSettings();
+    settings.thermalInterval = m_thermalInterval;
+    m_stepController.SetSettings(settings);
+}
+
+void SimulationSystem::SetHeatSolverMode(HeatSolverMode mode)
+{
+    m_heatSolverMode = mode;
+
+    StepController::Settings settings = m_stepController.GetSettings();
+    settings.implicitThermal = mode != HeatSolverMode::Explicit;
+    m_stepController.SetSettings(settings);
+}
+
+void SimulationSystem::SetViscositySolverMode(ViscositySolverMode mode)
+{
+    m_viscositySolverMode = mode;
+
+    StepController::Settings settings = m_stepController.GetSettings();
+    settings.implicitViscosity = mode == ViscositySolverMode::ImplicitCG;
+    m_stepController.SetSettings(settings);
+}
+
+void SimulationSystem::PrintReport(std::ostream &os)
+{
+    m_profiler.PrintReport(os);
+    m_stepController.PrintReport(os);
+
+    if (m_simParams.sleepingEnabled != 0 && m_activeCountStats.count() > 0)
+    {
+        os << "\n=== Sleeping ===\n";
+        os << "Particles        : " << m_simParams.numParticles << "\n";
+        os << "Active avg       : " << m_activeCountStats.average() << "\n";
+        os << "Active min       : " << m_minActiveCount << "\n";
+        os << "Active last step : " << m_lastActiveCount << "\n";
+        os << "================\n";
+    }
+
+    if (m_simParams.surfaceCoolingEnabled != 0 && m_surfaceCountStats.count() > 0)
+    {
+        os << "\n=== Surface Cooling ===\n";
+        os << "Classified every : " << m_surfaceInterval << " steps\n";
+        os << "Surface avg      : " << m_surfaceCountStats.average() << " of "
+           << m_simParams.numParticles << " particles\n";
+        os << "Surface last     : " << m_lastSurfaceCount << "\n";
+        os << "=======================\n";
+    }
+
+    if (m_stepController.GetSettings().timeLevels > 1 && m_activeCountStats.count() > 0)
+    {
+        // particle updates against every active particle advancing every substep
+        uint64_t awake = 0;
+        for (uint64_t total : m_timeLevelTotals)
+        {
+            awake += total;
+        }
+        os << "\n=== Local Time Stepping ===\n";
+        os << "Due per substep  : " << m_activeCountStats.average() << " of "
+           << double(awake) / m_activeCountStats.count() << " active\n";
+        for (int level = 0; level < k_maxTimeLevels; ++level)
+        {
+            if (m_timeLevelTotals[level] > 0)
+            {
+                os << "Level " << level << " (" << (1 << level) << " dt)  : "
+                   << 100.0 * double(m_timeLevelTotals[level]) / double(awake) << " %\n";
+            }
+        }
+        os << "===========================\n";
+    }
+
+    if (!m_emitters.empty())
+    {
+        os << "\n=== Emitters ===\n";
+        os << "Emitters         : " << m_emitters.size() << "\n";
+        os << "Emitted total    : " << m_emittedTotal << "\n";
+        os << "Emitted avg      : " << m_emittedStats.average() << " per step\n";
+        os << "Queue CPU avg    : " << m_emitQueueStats.average() << " ms per step\n";
+        os << "Particles        : " << m_simParams.numParticles << " of " << m_slotPool.GetCapacity() << "\n";
+        os << "================\n";
+    }
+
+    if (!m_capacityGrowths.empty())
+    {
+        os << "\n=== Capacity Growth ===\n";
+        os << "Capacity         : " << m_particleCapacity << " of at most " << m_maxParticleCapacity << "\n";
+        for (const CapacityGrowth &growth : m_capacityGrowths)
+        {
+            os << "Step " << growth.step << ": " << growth.oldCapacity << " -> " << growth.newCapacity << ", "
+               << growth.bytes / (1024.0 * 1024.0) << " MiB, " << growth.ms << " ms\n";
+        }
+        os << "=======================\n";
+    }
+
+    if (m_simParams.killPlaneCount + m_simParams.killBoxCount > 0)
+    {
+        os << "\n=== Kill Volumes ===\n";
+        os << "Planes / boxes   : " << m_simParams.killPlaneCount << " / " << m_simParams.killBoxCount << "\n";
+        os << "Killed total     : " << m_killedTotal << "\n";
+        os << "Compactions      : " << m_compactionStats.count() << "\n";
+        os << "Compaction avg   : " << m_compactionStats.average() << " ms (wall, incl. grid rebuild)\n";
+        os << "Particles        : " << m_simParams.numParticles << "\n";
+        os << "====================\n";
+    }
+
+    os << "\n=== Walls ===\n";
+    os << "Wall density     : " << (m_simParams.wallDensityEnabled != 0 ? "boundary volume map, " + std::to_string(k_boundaryMapIntervals) + " intervals" : "off, clamp only")
+       << "\n";
+    os << "=============\n";
+
+    if (m_scene)
+    {
+        os << "\n=== Scene ===\n";
+        os << "File             : " << m_scenePath.string() << ", load " << m_sceneLoadMs << " ms\n";
+        os << "Items            : " << m_scene->fills.size() << " fills, " << m_scene->temperatureFields.size()
+           << " temperature fields, " << m_scene->obstacles.size() << " obstacles, " << m_scene->emitters.size()
+           << " emitters, " << m_scene->killVolumes.size() << " kill volumes\n";
+        if (m_sceneSpacing > 0.0f && m_scene->sampler == Scene::Sampler::Relaxed)
+        {
+            os << "Sampling         : relaxed, " << m_initialParticleCount << " particles, mean spacing " << m_sceneSpacing
+               << ", seed " << m_scene->seed << ", " << m_sceneGenerateMs << " ms\n";
+        }
+        else if (m_sceneSpacing > 0.0f)
+        {
+            os << "Sampling         : lattice, " << m_initialParticleCount << " particles, spacing " << m_sceneSpacing
+               << ", jitter " << m_scene->jitter << ", seed " << m_scene->seed << ", " << m_sceneGenerateMs << " ms\n";
+        }
+        if (m_settledBlock)
+        {
+            os << "Settled block    : " << m_settledBlock->points.size() << " particles, edge " << m_settledBlock->size
+               << ", max error " << m_settledBlock->densityError * 100.0f << " %, "
+               << (m_settledBlock->cached ? "cached" : std::to_string(m_settledBlock->iterations) + " iterations") << ", "
+               << m_settledBlockMs << " ms\n";
+        }
+        os << "=============\n";
+    }
+
+    if (m_initialDensity.particles > 0 || !m_samplerBenchmarkSamples.empty())
+    {
+        os << "\n=== Initial Density ===\n";
+        if (m_initialDensity.particles > 0)
+        {
+            os << "Density error    : mean " << m_initialDensity.meanError * 100.0 << " %, max "
+               << m_initialDensity.maxError * 100.0 << " %, " << m_initialDensity.compressed * 100.0
+               << " % of particles compressed by more than 1 %\n";
+        }
+        for (const SamplerBenchmarkSample &sample : m_samplerBenchmarkSamples)
+        {
+            os << "Benchmark        : " << sample.sampler << ", " << sample.density.particles << " inner particles, mean "
+               << sample.density.meanError * 100.0 << " %, max " << sample.density.maxError * 100.0 << " %, "
+               << sample.density.compressed * 100.0 << " % compressed, " << sample.ms << " ms\n";
+        }
+        os << "=======================\n";
+    }
+
+    if (m_terrain)
+    {
+        const auto &res = m_simParams.gridResolution;
+        os << "\n=== Terrain ===\n";
+        os << "Raster           : " << m_terrain->GetCols() << " x " << m_terrain->GetRows() << ", cell "
+           << m_terrain->GetCellSize() << ", heights " << m_terrain->GetMinHeight() << " .. " << m_terrain->GetMaxHeight() << "\n";
+        os << "Tile cache       : " << m_terrain->GetCacheBytes() / (1024.0 * 1024.0) << " MiB mapped, "
+           << (m_terrain->WasCacheRebuilt() ? "rebuilt" : "reused") << ", load " << m_terrainLoadMs << " ms\n";
+        os << "World            : scale " << m_terrainScale << ", origin at map (" << m_terrain->GetMinX() << ", "
+           << m_terrain->GetMinY() << "), grid " << res[0] << " x " << res[1] << " x " << res[2] << " cells\n";
+        os << "Heightfield      : " << m_simParams.terrainDims[0] << " x " << m_simParams.terrainDims[1]
+           << " samples, spacing " << m_simParams.terrainSpacing << "\n";
+        os << "===============\n";
+    }
+
+    if (m_simParams.meshNodeCount > 0)
+    {
+        os << "\n=== Mesh Obstacles ===\n";
+        os << "Meshes           : " << m_obstacleMeshFiles << ", " << m_meshBvh.GetTriangles().size() << " triangles, load "
+           << m_meshLoadMs << " ms\n";
+        os << "BVH              : " << m_simParams.meshNodeCount << " nodes, depth " << m_meshBvh.GetDepth() << ", "
+           << (m_meshBvh.GetNodes().size() * sizeof(MeshBvhNode) + m_meshBvh.GetTriangles().size() * sizeof(MeshTriangle)) / (1024.0 * 1024.0)
+           << " MiB\n";
+        os << "Build            : " << m_meshBuildMs << " ms (SAH BVH + cell roots)\n";
+        os << "Cell roots       : " << m_meshAvgCellRoots << " subtrees per non-empty cell, max " << k_meshRootsPerCell << "\n";
+        for (const MeshBenchmarkSample &sample : m_meshBenchmarkSamples)
+        {
+            os << "Benchmark        : " << sample.triangles << " triangles, depth " << sample.depth << ", build "
+               << sample.buildMs << " ms, " << sample.batchedQueriesPerSec / 1e6 << " M queries/s batched, "
+               << sample.singleQueriesPerSec / 1e6 << " M queries/s single\n";
+        }
+        os << "======================\n";
+    }
+
+    if (!m_obstacles.empty())
+    {
+        size_t samples = 0;
+        for (const SignedDistanceField &sdf : m_obstacles)
+        {
+            samples += sdf.samples.size();
+        }
+        os << "\n=== Obstacles ===\n";
+        os << "Distance grids   : " << m_obstacles.size() << ", " << samples << " samples, "
+           << samples * sizeof(float) / (1024.0 * 1024.0) << " MiB\n";
+        os << "Voxelize avg     : " << m_obstacleBuildStats.average() << " ms (fast sweeping)\n";
+        os << "Margin           : " << m_simParams.obstacleMargin << "\n";
+        os << "=================\n";
+    }
+
+    if (!m_adaptiveSamples.empty())
+    {
+        os << "\n=== Adaptive Resolution ===\n";
+        os << "Levels           : " << m_simParams.minLevel << " .. " << m_simParams.maxLevel
+           << ", every " << m_adaptiveInterval << " steps\n";
+        os << "Split / merged   : " << m_splitTotal << " / " << m_mergeTotal << " pairs\n";
+        os << "Last histogram   :";
+        for (int level = m_simParams.minLevel; level <= m_simParams.maxLevel; ++level)
+        {
+            os << " L" << level << "=" << m_levelCounts[level - k_adaptiveLevelMin];
+        }
+        os << "\n";
+        // particle count against a uniform simulation at the finest level
+        const size_t sampleCount = m_adaptiveSamples.size();
+        const size_t rows = std::min<size_t>(sampleCount, 10);
+        for (size_t row = 0; row < rows; ++row)
+        {
+            const AdaptiveSample &sample = m_adaptiveSamples[(sampleCount - 1) * (row + 1) / rows];
+            os << "t=" << sample.time << " s: " << sample.particles << " particles, uniform "
+               << static_cast<uint64_t>(sample.uniformParticles) << " ("
+               << sample.particles / std::max(sample.uniformParticles, 1.0) << "x)\n";
+        }
+        os << "===========================\n";
+    }
+
+    if (m_rigidSolidStats.count() > 0)
+    {
+        os << "\n=== Rigid Crust ===\n";
+        os << "Solid avg        : " << m_rigidSolidStats.average() << "\n";
+        os << "Clusters avg     : " << m_rigidClusterStats.average() << "\n";
+        os << "Rebuilds         : " << m_rigidRebuilds[static_cast<UINT>(RigidRebuild::Changed)] << " after phase changes, "
+           << m_rigidRebuilds[static_cast<UINT>(RigidRebuild::Full)] << " full, "
+           << m_rigidRebuilds[static_cast<UINT>(RigidRebuild::None)] << " steps without\n";
+        os << "===================\n";
+    }
+
+    if (m_heatSolverIterationStats.count() > 0)
+    {
+        os << "\n=== Implicit Heat Solver ===\n";
+        os << "Solves           : " << m_heatSolverIterationStats.count() << "\n";
+        os << "CG iterations avg: " << m_heatSolverIterationStats.average()
+           << " (max " << m_heatSolverIterations << ")\n";
+        os << "|r| / |r0| avg   : " << m_heatSolverResidualStats.average() << "\n";
+        os << "============================\n";
+    }
+
+    if (m_viscositySolverIterationStats.count() > 0)
+    {
+        os << "\n=== Implicit Viscosity Solver ===\n";
+        os << "Solves           : " << m_viscositySolverIterationStats.count() << "\n";
+        os << "CG iterations avg: " << m_viscositySolverIterationStats.average()
+           << " (max " << m_viscositySolverIterations << ")\n";
+        os << "|r| / |r0| avg   : " << m_viscositySolverResidualStats.average() << "\n";
+        os << "=================================\n";
+    }
+
+    if (m_trajectory)
+    {
+        m_trajectory->PrintReport(os);
+    }
+
+    if (!m_restartPath.empty() || m_checkpointsWritten + m_checkpointsSkipped > 0)
+    {
+        os << "\n=== Checkpoints ===\n";
+        if (!m_restartPath.empty())
+        {
+            os << "Restarted from   : " << m_restartPath.string() << ", step " << m_restartStep << ", t = " << m_restartTime << " s\n";
+            os << "Restart load     : " << m_restartLoadMs << " ms (mapping, checks, GPU uploads)\n";
+        }
+        if (m_checkpointsWritten + m_checkpointsSkipped > 0)
+        {
+            os << "Written          : " << m_checkpointsWritten << ", " << m_checkpointsSkipped
+               << " skipped while the previous write was running\n";
+            os << "File size        : " << m_checkpointBytes / (1024.0 * 1024.0) << " MiB\n";
+            os << "Step loop avg    : " << m_checkpointStallStats.average() << " ms per save (GPU copy)\n";
+            os << "Write avg        : " << m_checkpointWriteStats.average() << " ms per file (background)\n";
+        }
+        os << "===================\n";
+    }
+
+    if (!m_convergenceLog.empty())
+    {
+        const char *solverName = m_pressureSolver == PressureSolver::Dfsph ? "DFSPH"
+                                 : m_pbfSolverMode == PbfSolverMode::ColoredGaussSeidel
+                                     ? "colored Gauss-Seidel"
+                                     : "Jacobi";
+        m_convergenceLog.Print(os, solverName);
+    }
+}
+#pragma endregion
+
+// TODO: move to StructuredBuffer?
+#pragma region GETTERS
+D3D12_GPU_DESCRIPTOR_HANDLE SimulationSystem::GetPositionBufferSRV()
+{
+    auto alloc = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
+    UINT idx = particleSwapBuffers.position.GetReadBuffer()->srvIndex;
+    return alloc->GetGpuHandle(idx);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE SimulationSystem::GetTemperatureBufferSRV()
+{
+    auto alloc = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
+    UINT idx = particleSwapBuffers.temperature.GetReadBuffer()->srvIndex;
+    return alloc->GetGpuHandle(idx);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE SimulationSystem::GetParticleIdBufferSRV()
+{
+    auto alloc = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
+    return alloc->GetGpuHandle(particleScratchBuffers.particleId->srvIndex);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE SimulationSystem::GetSurfaceIndexBufferSRV()
+{
+    auto alloc = RenderSubsystem::GetCBVSRVUAVAllocatorGPUVisible();
+    return alloc->GetGpuHandle(particleScratchBuffers.surfaceIndices->srvIndex);
 }
 #pragma endregion
 
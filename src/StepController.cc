@@ -0,0 +1,149 @@
+#include "pch.h"
+
+#include "framework/StepController.h"
+
+void StepController::SetSettings(const Settings &settingsIn)
+{
+    settings = settingsIn;
+    stableDt = settings.fixedDt > 0.0f ? settings.fixedDt : settings.maxDt;
+    nonAdvectiveDt = settings.fixedDt > 0.0f ? std::numeric_limits<float>::infinity() : settings.maxDt;
+    carriedTime = 0.0f;
+}
+
+void StepController::SetState(const State &state)
+{
+    stableDt = state.stableDt;
+    carriedTime = state.carriedTime;
+    nonAdvectiveDt = state.nonAdvectiveDt;
+    substepCounter = state.substepCounter;
+    recentDts = state.recentDts;
+}
+
+void StepController::UpdateLimits(const StepLimitValues &limits, const SimParams &params)
+{
+    // NaN compares false, report it as infinite
+    peakSpeed = limits.maxSpeed <= peakSpeed ? peakSpeed : (std::isnan(limits.maxSpeed) ? std::numeric_limits<float>::infinity() : limits.maxSpeed);
+
+    if (settings.fixedDt > 0.0f)
+    {
+        return;
+    }
+
+    const float tiny = 1e-12f;
+    float dt = settings.maxDt;
+
+    // body force: free fall over h
+    float g = params.gravityVec.Length();
+    if (g > tiny)
+        dt = std::min(dt, settings.forceNumber * std::sqrt(params.h / g));
+
+    // explicit diffusion limits
+    float nu = limits.maxViscosity / params.rho0;
+    if (nu > tiny && !settings.implicitViscosity)
+        dt = std::min(dt, settings.viscousNumber * params.h2 / nu);
+
+    if (!settings.implicitThermal)
+    {
+        const float thermalSteps = static_cast<float>(std::max(settings.thermalInterval, 1));
+
+        float alpha = limits.maxConductivity / params.rho0;
+        if (alpha > tiny)
+            dt = std::min(dt, settings.thermalNumber * params.h2 / alpha / thermalSteps);
+
+        // explicit radiative/convective cooling
+        if (settings.coolingRate > tiny)
+            dt = std::min(dt, 1.0f / settings.coolingRate / thermalSteps);
+    }
+
+    // local time levels only relax the advection limit below
+    nonAdvectiveDt = dt;
+
+    // advection: a particle must not cross more than a fraction of h per step
+    if (limits.maxSpeed > tiny)
+        dt = std::min(dt, settings.cflNumber * params.h / limits.maxSpeed);
+
+    stableDt = std::max(dt, settings.minDt);
+}
+
+int StepController::PlanInterval(float interval, float &substepDt)
+{
+    carriedTime += std::max(interval, 0.0f);
+
+    const bool fixed = settings.fixedDt > 0.0f;
+    int substeps = 0;
+    substepDt = 0.0f;
+
+    if (fixed)
+    {
+        substeps = static_cast<int>(std::floor(carriedTime / settings.fixedDt));
+        substepDt = settings.fixedDt;
+    }
+    else if (carriedTime >= settings.minStepFraction * stableDt)
+    {
+        // equal substeps, none larger than the stable dt
+        substeps = static_cast<int>(std::ceil(carriedTime / stableDt));
+        substepDt = carriedTime / substeps;
+    }
+
+    if (substeps > settings.maxSubsteps)
+    {
+        // cannot keep up with real time, run slower instead of taking unstable steps
+        substeps = settings.maxSubsteps;
+        if (!fixed)
+            substepDt = stableDt;
+        droppedTime += carriedTime - substepDt * substeps;
+        carriedTime = 0.0f;
+    }
+    else
+    {
+        carriedTime = std::max(carriedTime - substepDt * substeps, 0.0f);
+    }
+
+    lastSubsteps = substeps;
+    substepCounts.add(substeps);
+    for (int i = 0; i < substeps; ++i)
+        substepDts.add(substepDt);
+    simulatedTime += double(substepDt) * substeps;
+
+    return substeps;
+}
+
+void StepController::BeginSubstep(float dt, SimParams &params)
+{
+    const uint32_t ringSize = static_cast<uint32_t>(recentDts.size());
+    recentDts[substepCounter % ringSize] = dt;
+
+    // a level L particle due in this substep started its interval 2^L substeps ago, it catches
+    // up with exactly the time that passed since, also when dt changed in between
+    float sum = 0.0f;
+    uint32_t summed = 0;
+    for (int level = 0; level < k_maxTimeLevels; ++level)
+    {
+        for (; summed < (1u << level); ++summed)
+            sum += recentDts[(substepCounter - summed) % ringSize];
+        params.levelDt[level] = sum;
+    }
+
+    int maxLevel = std::clamp(settings.timeLevels, 1, k_maxTimeLevels) - 1;
+    while (maxLevel > 0 && dt * static_cast<float>(1u << maxLevel) > nonAdvectiveDt)
+        --maxLevel;
+
+    params.maxTimeLevel = static_cast<uint32_t>(maxLevel);
+    params.localStep = substepCounter;
+    params.timeLevelCfl = settings.cflNumber;
+    ++substepCounter;
+}
+
+void StepController::PrintReport(std::ostream &os) const
+{
+    os << "\n=== Time Stepping ===\n";
+    os << "Mode             : " << (settings.fixedDt > 0.0f ? "fixed" : "adaptive") << "\n";
+    os << "Time levels      : " << std::clamp(settings.timeLevels, 1, k_maxTimeLevels) << "\n";
+    os << "Intervals        : " << substepCounts.count() << "\n";
+    os << "Substeps/interval: " << substepCounts.average() << "\n";
+    os << "Average dt       : " << substepDts.average() << " s\n";
+    os << "Simulated time   : " << simulatedTime << " s\n";
+    os << "Dropped time     : " << droppedTime << " s\n";
+    os << "Peak max |v|     : " << peakSpeed << "\n";
+    os << "=====================\n";
+}
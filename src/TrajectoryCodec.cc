@@ -0,0 +1,716 @@
+#include "pch.h"
+
+#include "framework/TrajectoryCodec.h"
+#include "framework/ParallelFor.h"
+
+#include <bit>
+#include <limits>
+
+namespace
+{
+constexpr uint32_t k_packGroup = 128;
+constexpr uint32_t k_blockShift = 2; // log2(k_trajectoryBlockCells)
+static_assert((1u << k_blockShift) == k_trajectoryBlockCells);
+
+// block coordinates take the 14 bits above the cube within the block
+constexpr uint32_t k_blockBits = 16 - k_blockShift;
+constexpr uint32_t k_blockMask = (1u << k_blockBits) - 1;
+constexpr uint32_t k_cellBits = 3 * k_blockShift;
+
+uint32_t ZigZag(int32_t value)
+{
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t UnZigZag(uint32_t value)
+{
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+template <typename T>
+void Append(std::vector<uint8_t> &out, const T *data, size_t count)
+{
+    const size_t start = out.size();
+    out.resize(start + count * sizeof(T));
+    if (count > 0)
+    {
+        memcpy(out.data() + start, data, count * sizeof(T));
+    }
+}
+
+// a uint32 byte count, filled in by EndStream
+size_t BeginStream(std::vector<uint8_t> &out)
+{
+    const uint32_t placeholder = 0;
+    Append(out, &placeholder, 1);
+    return out.size();
+}
+
+void EndStream(std::vector<uint8_t> &out, size_t start)
+{
+    const uint32_t bytes = static_cast<uint32_t>(out.size() - start);
+    memcpy(out.data() + start - sizeof(uint32_t), &bytes, sizeof(bytes));
+}
+
+// Groups of 128 values at the width of the largest one. Fixed-width groups keep the inner
+// loops free of data-dependent branches, so they vectorize, unlike byte-wise varints.
+void PackBits(const uint32_t *values, size_t count, std::vector<uint8_t> &out)
+{
+    for (size_t group = 0; group < count; group += k_packGroup)
+    {
+        const size_t n = std::min<size_t>(k_packGroup, count - group);
+        uint32_t bitsUsed = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            bitsUsed |= values[group + i];
+        }
+        const uint32_t width = static_cast<uint32_t>(std::bit_width(bitsUsed));
+        out.push_back(static_cast<uint8_t>(width));
+
+        const size_t start = out.size();
+        out.resize(start + (n * width + 7) / 8);
+        uint8_t *cursor = out.data() + start;
+        uint64_t pending = 0;
+        uint32_t pendingBits = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            pending |= uint64_t(values[group + i]) << pendingBits;
+            pendingBits += width;
+            while (pendingBits >= 8)
+            {
+                *cursor++ = static_cast<uint8_t>(pending);
+                pending >>= 8;
+                pendingBits -= 8;
+            }
+        }
+        if (pendingBits > 0)
+        {
+            *cursor = static_cast<uint8_t>(pending);
+        }
+    }
+}
+
+// false when the stream is shorter than count values
+bool UnpackBits(const uint8_t *data, size_t bytes, size_t count, uint32_t *values)
+{
+    size_t pos = 0;
+    for (size_t group = 0; group < count; group += k_packGroup)
+    {
+        const size_t n = std::min<size_t>(k_packGroup, count - group);
+        if (pos >= bytes)
+        {
+            return false;
+        }
+        const uint32_t width = data[pos++];
+        const size_t groupBytes = (n * width + 7) / 8;
+        if (width > 32 || bytes - pos < groupBytes)
+        {
+            return false;
+        }
+        const uint64_t mask = (uint64_t(1) << width) - 1;
+        const uint8_t *cursor = data + pos;
+        uint64_t pending = 0;
+        uint32_t pendingBits = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            while (pendingBits < width)
+            {
+                pending |= uint64_t(*cursor++) << pendingBits;
+                pendingBits += 8;
+            }
+            values[group + i] = static_cast<uint32_t>(pending & mask);
+            pending >>= width;
+            pendingBits -= width;
+        }
+        pos += groupBytes;
+    }
+    return true;
+}
+
+// bounds-checked cursor over one block
+struct BlockReader
+{
+    const uint8_t *data;
+    size_t bytes;
+    size_t pos = 0;
+
+    template <typename T>
+    bool Read(T *out, size_t count)
+    {
+        if ((bytes - pos) / sizeof(T) < count)
+        {
+            return false;
+        }
+        memcpy(out, data + pos, count * sizeof(T));
+        pos += count * sizeof(T);
+        return true;
+    }
+
+    // the next stream's data
+    bool Stream(const uint8_t *&streamData, size_t &streamBytes)
+    {
+        uint32_t length = 0;
+        if (!Read(&length, 1) || bytes - pos < length)
+        {
+            return false;
+        }
+        streamData = data + pos;
+        streamBytes = length;
+        pos += length;
+        return true;
+    }
+};
+
+struct SortEntry
+{
+    uint64_t key; // block, then cube within the block
+    uint32_t id;
+    uint32_t index; // in capture order
+};
+
+uint16_t QuantizeTemperature(float temperature, const TrajectoryQuantization &quantization, double inverseStep)
+{
+    const double level = std::round((double(temperature) - quantization.temperatureMin) * inverseStep);
+    return static_cast<uint16_t>(std::clamp(level, 0.0, 65535.0));
+}
+
+// error of the float the decoder reconstructs from decoded, rounded up so that the
+// reported bound holds for every decoded value
+float ReconstructionError(double decoded, float value)
+{
+    const double error = std::abs(double(static_cast<float>(decoded)) - double(value));
+    const float rounded = static_cast<float>(error);
+    return double(rounded) < error ? std::nextafter(rounded, std::numeric_limits<float>::infinity()) : rounded;
+}
+
+uint32_t BlockParticleCount(const TrajectoryCellEntry *cells, uint32_t cellCount)
+{
+    uint64_t count = 0;
+    for (uint32_t c = 0; c < cellCount; ++c)
+    {
+        count += cells[c].particleCount;
+    }
+    return static_cast<uint32_t>(std::min<uint64_t>(count, UINT32_MAX));
+}
+
+// Decodes one block into out at first; false on malformed data. Runs inside ParallelFor, so
+// it must not throw.
+bool DecodeBlock(const uint8_t *data, const TrajectoryBlockEntry &entry, uint32_t first, uint32_t attributes,
+                 const TrajectoryQuantization &quantization, const TrajectoryKeyframe *reference,
+                 TrajectoryKeyframe *keyframeOut, TrajectoryParticles &out)
+{
+    BlockReader reader{data, static_cast<size_t>(entry.bytes)};
+    uint32_t cellCount = 0;
+    if (!reader.Read(&cellCount, 1) || cellCount != entry.cellCount)
+    {
+        return false;
+    }
+    std::vector<TrajectoryCellEntry> cells(cellCount);
+    if (!reader.Read(cells.data(), cellCount) || BlockParticleCount(cells.data(), cellCount) != entry.particleCount)
+    {
+        return false;
+    }
+    const uint32_t n = entry.particleCount;
+
+    // the 16.16 coordinate of every particle's cube origin
+    std::vector<uint32_t> cellBase[3];
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        cellBase[axis].reserve(n);
+    }
+    for (const TrajectoryCellEntry &cell : cells)
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            if (cell.cell[axis] >= k_trajectoryBlockCells)
+            {
+                return false;
+            }
+            const uint32_t cube = (uint32_t(entry.block[axis]) << k_blockShift) | cell.cell[axis];
+            cellBase[axis].insert(cellBase[axis].end(), cell.particleCount, cube << 16);
+        }
+    }
+
+    const uint8_t *stream = nullptr;
+    size_t streamBytes = 0;
+    std::vector<uint32_t> values(n);
+    uint32_t *ids = out.ids.data() + first;
+    if (!reader.Stream(stream, streamBytes) || !UnpackBits(stream, streamBytes, n, values.data()))
+    {
+        return false;
+    }
+    uint32_t previous = 0;
+    for (uint32_t k = 0; k < n; ++k)
+    {
+        previous += static_cast<uint32_t>(UnZigZag(values[k]));
+        ids[k] = previous;
+    }
+
+    auto referenceIndex = [&](uint32_t id)
+    {
+        return id < reference->indexOfId.size() ? reference->indexOfId[id] : TrajectoryKeyframe::k_absent;
+    };
+
+    const double step = quantization.GetPositionStep();
+    const double origin[3] = {quantization.origin.x, quantization.origin.y, quantization.origin.z};
+    std::vector<uint16_t> levels(n);
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        if (!reader.Stream(stream, streamBytes))
+        {
+            return false;
+        }
+        std::vector<uint32_t> &q = values;
+        if (!reference)
+        {
+            if (streamBytes != n * sizeof(uint16_t))
+            {
+                return false;
+            }
+            memcpy(levels.data(), stream, streamBytes);
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                q[k] = cellBase[axis][k] | levels[k];
+            }
+        }
+        else
+        {
+            if (!UnpackBits(stream, streamBytes, n, q.data()))
+            {
+                return false;
+            }
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                const uint32_t index = referenceIndex(ids[k]);
+                const uint32_t base = index != TrajectoryKeyframe::k_absent ? reference->q[axis][index] : cellBase[axis][k];
+                q[k] = base + static_cast<uint32_t>(UnZigZag(q[k]));
+            }
+        }
+        for (uint32_t k = 0; k < n; ++k)
+        {
+            (&out.positions[first + k].x)[axis] = static_cast<float>(origin[axis] + q[k] * step);
+        }
+        if (keyframeOut)
+        {
+            std::copy(q.begin(), q.end(), keyframeOut->q[axis].begin() + first);
+        }
+    }
+
+    if (attributes & TrajectoryTemperature)
+    {
+        if (!reader.Stream(stream, streamBytes))
+        {
+            return false;
+        }
+        if (!reference)
+        {
+            if (streamBytes != n * sizeof(uint16_t))
+            {
+                return false;
+            }
+            memcpy(levels.data(), stream, streamBytes);
+        }
+        else
+        {
+            if (!UnpackBits(stream, streamBytes, n, values.data()))
+            {
+                return false;
+            }
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                const uint32_t index = referenceIndex(ids[k]);
+                const uint32_t base = index != TrajectoryKeyframe::k_absent ? reference->temperature[index] : 0;
+                levels[k] = static_cast<uint16_t>(base + static_cast<uint32_t>(UnZigZag(values[k])));
+            }
+        }
+        const double temperatureStep = quantization.GetTemperatureStep();
+        for (uint32_t k = 0; k < n; ++k)
+        {
+            out.temperatures[first + k] = static_cast<float>(quantization.temperatureMin + levels[k] * temperatureStep);
+        }
+        if (keyframeOut)
+        {
+            std::copy(levels.begin(), levels.end(), keyframeOut->temperature.begin() + first);
+        }
+    }
+
+    if (attributes & TrajectoryVelocity)
+    {
+        if (!reader.Stream(stream, streamBytes) || streamBytes != n * sizeof(Vector3))
+        {
+            return false;
+        }
+        memcpy(out.velocities.data() + first, stream, streamBytes);
+    }
+    return reader.pos == reader.bytes;
+}
+
+void IndexKeyframe(TrajectoryKeyframe &keyframe, const uint32_t *ids, uint32_t count)
+{
+    const uint32_t maxId = count > 0 ? *std::max_element(std::execution::par, ids, ids + count) : 0;
+    keyframe.indexOfId.assign(size_t(maxId) + 1, TrajectoryKeyframe::k_absent);
+    ParallelFor(0, count, [&](uint32_t i)
+                { keyframe.indexOfId[ids[i]] = i; });
+}
+} // namespace
+
+void TrajectoryParticles::Resize(size_t count, uint32_t attributes)
+{
+    positions.resize(attributes & TrajectoryPosition ? count : 0);
+    velocities.resize(attributes & TrajectoryVelocity ? count : 0);
+    temperatures.resize(attributes & TrajectoryTemperature ? count : 0);
+    ids.resize(attributes & TrajectoryParticleId ? count : 0);
+}
+
+size_t TrajectoryParticles::GetCount() const
+{
+    return std::max(positions.size(), std::max(velocities.size(), std::max(temperatures.size(), ids.size())));
+}
+
+void TrajectoryParticles::KeepInside(const Vector3 &boxMin, const Vector3 &boxMax)
+{
+    assert(positions.size() == GetCount());
+    size_t kept = 0;
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        const Vector3 &p = positions[i];
+        if (p.x < boxMin.x || p.y < boxMin.y || p.z < boxMin.z || p.x > boxMax.x || p.y > boxMax.y || p.z > boxMax.z)
+        {
+            continue;
+        }
+        positions[kept] = p;
+        if (!velocities.empty())
+        {
+            velocities[kept] = velocities[i];
+        }
+        if (!temperatures.empty())
+        {
+            temperatures[kept] = temperatures[i];
+        }
+        if (!ids.empty())
+        {
+            ids[kept] = ids[i];
+        }
+        ++kept;
+    }
+    const uint32_t attributes = TrajectoryPosition | (velocities.empty() ? 0u : TrajectoryVelocity) |
+                                (temperatures.empty() ? 0u : TrajectoryTemperature) |
+                                (ids.empty() ? 0u : TrajectoryParticleId);
+    Resize(kept, attributes);
+}
+
+TrajectoryErrors EncodeTrajectoryFrame(const TrajectoryFrameView &frame, uint32_t attributes,
+                                       const TrajectoryQuantization &quantization, const TrajectoryKeyframe *reference,
+                                       TrajectoryKeyframe *keyframeOut, std::vector<uint8_t> &out)
+{
+    // an empty frame may come with null arrays
+    assert(frame.count == 0 || (frame.positions && frame.ids));
+    assert(frame.count == 0 || !(attributes & TrajectoryVelocity) || frame.velocities);
+    assert(frame.count == 0 || !(attributes & TrajectoryTemperature) || frame.temperatures);
+    const uint32_t count = frame.count;
+    const double step = quantization.GetPositionStep();
+    const double inverseStep = 1.0 / step;
+    const double origin[3] = {quantization.origin.x, quantization.origin.y, quantization.origin.z};
+    const double temperatureStep = quantization.GetTemperatureStep();
+    const double inverseTemperatureStep = temperatureStep > 0.0 ? 1.0 / temperatureStep : 0.0;
+
+    // 16.16 coordinates; particles outside the quantized range are clamped, which shows in the error
+    std::vector<uint32_t> q[3];
+    for (std::vector<uint32_t> &axis : q)
+    {
+        axis.resize(count);
+    }
+    std::vector<SortEntry> order(count);
+    ParallelFor(0, count, [&](uint32_t i)
+                {
+        const float *position = &frame.positions[i].x;
+        uint64_t key = 0;
+        uint32_t cell = 0;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const double level = std::round((position[axis] - origin[axis]) * inverseStep);
+            q[axis][i] = static_cast<uint32_t>(std::clamp(level, 0.0, double(UINT32_MAX)));
+            const uint32_t cube = q[axis][i] >> 16;
+            key |= uint64_t(cube >> k_blockShift) << (k_blockBits * axis);
+            cell |= (cube & (k_trajectoryBlockCells - 1)) << (k_blockShift * axis);
+        }
+        order[i] = {(key << k_cellBits) | cell, frame.ids[i], i}; });
+
+    // z-major blocks, cubes within them, ids within cubes
+    std::sort(std::execution::par, order.begin(), order.end(), [](const SortEntry &a, const SortEntry &b)
+              { return a.key != b.key ? a.key < b.key : a.id < b.id; });
+
+    std::vector<std::pair<uint32_t, uint32_t>> blocks; // [begin, end) in order
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (blocks.empty() || (order[i].key >> k_cellBits) != (order[blocks.back().first].key >> k_cellBits))
+        {
+            blocks.push_back({i, i});
+        }
+        blocks.back().second = i + 1;
+    }
+    const uint32_t blockCount = static_cast<uint32_t>(blocks.size());
+
+    if (keyframeOut)
+    {
+        for (std::vector<uint32_t> &axis : keyframeOut->q)
+        {
+            axis.resize(count);
+        }
+        keyframeOut->temperature.resize(attributes & TrajectoryTemperature ? count : 0);
+    }
+
+    auto referenceIndex = [&](uint32_t id)
+    {
+        return id < reference->indexOfId.size() ? reference->indexOfId[id] : TrajectoryKeyframe::k_absent;
+    };
+
+    // blocks encode independently, each into its own buffer
+    std::vector<std::vector<uint8_t>> blockData(blockCount);
+    std::vector<TrajectoryBlockEntry> entries(blockCount);
+    std::vector<TrajectoryErrors> blockErrors(blockCount);
+    ParallelFor(0, blockCount, [&](uint32_t b)
+                {
+        const auto [begin, end] = blocks[b];
+        const uint32_t n = end - begin;
+        const SortEntry *sorted = order.data() + begin;
+        std::vector<uint8_t> &data = blockData[b];
+        TrajectoryErrors &errors = blockErrors[b];
+
+        std::vector<TrajectoryCellEntry> cells;
+        for (uint32_t k = 0; k < n; ++k)
+        {
+            const uint32_t cell = static_cast<uint32_t>(sorted[k].key) & ((1u << k_cellBits) - 1);
+            if (k == 0 || cell != (static_cast<uint32_t>(sorted[k - 1].key) & ((1u << k_cellBits) - 1)))
+            {
+                const uint32_t mask = k_trajectoryBlockCells - 1;
+                cells.push_back({{uint8_t(cell & mask), uint8_t((cell >> k_blockShift) & mask),
+                                  uint8_t((cell >> (2 * k_blockShift)) & mask)},
+                                 0,
+                                 0});
+            }
+            ++cells.back().particleCount;
+        }
+        const uint32_t cellCount = static_cast<uint32_t>(cells.size());
+        Append(data, &cellCount, 1);
+        Append(data, cells.data(), cells.size());
+
+        std::vector<uint32_t> values(n);
+        std::vector<uint16_t> levels(n);
+        uint32_t previous = 0;
+        for (uint32_t k = 0; k < n; ++k)
+        {
+            values[k] = ZigZag(static_cast<int32_t>(sorted[k].id - previous));
+            previous = sorted[k].id;
+        }
+        size_t stream = BeginStream(data);
+        PackBits(values.data(), n, data);
+        EndStream(data, stream);
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                const uint32_t level = q[axis][sorted[k].index];
+                const float error = ReconstructionError(origin[axis] + level * step, (&frame.positions[sorted[k].index].x)[axis]);
+                errors.position = std::max(errors.position, error);
+                if (!reference)
+                {
+                    levels[k] = static_cast<uint16_t>(level);
+                }
+                else
+                {
+                    const uint32_t index = referenceIndex(sorted[k].id);
+                    const uint32_t base = index != TrajectoryKeyframe::k_absent ? reference->q[axis][index] : level & 0xffff0000u;
+                    values[k] = ZigZag(static_cast<int32_t>(level - base));
+                }
+                if (keyframeOut)
+                {
+                    keyframeOut->q[axis][begin + k] = level;
+                }
+            }
+            stream = BeginStream(data);
+            if (!reference)
+            {
+                Append(data, levels.data(), n);
+            }
+            else
+            {
+                PackBits(values.data(), n, data);
+            }
+            EndStream(data, stream);
+        }
+
+        if (attributes & TrajectoryTemperature)
+        {
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                const float temperature = frame.temperatures[sorted[k].index];
+                const uint16_t level = QuantizeTemperature(temperature, quantization, inverseTemperatureStep);
+                const float error = ReconstructionError(quantization.temperatureMin + level * temperatureStep, temperature);
+                errors.temperature = std::max(errors.temperature, error);
+                if (!reference)
+                {
+                    levels[k] = level;
+                }
+                else
+                {
+                    const uint32_t index = referenceIndex(sorted[k].id);
+                    const uint32_t base = index != TrajectoryKeyframe::k_absent ? reference->temperature[index] : 0;
+                    values[k] = ZigZag(static_cast<int32_t>(level) - static_cast<int32_t>(base));
+                }
+                if (keyframeOut)
+                {
+                    keyframeOut->temperature[begin + k] = level;
+                }
+            }
+            stream = BeginStream(data);
+            if (!reference)
+            {
+                Append(data, levels.data(), n);
+            }
+            else
+            {
+                PackBits(values.data(), n, data);
+            }
+            EndStream(data, stream);
+        }
+
+        if (attributes & TrajectoryVelocity)
+        {
+            stream = BeginStream(data);
+            const size_t start = data.size();
+            data.resize(start + size_t(n) * sizeof(Vector3));
+            Vector3 *velocities = reinterpret_cast<Vector3 *>(data.data() + start);
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                memcpy(&velocities[k], &frame.velocities[sorted[k].index], sizeof(Vector3));
+            }
+            EndStream(data, stream);
+        }
+
+        const uint64_t key = sorted[0].key >> k_cellBits;
+        TrajectoryBlockEntry &entry = entries[b];
+        entry = {};
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            entry.block[axis] = static_cast<uint16_t>((key >> (k_blockBits * axis)) & k_blockMask);
+        }
+        entry.particleCount = n;
+        entry.cellCount = cellCount;
+        entry.bytes = data.size(); }, 1);
+
+    uint64_t offset = sizeof(uint32_t) + sizeof(TrajectoryBlockEntry) * blockCount;
+    for (TrajectoryBlockEntry &entry : entries)
+    {
+        entry.offset = offset;
+        offset += entry.bytes;
+    }
+    out.resize(offset);
+    memcpy(out.data(), &blockCount, sizeof(blockCount));
+    if (blockCount > 0)
+    {
+        memcpy(out.data() + sizeof(uint32_t), entries.data(), sizeof(TrajectoryBlockEntry) * blockCount);
+    }
+    ParallelFor(0, blockCount, [&](uint32_t b)
+                { memcpy(out.data() + entries[b].offset, blockData[b].data(), blockData[b].size()); }, 1);
+
+    if (keyframeOut)
+    {
+        std::vector<uint32_t> sortedIds(count);
+        ParallelFor(0, count, [&](uint32_t i)
+                    { sortedIds[i] = order[i].id; });
+        IndexKeyframe(*keyframeOut, sortedIds.data(), count);
+    }
+
+    TrajectoryErrors errors;
+    for (const TrajectoryErrors &blockError : blockErrors)
+    {
+        errors.position = std::max(errors.position, blockError.position);
+        errors.temperature = std::max(errors.temperature, blockError.temperature);
+    }
+    return errors;
+}
+
+std::vector<TrajectoryBlockEntry> ReadTrajectoryBlockTable(const uint8_t *payload, uint64_t bytes)
+{
+    uint32_t blockCount = 0;
+    if (bytes < sizeof(uint32_t))
+    {
+        throw std::runtime_error("Truncated trajectory frame");
+    }
+    memcpy(&blockCount, payload, sizeof(blockCount));
+    if ((bytes - sizeof(uint32_t)) / sizeof(TrajectoryBlockEntry) < blockCount)
+    {
+        throw std::runtime_error("Truncated trajectory block table");
+    }
+    std::vector<TrajectoryBlockEntry> blocks(blockCount);
+    if (blockCount > 0)
+    {
+        memcpy(blocks.data(), payload + sizeof(uint32_t), sizeof(TrajectoryBlockEntry) * blockCount);
+    }
+    for (const TrajectoryBlockEntry &block : blocks)
+    {
+        if (block.offset > bytes || block.bytes > bytes - block.offset)
+        {
+            throw std::runtime_error("Trajectory block out of bounds");
+        }
+    }
+    return blocks;
+}
+
+void GetTrajectoryBlockBounds(const TrajectoryBlockEntry &block, const TrajectoryQuantization &quantization,
+                              Vector3 &boxMin, Vector3 &boxMax)
+{
+    const float blockSize = quantization.cellSize * k_trajectoryBlockCells;
+    boxMin = quantization.origin + Vector3(block.block[0], block.block[1], block.block[2]) * blockSize;
+    boxMax = boxMin + Vector3(blockSize);
+}
+
+void DecodeTrajectoryBlocks(const uint8_t *payload, const std::vector<TrajectoryBlockEntry> &blocks, uint32_t attributes,
+                            const TrajectoryQuantization &quantization, const TrajectoryKeyframe *reference,
+                            TrajectoryKeyframe *keyframeOut, TrajectoryParticles &out)
+{
+    const uint32_t blockCount = static_cast<uint32_t>(blocks.size());
+    std::vector<uint32_t> first(blockCount);
+    uint64_t count = 0;
+    for (uint32_t b = 0; b < blockCount; ++b)
+    {
+        first[b] = static_cast<uint32_t>(count);
+        count += blocks[b].particleCount;
+    }
+    if (count > UINT32_MAX)
+    {
+        throw std::runtime_error("Trajectory frame too large");
+    }
+
+    out.Resize(count, attributes | TrajectoryPosition | TrajectoryParticleId);
+    if (keyframeOut)
+    {
+        for (std::vector<uint32_t> &axis : keyframeOut->q)
+        {
+            axis.resize(count);
+        }
+        keyframeOut->temperature.resize(attributes & TrajectoryTemperature ? count : 0);
+    }
+    std::vector<uint8_t> valid(blockCount);
+    ParallelFor(0, blockCount, [&](uint32_t b)
+                { valid[b] = DecodeBlock(payload + blocks[b].offset, blocks[b], first[b], attributes, quantization,
+                                         reference, keyframeOut, out); }, 1);
+    if (std::find(valid.begin(), valid.end(), uint8_t(0)) != valid.end())
+    {
+        throw std::runtime_error("Malformed trajectory block");
+    }
+    if (keyframeOut)
+    {
+        IndexKeyframe(*keyframeOut, out.ids.data(), static_cast<uint32_t>(count));
+    }
+}
+
+void DecodeTrajectoryFrame(const uint8_t *payload, uint64_t bytes, uint32_t attributes,
+                           const TrajectoryQuantization &quantization, const TrajectoryKeyframe *reference,
+                           TrajectoryKeyframe *keyframeOut, TrajectoryParticles &out)
+{
+    DecodeTrajectoryBlocks(payload, ReadTrajectoryBlockTable(payload, bytes), attributes, quantization, reference,
+                           keyframeOut, out);
+}
@@ -0,0 +1,204 @@
+#include "pch.h"
+
+#include "framework/TrajectoryReader.h"
+
+TrajectoryReader::TrajectoryReader(const std::filesystem::path &pathIn)
+    : path(pathIn), file(MappedFile::Open(pathIn))
+{
+    if (file.bytes < sizeof(TrajectoryFileHeader))
+    {
+        throw std::runtime_error(path.string() + " is not a trajectory");
+    }
+    memcpy(&header, file.GetData(), sizeof(header));
+    if (memcmp(header.magic, k_trajectoryMagic, sizeof(k_trajectoryMagic)) != 0)
+    {
+        throw std::runtime_error(path.string() + " is not a trajectory");
+    }
+    if (header.version != k_trajectoryVersion)
+    {
+        throw std::runtime_error(path.string() + " has trajectory version " + std::to_string(header.version) +
+                                 ", expected " + std::to_string(k_trajectoryVersion));
+    }
+    if (header.encoding == TrajectoryEncoding::Quantized)
+    {
+        quantization.origin = Vector3(header.quantizationOrigin[0], header.quantizationOrigin[1],
+                                      header.quantizationOrigin[2]);
+        quantization.cellSize = header.quantizationCellSize;
+        quantization.temperatureMin = header.temperatureMin;
+        quantization.temperatureMax = header.temperatureMax;
+        if (!(quantization.cellSize > 0.0f) || header.keyframeInterval == 0)
+        {
+            throw std::runtime_error(path.string() + " has no quantization grid");
+        }
+    }
+    else if (header.encoding != TrajectoryEncoding::Raw)
+    {
+        throw std::runtime_error(path.string() + " has an unknown encoding");
+    }
+
+    if (header.indexOffset == 0)
+    {
+        // the writer did not finish, find the records one by one
+        ScanRecords();
+        return;
+    }
+    uint64_t count = 0;
+    if (header.indexOffset > file.bytes || file.bytes - header.indexOffset < sizeof(count))
+    {
+        throw std::runtime_error(path.string() + " has a damaged frame table");
+    }
+    memcpy(&count, file.GetData() + header.indexOffset, sizeof(count));
+    if ((file.bytes - header.indexOffset - sizeof(count)) / sizeof(uint64_t) < count)
+    {
+        throw std::runtime_error(path.string() + " has a damaged frame table");
+    }
+    frameOffsets.resize(count);
+    memcpy(frameOffsets.data(), file.GetData() + header.indexOffset + sizeof(count), count * sizeof(uint64_t));
+}
+
+void TrajectoryReader::ScanRecords()
+{
+    // Writer threads reserve ranges before filling them, so a crash can leave zeroed gaps.
+    // A gap does not carry the file's attributes and is stepped over byte by byte, since
+    // records have any length.
+    uint64_t offset = sizeof(TrajectoryFileHeader);
+    while (file.bytes - offset >= sizeof(TrajectoryFrameHeader))
+    {
+        TrajectoryFrameHeader frameHeader;
+        memcpy(&frameHeader, file.GetData() + offset, sizeof(frameHeader));
+        const uint64_t available = file.bytes - offset - sizeof(frameHeader);
+        if (frameHeader.attributes != header.attributes || frameHeader.payloadBytes > available)
+        {
+            ++offset;
+            continue;
+        }
+        if (frameHeader.frame >= frameOffsets.size())
+        {
+            frameOffsets.resize(frameHeader.frame + 1, 0);
+        }
+        frameOffsets[frameHeader.frame] = offset;
+        offset += sizeof(frameHeader) + frameHeader.payloadBytes;
+    }
+}
+
+const uint8_t *TrajectoryReader::GetPayload(uint64_t frame, TrajectoryFrameHeader &frameHeader) const
+{
+    if (!HasFrame(frame))
+    {
+        throw std::runtime_error("Frame " + std::to_string(frame) + " is not in " + path.string());
+    }
+    const uint64_t offset = frameOffsets[frame];
+    if (offset > file.bytes || file.bytes - offset < sizeof(frameHeader))
+    {
+        throw std::runtime_error("Frame " + std::to_string(frame) + " is out of bounds");
+    }
+    memcpy(&frameHeader, file.GetData() + offset, sizeof(frameHeader));
+    if (frameHeader.frame != frame || frameHeader.payloadBytes > file.bytes - offset - sizeof(frameHeader))
+    {
+        throw std::runtime_error("Frame " + std::to_string(frame) + " is damaged");
+    }
+    return file.GetData() + offset + sizeof(frameHeader);
+}
+
+TrajectoryFrameHeader TrajectoryReader::GetFrameHeader(uint64_t frame) const
+{
+    TrajectoryFrameHeader frameHeader;
+    GetPayload(frame, frameHeader);
+    return frameHeader;
+}
+
+void TrajectoryReader::ReadRawFrame(const TrajectoryFrameHeader &frameHeader, const uint8_t *payload,
+                                    TrajectoryParticles &out) const
+{
+    const uint64_t count = frameHeader.particleCount;
+    uint64_t expected = 0;
+    for (uint32_t attribute = 1; attribute < (1u << k_trajectoryAttributeCount); attribute <<= 1)
+    {
+        expected += header.attributes & attribute ? count * TrajectoryAttributeStride(attribute) : 0;
+    }
+    if (expected != frameHeader.payloadBytes)
+    {
+        throw std::runtime_error("Frame " + std::to_string(frameHeader.frame) + " has the wrong size");
+    }
+
+    out.Resize(count, header.attributes);
+    const uint8_t *cursor = payload;
+    auto copy = [&](auto &array)
+    {
+        const size_t bytes = array.size() * sizeof(array[0]);
+        if (bytes > 0)
+        {
+            memcpy(array.data(), cursor, bytes);
+        }
+        cursor += bytes;
+    };
+    // bit order, empty arrays are not selected
+    copy(out.positions);
+    copy(out.velocities);
+    copy(out.temperatures);
+    copy(out.ids);
+}
+
+const TrajectoryKeyframe *TrajectoryReader::GetReference(const TrajectoryFrameHeader &frameHeader)
+{
+    if (frameHeader.keyframe == frameHeader.frame)
+    {
+        return nullptr;
+    }
+    if (cachedKeyframe != frameHeader.keyframe)
+    {
+        TrajectoryFrameHeader keyframeHeader;
+        const uint8_t *payload = GetPayload(frameHeader.keyframe, keyframeHeader);
+        cachedKeyframe = UINT64_MAX;
+        DecodeTrajectoryFrame(payload, keyframeHeader.payloadBytes, header.attributes, quantization, nullptr, &keyframe,
+                              keyframeParticles);
+        cachedKeyframe = frameHeader.keyframe;
+        lastRead.keyframeDecoded = true;
+    }
+    return &keyframe;
+}
+
+void TrajectoryReader::ReadFrame(uint64_t frame, TrajectoryParticles &out)
+{
+    lastRead = {};
+    TrajectoryFrameHeader frameHeader;
+    const uint8_t *payload = GetPayload(frame, frameHeader);
+    if (header.encoding == TrajectoryEncoding::Raw)
+    {
+        ReadRawFrame(frameHeader, payload, out);
+        return;
+    }
+    const std::vector<TrajectoryBlockEntry> blocks = ReadTrajectoryBlockTable(payload, frameHeader.payloadBytes);
+    lastRead.blocksTotal = lastRead.blocksDecoded = static_cast<uint32_t>(blocks.size());
+    DecodeTrajectoryBlocks(payload, blocks, header.attributes, quantization, GetReference(frameHeader), nullptr, out);
+}
+
+void TrajectoryReader::ReadFrame(uint64_t frame, const Vector3 &boxMin, const Vector3 &boxMax, TrajectoryParticles &out)
+{
+    if (!(header.attributes & TrajectoryPosition))
+    {
+        throw std::runtime_error(path.string() + " has no positions");
+    }
+    lastRead = {};
+    TrajectoryFrameHeader frameHeader;
+    const uint8_t *payload = GetPayload(frame, frameHeader);
+    if (header.encoding == TrajectoryEncoding::Raw)
+    {
+        // capture order has no spatial index
+        ReadRawFrame(frameHeader, payload, out);
+        out.KeepInside(boxMin, boxMax);
+        return;
+    }
+
+    std::vector<TrajectoryBlockEntry> blocks = ReadTrajectoryBlockTable(payload, frameHeader.payloadBytes);
+    lastRead.blocksTotal = static_cast<uint32_t>(blocks.size());
+    std::erase_if(blocks, [&](const TrajectoryBlockEntry &block)
+                  {
+        Vector3 blockMin, blockMax;
+        GetTrajectoryBlockBounds(block, quantization, blockMin, blockMax);
+        return blockMax.x < boxMin.x || blockMax.y < boxMin.y || blockMax.z < boxMin.z ||
+               blockMin.x > boxMax.x || blockMin.y > boxMax.y || blockMin.z > boxMax.z; });
+    lastRead.blocksDecoded = static_cast<uint32_t>(blocks.size());
+    DecodeTrajectoryBlocks(payload, blocks, header.attributes, quantization, GetReference(frameHeader), nullptr, out);
+    out.KeepInside(boxMin, boxMax);
+}
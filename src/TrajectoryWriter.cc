@@ -0,0 +1,452 @@
+#include "pch.h"
+
+#include "framework/TrajectoryWriter.h"
+#include "framework/UploadHelpers.h"
+
+TrajectoryWriter::TrajectoryWriter(const Settings &settingsIn)
+    : settings(settingsIn),
+      freeSlots(std::max(settingsIn.slots, 2u)),
+      filledSlots(std::max(settingsIn.slots, 2u))
+{
+    settings.slots = std::max(settings.slots, 2u);
+    settings.threads = std::max(settings.threads, 1u);
+    settings.interval = std::max(settings.interval, 1);
+    settings.attributes &= (1u << k_trajectoryAttributeCount) - 1;
+    if (settings.attributes == 0)
+    {
+        throw std::runtime_error("No trajectory attributes selected");
+    }
+    if (settings.encoding == TrajectoryEncoding::Quantized)
+    {
+        if (!(settings.attributes & TrajectoryPosition))
+        {
+            throw std::runtime_error("Quantized trajectories need positions");
+        }
+        // frames are reordered and deltas are matched by id
+        settings.attributes |= TrajectoryParticleId;
+        settings.keyframeInterval = std::max(settings.keyframeInterval, 1u);
+        settings.temperatureMax = std::max(settings.temperatureMax, settings.temperatureMin);
+    }
+
+    file.reset(CreateFileW(settings.path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!file)
+    {
+        throw std::runtime_error("Cannot create " + settings.path.string());
+    }
+    // frame count 0 until the file is closed
+    const TrajectoryFileHeader header = MakeHeader();
+    WriteAt(0, &header, sizeof(header));
+
+    slots.resize(settings.slots);
+    for (uint32_t i = 0; i < settings.slots; ++i)
+    {
+        freeSlots.TryPush(i);
+    }
+    for (uint32_t i = 0; i < settings.threads; ++i)
+    {
+        writers.emplace_back(&TrajectoryWriter::WriterLoop, this);
+    }
+}
+
+void TrajectoryWriter::Finish()
+{
+    if (writers.empty())
+    {
+        return;
+    }
+    stopping.store(true);
+    filledSignal.fetch_add(1, std::memory_order_release);
+    filledSignal.notify_all();
+    for (std::thread &writer : writers)
+    {
+        writer.join();
+    }
+    writers.clear();
+
+    try
+    {
+        // offset table after the last record, then the header that points to it
+        const uint64_t indexOffset = fileEnd.load();
+        const uint64_t indexCount = frameOffsets.size();
+        WriteAt(indexOffset, &indexCount, sizeof(indexCount));
+        WriteAt(indexOffset + sizeof(indexCount), frameOffsets.data(), indexCount * sizeof(uint64_t));
+        TrajectoryFileHeader header = MakeHeader();
+        header.frameCount = framesWritten.load();
+        header.indexOffset = indexOffset;
+        WriteAt(0, &header, sizeof(header));
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Trajectory: " << e.what() << "\n";
+    }
+}
+
+TrajectoryFileHeader TrajectoryWriter::MakeHeader() const
+{
+    TrajectoryFileHeader header = {};
+    memcpy(header.magic, k_trajectoryMagic, sizeof(k_trajectoryMagic));
+    header.version = k_trajectoryVersion;
+    header.attributes = settings.attributes;
+    header.encoding = settings.encoding;
+    if (settings.encoding == TrajectoryEncoding::Quantized)
+    {
+        header.keyframeInterval = settings.keyframeInterval;
+        header.quantizationOrigin[0] = quantization.origin.x;
+        header.quantizationOrigin[1] = quantization.origin.y;
+        header.quantizationOrigin[2] = quantization.origin.z;
+        header.quantizationCellSize = quantization.cellSize;
+        header.temperatureMin = quantization.temperatureMin;
+        header.temperatureMax = quantization.temperatureMax;
+    }
+    return header;
+}
+
+void TrajectoryWriter::SetQuantizationGrid(const Vector3 &origin, float gridCellSize)
+{
+    if (settings.encoding != TrajectoryEncoding::Quantized)
+    {
+        return;
+    }
+    // rounding to the nearest of 2^16 steps per cube: the error is at most cube / 2^17
+    quantization.cellSize = settings.positionError > 0.0f ? settings.positionError * 131072.0f : gridCellSize;
+    // one block of margin below the grid, particles slightly outside are not clamped
+    quantization.origin = origin - Vector3(quantization.cellSize * k_trajectoryBlockCells);
+    quantization.temperatureMin = settings.temperatureMin;
+    quantization.temperatureMax = settings.temperatureMax;
+    const TrajectoryFileHeader header = MakeHeader();
+    WriteAt(0, &header, sizeof(header));
+}
+
+bool TrajectoryWriter::WaitPop(BoundedQueue<uint32_t> &queue, std::atomic<uint32_t> &signal, uint32_t &slotIndex,
+                               bool untilStopped)
+{
+    for (;;)
+    {
+        // read before trying, so a push in between changes it and the wait returns at once
+        const uint32_t seen = signal.load(std::memory_order_acquire);
+        if (queue.TryPop(slotIndex))
+        {
+            return true;
+        }
+        if (untilStopped && stopping.load())
+        {
+            return false;
+        }
+        signal.wait(seen, std::memory_order_acquire);
+    }
+}
+
+void TrajectoryWriter::Push(BoundedQueue<uint32_t> &queue, std::atomic<uint32_t> &signal, uint32_t slotIndex)
+{
+    // never full, there are as many cells as slots
+    queue.TryPush(slotIndex);
+    signal.fetch_add(1, std::memory_order_release);
+    signal.notify_one();
+}
+
+void TrajectoryWriter::Capture(ID3D12Device *device, ID3D12CommandQueue *queue, const Frame &frame,
+                               const std::vector<std::shared_ptr<StructuredBuffer>> &sources)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    uint32_t slotIndex = 0;
+    if (!freeSlots.TryPop(slotIndex))
+    {
+        // the disk does not keep up, hold the step loop until a frame is written
+        WaitPop(freeSlots, freeSignal, slotIndex, false);
+        ++stalledCaptures;
+        stalledMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    Slot &slot = slots[slotIndex];
+
+    UINT64 payloadBytes = 0;
+    uint32_t source = 0;
+    for (uint32_t attribute = 1; attribute < (1u << k_trajectoryAttributeCount); attribute <<= 1)
+    {
+        if (settings.attributes & attribute)
+        {
+            assert(source < sources.size() && sources[source]->elementStride == TrajectoryAttributeStride(attribute));
+            payloadBytes += UINT64(frame.particleCount) * TrajectoryAttributeStride(attribute);
+            ++source;
+        }
+    }
+
+    if (!fence)
+    {
+        ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(fence.put())));
+    }
+    if (!slot.allocator)
+    {
+        ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(slot.allocator.put())));
+        ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, slot.allocator.get(), nullptr,
+                                                IID_PPV_ARGS(slot.commandList.put())));
+        ThrowIfFailed(slot.commandList->Close());
+    }
+    if (payloadBytes > slot.capacity)
+    {
+        // headroom, so a growing particle count does not reallocate every frame
+        slot.capacity = payloadBytes + payloadBytes / 4;
+        slot.readback = UploadHelpers::CreateReadbackBuffer(device, slot.capacity);
+    }
+
+    // the slot came back from a writer, so the GPU is done with its previous list
+    ThrowIfFailed(slot.allocator->Reset());
+    ThrowIfFailed(slot.commandList->Reset(slot.allocator.get(), nullptr));
+    UINT64 offset = 0;
+    for (const std::shared_ptr<StructuredBuffer> &buffer : sources)
+    {
+        const UINT64 bytes = UINT64(frame.particleCount) * buffer->elementStride;
+        if (bytes > 0)
+        {
+            // promoted from COMMON to COPY_SOURCE by the copy
+            slot.commandList->CopyBufferRegion(slot.readback.get(), offset, buffer->resource.get(), 0, bytes);
+        }
+        offset += bytes;
+    }
+    ThrowIfFailed(slot.commandList->Close());
+    ID3D12CommandList *lists[] = {slot.commandList.get()};
+    queue->ExecuteCommandLists(1, lists);
+    slot.fenceValue = ++fenceValue;
+    ThrowIfFailed(queue->Signal(fence.get(), slot.fenceValue));
+
+    // the step loop may replace or grow the buffers before the copy has run
+    slot.sources = sources;
+    const uint64_t frameIndex = nextFrame++;
+    const uint64_t keyframe = settings.encoding == TrajectoryEncoding::Quantized
+                                  ? frameIndex - frameIndex % settings.keyframeInterval
+                                  : frameIndex;
+    slot.header = {frameIndex, frame.step, frame.time, frame.particleCount, settings.attributes, payloadBytes, keyframe};
+    if (frameIndex == keyframe && settings.encoding == TrajectoryEncoding::Quantized)
+    {
+        // frames are captured in order, so the keyframe opens its group
+        std::lock_guard lock(keyframeMutex);
+        keyframeGroups[keyframe / settings.keyframeInterval].framesLeft = settings.keyframeInterval;
+    }
+    Push(filledSlots, filledSignal, slotIndex);
+
+    captureStats.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+TrajectoryErrors TrajectoryWriter::Encode(const Slot &slot, const void *mapped, std::vector<uint8_t> &encoded)
+{
+    // the readback holds the attribute arrays in bit order
+    const TrajectoryFrameHeader &header = slot.header;
+    const uint8_t *cursor = static_cast<const uint8_t *>(mapped);
+    const void *arrays[k_trajectoryAttributeCount] = {};
+    for (uint32_t bit = 0; bit < k_trajectoryAttributeCount; ++bit)
+    {
+        if (settings.attributes & (1u << bit))
+        {
+            arrays[bit] = cursor;
+            cursor += uint64_t(header.particleCount) * TrajectoryAttributeStride(1u << bit);
+        }
+    }
+    TrajectoryFrameView view;
+    view.count = header.particleCount;
+    view.positions = static_cast<const Vector3 *>(arrays[0]);
+    view.velocities = static_cast<const Vector3 *>(arrays[1]);
+    view.temperatures = static_cast<const float *>(arrays[2]);
+    view.ids = static_cast<const uint32_t *>(arrays[3]);
+
+    const uint64_t group = header.keyframe / settings.keyframeInterval;
+    KeyframeGroup *keyframe = nullptr;
+    {
+        // the node stays until this frame releases it
+        std::lock_guard lock(keyframeMutex);
+        keyframe = &keyframeGroups.at(group);
+    }
+    if (header.frame == header.keyframe)
+    {
+        // no delta reads it before encoded is set
+        return EncodeTrajectoryFrame(view, settings.attributes, quantization, nullptr, &keyframe->keyframe, encoded);
+    }
+    {
+        std::unique_lock lock(keyframeMutex);
+        keyframeEncoded.wait(lock, [keyframe] { return keyframe->encoded; });
+        if (keyframe->failed)
+        {
+            throw std::runtime_error("Keyframe " + std::to_string(header.keyframe) + " of frame " +
+                                     std::to_string(header.frame) + " was not written");
+        }
+    }
+    return EncodeTrajectoryFrame(view, settings.attributes, quantization, &keyframe->keyframe, nullptr, encoded);
+}
+
+void TrajectoryWriter::ReleaseKeyframe(uint64_t group, bool isKeyframe, bool failed)
+{
+    {
+        std::lock_guard lock(keyframeMutex);
+        auto it = keyframeGroups.find(group);
+        if (it == keyframeGroups.end())
+        {
+            return;
+        }
+        if (isKeyframe)
+        {
+            it->second.encoded = true;
+            it->second.failed = failed;
+        }
+        if (--it->second.framesLeft == 0)
+        {
+            keyframeGroups.erase(it);
+        }
+    }
+    if (isKeyframe)
+    {
+        keyframeEncoded.notify_all();
+    }
+}
+
+void TrajectoryWriter::WriterLoop()
+{
+    auto raiseTo = [](std::atomic<float> &maximum, float value)
+    {
+        float current = maximum.load();
+        while (value > current && !maximum.compare_exchange_weak(current, value))
+        {
+        }
+    };
+
+    std::vector<uint8_t> encoded; // reused across frames
+    uint32_t slotIndex = 0;
+    while (WaitPop(filledSlots, filledSignal, slotIndex, true))
+    {
+        Slot &slot = slots[slotIndex];
+        const auto start = std::chrono::steady_clock::now();
+        // every frame releases its group once encoded, or when it fails, so the deltas do not
+        // wait forever and the group is erased after its last frame
+        const bool quantized = settings.encoding == TrajectoryEncoding::Quantized;
+        const bool isKeyframe = slot.header.frame == slot.header.keyframe;
+        const uint64_t group = quantized ? slot.header.keyframe / settings.keyframeInterval : 0;
+        auto releaseKeyframe = wil::scope_exit([this, quantized, isKeyframe, group]
+                                               {
+            if (quantized)
+            {
+                ReleaseKeyframe(group, isKeyframe, true);
+            } });
+        try
+        {
+            // a null event blocks until the copy is done
+            ThrowIfFailed(fence->SetEventOnCompletion(slot.fenceValue, nullptr));
+            slot.sources.clear();
+
+            const uint64_t readbackBytes = slot.header.payloadBytes;
+            void *mapped = nullptr;
+            D3D12_RANGE readRange{0, static_cast<SIZE_T>(readbackBytes)};
+            ThrowIfFailed(slot.readback->Map(0, &readRange, &mapped));
+            auto unmap = wil::scope_exit([&]
+                                         {
+                D3D12_RANGE writtenRange{0, 0};
+                slot.readback->Unmap(0, &writtenRange); });
+
+            TrajectoryFrameHeader header = slot.header;
+            const void *payload = mapped;
+            if (settings.encoding == TrajectoryEncoding::Quantized)
+            {
+                const auto encodeStart = std::chrono::steady_clock::now();
+                const TrajectoryErrors errors = Encode(slot, mapped, encoded);
+                releaseKeyframe.release();
+                ReleaseKeyframe(group, isKeyframe, false);
+                encodeNanoseconds.fetch_add(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - encodeStart).count()));
+                header.payloadBytes = encoded.size();
+                header.positionError = errors.position;
+                header.temperatureError = errors.temperature;
+                raiseTo(maxPositionError, errors.position);
+                raiseTo(maxTemperatureError, errors.temperature);
+                payload = encoded.data();
+            }
+
+            const uint64_t recordBytes = sizeof(TrajectoryFrameHeader) + header.payloadBytes;
+            const uint64_t offset = fileEnd.fetch_add(recordBytes);
+            WriteAt(offset, &header, sizeof(TrajectoryFrameHeader));
+            WriteAt(offset + sizeof(TrajectoryFrameHeader), payload, header.payloadBytes);
+            {
+                std::lock_guard lock(indexMutex);
+                if (header.frame >= frameOffsets.size())
+                {
+                    frameOffsets.resize(header.frame + 1, 0);
+                }
+                frameOffsets[header.frame] = offset;
+            }
+            framesWritten.fetch_add(1);
+            bytesWritten.fetch_add(recordBytes);
+            rawBytes.fetch_add(sizeof(TrajectoryFrameHeader) + readbackBytes);
+        }
+        catch (const std::exception &e)
+        {
+            std::lock_guard lock(errorMutex);
+            if (firstError.empty())
+            {
+                firstError = e.what();
+            }
+        }
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        writeNanoseconds.fetch_add(static_cast<uint64_t>(ns));
+        Push(freeSlots, freeSignal, slotIndex);
+    }
+}
+
+void TrajectoryWriter::WriteAt(uint64_t offset, const void *data, uint64_t bytes)
+{
+    // positioned writes, so the writer threads need no shared file pointer
+    const uint8_t *cursor = static_cast<const uint8_t *>(data);
+    while (bytes > 0)
+    {
+        const DWORD chunk = static_cast<DWORD>(std::min<uint64_t>(bytes, 1u << 30));
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD written = 0;
+        if (!WriteFile(file.get(), cursor, chunk, &written, &overlapped) || written != chunk)
+        {
+            throw std::runtime_error("Cannot write " + settings.path.string());
+        }
+        cursor += chunk;
+        offset += chunk;
+        bytes -= chunk;
+    }
+}
+
+void TrajectoryWriter::PrintReport(std::ostream &os) const
+{
+    const uint64_t frames = framesWritten.load();
+    const double writeMs = writeNanoseconds.load() * 1e-6;
+    os << "\n=== Trajectory ===\n";
+    os << "File             : " << settings.path.string() << ", every " << settings.interval << " frame(s)\n";
+    os << "Frames written   : " << frames << ", " << bytesWritten.load() / (1024.0 * 1024.0) << " MiB\n";
+    if (settings.encoding == TrajectoryEncoding::Quantized)
+    {
+        os << "Encoding         : 16-bit in " << quantization.cellSize << " m cubes, keyframe every "
+           << settings.keyframeInterval << " frames\n";
+        if (bytesWritten.load() > 0)
+        {
+            os << "Compression      : " << rawBytes.load() / (1024.0 * 1024.0) << " MiB raw, "
+               << double(rawBytes.load()) / bytesWritten.load() << "x\n";
+        }
+        if (frames > 0)
+        {
+            os << "Encode avg       : " << encodeNanoseconds.load() * 1e-6 / frames << " ms per frame\n";
+        }
+        // the bounds hold for particles inside the quantized range and temperature range
+        os << "Max error        : position " << maxPositionError.load() << " m (bound "
+           << quantization.GetPositionStep() / 2.0 << "), temperature " << maxTemperatureError.load() << " K (bound "
+           << quantization.GetTemperatureStep() / 2.0 << ")\n";
+    }
+    os << "Capture avg      : " << captureStats.average() * 1000.0 << " us on the step loop\n";
+    os << "Backpressure     : " << stalledCaptures << " captures waited, " << stalledMs << " ms total ("
+       << settings.slots << " slots)\n";
+    if (frames > 0 && writeMs > 0.0)
+    {
+        os << "Write avg        : " << writeMs / frames << " ms per frame, "
+           << bytesWritten.load() / (1024.0 * 1024.0) / (writeMs / 1000.0) * settings.threads << " MiB/s over "
+           << settings.threads << " threads\n";
+    }
+    std::lock_guard lock(errorMutex);
+    if (!firstError.empty())
+    {
+        os << "Write error      : " << firstError << "\n";
+    }
+    os << "==================\n";
+}
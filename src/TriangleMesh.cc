@@ -0,0 +1,115 @@
+#include "pch.h"
+
+#include "framework/TriangleMesh.h"
+
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+namespace
+{
+std::string_view NextToken(std::string_view &line)
+{
+    const size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos)
+    {
+        line = {};
+        return {};
+    }
+    const size_t end = line.find_first_of(" \t\r", start);
+    std::string_view token = line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+    line = end == std::string_view::npos ? std::string_view() : line.substr(end);
+    return token;
+}
+
+template <typename T>
+T ParseObjNumber(std::string_view token, const std::filesystem::path &path, size_t lineNumber)
+{
+    T value = {};
+    auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (token.empty() || ec != std::errc())
+    {
+        throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": bad number '" + std::string(token) + "'");
+    }
+    return value;
+}
+}
+
+TriangleMesh TriangleMesh::LoadObj(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot open " + path.string());
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+
+    TriangleMesh mesh;
+    std::vector<uint32_t> polygon;
+    size_t lineNumber = 0;
+    size_t lineStart = 0;
+    while (lineStart < text.size())
+    {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+        {
+            lineEnd = text.size();
+        }
+        std::string_view line(text.data() + lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        ++lineNumber;
+
+        const std::string_view record = NextToken(line);
+        if (record == "v")
+        {
+            Vector3 v;
+            v.x = ParseObjNumber<float>(NextToken(line), path, lineNumber);
+            v.y = ParseObjNumber<float>(NextToken(line), path, lineNumber);
+            v.z = ParseObjNumber<float>(NextToken(line), path, lineNumber);
+            mesh.vertices.push_back(v);
+        }
+        else if (record == "f")
+        {
+            // v, v/vt, v//vn or v/vt/vn, only the position index is used
+            polygon.clear();
+            for (std::string_view corner = NextToken(line); !corner.empty(); corner = NextToken(line))
+            {
+                const int64_t index = ParseObjNumber<int64_t>(corner.substr(0, corner.find('/')), path, lineNumber);
+                const int64_t resolved = index < 0 ? int64_t(mesh.vertices.size()) + index : index - 1;
+                if (resolved < 0 || resolved >= int64_t(mesh.vertices.size()))
+                {
+                    throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": vertex index out of range");
+                }
+                polygon.push_back(static_cast<uint32_t>(resolved));
+            }
+            for (size_t i = 2; i < polygon.size(); ++i)
+            {
+                mesh.indices.insert(mesh.indices.end(), {polygon[0], polygon[i - 1], polygon[i]});
+            }
+        }
+    }
+
+    if (mesh.indices.empty())
+    {
+        throw std::runtime_error("No faces in " + path.string());
+    }
+    return mesh;
+}
+
+void TriangleMesh::Append(const TriangleMesh &other, float scale, const Vector3 &offset)
+{
+    const uint32_t base = static_cast<uint32_t>(vertices.size());
+    vertices.reserve(vertices.size() + other.vertices.size());
+    for (const Vector3 &v : other.vertices)
+    {
+        vertices.push_back(v * scale + offset);
+    }
+    indices.reserve(indices.size() + other.indices.size());
+    for (uint32_t index : other.indices)
+    {
+        indices.push_back(base + index);
+    }
+}
@@ -47,4 +47,53 @@ namespace UploadHelpers
             after);
         cmdList->ResourceBarrier(1, &toAfter);
     }
+
+    winrt::com_ptr<ID3D12Resource> CreateReadbackBuffer(ID3D12Device *device, UINT64 size)
+    {
+        CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_READBACK);
+        CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+        winrt::com_ptr<ID3D12Resource> readback;
+        ThrowIfFailed(device->CreateCommittedResource(
+            &heapProps,
+            D3D12_HEAP_FLAG_NONE,
+            &desc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(readback.put())));
+
+        return readback;
+    }
+
+    void CopyResourceToReadback(
+        ID3D12GraphicsCommandList *cmdList,
+        ID3D12Resource *srcResource,
+        ID3D12Resource *readbackResource,
+        UINT64 size,
+        D3D12_RESOURCE_STATES state)
+    {
+        CD3DX12_RESOURCE_BARRIER toCopy = CD3DX12_RESOURCE_BARRIER::Transition(
+            srcResource,
+            state,
+            D3D12_RESOURCE_STATE_COPY_SOURCE);
+        cmdList->ResourceBarrier(1, &toCopy);
+
+        cmdList->CopyBufferRegion(readbackResource, 0, srcResource, 0, size);
+
+        CD3DX12_RESOURCE_BARRIER toAfter = CD3DX12_RESOURCE_BARRIER::Transition(
+            srcResource,
+            D3D12_RESOURCE_STATE_COPY_SOURCE,
+            state);
+        cmdList->ResourceBarrier(1, &toAfter);
+    }
+
+    void ReadbackToHost(ID3D12Resource *readbackResource, void *dst, UINT64 size)
+    {
+        D3D12_RANGE readRange{0, static_cast<SIZE_T>(size)};
+        void *pData = nullptr;
+        ThrowIfFailed(readbackResource->Map(0, &readRange, &pData));
+        memcpy(dst, pData, static_cast<size_t>(size));
+        D3D12_RANGE writeRange{0, 0};
+        readbackResource->Unmap(0, &writeRange);
+    }
 }
@@ -0,0 +1,333 @@
+#include "pch.h"
+
+#include "framework/TrajectoryReader.h"
+
+#include <fstream>
+#include <map>
+
+// Encode -> decode round trips of the quantized trajectory format, without the simulation:
+//   TrajectoryCodecCheck [scratch directory]
+// Covers empty frames, packed groups at the full 32-bit width, ids the keyframe does not
+// have, positions clamped to the grid, decoded errors within the reported bounds, and box
+// reads through TrajectoryReader against full reads. Prints every failed check and exits
+// with 1 if there was one.
+
+static int failures = 0;
+
+static void Check(bool ok, const std::string &what)
+{
+	if (!ok)
+	{
+		std::cout << "FAILED: " << what << "\n";
+		++failures;
+	}
+}
+
+constexpr uint32_t k_attributes = TrajectoryPosition | TrajectoryVelocity | TrajectoryTemperature | TrajectoryParticleId;
+
+struct Frame
+{
+	std::vector<Vector3> positions;
+	std::vector<Vector3> velocities;
+	std::vector<float> temperatures;
+	std::vector<uint32_t> ids;
+
+	void Add(uint32_t id, const Vector3 &position, const Vector3 &velocity, float temperature)
+	{
+		ids.push_back(id);
+		positions.push_back(position);
+		velocities.push_back(velocity);
+		temperatures.push_back(temperature);
+	}
+
+	TrajectoryFrameView View() const
+	{
+		return {static_cast<uint32_t>(ids.size()), positions.data(), velocities.data(), temperatures.data(), ids.data()};
+	}
+};
+
+static TrajectoryQuantization MakeQuantization()
+{
+	TrajectoryQuantization quantization;
+	quantization.origin = Vector3(-1.0f);
+	quantization.cellSize = 0.01f; // 655.36 m of grid per axis
+	quantization.temperatureMin = 300.0f;
+	quantization.temperatureMax = 1500.0f;
+	return quantization;
+}
+
+// Even ids in a 2 m cube, plus particles below and beyond the grid and a temperature above
+// the range, which are all clamped.
+static Frame MakeKeyframe(std::mt19937 &rng)
+{
+	std::uniform_real_distribution<float> position(0.0f, 2.0f);
+	std::uniform_real_distribution<float> velocity(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> temperature(400.0f, 1400.0f);
+	Frame frame;
+	for (uint32_t id = 0; id < 2000; id += 2)
+	{
+		frame.Add(id, Vector3(position(rng), position(rng), position(rng)), Vector3(velocity(rng)), temperature(rng));
+	}
+	frame.Add(5000, Vector3(-3.0f), Vector3::Zero, 1000.0f);
+	frame.Add(5001, Vector3(700.0f, 0.5f, 0.5f), Vector3::Zero, 1000.0f);
+	frame.Add(5002, Vector3(0.5f), Vector3::Zero, 2000.0f);
+	return frame;
+}
+
+// Drops every tenth keyframe particle, moves the rest a little, adds odd ids and ids above
+// the keyframe's largest, and moves particle 5000 from the clamped grid origin to more than
+// 2^31 position steps away, so its delta needs all 32 bits.
+static Frame MakeDeltaFrame(const Frame &keyframe, std::mt19937 &rng)
+{
+	std::uniform_real_distribution<float> move(-0.01f, 0.01f);
+	std::uniform_real_distribution<float> position(0.0f, 2.0f);
+	Frame frame;
+	for (size_t i = 0; i < keyframe.ids.size(); ++i)
+	{
+		const uint32_t id = keyframe.ids[i];
+		if (id == 5000)
+		{
+			frame.Add(id, Vector3(329.5f, 0.5f, 0.5f), Vector3::Zero, 900.0f);
+		}
+		else if (id % 20 != 10)
+		{
+			frame.Add(id, keyframe.positions[i] + Vector3(move(rng), move(rng), move(rng)), keyframe.velocities[i],
+					  keyframe.temperatures[i] - 5.0f);
+		}
+	}
+	for (uint32_t id = 1; id < 100; id += 2)
+	{
+		frame.Add(id, Vector3(position(rng), position(rng), position(rng)), Vector3(1.0f), 1200.0f);
+	}
+	for (uint32_t id = 6000; id < 6010; ++id)
+	{
+		frame.Add(id, Vector3(position(rng), position(rng), position(rng)), Vector3(-1.0f), 350.0f);
+	}
+	return frame;
+}
+
+// decoded particles against the frame they were encoded from, matched by id
+static void CheckDecoded(const Frame &frame, const TrajectoryParticles &decoded, const TrajectoryErrors &errors,
+						 const std::string &name)
+{
+	Check(decoded.GetCount() == frame.ids.size(), name + ": particle count");
+	std::map<uint32_t, size_t> indexOfId;
+	for (size_t i = 0; i < frame.ids.size(); ++i)
+	{
+		indexOfId[frame.ids[i]] = i;
+	}
+
+	float positionError = 0.0f;
+	float temperatureError = 0.0f;
+	bool idsMatch = decoded.ids.size() == frame.ids.size();
+	bool velocitiesMatch = true;
+	for (size_t k = 0; k < decoded.ids.size(); ++k)
+	{
+		const auto it = indexOfId.find(decoded.ids[k]);
+		if (it == indexOfId.end())
+		{
+			idsMatch = false;
+			continue;
+		}
+		const size_t i = it->second;
+		const Vector3 d = decoded.positions[k] - frame.positions[i];
+		positionError = std::max({positionError, std::abs(d.x), std::abs(d.y), std::abs(d.z)});
+		temperatureError = std::max(temperatureError, std::abs(decoded.temperatures[k] - frame.temperatures[i]));
+		velocitiesMatch = velocitiesMatch && memcmp(&decoded.velocities[k], &frame.velocities[i], sizeof(Vector3)) == 0;
+		indexOfId.erase(it);
+	}
+	Check(idsMatch && indexOfId.empty(), name + ": ids");
+	Check(velocitiesMatch, name + ": velocities");
+	Check(positionError <= errors.position,
+		  name + ": position error " + std::to_string(positionError) + " above reported " + std::to_string(errors.position));
+	Check(temperatureError <= errors.temperature, name + ": temperature error " + std::to_string(temperatureError) +
+													  " above reported " + std::to_string(errors.temperature));
+}
+
+// width byte of the first x group of every block
+static std::vector<uint32_t> GetFirstXWidths(const std::vector<uint8_t> &payload)
+{
+	std::vector<uint32_t> widths;
+	for (const TrajectoryBlockEntry &block : ReadTrajectoryBlockTable(payload.data(), payload.size()))
+	{
+		const uint8_t *data = payload.data() + block.offset;
+		size_t pos = sizeof(uint32_t) + sizeof(TrajectoryCellEntry) * block.cellCount;
+		uint32_t length = 0;
+		memcpy(&length, data + pos, sizeof(length));
+		pos += sizeof(length) + length;
+		memcpy(&length, data + pos, sizeof(length));
+		pos += sizeof(length);
+		widths.push_back(length > 0 ? data[pos] : 0);
+	}
+	return widths;
+}
+
+static bool SameKeyframe(const TrajectoryKeyframe &a, const TrajectoryKeyframe &b)
+{
+	return a.indexOfId == b.indexOfId && a.q[0] == b.q[0] && a.q[1] == b.q[1] && a.q[2] == b.q[2] &&
+		   a.temperature == b.temperature;
+}
+
+static bool SameParticles(const TrajectoryParticles &a, const TrajectoryParticles &b)
+{
+	auto same = [](const auto &x, const auto &y)
+	{ return x.size() == y.size() && (x.empty() || memcmp(x.data(), y.data(), x.size() * sizeof(x[0])) == 0); };
+	return same(a.positions, b.positions) && same(a.velocities, b.velocities) && same(a.temperatures, b.temperatures) &&
+		   same(a.ids, b.ids);
+}
+
+struct EncodedFrame
+{
+	std::vector<uint8_t> payload;
+	TrajectoryErrors errors;
+	uint32_t count = 0;
+	uint64_t keyframe = 0;
+};
+
+// the frames as a closed quantized file: header, records, offset table
+static void WriteFile(const std::filesystem::path &path, const TrajectoryQuantization &quantization,
+					  const std::vector<EncodedFrame> &frames)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		throw std::runtime_error("Cannot create " + path.string());
+	}
+	TrajectoryFileHeader header = {};
+	memcpy(header.magic, k_trajectoryMagic, sizeof(header.magic));
+	header.version = k_trajectoryVersion;
+	header.attributes = k_attributes;
+	header.frameCount = frames.size();
+	header.encoding = TrajectoryEncoding::Quantized;
+	header.keyframeInterval = static_cast<uint32_t>(frames.size());
+	header.quantizationOrigin[0] = quantization.origin.x;
+	header.quantizationOrigin[1] = quantization.origin.y;
+	header.quantizationOrigin[2] = quantization.origin.z;
+	header.quantizationCellSize = quantization.cellSize;
+	header.temperatureMin = quantization.temperatureMin;
+	header.temperatureMax = quantization.temperatureMax;
+
+	std::vector<uint64_t> offsets;
+	uint64_t offset = sizeof(header);
+	for (const EncodedFrame &frame : frames)
+	{
+		offsets.push_back(offset);
+		offset += sizeof(TrajectoryFrameHeader) + frame.payload.size();
+	}
+	header.indexOffset = offset;
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	for (size_t f = 0; f < frames.size(); ++f)
+	{
+		TrajectoryFrameHeader frameHeader = {};
+		frameHeader.frame = f;
+		frameHeader.step = f;
+		frameHeader.particleCount = frames[f].count;
+		frameHeader.attributes = k_attributes;
+		frameHeader.payloadBytes = frames[f].payload.size();
+		frameHeader.keyframe = frames[f].keyframe;
+		frameHeader.positionError = frames[f].errors.position;
+		frameHeader.temperatureError = frames[f].errors.temperature;
+		file.write(reinterpret_cast<const char *>(&frameHeader), sizeof(frameHeader));
+		file.write(reinterpret_cast<const char *>(frames[f].payload.data()), frames[f].payload.size());
+	}
+	const uint64_t count = offsets.size();
+	file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+	file.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+}
+
+int main(int argc, char **argv)
+{
+	const std::filesystem::path scratch = argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::temp_directory_path();
+	const std::filesystem::path path = scratch / "TrajectoryCodecCheck.lavatraj";
+
+	try
+	{
+		const TrajectoryQuantization quantization = MakeQuantization();
+		std::mt19937 rng(7);
+		const Frame keyframe = MakeKeyframe(rng);
+		const Frame delta = MakeDeltaFrame(keyframe, rng);
+		const Frame empty;
+
+		// keyframe
+		EncodedFrame encodedKeyframe;
+		TrajectoryKeyframe encoderKeyframe;
+		encodedKeyframe.errors = EncodeTrajectoryFrame(keyframe.View(), k_attributes, quantization, nullptr,
+													   &encoderKeyframe, encodedKeyframe.payload);
+		encodedKeyframe.count = static_cast<uint32_t>(keyframe.ids.size());
+		TrajectoryKeyframe decoderKeyframe;
+		TrajectoryParticles decoded;
+		DecodeTrajectoryFrame(encodedKeyframe.payload.data(), encodedKeyframe.payload.size(), k_attributes, quantization,
+							  nullptr, &decoderKeyframe, decoded);
+		CheckDecoded(keyframe, decoded, encodedKeyframe.errors, "keyframe");
+		Check(SameKeyframe(encoderKeyframe, decoderKeyframe), "keyframe: decoded reference differs from the encoder's");
+
+		// clamped particles end on the grid border, and the reported error covers the clamp
+		for (size_t k = 0; k < decoded.ids.size(); ++k)
+		{
+			if (decoded.ids[k] == 5000)
+			{
+				Check(decoded.positions[k] == quantization.origin, "keyframe: particle below the grid not clamped to the origin");
+			}
+		}
+		Check(encodedKeyframe.errors.position >= 2.0f, "keyframe: clamped position error not reported");
+		Check(encodedKeyframe.errors.temperature >= 500.0f, "keyframe: clamped temperature error not reported");
+
+		// delta frame against the keyframe the reader would decode
+		EncodedFrame encodedDelta;
+		encodedDelta.errors = EncodeTrajectoryFrame(delta.View(), k_attributes, quantization, &encoderKeyframe, nullptr,
+													encodedDelta.payload);
+		encodedDelta.count = static_cast<uint32_t>(delta.ids.size());
+		DecodeTrajectoryFrame(encodedDelta.payload.data(), encodedDelta.payload.size(), k_attributes, quantization,
+							  &decoderKeyframe, nullptr, decoded);
+		CheckDecoded(delta, decoded, encodedDelta.errors, "delta frame");
+		const std::vector<uint32_t> widths = GetFirstXWidths(encodedDelta.payload);
+		Check(std::find(widths.begin(), widths.end(), 32u) != widths.end(), "delta frame: no 32-bit group was encoded");
+
+		// empty frames, as a keyframe and as a delta
+		EncodedFrame encodedEmpty;
+		TrajectoryKeyframe emptyKeyframe;
+		encodedEmpty.errors = EncodeTrajectoryFrame(empty.View(), k_attributes, quantization, nullptr, &emptyKeyframe,
+													encodedEmpty.payload);
+		DecodeTrajectoryFrame(encodedEmpty.payload.data(), encodedEmpty.payload.size(), k_attributes, quantization,
+							  nullptr, nullptr, decoded);
+		CheckDecoded(empty, decoded, encodedEmpty.errors, "empty keyframe");
+		encodedEmpty.errors = EncodeTrajectoryFrame(empty.View(), k_attributes, quantization, &encoderKeyframe, nullptr,
+													encodedEmpty.payload);
+		DecodeTrajectoryFrame(encodedEmpty.payload.data(), encodedEmpty.payload.size(), k_attributes, quantization,
+							  &decoderKeyframe, nullptr, decoded);
+		CheckDecoded(empty, decoded, encodedEmpty.errors, "empty delta frame");
+
+		// box reads through the file reader against full reads
+		WriteFile(path, quantization, {encodedKeyframe, encodedDelta, encodedEmpty});
+		{
+			TrajectoryReader reader(path);
+			const Vector3 boxMin(-0.5f, 0.25f, -0.5f);
+			const Vector3 boxMax(1.0f, 1.2f, 0.7f);
+			for (uint64_t frame = 0; frame < reader.GetFrameCount(); ++frame)
+			{
+				const std::string name = "file frame " + std::to_string(frame);
+				TrajectoryParticles full;
+				reader.ReadFrame(frame, full);
+				const TrajectoryFrameHeader header = reader.GetFrameHeader(frame);
+				Check(full.GetCount() == header.particleCount, name + ": particle count");
+				full.KeepInside(boxMin, boxMax);
+
+				TrajectoryParticles box;
+				reader.ReadFrame(frame, boxMin, boxMax, box);
+				Check(SameParticles(full, box), name + ": box read differs from a full read and KeepInside");
+				const TrajectoryReader::ReadStats &stats = reader.GetLastReadStats();
+				Check(header.particleCount == 0 || stats.blocksDecoded < stats.blocksTotal, name + ": box read decoded every block");
+			}
+		}
+		std::filesystem::remove(path);
+	}
+	catch (const std::exception &e)
+	{
+		std::cout << "FAILED: " << e.what() << "\n";
+		return 1;
+	}
+
+	std::cout << (failures == 0 ? "All trajectory codec checks passed\n" : std::to_string(failures) + " checks failed\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+
+#include "pch.h"
+
+#include "framework/TrajectoryReader.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <string_view>
+
+// Reads a trajectory file without the simulation:
+//   TrajectoryQuery file                                    summary of the file
+//   TrajectoryQuery file --frame N [--box x0 y0 z0 x1 y1 z1] [--csv out.csv]
+// prints statistics of one frame, optionally only of the particles inside the box, and
+// writes them as CSV.
+
+static void PrintSummary(const TrajectoryReader &reader)
+{
+	const TrajectoryFileHeader &header = reader.GetHeader();
+	std::cout << "Version          : " << header.version << "\n";
+	std::cout << "Attributes       : " << (header.attributes & TrajectoryPosition ? "p" : "")
+			  << (header.attributes & TrajectoryVelocity ? "v" : "") << (header.attributes & TrajectoryTemperature ? "t" : "")
+			  << (header.attributes & TrajectoryParticleId ? "i" : "") << "\n";
+	if (header.encoding == TrajectoryEncoding::Quantized)
+	{
+		const TrajectoryQuantization &quantization = reader.GetQuantization();
+		std::cout << "Encoding         : quantized, " << quantization.cellSize << " m cubes, keyframe every "
+				  << header.keyframeInterval << " frames\n";
+	}
+	else
+	{
+		std::cout << "Encoding         : raw\n";
+	}
+	std::cout << "Frames           : " << reader.GetFrameCount()
+			  << (reader.IsIndexed() ? "" : " (file not closed, records scanned)") << "\n";
+
+	uint64_t first = 0;
+	while (first < reader.GetFrameCount() && !reader.HasFrame(first))
+	{
+		++first;
+	}
+	uint64_t last = reader.GetFrameCount();
+	while (last > first && !reader.HasFrame(last - 1))
+	{
+		--last;
+	}
+	if (first < last)
+	{
+		const TrajectoryFrameHeader begin = reader.GetFrameHeader(first);
+		const TrajectoryFrameHeader end = reader.GetFrameHeader(last - 1);
+		std::cout << "Steps            : " << begin.step << " to " << end.step << ", " << begin.time << " s to "
+				  << end.time << " s\n";
+		std::cout << "Particles        : " << begin.particleCount << " to " << end.particleCount << "\n";
+	}
+}
+
+static void WriteCsv(const std::filesystem::path &path, const TrajectoryParticles &particles)
+{
+	std::ofstream csv(path);
+	if (!csv)
+	{
+		throw std::runtime_error("Cannot create " + path.string());
+	}
+	// columns of the attributes in the file
+	std::string columns;
+	columns += particles.ids.empty() ? "" : ",id";
+	columns += particles.positions.empty() ? "" : ",x,y,z";
+	columns += particles.velocities.empty() ? "" : ",vx,vy,vz";
+	columns += particles.temperatures.empty() ? "" : ",temperature";
+	csv << std::string_view(columns).substr(1) << "\n";
+	for (size_t i = 0; i < particles.GetCount(); ++i)
+	{
+		const char *separator = "";
+		if (!particles.ids.empty())
+		{
+			csv << particles.ids[i];
+			separator = ",";
+		}
+		if (!particles.positions.empty())
+		{
+			const Vector3 &p = particles.positions[i];
+			csv << separator << p.x << "," << p.y << "," << p.z;
+			separator = ",";
+		}
+		if (!particles.velocities.empty())
+		{
+			const Vector3 &v = particles.velocities[i];
+			csv << separator << v.x << "," << v.y << "," << v.z;
+			separator = ",";
+		}
+		if (!particles.temperatures.empty())
+		{
+			csv << separator << particles.temperatures[i];
+		}
+		csv << "\n";
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: TrajectoryQuery file [--frame N] [--box x0 y0 z0 x1 y1 z1] [--csv out.csv]\n";
+		return 1;
+	}
+
+	int64_t frame = -1;
+	bool useBox = false;
+	Vector3 boxMin, boxMax;
+	std::string csvPath;
+	for (int i = 2; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--frame" && hasValue)
+		{
+			frame = std::atoll(argv[++i]);
+		}
+		else if (arg == "--box" && i + 6 < argc)
+		{
+			useBox = true;
+			boxMin.x = static_cast<float>(std::atof(argv[++i]));
+			boxMin.y = static_cast<float>(std::atof(argv[++i]));
+			boxMin.z = static_cast<float>(std::atof(argv[++i]));
+			boxMax.x = static_cast<float>(std::atof(argv[++i]));
+			boxMax.y = static_cast<float>(std::atof(argv[++i]));
+			boxMax.z = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "--csv" && hasValue)
+		{
+			csvPath = argv[++i];
+		}
+	}
+
+	try
+	{
+		TrajectoryReader reader(argv[1]);
+		if (frame < 0)
+		{
+			PrintSummary(reader);
+			return 0;
+		}
+
+		const TrajectoryFrameHeader header = reader.GetFrameHeader(static_cast<uint64_t>(frame));
+		TrajectoryParticles particles;
+		const auto start = std::chrono::steady_clock::now();
+		if (useBox)
+		{
+			reader.ReadFrame(header.frame, boxMin, boxMax, particles);
+		}
+		else
+		{
+			reader.ReadFrame(header.frame, particles);
+		}
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		const TrajectoryReader::ReadStats &stats = reader.GetLastReadStats();
+		std::cout << "Frame            : " << header.frame << ", step " << header.step << ", " << header.time << " s\n";
+		std::cout << "Particles        : " << particles.GetCount() << " of " << header.particleCount << "\n";
+		std::cout << "Read             : " << ms << " ms";
+		if (reader.GetHeader().encoding == TrajectoryEncoding::Quantized)
+		{
+			std::cout << ", " << stats.blocksDecoded << " of " << stats.blocksTotal << " blocks"
+					  << (stats.keyframeDecoded ? ", keyframe " + std::to_string(header.keyframe) + " decoded first" : "");
+			std::cout << "\nMax error        : position " << header.positionError << " m, temperature "
+					  << header.temperatureError << " K";
+		}
+		std::cout << "\n";
+
+		if (!particles.positions.empty())
+		{
+			Vector3 low = particles.positions[0];
+			Vector3 high = low;
+			for (const Vector3 &p : particles.positions)
+			{
+				low = Vector3::Min(low, p);
+				high = Vector3::Max(high, p);
+			}
+			std::cout << "Bounds           : (" << low.x << ", " << low.y << ", " << low.z << ") to (" << high.x << ", "
+					  << high.y << ", " << high.z << ")\n";
+		}
+		if (!particles.temperatures.empty())
+		{
+			const auto [coldest, hottest] = std::minmax_element(particles.temperatures.begin(), particles.temperatures.end());
+			const double mean = std::accumulate(particles.temperatures.begin(), particles.temperatures.end(), 0.0) /
+								particles.temperatures.size();
+			std::cout << "Temperature      : mean " << mean << " K, " << *coldest << " to " << *hottest << " K\n";
+		}
+		if (!csvPath.empty())
+		{
+			WriteCsv(csvPath, particles);
+		}
+	}
+	catch (const std::exception &e)
+	{
+		std::cout << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}